@@ -7,7 +7,11 @@
  *
  * This header handles communicating between this board and the Pi.
  *
- * It will receive messages using the ThreadX queue functions, and then send that data over UART to the Pi.
+ * Messages are framed with COBS and a CRC in both directions (see PiFraming.h). Received messages are decoded in
+ * place in the receive ring and handed to the state machine as views (pi_comms_rx_peek()), a PiCommHeader followed
+ * by the payload, until released (pi_comms_rx_release()).
+ *
+ * Transmissions never block: messages are queued and sent by DMA in the background (see PiCommsTX.c).
  *
  * Other threads (e.g., GPS collection) should feed the data into this thread (from the queue), and then this thread will do the UART transmission to the Pi.
 
@@ -22,6 +26,14 @@
 #include "tx_api.h"
 #include <stdint.h>
 #include "Recovery Inc/GPS.h"
+#include "Recovery Inc/Geofence.h"
+#include "Recovery Inc/GpsReplay.h"
+#include "Comms Inc/PiFraming.h"
+#include "Comms Inc/PiGpsForward.h"
+#include "Comms Inc/PiLink.h"
+#include "Comms Inc/PiStatus.h"
+#include "Comms Inc/PiTelemetry.h"
+#include "Lib Inc/time_service.h"
 
 /*** MACROS ******************************************************************/
 
@@ -55,8 +67,16 @@
 
 #define GPS_TX_MESSAGE_SIZE (sizeof(GPS_TX_Message))
 
-#define PI_COMM_RX_BUFFER_COUNT 16
-#define PI_COMM_RX_BUFFER_SIZE  (4 + 256)
+//Receive ring (circular DMA) and messages it can hold for the state machine
+#define PI_COMM_RX_RING_SIZE    4096
+#define PI_COMM_RX_QUEUE_COUNT  16
+
+//Event log chunks sent at once (each holds a transmit buffer until sent)
+#define PI_COMMS_LOG_READ_MAX_CHUNKS 8
+
+//Transmit queue: messages waiting to be sent and largest payload copied into a message
+#define PI_COMMS_TX_BLOCK_COUNT 16
+#define PI_COMMS_TX_INLINE_SIZE 64
 
 /*** TYPE DEFINITIONS ********************************************************/
 
@@ -71,7 +91,10 @@ typedef enum pi_comms_message_id_e {
     PI_COMM_MSG_GPS_PACKET   = 0x10, //rec --> pi: raw gps packet
     PI_COMM_MSG_APRS_MESSAGE,
     PI_COMM_PING,
-    PI_COMM_PONG,
+    PI_COMM_PONG,                       //rec --> pi: carries a Timestamp
+    PI_COMM_MSG_GPS_BATCH,              // 0x14, rec --> pi: several gps sentences (see PiGpsForward.h)
+    PI_COMM_MSG_TELEMETRY,              // 0x15, rec --> pi: periodic PiTelemetryPkt (see PiTelemetry.h)
+    PI_COMM_MSG_ERROR,                  // 0x16, rec --> pi: PiCommErrorPkt, a message without a reply of its own was rejected
 
     /* recovery configuration */
     PI_COMM_MSG_CONFIG_CRITICAL_VOLTAGE = 0x20,
@@ -83,9 +106,49 @@ typedef enum pi_comms_message_id_e {
     PI_COMM_MSG_CONFIG_MSG_RCPT_CALLSIGN,
     PI_COMM_MSG_CONFIG_MSG_RCPT_SSID,
     PI_COMM_MSG_CONFIG_HOSTNAME,
+    PI_COMM_MSG_CONFIG_GPS_FIX_GATE,    // 0x29,
+    PI_COMM_MSG_CONFIG_GEOFENCE_CLEAR,  // 0x2A, removes all geofence regions
+    PI_COMM_MSG_CONFIG_GEOFENCE_REGION, // 0x2B, loads one geofence region (see Geofence.h)
+    PI_COMM_MSG_CONFIG_UTC_TIME,        // 0x2C, current UTC time, used until GPS time is available
+    PI_COMM_MSG_CONFIG_GPS_CONTINUOUS,  // 0x2D, u8: 1 keeps the GPS on between beacons (e.g. for logging), 0 duty cycles it
+    PI_COMM_MSG_CONFIG_GPS_FORWARD,     // 0x2E, decimation of each forwarded sentence type (see PiGpsForward.h)
+    PI_COMM_MSG_CONFIG_TELEMETRY_PERIOD,// 0x2F, u16 seconds between telemetry messages, 0 stops them
+
+    /* gps assistance data (see GpsAssist.h) */
+    PI_COMM_MSG_MGA_BEGIN               = 0x30, //pi --> rec: start of an assistance data transfer
+    PI_COMM_MSG_MGA_CHUNK,              // 0x31, pi --> rec: offset + data
+    PI_COMM_MSG_MGA_END,                // 0x32, pi --> rec: end of transfer, validate and store
+    PI_COMM_MSG_MGA_ACK,                // 0x33, rec --> pi: status + next expected offset
+
+    /* gps replay (see GpsReplay.h) */
+    PI_COMM_MSG_GPS_REPLAY_BEGIN        = 0x38, //pi --> rec: u8 pacing (GpsReplayPacing), powers the receiver off
+    PI_COMM_MSG_GPS_REPLAY_DATA,        // 0x39, pi --> rec: offset_ms + recorded NMEA/UBX bytes
+    PI_COMM_MSG_GPS_REPLAY_END,         // 0x3A, pi --> rec: ends the replay
+    PI_COMM_MSG_GPS_REPLAY_ACK,         // 0x3B, rec --> pi: status + free chunk slots + statistics
     
-    /* recovery query */
+    /* recovery query, each answered by a PI_COMM_MSG_STATUS (see PiStatus.h) */
     PI_COMM_MSG_QUERY_STATE             = 0x40,
+    PI_COMM_MSG_QUERY_SNAPSHOT,         // 0x41, state, configuration, last fix, battery, counters and uptime
+    PI_COMM_MSG_QUERY_FIELDS,           // 0x42, pi --> rec: list of PiStatusTag to return
+    PI_COMM_MSG_STATUS                  = 0x48, //rec --> pi: TLV list of PiStatusTag fields
+
+    /* KISS TNC (see Kiss.h) */
+    PI_COMM_MSG_KISS                    = 0x50, //pi --> rec: piece of a KISS byte stream
+
+    /* firmware update (see fw_update.h) */
+    PI_COMM_MSG_FW_BEGIN                = 0x58, //pi --> rec: image length + CRC-32, erases the update bank
+    PI_COMM_MSG_FW_CHUNK,               // 0x59, pi --> rec: offset + data
+    PI_COMM_MSG_FW_END,                 // 0x5A, pi --> rec: end of transfer, check the image and swap banks
+    PI_COMM_MSG_FW_ACK,                 // 0x5B, rec --> pi: status + window + state + next expected offset
+    PI_COMM_MSG_FW_CONFIRM              = 0x5E, //pi --> rec: the image on trial passed the Pi's checks, confirm it
+
+    /* link speed (see PiLink.h) */
+    PI_COMM_MSG_LINK_SPEED              = 0x5C, //pi --> rec: u32 requested baud rate
+    PI_COMM_MSG_LINK_ACK,               // 0x5D, rec --> pi: status + rate in use once sent + max rate
+
+    /* event log download (see event_log.h) */
+    PI_COMM_MSG_LOG_READ                = 0x68, //pi --> rec: offset + number of chunks to send
+    PI_COMM_MSG_LOG_DATA,               // 0x69, rec --> pi: offset + log bytes, no bytes at the end of the log
 
     PI_COMM_MSG_QUERY_CRITICAL_VOLTAGE  = 0x60,
     PI_COMM_MSG_QUERY_VHF_POWER_LEVEL,  // 0x61,
@@ -102,11 +165,12 @@ typedef struct __PI_COMMS_PACKET {
     uint8_t data_buffer[PI_COMMS_MAX_DATA_PAYLOAD];
 }RX_Message;
 
+//Header of the received messages handed to the state machine (the framing itself is in PiFraming.h)
 typedef struct pi_comm_header_t {
     uint8_t start_byte; //'$'
     uint8_t id;         //PiCommsMessageID
     uint8_t length;
-    uint8_t __res;
+    uint8_t sequence;   //frame sequence number
 }PiCommHeader;
 
 typedef struct __GPS_TX_MESSAGE {
@@ -130,31 +194,224 @@ typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"
     float value;
 }PiCommAPRSFreq;
 
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  critical;  //0: normal gate, 1: low battery gate
+    float    max_hdop;
+    uint8_t  min_satellites;
+    uint8_t  min_fix_type;
+    uint32_t max_age_ms;
+}PiCommGpsFixGatePkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t decimation[PI_GPS_FORWARD_NUM_TYPES]; //indexed by PiGpsForwardType, 0: not forwarded, N: every Nth sentence
+}PiCommGpsForwardPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint16_t period_s;  //0: off
+}PiCommTelemetryPeriodPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t utc_s;     //unix seconds
+    uint16_t utc_ms;
+}PiCommUtcTimePkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  index;             //table entry, 0 to GEOFENCE_MAX_REGIONS - 1, lower indices take precedence
+    float    aprs_freq_MHz;
+    uint8_t  power_level;       //VHFPowerLevel
+    uint16_t beacon_interval_s; //0: default interval
+    uint8_t  beacon_enabled;
+    char     digi_path[GEOFENCE_DIGI_PATH_LENGTH]; //not necessarily null terminated
+    uint8_t  vertex_count;      //0 removes the region
+    struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+        float latitude;
+        float longitude;
+    } vertices[GEOFENCE_MAX_VERTICES]; //only vertex_count entries are sent
+}PiCommGeofenceRegionPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t length;    //total blob length
+    uint32_t utc_time;  //current time (unix seconds), 0 if unknown
+}PiCommMgaBeginPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t offset;
+    uint8_t  data[PI_COMMS_MAX_DATA_PAYLOAD - sizeof(uint32_t)];
+}PiCommMgaChunkPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t length;
+}PiCommMgaEndPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  id;            //PiCommsMessageID being acknowledged
+    uint8_t  status;        //GpsAssistStatus
+    uint32_t next_offset;
+}PiCommMgaAckPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t length;    //image length
+    uint32_t crc;       //CRC-32 of the image (see crc32.h)
+}PiCommFwBeginPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t offset;
+    uint8_t  data[PI_COMMS_MAX_DATA_PAYLOAD - sizeof(uint32_t)];
+}PiCommFwChunkPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t length;
+}PiCommFwEndPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  id;            //PiCommsMessageID being acknowledged
+    uint8_t  status;        //FwUpdateStatus
+    uint8_t  window;        //chunks that may be sent ahead of their acknowledgement
+    uint8_t  state;         //FwUpdateState
+    uint32_t next_offset;
+}PiCommFwAckPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t baud;
+}PiCommLinkSpeedPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t offset;    //log offset to resume from, 0 for the oldest record still stored
+    uint8_t  chunks;    //at most PI_COMMS_LOG_READ_MAX_CHUNKS
+}PiCommLogReadPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t offset;    //log offset of data[0], may be past the requested one if that part was overwritten
+    uint8_t  data[PI_COMMS_MAX_DATA_PAYLOAD - sizeof(uint32_t)];
+}PiCommLogDataPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  status;        //PiLinkStatus
+    uint32_t baud;          //rate used after this message
+    uint32_t max_baud;      //PI_LINK_MAX_BAUD
+}PiCommLinkAckPkt;
+
+//Why a message was rejected. Configuration changes and log reads have no reply when accepted.
+typedef enum pi_comm_error_e {
+    PI_COMM_ERROR_LENGTH = 1,   //payload shorter than the message needs
+    PI_COMM_ERROR_VALUE,        //a field is out of range
+}PiCommError;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  id;            //PiCommsMessageID rejected
+    uint8_t  error;         //PiCommError
+}PiCommErrorPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t offset_ms; //recording time of data[0], relative to the first chunk
+    uint8_t  data[GPS_REPLAY_CHUNK_SIZE];
+}PiCommGpsReplayDataPkt;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint8_t  id;            //PiCommsMessageID being acknowledged
+    uint8_t  status;        //GpsReplayStatus
+    uint8_t  free_chunks;   //chunks the Pi may send before the next acknowledgement
+    uint8_t  __res;
+    GpsReplayStats stats;
+}PiCommGpsReplayAckPkt;
+
 typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
     PiCommHeader header;
     union {
         PiCommCritVoltagePkt critical_voltage;
         PiCommTxLevelPkt     vhf_level;
         PiCommAPRSFreq		 aprs_freq_MHz;
+        PiCommGpsFixGatePkt  gps_fix_gate;
+        PiCommGpsForwardPkt  gps_forward;
+        PiCommTelemetryPeriodPkt telemetry_period;
+        PiCommGeofenceRegionPkt geofence_region;
+        PiCommUtcTimePkt     utc_time;
+        PiCommMgaBeginPkt    mga_begin;
+        PiCommMgaChunkPkt    mga_chunk;
+        PiCommMgaEndPkt      mga_end;
+        PiCommGpsReplayDataPkt gps_replay_data;
+        PiCommFwBeginPkt     fw_begin;
+        PiCommFwChunkPkt     fw_chunk;
+        PiCommFwEndPkt       fw_end;
+        PiCommLinkSpeedPkt   link_speed;
+        PiCommLogReadPkt     log_read;
+        uint8_t              tags[PI_COMMS_MAX_DATA_PAYLOAD]; //PiStatusTag
         char                 string_pkt[256];
         uint8_t              u8_pkt;
     } data;
 }PiRxCommMessage;
 
-/*** PUBLIC VARIABLES */
-extern uint8_t pi_comm_rx_buffer[PI_COMM_RX_BUFFER_COUNT][PI_COMM_RX_BUFFER_SIZE];
-extern volatile uint_fast8_t pi_comm_rx_buffer_start;
-extern volatile uint_fast8_t pi_comm_rx_buffer_end;
+typedef enum pi_comms_tx_priority_e {
+    PI_COMMS_TX_PRIORITY_RESPONSE = 0,  //replies to the Pi, always sent before streaming data
+    PI_COMMS_TX_PRIORITY_STREAM,        //unsolicited data (e.g. gps batches)
+    PI_COMMS_TX_NUM_PRIORITIES
+}PiCommsTxPriority;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t queued[PI_COMMS_TX_NUM_PRIORITIES];
+    uint32_t sent[PI_COMMS_TX_NUM_PRIORITIES];
+    uint32_t rejected[PI_COMMS_TX_NUM_PRIORITIES];    //messages refused because the transmit queue was full
+    uint32_t max_depth[PI_COMMS_TX_NUM_PRIORITIES];   //most messages waiting at once
+    uint32_t max_wait_ms[PI_COMMS_TX_NUM_PRIORITIES]; //longest time between queueing and start of transmission
+    uint32_t bytes;                                   //framed bytes sent
+    uint32_t dma_errors;
+}PiCommsTxStats;
+
+typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
+    uint32_t frames;            //valid frames received
+    uint32_t sequence_gaps;     //frames received out of sequence (frames lost in between)
+    uint32_t cobs_errors;
+    uint32_t length_errors;
+    uint32_t crc_errors;
+    uint32_t version_errors;
+    uint32_t overflows;         //data without a delimiter for longer than the longest frame, dropped
+    uint32_t queue_full;        //valid frames dropped because the state machine wasn't keeping up
+    uint32_t overruns;          //messages overwritten by the DMA before being released
+}PiCommsRxStats;
+
+//A received message, valid until released
+typedef struct {
+    PiRxCommMessage *message;
+    Timestamp timestamp;        //reception time
+    uint16_t ring_start;        //ring index of the frame
+    bool wrapped;               //decoded in the wrap buffer
+}PiCommRxView;
 
 /*** FUNCTION DECLARATIONS ***************************************************/
 
 void pi_comms_rx_init(void);
+PiCommsRxStats pi_comms_rx_get_stats(void);
+
+//Oldest received message not yet released, NULL if none
+PiCommRxView *pi_comms_rx_peek(void);
+//Hands the oldest message's memory back to the receiver
+void pi_comms_rx_release(void);
 void pi_comms_tx_init(void);
 
-void pi_comms_tx_forward_gps(const uint8_t *buffer, uint8_t len);
+//Queues a message, copying its payload (at most PI_COMMS_TX_INLINE_SIZE bytes). Never blocks, callable from interrupts.
+//Returns HAL_BUSY if the transmit queue is full.
+HAL_StatusTypeDef pi_comms_tx_send(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length);
+
+//Queues a message read straight from the caller's buffer, which must be left untouched until done(context) is called
+//(from the transmit interrupt, once the message has been framed). done is not called if the message couldn't be queued.
+HAL_StatusTypeDef pi_comms_tx_send_zero_copy(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+        void (*done)(void *context), void *context);
+
+//Queues a message, calling sent() from the transmit complete interrupt once its last bit is out, before the next
+//message starts (e.g. to change the link speed). sent is not called if the message couldn't be queued.
+HAL_StatusTypeDef pi_comms_tx_send_then(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+        void (*sent)(void));
+
+PiCommsTxStats pi_comms_tx_get_stats(void);
+
 void pi_comms_tx_pong(void);
-void pi_comms_tx_callsign(const char *callsign);
-void pi_comms_tx_ssid(uint8_t ssid);
+void pi_comms_tx_mga_ack(uint8_t id, uint8_t status, uint32_t next_offset);
+void pi_comms_tx_gps_replay_ack(uint8_t id, uint8_t status);
+void pi_comms_tx_fw_ack(uint8_t id, uint8_t status, uint32_t next_offset);
+void pi_comms_tx_error(uint8_t id, PiCommError error);
+
+//Sends up to chunks PI_COMM_MSG_LOG_DATA messages from offset, as many as there are free chunk buffers
+void pi_comms_tx_log_data(uint32_t offset, uint8_t chunks);
 void Pi_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
 
 #endif //INC_COMMS_INC_PICOMMS_H_
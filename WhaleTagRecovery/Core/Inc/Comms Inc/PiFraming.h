@@ -0,0 +1,73 @@
+/*
+ * PiFraming.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Framing of the messages exchanged with the Pi, in both directions.
+ *
+ * Each message is protected by a CRC and COBS encoded (Consistent Overhead Byte Stuffing), so that 0x00 never
+ * appears inside of a frame and can be used as the frame delimiter:
+ *
+ *      COBS(version | sequence | id | length | payload | crc16) | 0x00
+ *
+ *  - version:  PI_FRAME_VERSION, frames of other versions are rejected
+ *  - sequence: incremented by the sender for every frame, lets the receiver count lost frames
+ *  - id:       PiCommsMessageID
+ *  - length:   payload length (0 to PI_FRAME_MAX_PAYLOAD)
+ *  - crc16:    CRC-16/CCITT-FALSE (see crc16.h) of everything before it, most significant byte first
+ *
+ * A receiver resynchronises on the next 0x00 after any corruption, losing at most the damaged frame. Decoding is
+ * done in place, in a single pass that also checks the CRC. COBS adds 1 byte per 254 bytes of frame.
+ *
+ * This file has no HAL or ThreadX dependencies, so the framing can be built and exercised off-target.
+ */
+
+#ifndef INC_COMMS_INC_PIFRAMING_H_
+#define INC_COMMS_INC_PIFRAMING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define PI_FRAME_VERSION 1
+#define PI_FRAME_DELIMITER 0x00
+
+#define PI_FRAME_MAX_PAYLOAD 255U
+
+//version + sequence + id + length, crc16
+#define PI_FRAME_HEADER_SIZE 4U
+#define PI_FRAME_CRC_SIZE 2U
+
+//Bytes on the wire for a payload of length n (COBS code bytes and delimiter included)
+#define PI_FRAME_DECODED_SIZE(n) (PI_FRAME_HEADER_SIZE + (n) + PI_FRAME_CRC_SIZE)
+#define PI_FRAME_ENCODED_SIZE(n) (PI_FRAME_DECODED_SIZE(n) + (PI_FRAME_DECODED_SIZE(n) / 254) + 2)
+#define PI_FRAME_MAX_ENCODED_SIZE PI_FRAME_ENCODED_SIZE(PI_FRAME_MAX_PAYLOAD)
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum {
+	PI_FRAME_OK,
+	PI_FRAME_ERROR_COBS,	//code byte pointing past the end of the frame
+	PI_FRAME_ERROR_LENGTH,	//too short, or length field not matching the frame
+	PI_FRAME_ERROR_CRC,
+	PI_FRAME_ERROR_VERSION,
+}PiFrameStatus;
+
+//A decoded frame, payload points into the decoded buffer
+typedef struct {
+	uint8_t sequence;
+	uint8_t id;
+	uint8_t length;
+	const uint8_t *payload;
+}PiFrame;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Encodes a frame (including the trailing delimiter) into out. Returns the encoded length, 0 if out is too small.
+size_t pi_frame_encode(uint8_t *out, size_t out_size, uint8_t sequence, uint8_t id, const uint8_t *payload, uint8_t length);
+
+//Decodes a frame received between two delimiters (delimiters excluded), overwriting the encoded bytes.
+PiFrameStatus pi_frame_decode(uint8_t *buffer, size_t length, PiFrame *frame);
+
+#endif /* INC_COMMS_INC_PIFRAMING_H_ */
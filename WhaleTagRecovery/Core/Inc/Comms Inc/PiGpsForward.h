@@ -0,0 +1,74 @@
+/*
+ * PiGpsForward.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Forwards the received GPS sentences to the Pi (for logging) without ever blocking the GPS buffer thread.
+ *
+ * Each sentence type is forwarded at a configurable decimation (0: never, 1: every sentence, N: every Nth).
+ * Forwarded sentences are coalesced into PI_COMM_MSG_GPS_BATCH frames, each carrying as many records as fit:
+ *
+ *      type (GPS_SentenceType) | length | sentence (NMEA without "\r\n", or the full UBX frame)
+ *
+ * Frames are queued in a small pool and handed one at a time to the Pi transmit queue as zero copy streaming
+ * messages, the next queued frame being handed over once the previous one has been framed for transmission.
+ * When the Pi doesn't keep up (or is absent) the oldest queued frame is dropped to make room.
+ */
+
+#ifndef INC_COMMS_INC_PIGPSFORWARD_H_
+#define INC_COMMS_INC_PIGPSFORWARD_H_
+
+#include "Recovery Inc/GpsFramer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Frames in the transmit pool (each holds up to PI_GPS_FORWARD_FRAME_PAYLOAD bytes of records)
+#define PI_GPS_FORWARD_FRAME_COUNT 8
+#define PI_GPS_FORWARD_FRAME_PAYLOAD 255
+
+//type + length
+#define PI_GPS_FORWARD_RECORD_OVERHEAD 2
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum pi_gps_forward_type_e {
+	PI_GPS_FORWARD_RMC = 0,
+	PI_GPS_FORWARD_GGA,
+	PI_GPS_FORWARD_GLL,
+	PI_GPS_FORWARD_GSA,
+	PI_GPS_FORWARD_GSV,
+	PI_GPS_FORWARD_VTG,
+	PI_GPS_FORWARD_ZDA,
+	PI_GPS_FORWARD_NMEA_OTHER,
+	PI_GPS_FORWARD_UBX_NAV_PVT,
+	PI_GPS_FORWARD_UBX_OTHER,
+	PI_GPS_FORWARD_NUM_TYPES
+}PiGpsForwardType;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t sentences;		//sentences offered by the GPS buffer thread
+	uint32_t forwarded;		//sentences queued for transmission
+	uint32_t filtered;		//sentences skipped by the decimation
+	uint32_t dropped;		//sentences in frames dropped because the link was congested
+	uint32_t frames_sent;
+	uint32_t frames_dropped;
+	uint32_t dma_errors;	//frames refused by the full transmit queue, retried on the next flush
+}PiGpsForwardStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Sets the decimation of a sentence type (0: not forwarded)
+void pi_gps_forward_set_decimation(PiGpsForwardType type, uint8_t decimation);
+uint8_t pi_gps_forward_get_decimation(PiGpsForwardType type);
+
+//Adds a sentence to the open frame if it passes the filter. Never blocks.
+void pi_gps_forward_sentence(const GPS_Sentence *sentence);
+
+//Queues the open frame and starts the transmission if the link is idle. Never blocks.
+void pi_gps_forward_flush(void);
+
+PiGpsForwardStats pi_gps_forward_get_stats(void);
+
+#endif /* INC_COMMS_INC_PIGPSFORWARD_H_ */
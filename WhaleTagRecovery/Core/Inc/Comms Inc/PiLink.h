@@ -0,0 +1,68 @@
+/*
+ * PiLink.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Speed of the Pi link (USART2). The link starts at PI_LINK_DEFAULT_BAUD, and the Pi may negotiate a faster rate for
+ * bulk transfers (gps forwarding, firmware or assistance data uploads):
+ *  1. Pi  --> rec: PI_COMM_MSG_LINK_SPEED (u32 baud)
+ *  2. rec --> pi : PI_COMM_MSG_LINK_ACK at the current rate. If accepted, the board switches right after the last bit
+ *                  of this acknowledgement. Messages already received or queued are not lost.
+ *  3. The Pi switches once it has received the acknowledgement, and sends any message (e.g. a ping) within
+ *     PI_LINK_CONFIRM_TIMEOUT_MS. Otherwise the board falls back to PI_LINK_DEFAULT_BAUD.
+ *
+ * Away from the default rate, the Pi must send a message at least every PI_LINK_IDLE_TIMEOUT_S (a rebooted Pi starts
+ * again at the default rate). Frame errors (COBS, length, CRC, overflows, DMA) in excess of PI_LINK_ERROR_THRESHOLD per
+ * check period step the link down to the next rate of pi_link_rates (see PiLink.c).
+ * Changes made by the board are announced with an unsolicited PI_COMM_MSG_LINK_ACK, sent at the old rate.
+ */
+
+#ifndef INC_COMMS_INC_PILINK_H_
+#define INC_COMMS_INC_PILINK_H_
+
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define PI_LINK_DEFAULT_BAUD 115200
+
+//Connector and cabling limit (the USART itself reaches PCLK1 / 16)
+#define PI_LINK_MAX_BAUD 2000000
+
+//Largest error between the requested and the generated rate, in per mille
+#define PI_LINK_MAX_BAUD_ERROR_PERMILLE 20
+
+#define PI_LINK_CHECK_PERIOD_MS    250
+#define PI_LINK_CONFIRM_TIMEOUT_MS 1000
+#define PI_LINK_IDLE_TIMEOUT_S     10
+#define PI_LINK_ERROR_THRESHOLD    4
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum pi_link_status_e {
+	PI_LINK_OK = 0,             //switching to the acknowledged rate
+	PI_LINK_ERROR_BAUD,         //rate above PI_LINK_MAX_BAUD, below the default, or not accurate enough
+	PI_LINK_ERROR_BUSY,         //a change is already pending
+	PI_LINK_STEP_DOWN,          //unsolicited: too many errors, stepping down
+	PI_LINK_FALLBACK,           //unsolicited: no message at this rate, back to the default
+}PiLinkStatus;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t baud;              //current rate
+	uint32_t negotiations;      //rates accepted
+	uint32_t step_downs;
+	uint32_t fallbacks;
+	uint32_t errors;            //frame errors counted at non-default rates
+}PiLinkStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Starts the link supervision, once the Pi transmitter and receiver are started
+void pi_link_init(void);
+
+//Handles a PI_COMM_MSG_LINK_SPEED request (state machine thread)
+void pi_link_request(uint32_t baud);
+
+PiLinkStats pi_link_get_stats(void);
+
+#endif /* INC_COMMS_INC_PILINK_H_ */
@@ -0,0 +1,94 @@
+/*
+ * PiStatus.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Answers the Pi's queries with PI_COMM_MSG_STATUS messages, TLV lists (see PiTlv.h) of the fields below.
+ *
+ * PI_COMM_MSG_QUERY_SNAPSHOT returns every field up to PI_STATUS_COUNTERS in a single message (state,
+ * configuration, last fix, battery, counters and uptime). The detailed statistics are too large to fit together and
+ * are only returned when asked for by PI_COMM_MSG_QUERY_FIELDS. The older single field queries (e.g.
+ * PI_COMM_MSG_QUERY_STATE) return their field the same way.
+ *
+ * Fields that don't apply (e.g. the last fix before the first fix) are left out, fields that don't fit in the
+ * message are dropped.
+ */
+
+#ifndef INC_COMMS_INC_PISTATUS_H_
+#define INC_COMMS_INC_PISTATUS_H_
+
+#include "Comms Inc/PiTlv.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum pi_status_tag_e {
+	/* state */
+	PI_STATUS_STATE                 = 0x01, //u8 State
+	PI_STATUS_STATE_TIME_MS         = 0x02, //u32 time since the last state change
+	PI_STATUS_UPTIME_MS             = 0x03, //u32 time since boot
+	PI_STATUS_TIME                  = 0x04, //Timestamp, current time (utc_s is 0 while UTC is unknown)
+
+	/* configuration */
+	PI_STATUS_CRITICAL_VOLTAGE      = 0x10, //float V
+	PI_STATUS_VHF_POWER_LEVEL       = 0x11, //u8 VHFPowerLevel
+	PI_STATUS_APRS_FREQUENCY        = 0x12, //float MHz
+	PI_STATUS_APRS_CALLSIGN         = 0x13, //characters, not null terminated
+	PI_STATUS_APRS_SSID             = 0x14, //u8
+	PI_STATUS_APRS_COMMENT          = 0x15, //characters, not null terminated
+	PI_STATUS_GPS_FIX_GATE          = 0x16, //PiCommGpsFixGatePkt (critical = 0)
+	PI_STATUS_GPS_FIX_GATE_CRITICAL = 0x17, //PiCommGpsFixGatePkt (critical = 1)
+	PI_STATUS_GPS_CONTINUOUS        = 0x18, //u8 bool
+	PI_STATUS_TELEMETRY_PERIOD      = 0x19, //u32 s, 0: off
+
+	/* position */
+	PI_STATUS_LAST_FIX              = 0x20, //GPS_Data of the last locked fix
+	PI_STATUS_LAST_FIX_AGE_MS       = 0x21, //u32
+	PI_STATUS_LAST_TX_AGE_MS        = 0x22, //u32, since the last APRS transmission
+
+	/* battery */
+	PI_STATUS_BATTERY_VOLTAGE       = 0x28, //float V, last reading
+	PI_STATUS_BATTERY_LOW           = 0x29, //u8 bool
+
+	/* counters */
+	PI_STATUS_COUNTERS              = 0x30, //PiStatusCounters, last field of the snapshot
+
+	/* detailed statistics (PI_COMM_MSG_QUERY_FIELDS only) */
+	PI_STATUS_PI_RX_STATS           = 0x40, //PiCommsRxStats
+	PI_STATUS_PI_TX_STATS           = 0x41, //PiCommsTxStats
+	PI_STATUS_GPS_INGEST_STATS      = 0x42, //GPS_IngestStats
+	PI_STATUS_GPS_FORWARD_STATS     = 0x43, //PiGpsForwardStats
+	PI_STATUS_TIME_STATS            = 0x44, //TimeStats
+	PI_STATUS_KISS_STATS            = 0x45, //KissStats
+	PI_STATUS_FW_UPDATE             = 0x46, //FwUpdateInfo
+	PI_STATUS_PI_LINK               = 0x47, //PiLinkStats
+	PI_STATUS_EVENT_LOG             = 0x48, //EventLogStats
+	PI_STATUS_LOW_POWER             = 0x49, //LowPowerStats
+	PI_STATUS_ISR_STATS             = 0x4A, //CpuLoadIsrStats[CPU_LOAD_NUM_ISRS], timer interrupt cycles
+}PiStatusTag;
+
+//Summary of the detailed statistics
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t pi_rx_frames;
+	uint32_t pi_rx_errors;			//frames failing to decode (COBS, length, CRC, version)
+	uint32_t pi_rx_dropped;			//overflows, full queue and overruns
+	uint32_t pi_tx_rejected;		//messages refused by the full transmit queue
+	uint32_t gps_sentences;			//NMEA sentences and UBX frames received
+	uint32_t gps_dropped;			//dropped by the framer or overwritten in the sentence ring
+	uint32_t gps_forward_dropped;	//sentences not forwarded to the Pi because of congestion
+}PiStatusCounters;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Appends a field. Returns false if it doesn't apply, is unknown, or doesn't fit.
+bool pi_status_put(PiTlvWriter *writer, PiStatusTag tag);
+
+//Summary of the detailed statistics, also pushed with the telemetry (see PiTelemetry.h)
+PiStatusCounters pi_status_get_counters(void);
+
+//Sends the requested fields / the snapshot to the Pi
+void pi_status_send(const uint8_t *tags, size_t count);
+void pi_status_send_snapshot(void);
+
+#endif /* INC_COMMS_INC_PISTATUS_H_ */
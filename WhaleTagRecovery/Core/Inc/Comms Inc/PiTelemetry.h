@@ -0,0 +1,66 @@
+/*
+ * PiTelemetry.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Pushes the board's health to the Pi, so that it can be logged next to the tag's sensor data without polling.
+ *
+ * Every g_config.telemetry_period_s (0: off, set by PI_COMM_MSG_CONFIG_TELEMETRY_PERIOD) the state machine thread
+ * sends a PI_COMM_MSG_TELEMETRY message holding a PiTelemetryPkt, as streaming data of the Pi transmit queue.
+ * Values are scaled integers to keep the message small. Only thread_count entries of stack_high_water are sent.
+ */
+
+#ifndef INC_COMMS_INC_PITELEMETRY_H_
+#define INC_COMMS_INC_PITELEMETRY_H_
+
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define PI_TELEMETRY_VERSION 1
+
+#define PI_TELEMETRY_DEFAULT_PERIOD_S 60
+
+#define PI_TELEMETRY_MAX_THREADS 8
+
+//PiTelemetryPkt flags
+#define PI_TELEMETRY_FLAG_FIX            (1 << 0) //a fix has been locked, fix_age_s is valid
+#define PI_TELEMETRY_FLAG_BATTERY_LOW    (1 << 1)
+#define PI_TELEMETRY_FLAG_GPS_CONTINUOUS (1 << 2)
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint8_t  version;               //PI_TELEMETRY_VERSION
+	uint8_t  state;                 //State
+	uint8_t  flags;                 //PI_TELEMETRY_FLAG_*
+	uint8_t  gps_power;             //GPS_PowerState
+	uint32_t uptime_s;
+	uint16_t battery_mV;
+	uint16_t fix_age_s;             //since the last locked fix, saturates at 0xFFFF
+	uint16_t ttff_hot_ds;           //last time to first fix from standby, in tenths of a second
+	uint16_t ttff_cold_ds;          //last time to first fix from power off, in tenths of a second
+	uint32_t gps_energy_mJ;         //estimated receiver energy since boot
+	uint32_t aprs_transmissions;
+	uint32_t aprs_energy_mJ;        //estimated transmitter energy since boot
+	uint32_t gps_dropped;           //see PiStatusCounters
+	uint32_t gps_forward_dropped;
+	uint32_t pi_rx_dropped;
+	uint32_t pi_tx_rejected;
+	uint16_t cpu_load_permille;     //since the previous telemetry message
+	uint8_t  thread_count;
+	uint16_t stack_high_water[PI_TELEMETRY_MAX_THREADS]; //deepest stack use in bytes, in Thread order
+}PiTelemetryPkt;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Creates the telemetry timer, running at g_config.telemetry_period_s
+void pi_telemetry_init(void);
+
+//Restarts the telemetry timer at g_config.telemetry_period_s
+void pi_telemetry_update_period(void);
+
+//Builds and queues a telemetry message (state machine thread, on STATE_TELEMETRY_FLAG)
+void pi_telemetry_send(void);
+
+#endif /* INC_COMMS_INC_PITELEMETRY_H_ */
@@ -0,0 +1,58 @@
+/*
+ * PiTlv.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Tag-length-value lists, as carried by PI_COMM_MSG_STATUS:
+ *
+ *      tag | length | value (length bytes) | tag | length | value ...
+ *
+ * The type of each value is fixed by its tag (see PiStatus.h). Multi-byte values are little-endian. A reader skips
+ * tags it doesn't know, so fields can be added without breaking older readers.
+ *
+ * This file has no HAL or ThreadX dependencies, so the encoding can be built and exercised off-target.
+ */
+
+#ifndef INC_COMMS_INC_PITLV_H_
+#define INC_COMMS_INC_PITLV_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//tag + length
+#define PI_TLV_HEADER_SIZE 2
+#define PI_TLV_MAX_VALUE 255
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef struct {
+	uint8_t *buffer;
+	size_t size;
+	size_t length;	//bytes written so far
+}PiTlvWriter;
+
+typedef struct {
+	const uint8_t *buffer;
+	size_t length;
+	size_t offset;	//next entry
+}PiTlvReader;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+void pi_tlv_writer_init(PiTlvWriter *writer, uint8_t *buffer, size_t size);
+
+//Appends an entry. Returns false (and writes nothing) if it doesn't fit.
+bool pi_tlv_put(PiTlvWriter *writer, uint8_t tag, const void *value, size_t length);
+bool pi_tlv_put_u8(PiTlvWriter *writer, uint8_t tag, uint8_t value);
+bool pi_tlv_put_u32(PiTlvWriter *writer, uint8_t tag, uint32_t value);
+bool pi_tlv_put_float(PiTlvWriter *writer, uint8_t tag, float value);
+
+void pi_tlv_reader_init(PiTlvReader *reader, const uint8_t *buffer, size_t length);
+
+//Reads the next entry. Returns false at the end of the list, or on an entry running past it.
+bool pi_tlv_next(PiTlvReader *reader, uint8_t *tag, const uint8_t **value, uint8_t *length);
+
+#endif /* INC_COMMS_INC_PITLV_H_ */
@@ -0,0 +1,63 @@
+/*
+ * config_store.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Persistent key/value store in internal flash (FLASH_CONFIG_REGION, see flash.h), used to keep the configuration set
+ * by the Pi across resets and brown-outs (see config_load()/config_save() in config.h).
+ *
+ * The region is split in page sized sectors, one of which is active. Values are never rewritten in place: each write
+ * appends a record (key, length, CRC-32, value) to the active sector, and the last valid record of a key holds its
+ * value. When the active sector is full, the live records and the value being written are copied to the next sector,
+ * which is then activated by programming its header last. Sectors are used in turn, spreading the erases over the
+ * whole region.
+ *
+ * A write interrupted by a reset leaves either an invalid record, ignored along with the rest of the sector until the
+ * next compaction, or a sector without a header, ignored altogether. Either way the previous value is kept, and every
+ * other key keeps its value.
+ *
+ * The store is scanned once at boot to index the records. Writing an unchanged value doesn't touch the flash.
+ * Not thread safe: used by the state machine thread only.
+ */
+
+#ifndef INC_LIB_INC_CONFIG_STORE_H_
+#define INC_LIB_INC_CONFIG_STORE_H_
+
+#include "main.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define CONFIG_STORE_MAX_KEYS         32
+#define CONFIG_STORE_MAX_VALUE_LENGTH 256
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+//Keys of the stored values. Never reuse a key for another layout, add a new one instead.
+typedef enum config_store_key_e {
+	CONFIG_KEY_CONFIGURATION        = 0x0001, //u8 CONFIGURATION_VERSION + Configuration (g_config)
+
+	CONFIG_KEY_APRS_CALLSIGN        = 0x0010, //characters, not null terminated
+	CONFIG_KEY_APRS_SSID,                     // 0x0011, u8
+	CONFIG_KEY_APRS_COMMENT,                  // 0x0012, characters, not null terminated
+	CONFIG_KEY_APRS_RCPT_CALLSIGN,            // 0x0013, characters, not null terminated
+	CONFIG_KEY_APRS_RCPT_SSID,                // 0x0014, u8
+
+	CONFIG_KEY_GEOFENCE_REGION      = 0x0020, //0x0020 + index, up to GEOFENCE_MAX_REGIONS keys (see Geofence.c)
+
+	CONFIG_KEY_INVALID              = 0xFFFF, //erased flash
+}ConfigStoreKey;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Finds the active sector and indexes its records, formatting the region if no sector is valid
+void config_store_init(void);
+
+//Copies the value of key (at most max_length bytes). Returns the stored length, 0 if the key has no value.
+size_t config_store_read(uint16_t key, void *value, size_t max_length);
+
+//Stores a value, unless it is unchanged. A length of 0 removes the key.
+HAL_StatusTypeDef config_store_write(uint16_t key, const void *value, size_t length);
+
+#endif /* INC_LIB_INC_CONFIG_STORE_H_ */
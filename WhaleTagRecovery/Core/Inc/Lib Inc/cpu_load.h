@@ -0,0 +1,68 @@
+/*
+ * cpu_load.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Measures the CPU load from the time ThreadX spends in its idle loop.
+ *
+ * With TX_LOW_POWER, the scheduler calls the low power enter/exit hooks (app_threadx.c) on every pass of its idle
+ * loop. The core cycles (DWT->CYCCNT) between entering and leaving the hooks, plus the few cycles of the loop itself
+ * between two passes, are counted as idle. Anything longer between two passes ran a thread and is counted as load.
+ * The cycle counter stops in STOP2, the time spent there is added by cpu_load_idle_stopped().
+ *
+ * The cycle counter only runs once cpu_load_init() has enabled the trace unit (TRCENA), without a debugger attached
+ * it would otherwise read 0. The GPS ingest cycle counts (GPS.c, GpsReplay.c) rely on it as well.
+ *
+ * The periodic timer interrupts count their runs and cycles the same way as the GPS DMA callback, so that their share
+ * of the load can be read back (PI_STATUS_ISR_STATS): the ThreadX tick (SysTick_Handler in tx_initialize_low_level.S
+ * calls cpu_load_timer_interrupt()), the HAL tick (TIM6) and the APRS bit clock (TIM7, during transmissions only).
+ */
+
+#ifndef INC_LIB_INC_CPU_LOAD_H_
+#define INC_LIB_INC_CPU_LOAD_H_
+
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Longest gap between two passes of the idle loop still counted as idle (an interrupt longer than this is load)
+#define CPU_LOAD_IDLE_LOOP_MAX_CYCLES 128
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+//Interrupt handlers whose cycles are counted
+typedef enum cpu_load_isr_e {
+	CPU_LOAD_ISR_SYSTICK,	//ThreadX tick
+	CPU_LOAD_ISR_TIM6,		//HAL tick
+	CPU_LOAD_ISR_TIM7,		//APRS bit clock
+	CPU_LOAD_NUM_ISRS
+}CpuLoadIsr;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t runs;
+	uint32_t max_cycles;	//worst case run, in core cycles
+	uint32_t total_cycles;	//wraps around, compare two readings
+}CpuLoadIsrStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Starts the DWT cycle counter, before the scheduler starts
+void cpu_load_init(void);
+
+//Called by the ThreadX low power hooks, with interrupts disabled
+void cpu_load_idle_enter(void);
+void cpu_load_idle_exit(void);
+void cpu_load_idle_stopped(uint32_t ms);
+
+//Share of the time spent outside the idle loop since the previous call (or boot), in permille
+uint16_t cpu_load_sample_permille(void);
+
+//Counts a run of an interrupt handler, which read DWT->CYCCNT into start_cycles on entry
+void cpu_load_isr_done(CpuLoadIsr isr, uint32_t start_cycles);
+
+//ThreadX timer interrupt (_tx_timer_interrupt()), counted as CPU_LOAD_ISR_SYSTICK. Called by SysTick_Handler.
+void cpu_load_timer_interrupt(void);
+
+void cpu_load_get_isr_stats(CpuLoadIsrStats stats[CPU_LOAD_NUM_ISRS]);
+
+#endif /* INC_LIB_INC_CPU_LOAD_H_ */
@@ -0,0 +1,27 @@
+/*
+ * crc16.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, not reflected, no final xor).
+ *
+ * Appending the CRC most significant byte first makes the CRC of the whole message 0, which lets receivers check a
+ * message in the same pass that reads it.
+ */
+
+#ifndef INC_LIB_INC_CRC16_H_
+#define INC_LIB_INC_CRC16_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define CRC16_INIT 0xFFFF
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+uint16_t crc16_update(uint16_t crc, uint8_t byte);
+uint16_t crc16(uint16_t crc, const uint8_t *data, size_t length);
+
+#endif /* INC_LIB_INC_CRC16_H_ */
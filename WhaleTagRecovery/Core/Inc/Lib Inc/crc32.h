@@ -0,0 +1,21 @@
+/*
+ * crc32.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * CRC-32 (IEEE 802.3, as computed by zlib and Python's zlib.crc32).
+ *
+ * The CRC of a message split over several buffers is computed by passing the previous result back in, starting from 0.
+ */
+
+#ifndef INC_LIB_INC_CRC32_H_
+#define INC_LIB_INC_CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+uint32_t crc32(uint32_t crc, const uint8_t *data, size_t length);
+
+#endif /* INC_LIB_INC_CRC32_H_ */
@@ -0,0 +1,91 @@
+/*
+ * event_log.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Append-only log of fixes, transmissions, state changes and battery samples in internal flash (FLASH_LOG_REGION, see
+ * flash.h), so that the drift track survives a Pi failure. It is downloaded with PI_COMM_MSG_LOG_READ, and turned
+ * into CSV or GPX by tools/decode_event_log.py.
+ *
+ * The region is a ring of pages, the oldest page is erased when a new one is needed. Records are gathered in RAM and
+ * programmed in page sized batches, or when the oldest record waiting is older than EVENT_LOG_MAX_UNFLUSHED_S (and
+ * on event_log_flush()), which bounds what a power loss can take.
+ *
+ * Page layout: a 16 byte header (EVENT_LOG_MAGIC, sequence, monotonic seconds at the start of the page, ~sequence)
+ * followed by records. Each record is a type byte and the seconds since the previous record (varint), then:
+ *  - FIX:     latitude and longitude change since the previous fix (zigzag varints, 1e-5 degrees), satellites (u8),
+ *             HDOP (u8, tenths, at most 254)
+ *  - TX:      time on air (varint, ms)
+ *  - STATE:   new State (u8)
+ *  - BATTERY: voltage change since the previous sample (zigzag varint, mV)
+ *  - TIME:    UTC seconds minus monotonic seconds (varint), logged whenever UTC is learned or corrected
+ *  - BOOT:    the board was reset, the monotonic time restarts from 0
+ * Changes are relative to 0 at the start of every page and after every BOOT record, so pages decode on their own.
+ * 0xFF bytes are padding, to be skipped.
+ *
+ * Log offsets are (page sequence << EVENT_LOG_PAGE_SHIFT) + position in the page. They stay valid until the page is
+ * overwritten, a download can resume from the last offset received.
+ */
+
+#ifndef INC_LIB_INC_EVENT_LOG_H_
+#define INC_LIB_INC_EVENT_LOG_H_
+
+#include "Recovery Inc/GPS.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define EVENT_LOG_MAGIC 0x474F4C45 //"ELOG"
+
+#define EVENT_LOG_PAGE_SHIFT 13 //log offsets, one page per 8 KB
+
+//Bound on the records lost with the power
+#define EVENT_LOG_MAX_UNFLUSHED_S (60 * 60)
+
+//Battery samples are logged on a change of EVENT_LOG_BATTERY_CHANGE_MV, or every EVENT_LOG_BATTERY_PERIOD_S
+#define EVENT_LOG_BATTERY_CHANGE_MV 100
+#define EVENT_LOG_BATTERY_PERIOD_S  (10 * 60)
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum event_log_record_e {
+	EVENT_LOG_RECORD_FIX = 0x01,
+	EVENT_LOG_RECORD_TX,
+	EVENT_LOG_RECORD_STATE,
+	EVENT_LOG_RECORD_BATTERY,
+	EVENT_LOG_RECORD_TIME,
+	EVENT_LOG_RECORD_BOOT,
+	EVENT_LOG_RECORD_PADDING = 0xFF,
+}EventLogRecord;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t records;
+	uint32_t pages_written;		//page sized batches and partial flushes
+	uint32_t pages_erased;
+	uint32_t flash_errors;
+	uint32_t first_offset;		//oldest byte still stored
+	uint32_t end_offset;		//next byte to be logged
+}EventLogStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Finds the end of the log and appends a BOOT record (state machine thread, at start)
+void event_log_init(void);
+
+//Thread context only, the record is dropped if the log isn't initialized yet
+void event_log_fix(const GPS_Data *fix);
+void event_log_transmission(uint32_t on_air_ms);
+void event_log_state(uint8_t state);
+void event_log_battery(float voltage);
+
+//Programs the records waiting in RAM
+void event_log_flush(void);
+
+//Copies log bytes from *offset, moved forward first if that part was overwritten. Returns the number of bytes
+//copied, 0 at the end of the log.
+size_t event_log_read(uint32_t *offset, uint8_t *data, size_t max_length);
+
+EventLogStats event_log_get_stats(void);
+
+#endif /* INC_LIB_INC_EVENT_LOG_H_ */
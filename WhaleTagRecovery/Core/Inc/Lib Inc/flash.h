@@ -0,0 +1,82 @@
+/*
+ * flash.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Helpers for storing data in the internal flash of the STM32U575.
+ *
+ * The flash is 1 MB split over two 512 KB banks with 8 KB pages. Programming is done one quad-word (16 bytes)
+ * at a time, and a quad-word can only be programmed once between erases.
+ *
+ * Each bank holds a firmware image (FLASH_IMAGE_SIZE) followed by a data area. The running image is in the bank
+ * mapped at FLASH_BASE_ADDRESS, the other bank receives updates (see fw_update.h) and the SWAP_BANK option bit
+ * exchanges the two. The FLASH region of the linker script (STM32U575VGTX_FLASH.ld) is limited to FLASH_IMAGE_SIZE.
+ *
+ * The data regions below are carved off the data area of the second bank. It is copied to the first bank's data area
+ * before the banks are swapped, so that the regions keep their address and contents. The first bank's data area is
+ * otherwise unused. Keep the linker script in sync when adding a region.
+ *
+ * A quad-word whose programming was interrupted (reset, power loss) may fail its ECC check when read. The double error
+ * raises an NMI, which NMI_Handler hands to flash_ecc_nmi(): the error is cleared and the read goes on with corrupted
+ * data. Code reading flash that may have been cut off checks flash_ecc_error() after the read, or uses flash_read().
+ */
+
+#ifndef INC_LIB_INC_FLASH_H_
+#define INC_LIB_INC_FLASH_H_
+
+#include "main.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define FLASH_BASE_ADDRESS   0x08000000
+#define FLASH_BANK_SIZE_BYTES (512 * 1024)
+#define FLASH_PAGE_SIZE_BYTES (8 * 1024)
+#define FLASH_QUADWORD_SIZE   16
+
+#define FLASH_ERASED_BYTE 0xFF
+
+/* firmware images */
+#define FLASH_IMAGE_SIZE            (384 * 1024)
+#define FLASH_UPDATE_IMAGE_ADDRESS  (FLASH_BASE_ADDRESS + FLASH_BANK_SIZE_BYTES) //second bank
+#define FLASH_DATA_AREA_SIZE        (FLASH_BANK_SIZE_BYTES - FLASH_IMAGE_SIZE)
+#define FLASH_DATA_AREA_ADDRESS     (FLASH_UPDATE_IMAGE_ADDRESS + FLASH_IMAGE_SIZE)
+#define FLASH_SPARE_DATA_AREA_ADDRESS (FLASH_BASE_ADDRESS + FLASH_IMAGE_SIZE) //first bank, receives the copy
+
+/* data regions */
+#define FLASH_MGA_REGION_ADDRESS 0x080E0000 //GPS assistance data (see GpsAssist.h)
+#define FLASH_MGA_REGION_SIZE    (64 * 1024)
+
+#define FLASH_CONFIG_REGION_ADDRESS (FLASH_MGA_REGION_ADDRESS + FLASH_MGA_REGION_SIZE) //key/value store (see config_store.h)
+#define FLASH_CONFIG_REGION_SIZE    (2 * FLASH_PAGE_SIZE_BYTES)
+
+#define FLASH_LOG_REGION_ADDRESS (FLASH_CONFIG_REGION_ADDRESS + FLASH_CONFIG_REGION_SIZE) //event log (see event_log.h)
+#define FLASH_LOG_REGION_SIZE    (6 * FLASH_PAGE_SIZE_BYTES)
+
+#define FLASH_DATA_REGION_START  FLASH_MGA_REGION_ADDRESS
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Returns true if the banks are swapped (physical bank 2 mapped at FLASH_BASE_ADDRESS)
+bool flash_banks_swapped(void);
+
+//Erases all pages covering [address, address + length). Address must be page aligned.
+HAL_StatusTypeDef flash_erase(uint32_t address, size_t length);
+
+//Programs length bytes at address. Address must be quad-word aligned, a trailing partial quad-word is padded with 0xFF.
+HAL_StatusTypeDef flash_program(uint32_t address, const uint8_t *data, size_t length);
+
+//Copies length bytes at address to data. Quad-words failing their ECC check read as erased (0xFF).
+//Returns false if any did.
+bool flash_read(void *data, uint32_t address, size_t length);
+
+//Returns true if a flash read failed its ECC check since the last call, and clears the flag.
+bool flash_ecc_error(void);
+
+//Called from NMI_Handler. Clears a double ECC error and flags it for flash_ecc_error(). Returns false if the NMI has
+//another cause.
+bool flash_ecc_nmi(void);
+
+#endif /* INC_LIB_INC_FLASH_H_ */
@@ -0,0 +1,103 @@
+/*
+ * fw_update.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Firmware updates over the Pi link, into the second flash bank, with automatic rollback (see flash.h for the layout).
+ *
+ * Transfer sequence (see PiComms.h):
+ *  1. PI_COMM_MSG_FW_BEGIN (image length + CRC-32) -> erases the update bank
+ *  2. PI_COMM_MSG_FW_CHUNK (offset + data), repeated  -> up to FW_UPDATE_WINDOW_CHUNKS chunks may be sent ahead of their
+ *                                                        acknowledgement. Chunks must arrive in order, a repeated chunk
+ *                                                        is acknowledged again without being rewritten.
+ *  3. PI_COMM_MSG_FW_END   (image length)          -> checks the CRC and vector table, then swaps the banks (reset)
+ * Every message is answered with a PI_COMM_MSG_FW_ACK carrying a status and the next expected offset.
+ *
+ * The new image boots on trial. Once the Pi has checked it (e.g. queried the snapshot), it sends
+ * PI_COMM_MSG_FW_CONFIRM, which only confirms the image if the board's own checks pass as well:
+ *  - FW_UPDATE_HEALTH_MIN_S of uptime without a reset (a crash or a hang resets through the IWDG, see state_machine.h)
+ *  - at least FW_UPDATE_HEALTH_MIN_PI_FRAMES valid frames received from the Pi, so the link can still carry an update
+ *  - no thread has returned or been terminated
+ * Otherwise it is acknowledged with FW_UPDATE_ERROR_UNHEALTHY and the Pi may try again. If the image isn't confirmed
+ * within FW_UPDATE_CONFIRM_TIMEOUT_S, or resets more than FW_UPDATE_MAX_TRIAL_BOOTS times before that, the banks are
+ * swapped back to the previous image.
+ *
+ * The trial state is kept in an RTC backup register, it survives resets but not a complete loss of power (the image
+ * on trial is then kept).
+ */
+
+#ifndef INC_LIB_INC_FW_UPDATE_H_
+#define INC_LIB_INC_FW_UPDATE_H_
+
+#include "main.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Chunks the Pi may send without waiting for their acknowledgement (the receive ring holds more)
+#define FW_UPDATE_WINDOW_CHUNKS 8
+
+#define FW_UPDATE_HEALTH_MIN_S       30
+#define FW_UPDATE_HEALTH_MIN_PI_FRAMES 10
+#define FW_UPDATE_CONFIRM_TIMEOUT_S  (10 * 60)
+#define FW_UPDATE_MAX_TRIAL_BOOTS    3
+
+//Time given to the last acknowledgement to be sent before the banks are swapped
+#define FW_UPDATE_SWAP_DELAY_MS 100
+
+//RTC backup register holding the trial state
+#define FW_UPDATE_BKP_REGISTER RTC_BKP_DR1
+#define FW_UPDATE_BKP_MAGIC    0xF700
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum fw_update_status_e {
+	FW_UPDATE_OK = 0,
+	FW_UPDATE_ERROR_NO_TRANSFER,	//chunk/end received without a begin
+	FW_UPDATE_ERROR_SEQUENCE,		//chunk offset is ahead of the next expected offset
+	FW_UPDATE_ERROR_LENGTH,			//image does not fit in a bank, or does not match the announced length
+	FW_UPDATE_ERROR_FLASH,			//flash erase/program failed
+	FW_UPDATE_ERROR_CRC,			//stored image does not match the announced CRC
+	FW_UPDATE_ERROR_IMAGE,			//vector table doesn't point into RAM and the image
+	FW_UPDATE_ERROR_TRIAL,			//the running image is on trial, the update bank holds the rollback image
+	FW_UPDATE_ERROR_UNHEALTHY,		//confirmation refused, the board's own checks failed
+}FwUpdateStatus;
+
+typedef enum fw_update_state_e {
+	FW_UPDATE_STATE_CONFIRMED = 0,	//running a confirmed image (or the state was lost)
+	FW_UPDATE_STATE_TRIAL,			//running a new image, not yet confirmed
+	FW_UPDATE_STATE_ROLLED_BACK,	//running the previous image after a failed trial
+}FwUpdateState;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint8_t state;			//FwUpdateState
+	uint8_t trial_boots;	//boots of the image on trial
+	uint8_t bank;			//physical bank running (1 or 2)
+	uint8_t __res;
+	uint32_t image_crc;		//CRC-32 of the last image received
+}FwUpdateInfo;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Checks the trial state on boot, rolling back if the image on trial keeps resetting (state machine thread, at start)
+void fw_update_boot(void);
+
+//Confirms an image on trial if the board's checks pass (PI_COMM_MSG_FW_CONFIRM). FW_UPDATE_OK when not on trial.
+FwUpdateStatus fw_update_confirm(void);
+
+//Swaps back to the previous image (confirmation timeout, state machine thread). Doesn't return on success.
+void fw_update_rollback(void);
+
+//Image transfer. Each returns the status to acknowledge, and the next expected offset through next_offset.
+FwUpdateStatus fw_update_begin(uint32_t length, uint32_t crc, uint32_t *next_offset);
+FwUpdateStatus fw_update_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset);
+FwUpdateStatus fw_update_end(uint32_t length, uint32_t *next_offset);
+
+//Swaps to the received image once its END was acknowledged. Doesn't return on success.
+void fw_update_activate(void);
+
+FwUpdateInfo fw_update_get_info(void);
+
+#endif /* INC_LIB_INC_FW_UPDATE_H_ */
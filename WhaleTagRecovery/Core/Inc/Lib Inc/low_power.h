@@ -0,0 +1,84 @@
+/*
+ * low_power.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Tickless idle for ThreadX (TX_LOW_POWER_TICKLESS), driven by the low power hooks in app_threadx.c.
+ *
+ * When every thread is waiting, the core enters STOP2 (SRAM and registers retained) until the next ThreadX timer
+ * expiration, programmed on LPTIM1. LPTIM1 counts LSE / 32 (LOW_POWER_TIMER_HZ) and keeps running in STOP2, the
+ * crystal keeps the ticks within its ppm across long stops where the LSI would drift by percents. On wake, the PLL is
+ * restored (STOP2 wakes on MSI), and the ThreadX and HAL ticks are moved forward by the time spent stopped.
+ * The regulator range (SystemClock_Config()) and the flash latency are kept across STOP2.
+ *
+ * STOP2 stops the UARTs, the DMA and the timers. A peripheral with a transfer in progress vetoes it, the core then
+ * only sleeps (WFI, clocks and SysTick running). Next ThreadX timer expirations closer than LOW_POWER_STOP2_MIN_MS
+ * also just sleep, STOP2 wouldn't pay for its wake-up.
+ *
+ * Wake sources in STOP2: LPTIM1 and the Pi link RX pin (EXTI3), armed by low_power_init(). GPS_EXTINT (EXTI0) isn't
+ * one, its interrupt is not enabled. The byte waking the board is lost, with the frame it starts. After a silence the
+ * Pi should send a frame delimiter (0x00) first, an empty frame is ignored.
+ * Every frame from or to the Pi keeps the board out of STOP2 for LOW_POWER_PI_LINK_AWAKE_MS.
+ */
+
+#ifndef INC_LIB_INC_LOW_POWER_H_
+#define INC_LIB_INC_LOW_POWER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define LOW_POWER_TIMER_HZ 1024 //LSE (32.768 kHz) / 32
+
+//Longest STOP2 period, the 16 bit LPTIM1 counter must not wrap around (64 s at LOW_POWER_TIMER_HZ)
+#define LOW_POWER_MAX_STOP_MS 60000
+
+#define LOW_POWER_STOP2_MIN_MS 3
+
+#define LOW_POWER_PI_LINK_AWAKE_MS 2000
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+//Holders of a STOP2 veto
+typedef enum low_power_veto_e {
+	LOW_POWER_VETO_GPS_UART,	//USART3 DMA reception, while the receiver is on
+	LOW_POWER_VETO_PI_TX,		//USART2 DMA transmission
+	LOW_POWER_VETO_PI_RX,		//USART2 reception, for LOW_POWER_PI_LINK_AWAKE_MS after each frame
+	LOW_POWER_VETO_APRS_DAC,	//DAC DMA and TIM2 during an APRS transmission
+	LOW_POWER_NUM_VETOES
+}LowPowerVeto;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t stop_entries;
+	uint32_t sleep_entries;		//idle passes spent in sleep, because of a veto or a close timer
+	uint32_t vetoed_entries;
+	uint32_t stop_ms;			//total time in STOP2
+	uint32_t max_stop_ms;
+	uint8_t vetoes;				//LowPowerVeto bits currently held
+}LowPowerStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Sets up LPTIM1 and the wake sources, before the kernel starts
+void low_power_init(void);
+
+//Thread or interrupt context
+void low_power_veto(LowPowerVeto source, bool veto);
+
+//Vetoes STOP2 for the next timeout_ms (e.g. while an exchange is likely to go on). Thread or interrupt context.
+void low_power_veto_for(LowPowerVeto source, uint32_t timeout_ms);
+
+//ThreadX low power hooks (app_threadx.c), with interrupts disabled
+void low_power_timer_setup(uint32_t ticks);
+void low_power_enter(void);
+void low_power_exit(void);
+uint32_t low_power_timer_adjust(void);
+
+//Interrupt handlers (stm32u5xx_it.c)
+void low_power_lptim_irq_handler(void);
+void low_power_exti_irq_handler(void);
+
+LowPowerStats low_power_get_stats(void);
+
+#endif /* INC_LIB_INC_LOW_POWER_H_ */
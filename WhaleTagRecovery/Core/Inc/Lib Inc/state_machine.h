@@ -9,6 +9,8 @@
 #define INC_LIB_INC_STATE_MACHINE_H_
 
 #include "tx_api.h"
+#include "Lib Inc/time_service.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 //Should correspond with the state types enum below
@@ -17,8 +19,14 @@
 //Flags inside of our state machine event flags
 #define STATE_COMMS_MESSAGE_AVAILABLE_FLAG (1 << 0)
 #define STATE_CRITICAL_LOW_BATTERY_FLAG (1 << 1)
+#define STATE_TELEMETRY_FLAG (1 << 2) //time to push telemetry to the Pi
+#define STATE_FW_ROLLBACK_FLAG (1 << 3) //the firmware on trial wasn't confirmed in time
 
-#define ALL_STATE_FLAGS (STATE_COMMS_MESSAGE_AVAILABLE_FLAG | STATE_CRITICAL_LOW_BATTERY_FLAG)
+//The state machine thread refreshes the IWDG (100 s timeout, see MX_IWDG_Init()) at least this often, so a hung
+//thread, a crash or an interrupt storm resets the board. It keeps counting in STOP2.
+#define STATE_WATCHDOG_REFRESH_MS (30 * 1000)
+
+#define ALL_STATE_FLAGS (STATE_COMMS_MESSAGE_AVAILABLE_FLAG | STATE_CRITICAL_LOW_BATTERY_FLAG | STATE_TELEMETRY_FLAG | STATE_FW_ROLLBACK_FLAG)
 
 typedef enum {
 	STATE_CRITICAL = 0, //Do nothing and be in super low power
@@ -32,4 +40,18 @@ typedef enum {
 //Main thread entry for the state machine thread
 void state_machine_thread_entry(ULONG thread_input);
 
+//Changes state, releasing the GPS, VHF and threads the new state doesn't need. Returns false, with no change, if the
+//transition isn't allowed (e.g. out of STATE_CRITICAL, into a standalone mode from anything but STATE_WAITING, or a
+//transmitting state on a critical battery). The first call after a reset may enter any state.
+bool state_machine_set_state(State new_state);
+
+//Current state
+State state_machine_get_state(void);
+
+//Time of the last state change
+Timestamp state_machine_get_state_timestamp(void);
+
+//Total time spent in a state since boot (including the current period)
+uint32_t state_machine_get_state_time_ms(State state);
+
 #endif /* INC_LIB_INC_STATE_MACHINE_H_ */
@@ -22,6 +22,7 @@
 #include "Recovery Inc/Aprs.h"
 #include "Recovery Inc/FishTracker.h"
 #include "Recovery Inc/GPS.h"
+#include "Recovery Inc/Kiss.h"
 #include "Sensor Inc/BatteryMonitoring.h"
 #include "Sensor Inc/RTC.h"
 #include "Comms Inc/PiComms.h"
@@ -47,6 +48,7 @@ typedef enum __TX_THREAD_LIST {
 	RTC_THREAD,
 #endif
 	FISHTRACKER_THREAD,
+	KISS_TNC_THREAD,
 	NUM_THREADS //DO NOT ADD THREAD ENUMS BELOW THIS
 }Thread;
 
@@ -128,6 +130,17 @@ static Thread_ConfigTypeDef threadConfigList[NUM_THREADS] = {
 				.timeslice = TX_NO_TIME_SLICE,
 				.start = TX_DONT_START
 		},
+		[KISS_TNC_THREAD] = {
+				//KISS TNC Thread (frames from the Pi)
+				.thread_name = "KISS TNC Thread",
+				.thread_entry_function = kiss_thread_entry,
+				.thread_input = 0x1234,
+				.thread_stack_size = 2048,
+				.priority = 7,
+				.preempt_threshold = 7,
+				.timeslice = TX_NO_TIME_SLICE,
+				.start = TX_DONT_START
+		},
 #if BATTERY_MONITOR_ENABLED
 		[BATTERY_MONITOR_THREAD] = {
 				//GPS Collection
@@ -162,4 +175,7 @@ extern Thread_HandleTypeDef threads[NUM_THREADS];
 //Function to be called BEFORE creating any TX threads. It initializes the stack pointers and populates the thread handler array.
 void threadListInit();
 
+//Deepest use of a thread's stack so far, in bytes, found from the ThreadX stack fill pattern (TX_STACK_FILL)
+uint32_t thread_stack_high_water(Thread index);
+
 #endif /* INC_LIB_INC_THREADS_H_ */
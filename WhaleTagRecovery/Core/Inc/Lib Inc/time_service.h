@@ -0,0 +1,122 @@
+/*
+ * time_service.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Firmware wide time keeping: a monotonic millisecond clock plus UTC, disciplined by GPS.
+ *
+ * UTC is kept as a reference point (UTC at a given HAL tick) that is moved forward on every time sync:
+ *  - GPS: validated RMC/ZDA (valid status + date) or NAV-PVT (validDate, validTime and fullyResolved)
+ *  - Pi:  current time sent by the Pi (e.g. with an AssistNow upload), used until GPS time is available
+ *  - RTC: read back at boot, if the RTC was set before the reset (it runs on the LSE in the backup domain)
+ * A better source is never overridden by a worse one unless it has not synced for TIME_SOURCE_HOLDOVER_MS.
+ *
+ * The HAL tick runs off the MSI, which can be off by a fraction of a percent. Consecutive GPS syncs at least
+ * TIME_RATE_MIN_INTERVAL_MS apart measure the tick's rate error, which is then corrected in software between syncs.
+ * The RTC's rate error is measured the same way and trimmed with the smooth calibration
+ * register (CALP/CALM, +-487 ppm in 0.954 ppm steps), so that it keeps good time through resets and STOP modes.
+ *
+ * time_now() is cheap (no peripheral access) and can be called from interrupts.
+ */
+
+#ifndef INC_LIB_INC_TIME_SERVICE_H_
+#define INC_LIB_INC_TIME_SERVICE_H_
+
+#include "main.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//GPS time syncs closer together than this are ignored (the receiver reports the same time in several sentences)
+#define TIME_GPS_SYNC_PERIOD_MS (10 * 1000)
+
+//A worse time source may take over once the current source has not synced for this long
+#define TIME_SOURCE_HOLDOVER_MS (60 * 60 * 1000)
+
+//Minimum spacing of the GPS syncs used to measure the clock rate. Sentence latency jitter (~10 ms) limits the resolution to ~20 ppm.
+#define TIME_RATE_MIN_INTERVAL_MS (10 * 60 * 1000)
+
+//Rate measurements above this are discarded (e.g. a sync across a GPS time jump)
+#define TIME_RATE_MAX_PPM 20000.0f
+
+//Without syncs, time_now() moves the reference forward once it is this old, so that the HAL tick (wrapping around
+//every 49.7 days) never gets a full turn ahead of it. The state machine thread calls time_now() at least every
+//STATE_WATCHDOG_REFRESH_MS.
+#define TIME_REFERENCE_MAX_AGE_MS (7UL * 24 * 60 * 60 * 1000)
+
+//RTC is stepped instead of calibrated when it is off by more than this
+#define TIME_RTC_STEP_THRESHOLD_MS 2000
+
+//RTC smooth calibration: one step is 1 pulse in 2^20, CALP adds 512 pulses
+#define TIME_RTC_CALIBRATION_MIN (-511)
+#define TIME_RTC_CALIBRATION_MAX 512
+#define TIME_RTC_PULSES_PER_PPM  1.048576f
+
+//Backup register marking the RTC as set, so that its time can be trusted after a reset
+#define TIME_RTC_BKP_REGISTER    RTC_BKP_DR0
+#define TIME_RTC_VALID_MAGIC     0x54494D45 //"TIME"
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+//Ordered from worst to best
+typedef enum time_source_e {
+	TIME_SOURCE_NONE = 0,	//UTC unknown
+	TIME_SOURCE_RTC,
+	TIME_SOURCE_PI,
+	TIME_SOURCE_GPS,
+}TimeSource;
+
+//Attached to events (GPS fixes, transmissions, state changes, Pi messages)
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t monotonic_ms;	//HAL tick, ms since boot
+	uint32_t utc_s;			//unix seconds, 0 if source is TIME_SOURCE_NONE
+	uint16_t utc_ms;
+	uint8_t  source;		//TimeSource
+	uint8_t  __res;
+}Timestamp;
+
+typedef struct {
+	uint16_t year;
+	uint8_t month;		//1-12
+	uint8_t day;		//1-31
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t second;
+	uint8_t weekday;	//1 = monday ... 7 = sunday
+}TimeDate;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t syncs;
+	uint32_t last_sync_monotonic_ms;
+	int32_t  last_offset_ms;	//correction applied by the last sync (new time - disciplined clock)
+	float    tick_rate_ppm;		//measured HAL tick rate error, positive: tick is slow
+	float    rtc_rate_ppm;		//last measured RTC rate error before calibration, positive: RTC is slow
+	int16_t  rtc_calibration;	//current smooth calibration in 2^-20 steps, positive: RTC is sped up
+	uint16_t __res;
+}TimeStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Restores UTC from the RTC if it was set before the reset
+void time_init(void);
+
+//Monotonic milliseconds since boot
+uint32_t time_monotonic_ms(void);
+
+//Current monotonic time and UTC
+Timestamp time_now(void);
+
+//Gets the current UTC time (unix seconds). Returns false if the time has never been set.
+bool time_get_utc(uint32_t *utc_s);
+
+//Syncs UTC. monotonic_ms is the time_monotonic_ms() at which utc_s + utc_ms was valid (e.g. the reception of the GPS sentence).
+void time_set_utc(uint32_t utc_s, uint16_t utc_ms, uint32_t monotonic_ms, TimeSource source);
+
+const TimeStats * time_get_stats(void);
+
+//Calendar conversion (proleptic Gregorian, valid from 1970 to 2105)
+TimeDate time_date_from_utc(uint32_t utc_s);
+uint32_t time_utc_from_date(const TimeDate *date);
+
+#endif /* INC_LIB_INC_TIME_SERVICE_H_ */
@@ -11,14 +11,23 @@
 #define INC_LIB_INC_TIMING_H_
 
 #include "tx_user.h"
+#include <stdint.h>
+
+//The conversions to ticks round up, so that a non-zero delay never becomes 0 ticks (no sleep, or a timer that can't be
+//created) nor shorter than asked. They compute in 64 bits and are meant for delays fitting a ULONG of ticks.
 
 //A macro for converting seconds to threadX ticks. This can be used to feed into software timers, task sleeps, etc.
-#define tx_s_to_ticks(S) ((S) * (TX_TIMER_TICKS_PER_SECOND))
+#define tx_s_to_ticks(S) ((uint32_t)((uint64_t)(S) * (TX_TIMER_TICKS_PER_SECOND)))
 
 //A macro for converting milliseconds to threadX ticks. This can be used to feed into software timers, task sleeps, etc.
-#define tx_ms_to_ticks(MS) ((MS) * (TX_TIMER_TICKS_PER_SECOND) / 1000)
+#define tx_ms_to_ticks(MS) ((uint32_t)(((uint64_t)(MS) * (TX_TIMER_TICKS_PER_SECOND) + 999) / 1000))
 
 //A macro for converting microseconds to threadX ticks. This can be used to feed into software timers, task sleeps, etc.
-#define tx_us_to_ticks(US) ((US) * (TX_TIMER_TICKS_PER_SECOND) / 1000000)
+//Anything under a tick should rather use a hardware timer (see AprsTransmit.h).
+#define tx_us_to_ticks(US) ((uint32_t)(((uint64_t)(US) * (TX_TIMER_TICKS_PER_SECOND) + 999999) / 1000000))
+
+//Macros for converting threadX ticks (e.g. from tx_time_get()) to whole seconds and milliseconds, rounded down
+#define tx_ticks_to_s(TICKS) ((uint32_t)((TICKS) / (TX_TIMER_TICKS_PER_SECOND)))
+#define tx_ticks_to_ms(TICKS) ((uint32_t)((uint64_t)(TICKS) * 1000 / (TX_TIMER_TICKS_PER_SECOND)))
 
 #endif /* INC_LIB_INC_TIMING_H_ */
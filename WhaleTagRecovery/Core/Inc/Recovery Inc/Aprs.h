@@ -22,6 +22,8 @@
 
  */
 #include "tx_api.h"
+#include "Lib Inc/time_service.h"
+#include "Recovery Inc/GPS.h"
 
 #define APRS_PACKET_MAX_LENGTH 255
 
@@ -40,6 +42,11 @@
 
 #define NUM_TX_ATTEMPTS 3
 
+//Typical transmitter supply and currents (DRA818V), only used to estimate the transmit energy
+#define APRS_VHF_SUPPLY_MV 5000
+#define APRS_VHF_TX_CURRENT_HIGH_MA 750
+#define APRS_VHF_TX_CURRENT_LOW_MA 450
+
 //Events inside of our aprs state machine 
 #define APRS_EVENT_TRANSMIT_POSITION   (1 << 0)
 #define APRS_EVENT_RETRANSMIT_POSITION (1 << 1)
@@ -47,9 +54,33 @@
 
 #define ARPS_ALL_EVENT_FLAGS (APRS_EVENT_TRANSMIT_POSITION | APRS_EVENT_RETRANSMIT_POSITION | APRS_EVENT_TRANSMIT_MESSAGE)
 
+//Transmissions (beacons and messages) since boot
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+    uint32_t transmissions;
+    uint32_t on_air_ms;
+    uint32_t energy_mJ;     //estimated from the power level and APRS_VHF_SUPPLY_MV
+}AprsTxStats;
 
 //Main thread entry
 void aprs_thread_entry(ULONG aprs_thread_input);
+
+//Creates the VHF mutex, before the APRS and KISS threads start
+void aprs_init(void);
+
+//Puts the VHF to sleep, once no transmission is in progress
 void aprs_sleep(void);
+
+//Suspends the APRS thread between transmissions (from another thread)
+void aprs_suspend(TX_THREAD *aprs_thread);
 void aprs_tx_message(const char* message, size_t message_len);
+
+//Time of the last transmission (beacon or message), source is TIME_SOURCE_NONE before the first one
+Timestamp aprs_get_last_tx_timestamp(void);
+
+//Last locked fix and its time (zero before the first fix)
+Timestamp aprs_get_last_fix(GPS_Data *fix);
+
+//Accounts a transmission that started at start and just ended, made outside of the APRS thread (e.g. KISS frames)
+void aprs_record_transmission(Timestamp start);
+AprsTxStats aprs_get_tx_stats(void);
 #endif /* INC_RECOVERY_INC_APRS_H_ */
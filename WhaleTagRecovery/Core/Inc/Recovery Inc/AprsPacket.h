@@ -36,12 +36,19 @@
 #define APRS_DIGI_PATH "WIDE2"
 #define APRS_DIGI_SSID 2
 
+//AX.25 allows up to 8 digipeater addresses
+#define APRS_MAX_DIGIPEATERS 8
+
 #define APRS_MAX_COMMENT_LEN 40
 #define APRS_COMMENT "Dev Packet 4"
 
 #define APRS_CALLSIGN_LENGTH 6
 
 #define APRS_DT_POS_CHARACTER '!'
+#define APRS_DT_OBJECT_CHARACTER ';'
+
+//Appended to the callsign to name the object carrying the predicted drift position
+#define APRS_ESTIMATE_OBJECT_SUFFIX "EST"
 #define APRS_SYM_TABLE_CHAR '1'
 #define APRS_SYM_CODE_CHAR 's' //boat
 
@@ -53,17 +60,30 @@
 void aprs_generate_location_packet(uint8_t * buffer, uint8_t **buffer_end, float lat, float lon);
 void aprs_generate_message_packet(uint8_t *buffer, uint8_t **buffer_end, const char* message, size_t message_len);
 
+//generates an aprs object (named callsign + APRS_ESTIMATE_OBJECT_SUFFIX) for a predicted position, with course/speed and
+//a comment marking it as an estimate with its uncertainty radius and the age of the last fix
+void aprs_generate_estimate_packet(uint8_t *buffer, uint8_t **buffer_end, float lat, float lon, uint16_t course_deg, uint16_t speed_mm_s, uint32_t radius_m, uint32_t age_s);
+
 //get aprs source callsign
 void aprs_get_callsign(char callsign[static 7]);
 void aprs_get_ssid(uint8_t *p_ssid);
 
 int aprs_set_msg_recipient_callsign(const char *callsign);
 int aprs_set_msg_recipient_ssid(uint8_t ssid);
+void aprs_get_msg_recipient_callsign(char callsign[static 7]);
+void aprs_get_msg_recipient_ssid(uint8_t *p_ssid);
 
 //set aprs source callsign
 int aprs_set_callsign(const char *callsign);
 int aprs_set_ssid(uint8_t ssid);
 
 void aprs_set_comment(const char *comment, size_t comment_len);
+void aprs_get_comment(char comment[static APRS_MAX_COMMENT_LEN + 1]);
+
+//AX.25 frame check sequence of a frame (addresses to information field), sent least significant byte first
+uint16_t ax25_fcs(const uint8_t *data, size_t length);
+
+//set the digipeater path, e.g. "WIDE1-1,WIDE2-1" (empty for no path)
+int aprs_set_digi_path(const char *path);
 
 #endif /* INC_RECOVERY_INC_APRSPACKET_H_ */
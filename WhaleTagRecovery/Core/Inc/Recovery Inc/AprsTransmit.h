@@ -16,7 +16,8 @@
  *
  * It uses the DAC to transmit a sine wave through DMA. The frequency of the wave is controlled by a hardware timer (changing the period changes the frequency).
  *
- * There is a software timer that cycles through bits, changing the frequency appropriately.
+ * A second hardware timer (TIM7) cycles through bits, changing the frequency appropriately. Its interrupt takes the bytes
+ * one at a time from aprs_transmit_byte(), so there is no gap between them.
  *
  * A "0" bit indicates a change in frequency, while a "1" bit will keep the same frequency. We toggle between 1200 and 2200 Hz.
  *
@@ -34,9 +35,9 @@
 #include "stm32u5xx_hal.h"
 
 //Defines
-//The time to transmit each bit for
-//Each ThreadX tick is 50us -> 17 ticks makes it 850us. Based off the PICO code for the old recovery boards, where the bit time is 832us.
-#define APRS_TRANSMIT_BIT_TIME tx_us_to_ticks(850)
+//The time to transmit each bit for (1200 baud), the TIM7 period in MX_TIM7_Init() (1 MHz count). Based off the PICO code for
+//the old recovery boards, where the bit time is 832us.
+#define APRS_TRANSMIT_BIT_TIME_US 833
 
 //The hardware timer periods for 1200Hz and 2400Hz signals
 #define APRS_TRANSMIT_PERIOD_1200HZ 84
@@ -48,6 +49,12 @@
 //Self-explanatory
 #define BITS_PER_BYTE 8
 
+//HDLC flag, sent without bit stuffing
+#define APRS_TRANSMIT_FLAG 0x7E
+
+//Set in the bit timer input when the byte is a flag (a data byte may also be 0x7E)
+#define APRS_TRANSMIT_IS_FLAG (1 << BITS_PER_BYTE)
+
 //The number of sample points for the output sine wave. The more samples the smoother the wave.
 #define APRS_TRANSMIT_NUM_SINE_SAMPLES 100
 
@@ -57,7 +64,18 @@
 
 //Public functions
 void aprs_transmit_init(void);
+
+//Sends a whole packet (leading flags, frame and trailing flags), every 0x7E byte being sent as a flag
 bool aprs_transmit_send_data(uint8_t * packet_data, uint16_t packet_length);
-void aprs_transmit_bit_timer_entry(ULONG bit_timer_input);
+
+//Sends a key-up piece by piece: aprs_transmit_start(), then any number of flags and frames (already holding their FCS,
+//bit stuffed, so they may contain 0x7E), then aprs_transmit_stop()
+void aprs_transmit_start(void);
+void aprs_transmit_flags(uint16_t count);
+void aprs_transmit_frame(const uint8_t *frame, uint16_t frame_length);
+void aprs_transmit_stop(void);
+
+//TIM7 update interrupt (HAL_TIM_PeriodElapsedCallback in main.c)
+void aprs_transmit_bit_timer_entry(void);
 
 #endif /* INC_RECOVERY_INC_APRSTRANSMIT_H_ */
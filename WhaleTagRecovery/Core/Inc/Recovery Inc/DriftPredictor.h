@@ -0,0 +1,84 @@
+/*
+ * DriftPredictor.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Dead-reckoning of the drifting tag between GPS fixes.
+ *
+ * Once detached the tag drifts with wind and current, and lock attempts often fail while waves wash over the
+ * antenna. An alpha-beta filter tracks position and velocity over the last fixes; when no fix is available it
+ * predicts the current position with an uncertainty radius that grows with the time since the last fix:
+ *
+ *   radius = DRIFT_FIX_UNCERTAINTY_M + speed_sigma x age
+ *
+ * where speed_sigma is a moving average of how far the fixes deviated from the predicted track (per second),
+ * floored at DRIFT_MIN_SPEED_SIGMA_MM_S.
+ *
+ * The filter is fixed point: positions in 1e-7 degrees (as in UBX-NAV-PVT), velocities in 1e-7 degrees per second
+ * (Q8). The filter restarts from the new fix if fixes are more than DRIFT_MAX_FIX_GAP_MS apart, or if a fix is more
+ * than DRIFT_RESET_DISTANCE_M away from the prediction (e.g. the tag was picked up).
+ *
+ * This file has no hardware dependencies, all times are passed in by the caller.
+ */
+
+#ifndef INC_RECOVERY_INC_DRIFTPREDICTOR_H_
+#define INC_RECOVERY_INC_DRIFTPREDICTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Filter gains (Q8): alpha weighs the position residual, beta the velocity correction
+#define DRIFT_ALPHA_Q8 154 //0.6
+#define DRIFT_BETA_Q8  51  //0.2
+
+#define DRIFT_VELOCITY_Q 8
+
+//Length of 1e-7 degrees of latitude, in micrometers
+#define DRIFT_UM_PER_E7 11132
+
+//Uncertainty of a fix, and floor of the drift speed uncertainty
+#define DRIFT_FIX_UNCERTAINTY_M    10
+#define DRIFT_MIN_SPEED_SIGMA_MM_S 100
+
+//Estimates are not produced past this age (the drift will have changed)
+#define DRIFT_MAX_PREDICTION_MS (60 * 60 * 1000)
+
+//Restart conditions
+#define DRIFT_MAX_FIX_GAP_MS   (2 * 60 * 60 * 1000)
+#define DRIFT_RESET_DISTANCE_M 5000
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef struct drift_predictor_t {
+	uint8_t  fixes;				//fixes since the last restart (saturates)
+	uint32_t fix_ms;			//time of the last fix
+	int32_t  lat_e7;			//filtered position at fix_ms
+	int32_t  lon_e7;
+	int32_t  lat_velocity_q8;	//1e-7 deg/s, Q8
+	int32_t  lon_velocity_q8;
+	int32_t  lon_scale_q15;		//cos(latitude), Q15
+	uint32_t speed_sigma_mm_s;
+}DriftPredictor;
+
+typedef struct drift_estimate_t {
+	float    latitude;
+	float    longitude;
+	uint32_t radius_m;
+	uint32_t age_ms;			//time since the last fix
+	uint16_t course_deg;		//0 = north, clockwise
+	uint16_t speed_mm_s;
+}DriftEstimate;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+void drift_predictor_init(DriftPredictor *predictor);
+
+//Feeds a GPS fix taken at now_ms into the filter
+void drift_predictor_update(DriftPredictor *predictor, float latitude, float longitude, uint32_t now_ms);
+
+//Predicts the position at now_ms. Returns false if there is no track yet (fewer than 2 fixes) or the last fix is too old.
+bool drift_predictor_estimate(const DriftPredictor *predictor, uint32_t now_ms, DriftEstimate *estimate);
+
+#endif /* INC_RECOVERY_INC_DRIFTPREDICTOR_H_ */
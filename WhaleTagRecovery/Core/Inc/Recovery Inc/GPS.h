@@ -22,28 +22,78 @@
 #include <stdbool.h>
 #include <stdint.h> //for uint8_t
 #include "tx_api.h" //for ULONG
+#include "Recovery Inc/Ubx.h"
+#include "Recovery Inc/GpsFramer.h"
+#include "config.h" //for GpsFixGate
+#include "util.h"
+#include "Recovery Inc/GpsAcquisition.h"
+#include "Lib Inc/time_service.h"
 
 #define GPS_PACKET_START_CHAR '$'
 #define GPS_PACKET_END_CHAR '\r'
 
 #define GPS_UART_TIMEOUT 5000
-#define GPS_TRY_LOCK_TIMEOUT 5000
+//How often get_gps_lock() checks for new sentences while waiting for a lock
+#define GPS_POLL_PERIOD_MS 50
 
+//Satellites reported by GSV are forgotten if not reported again within this time
+#define GPS_SATELLITE_MAX_AGE_MS 3000
+#define GPS_SATELLITE_TABLE_SIZE 64
 
-#define GPS_SIMULATION false
-#define GPS_SIM_LAT 42.2000
-#define GPS_SIM_LON -71.0500
+//The receiver configuration is only written to its RAM layer, so it always boots with the default baud rate.
+#define GPS_DEFAULT_BAUD_RATE 38400
+#define GPS_BAUD_RATE 115200
+
+//Size of each half of the USART3 DMA double buffer, GPS_RxCpltCallback() frames one half while the other one fills
+#define GPS_RX_BUFFER_SIZE (16*GPS_NMEA_MAX_SIZE)
+
+//Navigation solution period
+#define GPS_NAV_RATE_MS 1000
+
+//Time from powering the receiver until it accepts configuration messages
+#define GPS_BOOT_TIME_MS 1000
+
+//Time for the receiver to apply a baud rate change before we follow it
+#define GPS_BAUD_SETTLE_TIME_MS 20
+
+//Longest expected off period for which the receiver is kept in software standby (backup) instead of being powered off.
+//Ephemeris is only useful for a hot start for a couple of hours, past that a standby wake is no faster than a cold start.
+#define GPS_HOT_STANDBY_MAX_OFF_S (2 * 60 * 60)
+
+//Dummy bytes sent on the receiver's UART RX to wake it from software standby. The first bytes are lost while it wakes.
+#define GPS_STANDBY_WAKE_BYTE 0xFF
+#define GPS_STANDBY_WAKE_BYTE_COUNT 8
+
+//Time to first fix assumed for a wake type until the first fix of that type was measured (see gps_get_wake_lead_ms())
+#define GPS_DEFAULT_TTFF_HOT_MS  (5 * 1000)
+#define GPS_DEFAULT_TTFF_COLD_MS (30 * 1000)
+
+//Typical receiver supply and currents, only used to estimate energy per fix
+#define GPS_SUPPLY_MV 3300
+#define GPS_ACTIVE_CURRENT_UA 32000
+#define GPS_STANDBY_CURRENT_UA 40
 
 #define DEFAULT_LAT 15.31383
 #define DEFAULT_LON -61.30075
 
 #define DOMINICA_LAT_BOUNDARY 17.71468
 
+//A position sentence whose UTC time is older than the fused fix is ignored, unless the fused fix is older than this
+#define GPS_FUSION_WINDOW_MS 5000
+
+//GPS_Data.quality packing: fix type (UbxFixType), satellites used, HDOP in tenths (saturates at 0xFFFF)
+#define GPS_QUALITY_PACK(fix_type, satellites, hdop_tenths) \
+	(((uint32_t)(fix_type) & 0xFF) | (((uint32_t)(satellites) & 0xFF) << 8) | ((uint32_t)(hdop_tenths) << 16))
+#define GPS_QUALITY_FIX_TYPE(quality)   _RSHIFT(quality, 0, 8)
+#define GPS_QUALITY_SATELLITES(quality) _RSHIFT(quality, 8, 8)
+#define GPS_QUALITY_HDOP_TENTHS(quality) _RSHIFT(quality, 16, 16)
+
 typedef enum __GPS_MESSAGE_TYPES {
-	GPS_SIM = 0,
-	GPS_GLL = 1,
-	GPS_GGA = 2,
-	GPS_RMC = 3,
+	GPS_SIM = 0, //unused, position simulation is replaced by the runtime replay (see GpsReplay.h)
+	GPS_PVT = 1, //UBX-NAV-PVT
+	GPS_GLL = 2,
+	GPS_GGA = 3,
+	GPS_RMC = 4,
 	GPS_NUM_MSG_TYPES //Should always be the last element in the enum. Represents the number of message types. If you need to add a new type, put it before this element.
 }GPS_MsgTypes;
 
@@ -60,10 +110,53 @@ typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))
 
 	uint8_t msg_type; //GPS_MsgTypes //h10
 
-	uint32_t quality; //h11-h14
+	uint32_t quality; //h11-h14 //see GPS_QUALITY_PACK
 
 }GPS_Data;
 
+typedef enum __GPS_POWER_STATES {
+	GPS_POWER_OFF,		//power FET off, next wake is a cold start
+	GPS_POWER_STANDBY,	//receiver in software standby (backup), next wake is a hot start
+	GPS_POWER_ON,
+	GPS_NUM_POWER_STATES
+}GPS_PowerState;
+
+typedef enum __GPS_WAKE_TYPES {
+	GPS_WAKE_COLD = 0,	//from GPS_POWER_OFF
+	GPS_WAKE_HOT = 1,	//from GPS_POWER_STANDBY
+	GPS_NUM_WAKE_TYPES
+}GPS_WakeType;
+
+//Time to first fix and energy statistics for a single wake type
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) __GPS_PowerStats {
+	uint32_t wakes;
+	uint32_t fixes;			//wakes that reached a position fix
+	uint32_t ttff_last_ms;
+	uint32_t ttff_min_ms;
+	uint32_t ttff_max_ms;
+	uint32_t ttff_total_ms;	//ttff_total_ms / fixes gives the average TTFF
+	uint32_t energy_mJ;		//estimated receiver energy (on + standby time), energy_mJ / fixes gives the energy per fix
+}GPS_PowerStats;
+
+//Health of the ingest path (DMA callback -> framer -> sentence ring)
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) __GPS_IngestStats {
+	GpsFramerStats framer;
+	uint32_t callbacks;				//DMA half/full transfer callbacks
+	uint32_t callback_max_cycles;	//worst case callback time, in core cycles
+	uint32_t callback_total_cycles;
+	uint32_t ring_overruns;			//sentences overwritten before the buffer thread released them
+}GPS_IngestStats;
+
+//Fix quality, taken from GGA/GSA/NAV-PVT
+typedef struct __GPS_FixQuality {
+	uint8_t fix_type;		//UbxFixType
+	uint8_t satellites;
+	float hdop;
+	uint32_t fix_type_tick;	//HAL tick of the last update of each field
+	uint32_t satellites_tick;
+	uint32_t hdop_tick;
+}GPS_FixQuality;
+
 typedef struct __GPS_TypeDef {
 
 	//UART handler for communication
@@ -73,6 +166,17 @@ typedef struct __GPS_TypeDef {
 
 	GPS_Data data[GPS_NUM_MSG_TYPES];
 
+	//Fused fix: position and time from the freshest sentence, quality from GGA/GSA/NAV-PVT
+	GPS_Data fix;
+	uint32_t fix_tick; //HAL tick of the last position update
+	Timestamp fix_timestamp;
+	GPS_FixQuality fix_quality;
+
+	//Adaptive lock timeout, learned from previous attempts
+	GpsAcqEstimator acquisition;
+	GpsAcqResult acquisition_result; //outcome of the last get_gps_lock()
+	Timestamp acquisition_timestamp; //end of the last get_gps_lock()
+
 }GPS_HandleTypeDef;
 
 //Initialized and configures the GPS
@@ -81,17 +185,52 @@ HAL_StatusTypeDef initialize_gps(UART_HandleTypeDef* huart, GPS_HandleTypeDef* g
 //Polls for new data from the GPS, parses it and stores it in the GPS struct. Returns true if it has successfully locked onto a positon.
 bool read_gps_data(GPS_HandleTypeDef* gps);
 
-//Repeatedly tries to read the GPS data to get a lock. User should call this function if they want a position lock.
-bool get_gps_lock(GPS_HandleTypeDef* gps, GPS_Data* gps_data);
+//Repeatedly tries to read the GPS data to get a lock that passes the gate. User should call this function if they want a position lock.
+//The attempt ends early if no satellite signal is visible, and is extended while satellites are being acquired (see GpsAcquisition.h).
+bool get_gps_lock(GPS_HandleTypeDef* gps, GPS_Data* gps_data, const GpsFixGate *gate);
+
+//Returns true if the fused fix currently passes the gate
+bool gps_fix_passes_gate(const GPS_HandleTypeDef* gps, const GpsFixGate *gate);
+
+//Summarizes the satellite signals reported by the receiver over the last GPS_SATELLITE_MAX_AGE_MS
+void gps_get_signal_summary(GpsSignalSummary *summary);
 
 //Checks if a GPS location is in dominica based on the latitude and longitude
 bool is_in_dominica(float latitude, float longitude);
 
 // public methods 
-const uint8_t * gpsBuffer_pop_latest(void);
+const GPS_Sentence * gpsBuffer_pop_latest(void);
 void gpsBuffer_thread(ULONG thread_input);
 void gps_sleep(void);
+void gps_sleep_for(uint32_t expected_off_s);
 void gps_wake(void);
+GPS_PowerState gps_get_power_state(void);
+const GPS_PowerStats * gps_get_power_stats(GPS_WakeType wake_type);
+
+//Total time spent in a power state since boot (including the current period)
+uint32_t gps_get_power_state_time_ms(GPS_PowerState power_state);
+
+//How long before a fix is needed gps_wake() should be called, from the measured TTFF of the next wake's type. 0 while on.
+uint32_t gps_get_wake_lead_ms(void);
+
+//Continuous mode (e.g. logging on the Pi): gps_sleep_for() keeps the receiver on. gps_sleep() still powers it off.
+void gps_set_continuous(bool continuous);
+bool gps_is_continuous(void);
 void GPS_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size);
 
+//Feeds bytes into the sentence framer as if received from the receiver. Returns the number of completed sentences.
+size_t gps_feed(const uint8_t *data, size_t length);
+
+//Drops the partially framed sentence
+void gps_feed_reset(void);
+
+//Wakes the GPS buffer thread (e.g. replay data is waiting)
+void gpsBuffer_notify(void);
+
+//Releases the sentences framed since the last call to read_gps_data() and forwards them to the Pi. Called by the GPS
+//buffer thread on every wakeup.
+void gpsBuffer_release(void);
+
+GPS_IngestStats gps_get_ingest_stats(void);
+
 #endif /* INC_RECOVERY_INC_GPS_H_ */
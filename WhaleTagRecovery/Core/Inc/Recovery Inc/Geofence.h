@@ -0,0 +1,92 @@
+/*
+ * Geofence.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Polygon geofences with per-region APRS settings.
+ *
+ * APRS frequencies, digipeater paths and acceptable transmit behaviour differ between regions (e.g. 145.050 MHz
+ * around Dominica, 144.390 MHz in North America). Instead of a single compile-time frequency, the Pi loads a table
+ * of up to GEOFENCE_MAX_REGIONS polygons (see PI_COMM_MSG_CONFIG_GEOFENCE_REGION), each carrying:
+ *  - the APRS frequency
+ *  - the digipeater path (e.g. "WIDE1-1,WIDE2-1")
+ *  - the beacon policy (enabled, interval)
+ *  - the VHF power level
+ *
+ * After every GPS lock the APRS thread calls geofence_update() with the position. The first polygon containing
+ * the position wins; outside of all polygons the default settings from g_config apply. The radio is only
+ * reconfigured when the active region changes, so a region crossing costs a single vhf_set_freq().
+ *
+ * Each polygon's bounding box is computed when it is loaded and checked before the (more expensive) even-odd
+ * ray casting test. Polygons must not cross the antimeridian.
+ *
+ * The table is kept in the config store along with the rest of the configuration (see config_save()), and restored
+ * by geofence_init().
+ */
+
+#ifndef INC_RECOVERY_INC_GEOFENCE_H_
+#define INC_RECOVERY_INC_GEOFENCE_H_
+
+#include "main.h"
+#include "config.h"
+#include "Recovery Inc/VHF.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define GEOFENCE_MAX_REGIONS  8
+#define GEOFENCE_MAX_VERTICES 16
+
+//Digipeater path, comma separated CALLSIGN-SSID list (see aprs_set_digi_path())
+#define GEOFENCE_DIGI_PATH_LENGTH 16
+
+//Path used outside of all regions, same as the compiled in APRS_DIGI_PATH/APRS_DIGI_SSID
+#define GEOFENCE_DEFAULT_DIGI_PATH "WIDE2-2"
+
+//Region indices returned by geofence_find_region()
+#define GEOFENCE_REGION_DEFAULT GEOFENCE_MAX_REGIONS //outside of all polygons
+#define GEOFENCE_REGION_UNKNOWN 0xFF                 //no position yet, or the table changed
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef struct geofence_beacon_policy_t {
+	bool		enabled;		//false: stay silent while in this region
+	uint16_t	interval_s;		//0: default APRS interval
+}GeofenceBeaconPolicy;
+
+typedef struct geofence_polygon_t {
+	uint8_t					vertex_count;	//0: unused entry
+	GlobalPosition			vertices[GEOFENCE_MAX_VERTICES];
+	GeofenceRegion			bounds;			//bounding box, computed by geofence_set_region()
+	float					aprs_freq_MHz;
+	VHFPowerLevel			power_level;
+	char					digi_path[GEOFENCE_DIGI_PATH_LENGTH + 1];
+	GeofenceBeaconPolicy	beacon;
+}GeofencePolygon;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Restores the regions stored by geofence_save(), after config_store_init()
+void geofence_init(void);
+
+//Stores the table, writing only the regions that changed
+void geofence_save(void);
+
+//Removes all regions
+void geofence_clear(void);
+
+//Loads (or replaces) the region at index. Computes the bounding box of the polygon.
+HAL_StatusTypeDef geofence_set_region(uint8_t index, const GeofencePolygon *polygon);
+
+//Forces the settings to be re-applied on the next geofence_update() (e.g. after g_config changed)
+void geofence_invalidate(void);
+
+//Returns the index of the first region containing the position, or GEOFENCE_REGION_DEFAULT
+uint8_t geofence_find_region(float latitude, float longitude);
+
+//Applies the settings of the region containing the position to the radio and APRS packets if the region changed.
+//The beacon policy of the active region is returned through beacon. Returns true if the region changed.
+bool geofence_update(VHF_HandleTypdeDef *vhf, float latitude, float longitude, GeofenceBeaconPolicy *beacon);
+
+#endif /* INC_RECOVERY_INC_GEOFENCE_H_ */
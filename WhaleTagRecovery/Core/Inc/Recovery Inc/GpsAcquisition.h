@@ -0,0 +1,101 @@
+/*
+ * GpsAcquisition.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Adaptive acquisition policy for GPS lock attempts.
+ *
+ * Instead of a fixed lock timeout, each attempt watches the satellite signals reported by the receiver (GSV):
+ *  - no satellite above GPS_ACQ_MIN_CNO after GPS_ACQ_NO_SIGNAL_ABORT_MS -> abort early, the antenna is most likely under water
+ *  - satellites/C/N0 still improving when the deadline is reached      -> extend the attempt (up to GPS_ACQ_MAX_TIMEOUT_MS)
+ *
+ * The outcome of every attempt feeds an estimator of the next attempt's timeout:
+ *  - success:            timeout = GPS_ACQ_TIMEOUT_MARGIN x (moving average of the time to lock)
+ *  - timeout w/ signal:  timeout grows by 50% (the receiver needed longer than we gave it)
+ *  - no signal abort:    unchanged (says nothing about how long acquisition takes)
+ *
+ * This file has no hardware dependencies, all times are passed in by the caller.
+ */
+
+#ifndef INC_RECOVERY_INC_GPSACQUISITION_H_
+#define INC_RECOVERY_INC_GPSACQUISITION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define GPS_ACQ_INITIAL_TIMEOUT_MS (60 * 1000) //enough for a cold start under open sky
+#define GPS_ACQ_MIN_TIMEOUT_MS     (5 * 1000)
+#define GPS_ACQ_MAX_TIMEOUT_MS     (180 * 1000)
+
+//Minimum C/N0 (dB-Hz) for a satellite to count as having usable signal
+#define GPS_ACQ_MIN_CNO 20
+
+//Time without any usable signal before giving up on the attempt (includes receiver boot)
+#define GPS_ACQ_NO_SIGNAL_ABORT_MS (10 * 1000)
+
+//The attempt is extended if the signal improved within this window before the deadline
+#define GPS_ACQ_PROGRESS_WINDOW_MS (5 * 1000)
+#define GPS_ACQ_EXTEND_MS          (15 * 1000)
+
+//C/N0 increase (dB-Hz) of the strongest satellite that counts as progress
+#define GPS_ACQ_CNO_PROGRESS_STEP 3
+
+#define GPS_ACQ_TIMEOUT_MARGIN 2
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum gps_acq_result_e {
+	GPS_ACQ_CONTINUE,
+	GPS_ACQ_SUCCESS,
+	GPS_ACQ_ABORT_NO_SIGNAL,
+	GPS_ACQ_TIMEOUT,
+}GpsAcqResult;
+
+//Satellite signal summary over the last couple of seconds
+typedef struct gps_signal_summary_t {
+	uint8_t satellites_in_view;
+	uint8_t satellites_with_signal;	//C/N0 >= GPS_ACQ_MIN_CNO
+	uint8_t max_cno;				//dB-Hz
+}GpsSignalSummary;
+
+typedef struct gps_acq_attempt_t {
+	uint32_t start_ms;
+	uint32_t deadline_ms;
+	uint32_t last_progress_ms;
+	uint8_t best_satellites_with_signal;
+	uint8_t best_max_cno;
+}GpsAcqAttempt;
+
+typedef struct gps_acq_estimator_t {
+	uint32_t next_timeout_ms;
+	uint32_t average_lock_ms;	//moving average of successful attempts, 0 until the first success
+
+	//statistics
+	uint32_t attempts;
+	uint32_t successes;
+	uint32_t aborts_no_signal;
+	uint32_t timeouts;
+	uint32_t total_attempt_ms;	//total_attempt_ms / successes is proportional to the acquisition energy per fix
+}GpsAcqEstimator;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+void gps_acq_init(GpsAcqEstimator *estimator);
+
+//Starts a new attempt with the estimator's current timeout
+void gps_acq_start(const GpsAcqEstimator *estimator, GpsAcqAttempt *attempt, uint32_t now_ms);
+
+//Updates the attempt with the current fix state and signals. Returns GPS_ACQ_CONTINUE until the attempt is over.
+GpsAcqResult gps_acq_update(GpsAcqAttempt *attempt, uint32_t now_ms, bool has_fix, const GpsSignalSummary *signal);
+
+//Feeds the outcome of a finished attempt into the estimator
+void gps_acq_finish(GpsAcqEstimator *estimator, const GpsAcqAttempt *attempt, GpsAcqResult result, uint32_t now_ms);
+
+//Plans the retry of a failed attempt ending at now. The caller wakes the receiver wake_lead (its boot and expected
+//time to first fix from the power state it was left in, 0 if left on) ahead of the returned time, so the receiver
+//stays in that state for off first. wake_lead must be taken after the receiver was put to sleep. Any time unit.
+uint32_t gps_acq_plan_retry(uint32_t now, uint32_t off, uint32_t wake_lead);
+
+#endif /* INC_RECOVERY_INC_GPSACQUISITION_H_ */
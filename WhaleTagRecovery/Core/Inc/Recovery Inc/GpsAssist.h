@@ -0,0 +1,71 @@
+/*
+ * GpsAssist.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * This file handles u-blox AssistNow (UBX-MGA) assistance data for the NEO M9N.
+ *
+ * The Pi streams a blob of UBX-MGA frames (e.g. AssistNow Offline MGA-ANO data downloaded before deployment) to
+ * the recovery board in chunks. The blob is written into a dedicated flash region (see Lib Inc/flash.h), validated
+ * frame by frame and then injected into the receiver on every gps_wake(), preceded by the current UTC time
+ * (UBX-MGA-INI-TIME_UTC). With time and orbit data available the receiver can skip most of its search, cutting
+ * the time to first fix from ~30 s to a few seconds.
+ *
+ * Transfer sequence (see PiComms.h):
+ *  1. PI_COMM_MSG_MGA_BEGIN (total length + current UTC time) -> erases the flash region, syncs the time service
+ *  2. PI_COMM_MSG_MGA_CHUNK (offset + data), repeated       -> chunks must arrive in order, a repeated chunk is acknowledged again without being rewritten
+ *  3. PI_COMM_MSG_MGA_END   (total length)                    -> validates the stored frames and marks the blob as valid
+ * Every message is answered with a PI_COMM_MSG_MGA_ACK carrying a status and the next expected offset.
+ */
+
+#ifndef INC_RECOVERY_INC_GPSASSIST_H_
+#define INC_RECOVERY_INC_GPSASSIST_H_
+
+#include "main.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define GPS_ASSIST_MAGIC 0x4D474131 //"MGA1"
+
+//Assumed accuracy of the injected time (see Lib Inc/time_service.h). Deliberately loose, the time may come from the Pi or the RTC.
+#define GPS_ASSIST_TIME_ACCURACY_S 2
+
+//Gap between injected frames so that the receiver's input buffer is not overrun
+#define GPS_ASSIST_INTER_FRAME_DELAY_MS 2
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum gps_assist_status_e {
+	GPS_ASSIST_OK = 0,
+	GPS_ASSIST_ERROR_NO_TRANSFER,	//chunk/end received without a begin
+	GPS_ASSIST_ERROR_SEQUENCE,		//chunk offset is ahead of the next expected offset
+	GPS_ASSIST_ERROR_LENGTH,		//blob does not fit in flash, or does not match the announced length
+	GPS_ASSIST_ERROR_FLASH,			//flash erase/program failed
+	GPS_ASSIST_ERROR_INVALID,		//stored data is not a sequence of valid UBX-MGA frames
+}GpsAssistStatus;
+
+//Stored at the start of the flash region, written last so that an interrupted transfer is never injected
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t magic;
+	uint32_t length;		//bytes of MGA data following the header
+	uint32_t upload_time;	//UTC (unix seconds) at the time of upload
+	uint32_t __res;
+}GpsAssistHeader;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Flash transfer of the assistance blob. Each returns the status to acknowledge, and the next expected offset through next_offset.
+GpsAssistStatus gps_assist_begin(uint32_t length, uint32_t utc_time, uint32_t *next_offset);
+GpsAssistStatus gps_assist_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset);
+GpsAssistStatus gps_assist_end(uint32_t length, uint32_t *next_offset);
+
+//Returns true if a valid assistance blob is stored in flash
+bool gps_assist_is_valid(void);
+
+//Sends the time assistance and the stored MGA frames through send. Frames of MGA-ANO data for other days are skipped.
+HAL_StatusTypeDef gps_assist_inject(HAL_StatusTypeDef (*send)(const uint8_t *frame, size_t frame_length));
+
+#endif /* INC_RECOVERY_INC_GPSASSIST_H_ */
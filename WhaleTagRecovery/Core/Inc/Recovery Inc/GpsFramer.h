@@ -0,0 +1,85 @@
+/*
+ * GpsFramer.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Splits the raw byte stream from the GPS into NMEA sentences and UBX frames.
+ *
+ * Sentences are assembled directly in the next free slot of a sentence ring, so sentences spanning DMA
+ * half-buffers (or any other split of the stream) need no extra copy. A completed sentence is published by moving
+ * the write index on, the consumer owns everything between its read index and the write index.
+ *
+ * This file has no HAL or ThreadX dependencies (reception times are passed in by the caller), so the ingest path
+ * can be built and exercised off-target.
+ */
+
+#ifndef INC_RECOVERY_INC_GPSFRAMER_H_
+#define INC_RECOVERY_INC_GPSFRAMER_H_
+
+#include "Recovery Inc/Ubx.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Longest NMEA sentence (excluding "\r\n") defined by the NMEA 0183 standard
+#define GPS_NMEA_MAX_SIZE (82)
+
+//Each buffered sentence holds either a NMEA sentence (+ null terminator) or a UBX frame (NAV-PVT is the largest we keep)
+#define GPS_SENTENCE_BUFFER_SIZE (UBX_NAV_PVT_FRAME_LENGTH)
+
+#define GPS_NMEA_START_CHAR '$'
+#define GPS_NMEA_END_CHAR   '\r'
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum __GPS_SENTENCE_TYPES {
+	GPS_SENTENCE_NMEA,
+	GPS_SENTENCE_UBX,
+}GPS_SentenceType;
+
+//A single sentence/frame received from the GPS. NMEA sentences are null terminated, UBX frames include sync chars and checksum.
+typedef struct __GPS_Sentence {
+	GPS_SentenceType type;
+	size_t length;
+	uint32_t rx_tick; //time_monotonic_ms() at the end of the sentence, for time syncs
+	uint8_t sentence[GPS_SENTENCE_BUFFER_SIZE];
+}GPS_Sentence;
+
+typedef enum {
+	GPS_FRAMER_IDLE,	//searching for '$' or UBX sync char
+	GPS_FRAMER_NMEA,	//inside of a NMEA sentence
+	GPS_FRAMER_UBX,		//inside of a UBX frame
+}GpsFramerState;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t bytes;
+	uint32_t nmea_sentences;
+	uint32_t ubx_frames;
+	uint32_t nmea_too_long;		//sentences longer than GPS_NMEA_MAX_SIZE, dropped
+	uint32_t nmea_truncated;	//sentences interrupted by the start of another one, dropped
+	uint32_t ubx_errors;		//UBX frames with a bad checksum or too large, dropped
+}GpsFramerStats;
+
+typedef struct {
+	GpsFramerState state;
+	UbxParser ubx_parser;
+	GPS_Sentence *ring;
+	size_t ring_count;
+	volatile size_t write_index;
+	GpsFramerStats stats;
+}GpsFramer;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Attaches the framer to a sentence ring, starting with an empty ring
+void gps_framer_init(GpsFramer *framer, GPS_Sentence *ring, size_t ring_count);
+
+//Drops the partially framed sentence
+void gps_framer_reset(GpsFramer *framer);
+
+//Feeds received bytes, stamping completed sentences with rx_tick. Returns the number of completed sentences.
+size_t gps_framer_feed(GpsFramer *framer, const uint8_t *data, size_t length, uint32_t rx_tick);
+
+#endif /* INC_RECOVERY_INC_GPSFRAMER_H_ */
@@ -0,0 +1,87 @@
+/*
+ * GpsReplay.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Runtime replay of recorded GPS output (NMEA and/or UBX), streamed by the Pi.
+ *
+ * Replayed bytes go through the same sentence framer and parsers as the USART3 DMA data, so beaconing, geofencing
+ * and scheduling can be bench tested on real tracks. While a replay runs the receiver is kept off: its DMA data is
+ * ignored, gps_wake()/gps_sleep() do nothing, and replayed time (RMC/ZDA/NAV-PVT) does not sync the time service.
+ * Replay needs the GPS buffer thread running (i.e. not in STATE_WAITING).
+ *
+ * Pacing:
+ *  - GPS_REPLAY_REAL_TIME: each chunk is fed when its offset (recording time of its first byte, relative to the
+ *    first chunk) is reached, so the Pi should split the recording at sentence boundaries.
+ *  - GPS_REPLAY_AS_FAST_AS_POSSIBLE: chunks are fed as soon as they arrive. The statistics (cycles spent framing
+ *    and parsing per byte/sentence) then give the on-target parser throughput.
+ *
+ * Transfer sequence (see PiComms.h):
+ *  1. PI_COMM_MSG_GPS_REPLAY_BEGIN (pacing)            -> powers the receiver off, acknowledged with the free chunk slots
+ *  2. PI_COMM_MSG_GPS_REPLAY_DATA  (offset_ms + data)  -> acknowledged once the chunk was fed. The Pi may have up to
+ *                                                         free_chunks chunks in flight, a chunk that doesn't fit is
+ *                                                         rejected with GPS_REPLAY_ERROR_FULL.
+ *  3. PI_COMM_MSG_GPS_REPLAY_END                       -> drops unfed chunks, acknowledged with the final statistics
+ */
+
+#ifndef INC_RECOVERY_INC_GPSREPLAY_H_
+#define INC_RECOVERY_INC_GPSREPLAY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Chunks buffered ahead of the framer (one slot is kept free)
+#define GPS_REPLAY_CHUNK_COUNT 8
+
+//Largest chunk, the PiComms payload minus the offset field
+#define GPS_REPLAY_CHUNK_SIZE (255 - sizeof(uint32_t))
+
+//gps_replay_service() return value when no chunk is waiting
+#define GPS_REPLAY_NO_CHUNK UINT32_MAX
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum gps_replay_pacing_e {
+	GPS_REPLAY_REAL_TIME = 0,
+	GPS_REPLAY_AS_FAST_AS_POSSIBLE = 1,
+}GpsReplayPacing;
+
+typedef enum gps_replay_status_e {
+	GPS_REPLAY_OK = 0,
+	GPS_REPLAY_ERROR_NOT_ACTIVE,	//data/end received without a begin
+	GPS_REPLAY_ERROR_FULL,			//no free chunk slot, resend the chunk after the next acknowledgement
+	GPS_REPLAY_ERROR_LENGTH,		//chunk empty or larger than GPS_REPLAY_CHUNK_SIZE, or unknown pacing
+}GpsReplayStatus;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t chunks;			//chunks fed
+	uint32_t bytes;				//bytes fed
+	uint32_t sentences;			//NMEA sentences and UBX frames completed by the framer
+	uint32_t framer_cycles;		//core cycles spent framing
+	uint32_t parsed;			//sentences parsed by read_gps_data()
+	uint32_t parse_cycles;		//core cycles spent parsing
+	uint32_t elapsed_ms;		//from the first to the last fed chunk
+	uint32_t core_clock_hz;		//to convert cycles to time
+}GpsReplayStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+GpsReplayStatus gps_replay_begin(GpsReplayPacing pacing);
+GpsReplayStatus gps_replay_write_chunk(uint32_t offset_ms, const uint8_t *data, size_t length);
+GpsReplayStatus gps_replay_end(void);
+
+bool gps_replay_is_active(void);
+uint8_t gps_replay_free_chunks(void);
+GpsReplayStats gps_replay_get_stats(void);
+
+//Called by the GPS buffer thread: feeds the chunks that are due into the framer. Returns the number of chunks fed
+//through fed_chunks, and the time until the next chunk is due in ms (GPS_REPLAY_NO_CHUNK if none is waiting).
+uint32_t gps_replay_service(uint_fast8_t *fed_chunks);
+
+//Adds the cost of parsing replayed sentences to the statistics
+void gps_replay_account_parse(uint32_t sentences, uint32_t cycles);
+
+#endif /* INC_RECOVERY_INC_GPSREPLAY_H_ */
@@ -0,0 +1,88 @@
+/*
+ * Kiss.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * KISS TNC, letting the Pi's packet software (e.g. Dire Wolf or kissattach) send any AX.25 frame through the board's
+ * AFSK modulator and VHF transmitter.
+ *
+ * The KISS byte stream (frames delimited by FEND, with FEND/FESC escaped) is carried in PI_COMM_MSG_KISS messages,
+ * which may cut it anywhere: frames are reassembled across messages. Data frames (command 0, port 0) hold an AX.25
+ * frame without flags nor FCS, the FCS is computed here. They are queued, and the TNC thread sends every queued frame
+ * in a single key-up once the channel access (p-persistence) allows it.
+ *
+ * Supported commands: TXDELAY, P, SLOTTIME, TXTAIL and FULLDUPLEX (no channel access delay). SETHARDWARE and RETURN
+ * are ignored.
+ *
+ * The board has neither a receive audio path nor a carrier detect: no frame is ever returned to the Pi, and the
+ * channel is taken as clear (p-persistence still spreads the key-ups of stations sharing it).
+ */
+
+#ifndef INC_RECOVERY_INC_KISS_H_
+#define INC_RECOVERY_INC_KISS_H_
+
+#include "tx_api.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+//Special characters
+#define KISS_FEND  0xC0
+#define KISS_FESC  0xDB
+#define KISS_TFEND 0xDC
+#define KISS_TFESC 0xDD
+
+//Commands (low nibble of the command byte, the high nibble is the port)
+#define KISS_CMD_DATA        0x00
+#define KISS_CMD_TXDELAY     0x01 //units of 10 ms
+#define KISS_CMD_PERSISTENCE 0x02 //p = (value + 1) / 256
+#define KISS_CMD_SLOT_TIME   0x03 //units of 10 ms
+#define KISS_CMD_TXTAIL      0x04 //units of 10 ms
+#define KISS_CMD_FULL_DUPLEX 0x05
+#define KISS_CMD_SET_HARDWARE 0x06
+#define KISS_CMD_RETURN      0xFF //whole command byte
+
+//Defaults, as recommended by the KISS specification (TXDELAY matches AX25_TXDELAY_MS)
+#define KISS_DEFAULT_TXDELAY     50
+#define KISS_DEFAULT_PERSISTENCE 63
+#define KISS_DEFAULT_SLOT_TIME   10
+#define KISS_DEFAULT_TXTAIL      0
+
+//Flags always sent after the last frame, whatever TXTAIL
+#define KISS_MIN_TAIL_FLAGS 3
+
+//AX.25 frame without FCS: 2 to 10 addresses (7 bytes each), control, PID and up to 256 information bytes
+#define KISS_MIN_FRAME_LENGTH 15
+#define KISS_MAX_FRAME_LENGTH 328
+#define KISS_FCS_LENGTH 2
+
+//Frames waiting for the transmitter, and most frames sent in one key-up (frames queued meanwhile are added)
+#define KISS_QUEUE_COUNT 4
+#define KISS_MAX_FRAMES_PER_KEY_UP 8
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t frames_queued;
+	uint32_t frames_sent;
+	uint32_t key_ups;
+	uint32_t frames_dropped;	//queue full, or transmitter failing to key
+	uint32_t frames_invalid;	//too short or too long
+	uint32_t ignored;			//other ports, unsupported commands
+}KissStats;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Creates the TNC's semaphore, before the Pi messages are handled or the thread started
+void kiss_init(void);
+
+//Decodes a piece of the KISS byte stream, queueing the completed data frames. Never blocks.
+void kiss_receive(const uint8_t *data, size_t length);
+
+//TNC thread: sends the queued frames
+void kiss_thread_entry(ULONG thread_input);
+
+KissStats kiss_get_stats(void);
+
+#endif /* INC_RECOVERY_INC_KISS_H_ */
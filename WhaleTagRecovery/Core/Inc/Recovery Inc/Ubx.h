@@ -0,0 +1,207 @@
+/*
+ * Ubx.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * This file contains the framing and message helpers for the u-blox UBX binary protocol used by the NEO M9N.
+ *
+ * A UBX frame is laid out as:
+ *      0xB5 0x62 | class | id | length (U2, little-endian) | payload | CK_A | CK_B
+ *
+ * The checksum is an 8-bit Fletcher checksum computed over class, id, length and payload.
+ *
+ * Configuration of the M9 series is done exclusively through the configuration database (UBX-CFG-VALSET),
+ * the key IDs used by this firmware are listed below.
+ *
+ * Interface Description: https://content.u-blox.com/sites/default/files/u-blox-M9-SPG-4.04_InterfaceDescription_UBX-21022436.pdf
+ */
+
+#ifndef INC_RECOVERY_INC_UBX_H_
+#define INC_RECOVERY_INC_UBX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*** MACROS ******************************************************************/
+
+#define UBX_SYNC_CHAR_1 0xB5
+#define UBX_SYNC_CHAR_2 0x62
+
+//sync chars + class + id + length
+#define UBX_HEADER_LENGTH 6
+#define UBX_CHECKSUM_LENGTH 2
+#define UBX_FRAME_OVERHEAD (UBX_HEADER_LENGTH + UBX_CHECKSUM_LENGTH)
+
+/* message classes and ids */
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_RXM 0x02
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_CLASS_MGA 0x13
+
+#define UBX_ID_NAV_PVT    0x07
+#define UBX_ID_ACK_NAK    0x00
+#define UBX_ID_ACK_ACK    0x01
+#define UBX_ID_CFG_VALSET 0x8A
+#define UBX_ID_RXM_PMREQ  0x41
+#define UBX_ID_MGA_ANO    0x20
+#define UBX_ID_MGA_INI    0x40
+
+#define UBX_NAV_PVT_PAYLOAD_LENGTH 92
+#define UBX_NAV_PVT_FRAME_LENGTH   (UBX_NAV_PVT_PAYLOAD_LENGTH + UBX_FRAME_OVERHEAD)
+
+/* CFG-VALSET layers */
+#define UBX_CFG_LAYER_RAM   (1 << 0)
+#define UBX_CFG_LAYER_BBR   (1 << 1)
+#define UBX_CFG_LAYER_FLASH (1 << 2)
+
+//The interface description limits a single VALSET message to 64 key/value pairs
+#define UBX_CFG_VALSET_MAX_ITEMS 64
+
+/* configuration key IDs (bits 28-30 of the key encode the value size) */
+#define UBX_CFG_RATE_MEAS                 0x30210001 //U2: measurement period (ms)
+#define UBX_CFG_RATE_NAV                  0x30210002 //U2: measurements per navigation solution
+#define UBX_CFG_UART1_BAUDRATE            0x40520001 //U4
+#define UBX_CFG_UART1OUTPROT_UBX          0x10740001 //L
+#define UBX_CFG_UART1OUTPROT_NMEA         0x10740002 //L
+#define UBX_CFG_MSGOUT_UBX_NAV_PVT_UART1  0x20910007 //U1: output rate per navigation solution
+#define UBX_CFG_MSGOUT_NMEA_GGA_UART1     0x209100bb
+#define UBX_CFG_MSGOUT_NMEA_GLL_UART1     0x209100ca
+#define UBX_CFG_MSGOUT_NMEA_GSA_UART1     0x209100c0
+#define UBX_CFG_MSGOUT_NMEA_GSV_UART1     0x209100c5
+#define UBX_CFG_MSGOUT_NMEA_RMC_UART1     0x209100ac
+#define UBX_CFG_MSGOUT_NMEA_VTG_UART1     0x209100b1
+
+/* NAV-PVT valid field */
+#define UBX_NAV_PVT_VALID_DATE           (1 << 0)
+#define UBX_NAV_PVT_VALID_TIME           (1 << 1)
+#define UBX_NAV_PVT_VALID_FULLY_RESOLVED (1 << 2)
+
+/* NAV-PVT flags field */
+#define UBX_NAV_PVT_FLAGS_GNSS_FIX_OK    (1 << 0)
+
+/* RXM-PMREQ (power management request) */
+#define UBX_RXM_PMREQ_PAYLOAD_LENGTH   16
+#define UBX_RXM_PMREQ_FLAGS_BACKUP     (1 << 1)
+#define UBX_RXM_PMREQ_FLAGS_FORCE      (1 << 2)
+#define UBX_RXM_PMREQ_WAKEUP_UARTRX    (1 << 3)
+#define UBX_RXM_PMREQ_WAKEUP_EXTINT0   (1 << 5)
+
+/* MGA-ANO (AssistNow Offline) payload offsets */
+#define UBX_MGA_ANO_YEAR_OFFSET  4 //years since 2000
+#define UBX_MGA_ANO_MONTH_OFFSET 5
+#define UBX_MGA_ANO_DAY_OFFSET   6
+
+/* MGA-INI-TIME_UTC */
+#define UBX_MGA_INI_TIME_UTC_TYPE 0x10
+#define UBX_MGA_INI_TIME_UTC_PAYLOAD_LENGTH 24
+
+/*** TYPE DEFINITIONS ********************************************************/
+
+typedef enum ubx_fix_type_e {
+	UBX_FIX_NONE = 0,
+	UBX_FIX_DEAD_RECKONING = 1,
+	UBX_FIX_2D = 2,
+	UBX_FIX_3D = 3,
+	UBX_FIX_GNSS_DEAD_RECKONING = 4,
+	UBX_FIX_TIME_ONLY = 5,
+}UbxFixType;
+
+typedef enum ubx_parse_result_e {
+	UBX_PARSE_INCOMPLETE,	//byte consumed, frame not finished
+	UBX_PARSE_COMPLETE,		//a full frame (payload_length + UBX_FRAME_OVERHEAD bytes) with a valid checksum is in the parser buffer
+	UBX_PARSE_ERROR,		//checksum failure or frame too large, parser has reset
+}UbxParseResult;
+
+typedef enum ubx_parser_state_e {
+	UBX_STATE_SYNC_1,
+	UBX_STATE_SYNC_2,
+	UBX_STATE_CLASS,
+	UBX_STATE_ID,
+	UBX_STATE_LENGTH_1,
+	UBX_STATE_LENGTH_2,
+	UBX_STATE_PAYLOAD,
+	UBX_STATE_CK_A,
+	UBX_STATE_CK_B,
+}UbxParserState;
+
+//Incremental (byte at a time) UBX frame parser. The whole frame, including the sync characters and checksum, is written into buffer.
+typedef struct ubx_parser_t {
+	UbxParserState state;
+	uint8_t *buffer;
+	uint16_t buffer_size;
+	uint16_t index;
+	uint16_t payload_length;
+	uint8_t ck_a;
+	uint8_t ck_b;
+}UbxParser;
+
+typedef struct ubx_config_item_t {
+	uint32_t key;
+	uint32_t value; //only the number of bytes encoded by the key are sent
+}UbxConfigItem;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t iTOW;		//ms
+	uint16_t year;
+	uint8_t  month;
+	uint8_t  day;
+	uint8_t  hour;
+	uint8_t  min;
+	uint8_t  sec;
+	uint8_t  valid;
+	uint32_t tAcc;		//ns
+	int32_t  nano;		//ns
+	uint8_t  fixType;	//UbxFixType
+	uint8_t  flags;
+	uint8_t  flags2;
+	uint8_t  numSV;
+	int32_t  lon;		//deg * 1e-7
+	int32_t  lat;		//deg * 1e-7
+	int32_t  height;	//mm
+	int32_t  hMSL;		//mm
+	uint32_t hAcc;		//mm
+	uint32_t vAcc;		//mm
+	int32_t  velN;		//mm/s
+	int32_t  velE;		//mm/s
+	int32_t  velD;		//mm/s
+	int32_t  gSpeed;	//mm/s
+	int32_t  headMot;	//deg * 1e-5
+	uint32_t sAcc;		//mm/s
+	uint32_t headAcc;	//deg * 1e-5
+	uint16_t pDOP;		//0.01
+	uint16_t flags3;
+	uint8_t  reserved0[4];
+	int32_t  headVeh;	//deg * 1e-5
+	int16_t  magDec;	//deg * 1e-2
+	uint16_t magAcc;	//deg * 1e-2
+}UbxNavPvt;
+
+/*** FUNCTION DECLARATIONS ***************************************************/
+
+//Computes the 8-bit Fletcher checksum over the len bytes starting at data
+void ubx_checksum(const uint8_t *data, size_t len, uint8_t *ck_a, uint8_t *ck_b);
+
+//Writes a complete UBX frame into dst. Returns the frame length, or 0 if dst is too small.
+size_t ubx_build_frame(uint8_t *dst, size_t dst_size, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t payload_length);
+
+//Writes a UBX-CFG-VALSET frame setting all items in the given layers. Returns the frame length, or 0 on failure.
+size_t ubx_build_valset(uint8_t *dst, size_t dst_size, uint8_t layers, const UbxConfigItem *items, size_t item_count);
+
+//Writes a UBX-RXM-PMREQ frame. A duration of 0 keeps the receiver in backup until one of the wakeup sources triggers.
+size_t ubx_build_pmreq(uint8_t *dst, size_t dst_size, uint32_t duration_ms, uint32_t flags, uint32_t wakeup_sources);
+
+//Resets the parser and points it at a new destination buffer
+void ubx_parser_reset(UbxParser *self, uint8_t *buffer, uint16_t buffer_size);
+
+//Feeds a single byte into the parser
+UbxParseResult ubx_parser_push(UbxParser *self, uint8_t byte);
+
+//Returns true if the frame is a UBX message of the given class and id
+bool ubx_frame_is(const uint8_t *frame, size_t frame_length, uint8_t msg_class, uint8_t msg_id);
+
+//Decodes a complete NAV-PVT frame. Returns false if the frame is not a NAV-PVT message.
+bool ubx_decode_nav_pvt(const uint8_t *frame, size_t frame_length, UbxNavPvt *pvt);
+
+#endif /* INC_RECOVERY_INC_UBX_H_ */
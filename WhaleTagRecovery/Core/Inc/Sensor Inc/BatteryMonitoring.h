@@ -17,6 +17,7 @@
 
 #include "Lib Inc/timing.h"
 #include "tx_api.h"
+#include <stdbool.h>
 #include <stdint.h>
 
 //The R1 and R2 values (in ohms) for our resistor divider (R1 is the one connected to VSYS, and R2 is connected to ground).
@@ -54,6 +55,12 @@ uint32_t battery_monitor_get_raw_adc_data();
 //Function to call to get the true (fully scaled) battery voltage, form 0-7.5V.
 float battery_monitor_get_true_voltage();
 
+//Returns true if the last battery reading is below BATT_MON_LOW_VOLTAGE_THRESHOLD (always false without battery monitoring)
+bool battery_monitor_is_low(void);
+
+//Returns true if the last battery reading is below the configured critical voltage (always false without battery monitoring)
+bool battery_monitor_is_critical(void);
+
 //Main thread entry for battery monitoring function
 void battery_monitor_thread_entry(ULONG thread_input);
 
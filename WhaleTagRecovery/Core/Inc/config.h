@@ -9,13 +9,15 @@
 #define INC_CONFIG_H_
 
 #include "Recovery Inc/VHF.h"
+#include "Comms Inc/PiTelemetry.h"
 
 /* COMPILE-TIME CONFIGURATION */
 #define USB_BOOTLOADER_ENABLED 0
 #define BATTERY_MONITOR_ENABLED 0
-#define RTC_ENABLED 0
+#define RTC_ENABLED 0 //test shutdown timer thread (Sensor Src/RTC.c), the RTC peripheral itself is always on
 #define UART_ENABLED 1
 #define HEARTBEAT_ENABLED 1
+#define LOW_POWER_STOP2_ENABLED 1 //tickless idle in STOP2 (see low_power.h), sleep only if 0
 
 #define IN_DOMINICA 1
 
@@ -37,6 +39,17 @@ typedef struct geofence_region_t{
 	GlobalPosition max;
 }GeofenceRegion;
 
+//Minimum fix quality for a GPS position to be considered locked (and beaconed)
+typedef struct gps_fix_gate_t{
+	float		max_hdop;
+	uint8_t		min_satellites;
+	uint8_t		min_fix_type;	//UbxFixType: 2 = 2D, 3 = 3D
+	uint32_t	max_age_ms;		//maximum age of the position and quality data
+}GpsFixGate;
+
+//Stored along with the Configuration (see config_save()), bump it whenever the structure changes
+#define CONFIGURATION_VERSION 1
+
 typedef struct config_t{
 	float 			critical_voltage;
 	VHFPowerLevel 	vhf_power;
@@ -44,6 +57,9 @@ typedef struct config_t{
 	GeofenceRegion 	geofence_area;
 	float			aprs_freq;
 	char 			pi_hostname[16];
+	GpsFixGate		gps_gate;			//normal operation
+	GpsFixGate		gps_gate_critical;	//used when the battery is low, any rough position beats none
+	uint16_t		telemetry_period_s;	//0: no telemetry pushed to the Pi
 }Configuration;
 
 
@@ -53,8 +69,17 @@ typedef struct config_t{
 	.vhf_power = VHF_POWER_HIGH,\
 	.aprs_freq = TX_FREQ_MHZ,\
 	.pi_hostname = "",\
+	.gps_gate = {.max_hdop = 4.0, .min_satellites = 5, .min_fix_type = 3, .max_age_ms = 3000},\
+	.gps_gate_critical = {.max_hdop = 10.0, .min_satellites = 3, .min_fix_type = 2, .max_age_ms = 5000},\
+	.telemetry_period_s = PI_TELEMETRY_DEFAULT_PERIOD_S,\
 }
 
 extern Configuration g_config;
 
+//Restores g_config and the APRS settings stored in flash (see config_store.h), keeping the defaults for anything missing
+void config_load(void);
+
+//Stores g_config, the APRS settings and the geofence table, writing only what changed since the last save
+void config_save(void);
+
 #endif /* INC_CONFIG_H_ */
@@ -3,86 +3,197 @@
  *
  *  Created on: Aug 17, 2023
  *      Author: Kaveet
+ *
+ * Reception from the Pi.
+ *
+ * USART2 receives continuously into a ring by circular DMA. On every idle line (and half/full ring) event the new
+ * bytes are searched for frame delimiters, and each complete frame is decoded in place in the ring. The state machine
+ * is handed a view of the decoded message where it lies, which it releases once handled. Only a frame wrapping around
+ * the end of the ring is copied out first, to a linear buffer.
  */
 
 
 #include "Comms Inc/PiComms.h"
+#include "Lib Inc/low_power.h"
 #include "Lib Inc/state_machine.h"
 #include "Recovery Inc/VHF.h"
 #include "config.h"
 #include "main.h"
 #include "stm32u5xx_hal_uart.h"
+#include <string.h>
 
 //External variables
 extern UART_HandleTypeDef huart2;
-extern DMA_HandleTypeDef handle_GPDMA1_Channel2;
 
 
 extern TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
 
-//Private typedef
+//the decoded frame header is rewritten in place as a PiCommHeader, the payload doesn't move
+_Static_assert(sizeof(PiCommHeader) == PI_FRAME_HEADER_SIZE, "PiCommHeader must match the frame header");
 
+//Receive ring, written by the circular DMA
+static uint8_t rx_ring[PI_COMM_RX_RING_SIZE];
 
-//Data buffer for receives
-uint8_t raw_buffer[PI_COMM_RX_BUFFER_COUNT * PI_COMM_RX_BUFFER_SIZE] = {0};
-uint8_t pi_comm_rx_buffer[PI_COMM_RX_BUFFER_COUNT][PI_COMM_RX_BUFFER_SIZE] = {0}; //max rx size = 3 + 4 = 7
-volatile uint_fast8_t pi_comm_rx_buffer_start = 0;
-volatile uint_fast8_t pi_comm_rx_buffer_end = 0;
-volatile bool pi_comm_rx_buffer_overflow = false;
+//Frames wrapping around the end of the ring are decoded here
+static uint8_t rx_wrap_buffer[PI_FRAME_MAX_ENCODED_SIZE];
+static volatile bool rx_wrap_buffer_used = false;
 
-void Pi_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size){
-	static int remaining = 0;
-	int pi_comm_start = -1;
-	int new = 0;
-	int total_bytes = remaining + Size;
-	for (int i = 0; i < total_bytes; ) {
-		// find command start character
-		if (raw_buffer[i] != PI_COMMS_START_CHAR) {
-			i++;
-			continue;
-		}
+static size_t rx_position = 0;		//next ring index to search
+static size_t rx_frame_start = 0;	//ring index of the frame being received
+static size_t rx_frame_length = 0;	//bytes of it received so far
+
+//Messages handed to the state machine, released in order
+static PiCommRxView rx_queue[PI_COMM_RX_QUEUE_COUNT];
+static volatile uint_fast8_t rx_queue_start = 0;
+static volatile uint_fast8_t rx_queue_end = 0;
+
+static PiCommsRxStats rx_stats = {0};
+static int rx_last_sequence = -1;
+
+//Decodes one received frame and queues it for the state machine. Returns 1 if a message was queued.
+static int pi_comms_rx_frame(size_t start, size_t length, Timestamp rx_timestamp) {
+	if (length >= PI_FRAME_MAX_ENCODED_SIZE) {
+		rx_stats.overflows++;
+		return 0;
+	}
 
-		// grab header
-		pi_comm_start = i;
-		i += sizeof(PiCommHeader);
-		if (i > Size) {
-			// incomplete message
+	uint_fast8_t next_end = (rx_queue_end + 1) % PI_COMM_RX_QUEUE_COUNT;
+	bool wrapped = (start + length) > PI_COMM_RX_RING_SIZE;
+	if ((next_end == rx_queue_start) || (wrapped && rx_wrap_buffer_used)) {
+		rx_stats.queue_full++;
+		return 0;
+	}
+
+	uint8_t *encoded = &rx_ring[start];
+	if (wrapped) {
+		size_t first = PI_COMM_RX_RING_SIZE - start;
+		memcpy(&rx_wrap_buffer[0], &rx_ring[start], first);
+		memcpy(&rx_wrap_buffer[first], &rx_ring[0], length - first);
+		encoded = rx_wrap_buffer;
+	}
+
+	PiFrame frame;
+	switch (pi_frame_decode(encoded, length, &frame)) {
+		case PI_FRAME_OK:
 			break;
-		}
+		case PI_FRAME_ERROR_COBS:
+			rx_stats.cobs_errors++;
+			return 0;
+		case PI_FRAME_ERROR_LENGTH:
+			rx_stats.length_errors++;
+			return 0;
+		case PI_FRAME_ERROR_CRC:
+			rx_stats.crc_errors++;
+			return 0;
+		case PI_FRAME_ERROR_VERSION:
+		default:
+			rx_stats.version_errors++;
+			return 0;
+	}
+
+	rx_stats.frames++;
+	if ((rx_last_sequence >= 0) && (frame.sequence != (uint8_t)(rx_last_sequence + 1))) {
+		rx_stats.sequence_gaps++;
+	}
+	rx_last_sequence = frame.sequence;
+
+	*(PiCommHeader *)encoded = (PiCommHeader){
+		.start_byte = PI_COMMS_START_CHAR,
+		.id = frame.id,
+		.length = frame.length,
+		.sequence = frame.sequence,
+	};
+	rx_queue[rx_queue_end] = (PiCommRxView){
+		.message = (PiRxCommMessage *)encoded,
+		.timestamp = rx_timestamp,
+		.ring_start = start,
+		.wrapped = wrapped,
+	};
+	if (wrapped) {
+		rx_wrap_buffer_used = true;
+	}
+	rx_queue_end = next_end;
+	return 1;
+}
 
-		// grab message
-		i += ((PiCommHeader *)&raw_buffer[pi_comm_start])->length;
-		if (i > Size) {
-			// incomplete message
+//Searches the ring from rx_position up to end (no wrap) for delimiters
+static int pi_comms_rx_search(size_t end, Timestamp rx_timestamp) {
+	int new = 0;
+	while (rx_position < end) {
+		uint8_t *delimiter = memchr(&rx_ring[rx_position], PI_FRAME_DELIMITER, end - rx_position);
+		if (delimiter == NULL) {
+			rx_frame_length += end - rx_position;
+			rx_position = end;
 			break;
 		}
 
-		// move full message in buffer
-		memcpy(&pi_comm_rx_buffer[pi_comm_rx_buffer_end][0], &raw_buffer[pi_comm_start], (i - pi_comm_start));
-		pi_comm_rx_buffer_end = (pi_comm_rx_buffer_end + 1) % PI_COMM_RX_BUFFER_COUNT;
-		new = 1;
-		pi_comm_start = -1;
+		size_t index = delimiter - rx_ring;
+		rx_frame_length += index - rx_position;
+		if (rx_frame_length > 0) {
+			new |= pi_comms_rx_frame(rx_frame_start, rx_frame_length, rx_timestamp);
+		}
+		rx_position = index + 1;
+		rx_frame_start = rx_position % PI_COMM_RX_RING_SIZE;
+		rx_frame_length = 0;
+	}
+	return new;
+}
+
+void Pi_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size){
+	//Size is the ring index reached by the DMA (the ring size at the end of each lap)
+	size_t position = Size % PI_COMM_RX_RING_SIZE;
+	int new = 0;
+	Timestamp rx_timestamp = time_now();
+
+	//the DMA can't be held back, but overwriting messages not yet handled is counted
+	if (rx_queue_start != rx_queue_end) {
+		size_t received = (position + PI_COMM_RX_RING_SIZE - rx_position) % PI_COMM_RX_RING_SIZE;
+		size_t space = (rx_queue[rx_queue_start].ring_start + PI_COMM_RX_RING_SIZE - rx_position) % PI_COMM_RX_RING_SIZE;
+		if (received > space) {
+			rx_stats.overruns++;
+		}
 	}
 
-	// shift remaining data
-	remaining = 0;
-	if (pi_comm_start > 0) {
-		remaining = total_bytes - pi_comm_start;
-		memmove(&raw_buffer[0], &raw_buffer[pi_comm_start], remaining);
+	if (position < rx_position) {
+		new |= pi_comms_rx_search(PI_COMM_RX_RING_SIZE, rx_timestamp);
+		rx_position = 0;
 	}
+	new |= pi_comms_rx_search(position, rx_timestamp);
+	rx_position %= PI_COMM_RX_RING_SIZE;
+
+	//more is likely to follow, USART2 stops in STOP2
+	low_power_veto_for(LOW_POWER_VETO_PI_RX, LOW_POWER_PI_LINK_AWAKE_MS);
 
 	// indicate new messages available
 	if(new) {
 		tx_event_flags_set(&state_machine_event_flags_group, STATE_COMMS_MESSAGE_AVAILABLE_FLAG, TX_OR);
 	}
-
-	//restart DMA
-	HAL_UARTEx_ReceiveToIdle_DMA(&huart2, &raw_buffer[remaining], sizeof(raw_buffer) - remaining); //initiate next transfer
-	__HAL_DMA_DISABLE_IT(&handle_GPDMA1_Channel2,DMA_IT_HT);//we don't want the half done transaction interrupt
 }
 
 void pi_comms_rx_init(void){
-	HAL_UARTEx_ReceiveToIdle_DMA(&huart2, &raw_buffer[0], sizeof(raw_buffer)); //initiate next transfer
-	__HAL_DMA_DISABLE_IT(&handle_GPDMA1_Channel2, DMA_IT_HT);//we don't want the half done transaction interrupt
+	HAL_UARTEx_ReceiveToIdle_DMA(&huart2, rx_ring, sizeof(rx_ring)); //circular, runs forever
+	//line errors (noise, framing, overrun) would abort the reception, leave them to the frame CRC instead
+	ATOMIC_CLEAR_BIT(huart2.Instance->CR3, USART_CR3_EIE);
 }
 
+PiCommRxView *pi_comms_rx_peek(void) {
+	return (rx_queue_start != rx_queue_end) ? &rx_queue[rx_queue_start] : NULL;
+}
+
+void pi_comms_rx_release(void) {
+	if (rx_queue_start == rx_queue_end) {
+		return;
+	}
+	if (rx_queue[rx_queue_start].wrapped) {
+		rx_wrap_buffer_used = false;
+	}
+	rx_queue_start = (rx_queue_start + 1) % PI_COMM_RX_QUEUE_COUNT;
+}
+
+PiCommsRxStats pi_comms_rx_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	PiCommsRxStats stats = rx_stats;
+	__set_PRIMASK(primask);
+	return stats;
+}
@@ -3,77 +3,289 @@
  *
  *  Created on: Aug 18, 2023
  *      Author: Kaveet
+ *
+ * Non-blocking transmission to the Pi.
+ *
+ * Messages are queued as blocks of a ThreadX block pool, on one list per priority, and sent by a single DMA drainer
+ * running from the transmit complete interrupt. The payload is either copied into the block (small responses) or
+ * read straight from the caller's buffer (zero copy, e.g. GPS batches). Either way it is read once, when the drainer
+ * frames the message (PiFraming.h) into the DMA buffer, and the block is released right after.
+ * Responses are always started before streaming data, at message boundaries.
  */
 
 #include "Comms Inc/PiComms.h"
 #include "Recovery Inc/GPS.h"
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/low_power.h"
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 //Queue to share data between this and the GPS threads
 TX_QUEUE gps_tx_queue;
-TX_MUTEX pi_tx_mutex;
 
 //External variables (uart handler)
 extern UART_HandleTypeDef huart2;
 
-typedef struct __attribute__ ((__packed__, scalar_storage_order ("little-endian"))) {
-	PiCommHeader header;
-	uint8_t msg[256];
-} Packet;
+// === PRIVATE TYPEDEFS ===
+typedef struct pi_comms_tx_message_t {
+	struct pi_comms_tx_message_t *next;
+	PiCommsTxPriority priority;
+	uint32_t queued_ms;
+	const uint8_t *payload;		//zero copy payload, NULL if copied into data
+	void (*done)(void *context);
+	void *context;
+	void (*sent)(void);			//called once the frame is out
+	uint8_t id;
+	uint8_t length;
+	uint8_t data[PI_COMMS_TX_INLINE_SIZE];
+}PiCommsTxMessage;
+
+// === PRIVATE VARIABLES ===
+static TX_BLOCK_POOL tx_pool;
+static ULONG tx_pool_area[(PI_COMMS_TX_BLOCK_COUNT * (sizeof(PiCommsTxMessage) + sizeof(void *))) / sizeof(ULONG) + 1];
+static bool tx_initialized = false;
+
+//one FIFO per priority
+static PiCommsTxMessage *tx_head[PI_COMMS_TX_NUM_PRIORITIES] = {NULL};
+static PiCommsTxMessage *tx_tail[PI_COMMS_TX_NUM_PRIORITIES] = {NULL};
+static uint32_t tx_depth[PI_COMMS_TX_NUM_PRIORITIES] = {0};
+
+//frame being sent by the DMA
+static uint8_t tx_frame[PI_FRAME_MAX_ENCODED_SIZE];
+static volatile bool tx_busy = false;
+static void (*tx_sent_callback)(void) = NULL;	//of the frame being sent
+static uint8_t tx_sequence = 0;
+
+static PiCommsTxStats tx_stats = {0};
+
+//event log chunks, sent in place
+static PiCommLogDataPkt log_chunks[PI_COMMS_LOG_READ_MAX_CHUNKS];
+static volatile bool log_chunk_busy[PI_COMMS_LOG_READ_MAX_CHUNKS] = {false};
+
+// === PRIVATE METHODS ===
+static void pi_comms_tx_frame_done(void) {
+	tx_busy = false;
+	low_power_veto(LOW_POWER_VETO_PI_TX, false);
+	low_power_veto_for(LOW_POWER_VETO_PI_RX, LOW_POWER_PI_LINK_AWAKE_MS); //the Pi may answer
+	if (tx_sent_callback != NULL) {
+		void (*sent)(void) = tx_sent_callback;
+		tx_sent_callback = NULL;
+		sent();
+	}
+}
+
+static PiCommsTxMessage *pi_comms_tx_pop(void) {
+	//responses first
+	for (int priority = 0; priority < PI_COMMS_TX_NUM_PRIORITIES; priority++) {
+		PiCommsTxMessage *message = tx_head[priority];
+		if (message != NULL) {
+			tx_head[priority] = message->next;
+			if (tx_head[priority] == NULL) {
+				tx_tail[priority] = NULL;
+			}
+			tx_depth[priority]--;
+			return message;
+		}
+	}
+	return NULL;
+}
+
+//Single drainer: frames and starts the next message if the DMA is idle. Called with interrupts disabled or from the transmit interrupts.
+static void pi_comms_tx_drain(void) {
+	while (!tx_busy) {
+		PiCommsTxMessage *message = pi_comms_tx_pop();
+		if (message == NULL) {
+			return; //idle
+		}
+
+		PiCommsTxPriority priority = message->priority;
+		uint32_t wait_ms = HAL_GetTick() - message->queued_ms;
+		tx_stats.max_wait_ms[priority] = (wait_ms > tx_stats.max_wait_ms[priority]) ? wait_ms : tx_stats.max_wait_ms[priority];
+
+		const uint8_t *payload = (message->payload != NULL) ? message->payload : message->data;
+		size_t length = pi_frame_encode(tx_frame, sizeof(tx_frame), tx_sequence++, message->id, payload, message->length);
+
+		if ((length != 0) && (HAL_UART_Transmit_DMA(&huart2, tx_frame, length) == HAL_OK)) {
+			tx_busy = true;
+			low_power_veto(LOW_POWER_VETO_PI_TX, true);
+			tx_sent_callback = message->sent;
+			tx_stats.sent[priority]++;
+			tx_stats.bytes += length;
+		} else {
+			tx_stats.dma_errors++;
+			if (message->sent != NULL) {
+				message->sent(); //nothing left on the line
+			}
+		}
+
+		//the payload has been read, hand it back (done may queue the next message)
+		if (message->done != NULL) {
+			message->done(message->context);
+		}
+		tx_block_release(message);
+	}
+}
+
+static void pi_comms_tx_TxCpltCallback(UART_HandleTypeDef *huart) {
+	pi_comms_tx_frame_done();
+	pi_comms_tx_drain();
+}
+
+static void pi_comms_tx_ErrorCallback(UART_HandleTypeDef *huart) {
+	//a failed transfer ends the transmission without a complete callback, the frame is abandoned
+	if (tx_busy && (huart->gState == HAL_UART_STATE_READY)) {
+		tx_stats.dma_errors++;
+		pi_comms_tx_frame_done();
+		pi_comms_tx_drain();
+	}
+}
+
+static void pi_comms_tx_log_chunk_done(void *context) {
+	*(volatile bool *)context = false;
+}
+
+static HAL_StatusTypeDef pi_comms_tx_queue(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+		bool copy, void (*done)(void *context), void *context, void (*sent)(void)) {
+	if ((priority >= PI_COMMS_TX_NUM_PRIORITIES) || (length > PI_COMMS_MAX_DATA_PAYLOAD)
+			|| (copy && (length > PI_COMMS_TX_INLINE_SIZE))) {
+		return HAL_ERROR;
+	}
 
+	PiCommsTxMessage *message;
+	if (!tx_initialized || (tx_block_allocate(&tx_pool, (VOID **)&message, TX_NO_WAIT) != TX_SUCCESS)) {
+		tx_stats.rejected[priority]++;
+		return HAL_BUSY;
+	}
+
+	*message = (PiCommsTxMessage){
+		.priority = priority,
+		.queued_ms = HAL_GetTick(),
+		.payload = copy ? NULL : payload,
+		.done = done,
+		.context = context,
+		.sent = sent,
+		.id = id,
+		.length = length,
+	};
+	if (copy && (length != 0)) {
+		memcpy(message->data, payload, length);
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (tx_tail[priority] == NULL) {
+		tx_head[priority] = message;
+	} else {
+		tx_tail[priority]->next = message;
+	}
+	tx_tail[priority] = message;
+	tx_depth[priority]++;
+	tx_stats.queued[priority]++;
+	tx_stats.max_depth[priority] = (tx_depth[priority] > tx_stats.max_depth[priority]) ? tx_depth[priority] : tx_stats.max_depth[priority];
+
+	pi_comms_tx_drain();
+	__set_PRIMASK(primask);
+	return HAL_OK;
+}
+
+// === PUBLIC METHODS ===
 void pi_comms_tx_init(void) {
-    tx_mutex_create(&pi_tx_mutex, "Pi TX mutex", 1);
+	tx_block_pool_create(&tx_pool, "Pi TX pool", sizeof(PiCommsTxMessage), tx_pool_area, sizeof(tx_pool_area));
+	HAL_UART_RegisterCallback(&huart2, HAL_UART_TX_COMPLETE_CB_ID, pi_comms_tx_TxCpltCallback);
+	HAL_UART_RegisterCallback(&huart2, HAL_UART_ERROR_CB_ID, pi_comms_tx_ErrorCallback);
+	tx_initialized = true;
+}
+
+HAL_StatusTypeDef pi_comms_tx_send(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length) {
+	return pi_comms_tx_queue(priority, id, payload, length, true, NULL, NULL, NULL);
+}
+
+HAL_StatusTypeDef pi_comms_tx_send_zero_copy(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+		void (*done)(void *context), void *context) {
+	return pi_comms_tx_queue(priority, id, payload, length, false, done, context, NULL);
+}
+
+HAL_StatusTypeDef pi_comms_tx_send_then(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+		void (*sent)(void)) {
+	return pi_comms_tx_queue(priority, id, payload, length, true, NULL, NULL, sent);
+}
+
+PiCommsTxStats pi_comms_tx_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	PiCommsTxStats stats = tx_stats;
+	__set_PRIMASK(primask);
+	return stats;
 }
 
 void pi_comms_tx_pong(void){
-	PiCommHeader gps_header = {
-		.start_byte = PI_COMMS_START_CHAR,
-		.id = PI_COMM_PONG,
-		.length = 0,
+	Timestamp timestamp = time_now();
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_PONG, &timestamp, sizeof(timestamp));
+}
+
+void pi_comms_tx_error(uint8_t id, PiCommError error){
+	PiCommErrorPkt pkt = {
+		.id = id,
+		.error = error,
 	};
-	tx_mutex_get(&pi_tx_mutex,TX_WAIT_FOREVER);
-	HAL_UART_Transmit(&huart2, (uint8_t *) &gps_header, sizeof(PiCommHeader), HAL_MAX_DELAY);
-	tx_mutex_put(&pi_tx_mutex);
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_ERROR, &pkt, sizeof(pkt));
 }
 
-void pi_comms_tx_forward_gps(const uint8_t *buffer, uint8_t len){
-	PiCommHeader gps_header = {
-			.start_byte = PI_COMMS_START_CHAR,
-			.id = PI_COMM_MSG_GPS_PACKET,
-			.length = len,
+void pi_comms_tx_mga_ack(uint8_t id, uint8_t status, uint32_t next_offset){
+	PiCommMgaAckPkt ack = {
+		.id = id,
+		.status = status,
+		.next_offset = next_offset,
 	};
-	tx_mutex_get(&pi_tx_mutex,TX_WAIT_FOREVER);
-	HAL_UART_Transmit(&huart2, (uint8_t *) &gps_header, sizeof(PiCommHeader), HAL_MAX_DELAY);
-	HAL_UART_Transmit(&huart2, buffer, len, HAL_MAX_DELAY);
-	tx_mutex_put(&pi_tx_mutex);
-}
-
-void pi_comms_tx_callsign(const char *callsign){
-	Packet pkt = {
-			.header = {
-				.start_byte = PI_COMMS_START_CHAR,
-				.id = PI_COMM_MSG_CONFIG_APRS_CALLSIGN,
-				.length = strlen(callsign),
-			},
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_MGA_ACK, &ack, sizeof(ack));
+}
+
+void pi_comms_tx_gps_replay_ack(uint8_t id, uint8_t status){
+	PiCommGpsReplayAckPkt ack = {
+		.id = id,
+		.status = status,
+		.free_chunks = gps_replay_free_chunks(),
+		.stats = gps_replay_get_stats(),
 	};
-	memcpy(pkt.msg, callsign, strlen(callsign));
-	tx_mutex_get(&pi_tx_mutex,TX_WAIT_FOREVER);
-	HAL_UART_Transmit(&huart2, (uint8_t *) &pkt, (sizeof(PiCommHeader) + strlen(callsign)), HAL_MAX_DELAY);
-	tx_mutex_put(&pi_tx_mutex);
-}
-
-void pi_comms_tx_ssid(uint8_t ssid){
-	Packet pkt = {
-		.header = {
-			.start_byte = PI_COMMS_START_CHAR,
-			.id = PI_COMM_MSG_CONFIG_APRS_SSID,
-			.length = 1,
-		},
-		.msg = {ssid},
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_GPS_REPLAY_ACK, &ack, sizeof(ack));
+}
+
+void pi_comms_tx_fw_ack(uint8_t id, uint8_t status, uint32_t next_offset){
+	PiCommFwAckPkt ack = {
+		.id = id,
+		.status = status,
+		.window = FW_UPDATE_WINDOW_CHUNKS,
+		.state = fw_update_get_info().state,
+		.next_offset = next_offset,
 	};
-	tx_mutex_get(&pi_tx_mutex,TX_WAIT_FOREVER);
-	HAL_UART_Transmit(&huart2, (uint8_t *) &pkt, (sizeof(PiCommHeader) + 1), HAL_MAX_DELAY);
-	tx_mutex_put(&pi_tx_mutex);
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_FW_ACK, &ack, sizeof(ack));
+}
+
+void pi_comms_tx_log_data(uint32_t offset, uint8_t chunks){
+	for (int i = 0; (i < PI_COMMS_LOG_READ_MAX_CHUNKS) && (chunks != 0); i++) {
+		if (log_chunk_busy[i]) {
+			continue;
+		}
+
+		PiCommLogDataPkt *chunk = &log_chunks[i];
+		chunk->offset = offset;
+		size_t length = event_log_read(&offset, chunk->data, sizeof(chunk->data));
+		chunk->offset = offset;
+
+		log_chunk_busy[i] = true;
+		if (pi_comms_tx_send_zero_copy(PI_COMMS_TX_PRIORITY_STREAM, PI_COMM_MSG_LOG_DATA, chunk,
+				sizeof(chunk->offset) + length, pi_comms_tx_log_chunk_done, (void *)&log_chunk_busy[i]) != HAL_OK) {
+			log_chunk_busy[i] = false;
+			return;
+		}
 
+		//an empty chunk marks the end of the log
+		if (length == 0) {
+			return;
+		}
+		offset += length;
+		chunks--;
+	}
 }
@@ -0,0 +1,103 @@
+/*
+ * PiFraming.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * COBS + CRC framing of the Pi messages. See matching header file for more info.
+ */
+
+#include "Comms Inc/PiFraming.h"
+#include "Lib Inc/crc16.h"
+
+// === PRIVATE TYPEDEFS ===
+typedef struct {
+	uint8_t *out;
+	size_t index;		//next output byte
+	size_t code_index;	//code byte of the current block
+	uint8_t code;		//current block length + 1
+}PiFrameEncoder;
+
+// === PRIVATE METHODS ===
+static void pi_frame_encode_byte(PiFrameEncoder *encoder, uint8_t byte) {
+	if (byte != 0) {
+		encoder->out[encoder->index++] = byte;
+		encoder->code++;
+		if (encoder->code != 0xFF) {
+			return;
+		}
+	}
+
+	//zero byte or full block: close the block and start the next one
+	encoder->out[encoder->code_index] = encoder->code;
+	encoder->code_index = encoder->index++;
+	encoder->code = 1;
+}
+
+// === PUBLIC METHODS ===
+size_t pi_frame_encode(uint8_t *out, size_t out_size, uint8_t sequence, uint8_t id, const uint8_t *payload, uint8_t length) {
+	if (out_size < PI_FRAME_ENCODED_SIZE(length)) {
+		return 0;
+	}
+
+	PiFrameEncoder encoder = {.out = out, .index = 1, .code_index = 0, .code = 1};
+	const uint8_t header[PI_FRAME_HEADER_SIZE] = {PI_FRAME_VERSION, sequence, id, length};
+	uint16_t crc = CRC16_INIT;
+
+	for (size_t i = 0; i < PI_FRAME_HEADER_SIZE; i++) {
+		crc = crc16_update(crc, header[i]);
+		pi_frame_encode_byte(&encoder, header[i]);
+	}
+	for (size_t i = 0; i < length; i++) {
+		crc = crc16_update(crc, payload[i]);
+		pi_frame_encode_byte(&encoder, payload[i]);
+	}
+	pi_frame_encode_byte(&encoder, crc >> 8);
+	pi_frame_encode_byte(&encoder, crc & 0xFF);
+
+	out[encoder.code_index] = encoder.code;
+	out[encoder.index++] = PI_FRAME_DELIMITER;
+	return encoder.index;
+}
+
+PiFrameStatus pi_frame_decode(uint8_t *buffer, size_t length, PiFrame *frame) {
+	size_t in = 0;
+	size_t out = 0;
+	uint16_t crc = CRC16_INIT;
+
+	//the decoded data is never longer than what was read, so it can overwrite the encoded data
+	while (in < length) {
+		uint8_t code = buffer[in++];
+		if ((code == 0) || ((in + code - 1) > length)) {
+			return PI_FRAME_ERROR_COBS;
+		}
+		for (uint8_t i = 1; i < code; i++) {
+			uint8_t byte = buffer[in++];
+			crc = crc16_update(crc, byte);
+			buffer[out++] = byte;
+		}
+		//each block but the last and full ones stands for a zero byte
+		if ((code != 0xFF) && (in < length)) {
+			crc = crc16_update(crc, 0);
+			buffer[out++] = 0;
+		}
+	}
+
+	if (out < PI_FRAME_DECODED_SIZE(0)) {
+		return PI_FRAME_ERROR_LENGTH;
+	}
+	if (crc != 0) {
+		return PI_FRAME_ERROR_CRC;
+	}
+	if (buffer[0] != PI_FRAME_VERSION) {
+		return PI_FRAME_ERROR_VERSION;
+	}
+	if (out != PI_FRAME_DECODED_SIZE(buffer[3])) {
+		return PI_FRAME_ERROR_LENGTH;
+	}
+
+	frame->sequence = buffer[1];
+	frame->id = buffer[2];
+	frame->length = buffer[3];
+	frame->payload = &buffer[PI_FRAME_HEADER_SIZE];
+	return PI_FRAME_OK;
+}
@@ -0,0 +1,226 @@
+/*
+ * PiGpsForward.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Decimated, batched and non-blocking forwarding of GPS sentences to the Pi. See matching header file for more info.
+ */
+
+#include "Comms Inc/PiGpsForward.h"
+#include "Comms Inc/PiComms.h"
+#include "Recovery Inc/Ubx.h"
+#include "main.h"
+#include <string.h>
+
+// === PRIVATE TYPEDEFS ===
+typedef enum {
+	PI_GPS_FORWARD_SLOT_FREE,
+	PI_GPS_FORWARD_SLOT_FILLING,	//open frame, owned by the GPS buffer thread
+	PI_GPS_FORWARD_SLOT_QUEUED,
+	PI_GPS_FORWARD_SLOT_SENDING,	//owned by the Pi transmit queue until its done callback
+}PiGpsForwardSlotState;
+
+typedef struct {
+	volatile PiGpsForwardSlotState state;
+	uint32_t sequence;	//queue order
+	uint16_t sentences;
+	uint16_t length;
+	uint8_t payload[PI_GPS_FORWARD_FRAME_PAYLOAD];	//sent in place, without header (zero copy)
+}PiGpsForwardSlot;
+
+//3 character NMEA sentence formatters, after the 2 character talker id
+static const struct {
+	char formatter[4];
+	PiGpsForwardType type;
+} nmea_types[] = {
+	{"RMC", PI_GPS_FORWARD_RMC},
+	{"GGA", PI_GPS_FORWARD_GGA},
+	{"GLL", PI_GPS_FORWARD_GLL},
+	{"GSA", PI_GPS_FORWARD_GSA},
+	{"GSV", PI_GPS_FORWARD_GSV},
+	{"VTG", PI_GPS_FORWARD_VTG},
+	{"ZDA", PI_GPS_FORWARD_ZDA},
+};
+
+// === PRIVATE VARIABLES ===
+static PiGpsForwardSlot slots[PI_GPS_FORWARD_FRAME_COUNT];
+static int open_slot = -1;
+static uint32_t next_sequence = 0;
+static volatile bool sending = false;
+
+//everything is forwarded by default, as before batching
+static uint8_t decimation[PI_GPS_FORWARD_NUM_TYPES] = {[0 ... PI_GPS_FORWARD_NUM_TYPES - 1] = 1};
+static uint8_t decimation_count[PI_GPS_FORWARD_NUM_TYPES] = {0};
+
+static PiGpsForwardStats stats = {0};
+
+// === PRIVATE METHODS ===
+static PiGpsForwardType pi_gps_forward_classify(const GPS_Sentence *sentence) {
+	if (sentence->type == GPS_SENTENCE_UBX) {
+		return ubx_frame_is(sentence->sentence, sentence->length, UBX_CLASS_NAV, UBX_ID_NAV_PVT)
+				? PI_GPS_FORWARD_UBX_NAV_PVT : PI_GPS_FORWARD_UBX_OTHER;
+	}
+
+	//"$ttFFF," (proprietary sentences start with "$P")
+	if ((sentence->length < 6) || (sentence->sentence[1] == 'P')) {
+		return PI_GPS_FORWARD_NMEA_OTHER;
+	}
+	for (size_t i = 0; i < sizeof(nmea_types) / sizeof(nmea_types[0]); i++) {
+		if (memcmp(&sentence->sentence[3], nmea_types[i].formatter, 3) == 0) {
+			return nmea_types[i].type;
+		}
+	}
+	return PI_GPS_FORWARD_NMEA_OTHER;
+}
+
+static void pi_gps_forward_start_next(void);
+
+static void pi_gps_forward_done(void *context) {
+	PiGpsForwardSlot *slot = context;
+	slot->state = PI_GPS_FORWARD_SLOT_FREE;
+	stats.frames_sent++;
+	sending = false;
+	pi_gps_forward_start_next();
+}
+
+//Hands the oldest queued frame to the Pi transmit queue, one frame at a time so that queued frames can still be
+//dropped for newer ones. Called with interrupts disabled or from the transmit complete interrupt (done callback).
+static void pi_gps_forward_start_next(void) {
+	if (sending) {
+		return;
+	}
+
+	PiGpsForwardSlot *next = NULL;
+	for (int i = 0; i < PI_GPS_FORWARD_FRAME_COUNT; i++) {
+		PiGpsForwardSlot *slot = &slots[i];
+		if ((slot->state == PI_GPS_FORWARD_SLOT_QUEUED)
+				&& ((next == NULL) || ((int32_t)(slot->sequence - next->sequence) < 0))) {
+			next = slot;
+		}
+	}
+	if (next == NULL) {
+		return;
+	}
+
+	next->state = PI_GPS_FORWARD_SLOT_SENDING;
+	sending = true;
+	if (pi_comms_tx_send_zero_copy(PI_COMMS_TX_PRIORITY_STREAM, PI_COMM_MSG_GPS_BATCH, next->payload, next->length,
+			pi_gps_forward_done, next) != HAL_OK) {
+		//transmit queue full, retried on the next flush
+		stats.dma_errors++;
+		next->state = PI_GPS_FORWARD_SLOT_QUEUED;
+		sending = false;
+	}
+}
+
+//Gets a free slot for a new frame, dropping the oldest queued frame if there is none
+static int pi_gps_forward_take_slot(void) {
+	int taken = -1;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	for (int i = 0; i < PI_GPS_FORWARD_FRAME_COUNT; i++) {
+		PiGpsForwardSlot *slot = &slots[i];
+		if (slot->state == PI_GPS_FORWARD_SLOT_FREE) {
+			taken = i;
+			break;
+		}
+		if ((slot->state == PI_GPS_FORWARD_SLOT_QUEUED)
+				&& ((taken < 0) || ((int32_t)(slot->sequence - slots[taken].sequence) < 0))) {
+			taken = i;
+		}
+	}
+	if ((taken >= 0) && (slots[taken].state == PI_GPS_FORWARD_SLOT_QUEUED)) {
+		stats.frames_dropped++;
+		stats.dropped += slots[taken].sentences;
+	}
+	if (taken >= 0) {
+		slots[taken].state = PI_GPS_FORWARD_SLOT_FILLING;
+	}
+	__set_PRIMASK(primask);
+
+	if (taken >= 0) {
+		PiGpsForwardSlot *slot = &slots[taken];
+		slot->sentences = 0;
+		slot->length = 0;
+	}
+	return taken;
+}
+
+// === PUBLIC METHODS ===
+void pi_gps_forward_set_decimation(PiGpsForwardType type, uint8_t value) {
+	if (type < PI_GPS_FORWARD_NUM_TYPES) {
+		decimation[type] = value;
+		decimation_count[type] = 0;
+	}
+}
+
+uint8_t pi_gps_forward_get_decimation(PiGpsForwardType type) {
+	return (type < PI_GPS_FORWARD_NUM_TYPES) ? decimation[type] : 0;
+}
+
+void pi_gps_forward_sentence(const GPS_Sentence *sentence) {
+	stats.sentences++;
+
+	PiGpsForwardType type = pi_gps_forward_classify(sentence);
+	if (decimation[type] == 0) {
+		stats.filtered++;
+		return;
+	}
+	uint8_t count = decimation_count[type];
+	decimation_count[type] = ((count + 1) < decimation[type]) ? (count + 1) : 0;
+	if (count != 0) {
+		stats.filtered++;
+		return;
+	}
+
+	size_t record_length = PI_GPS_FORWARD_RECORD_OVERHEAD + sentence->length;
+	if (record_length > PI_GPS_FORWARD_FRAME_PAYLOAD) {
+		stats.dropped++;
+		return;
+	}
+
+	//start a new frame once the record doesn't fit
+	if ((open_slot >= 0) && ((slots[open_slot].length + record_length) > PI_GPS_FORWARD_FRAME_PAYLOAD)) {
+		pi_gps_forward_flush();
+	}
+	if (open_slot < 0) {
+		open_slot = pi_gps_forward_take_slot();
+		if (open_slot < 0) {
+			stats.dropped++;
+			return;
+		}
+	}
+
+	PiGpsForwardSlot *slot = &slots[open_slot];
+	uint8_t *record = &slot->payload[slot->length];
+	record[0] = sentence->type;
+	record[1] = sentence->length;
+	memcpy(&record[PI_GPS_FORWARD_RECORD_OVERHEAD], sentence->sentence, sentence->length);
+	slot->length += record_length;
+	slot->sentences++;
+	stats.forwarded++;
+}
+
+void pi_gps_forward_flush(void) {
+	if (open_slot < 0) {
+		return;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	slots[open_slot].sequence = next_sequence++;
+	slots[open_slot].state = PI_GPS_FORWARD_SLOT_QUEUED;
+	pi_gps_forward_start_next();
+	__set_PRIMASK(primask);
+
+	open_slot = -1;
+}
+
+PiGpsForwardStats pi_gps_forward_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	PiGpsForwardStats copy = stats;
+	__set_PRIMASK(primask);
+	return copy;
+}
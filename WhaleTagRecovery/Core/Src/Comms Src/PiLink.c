@@ -0,0 +1,176 @@
+/*
+ * PiLink.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Speed of the Pi link. See matching header file for more info.
+ *
+ * The rate is changed from the transmit complete interrupt of the acknowledgement: the USART is briefly disabled to
+ * write BRR, while the circular receive DMA and everything already in the ring are left as they are.
+ */
+
+#include "Comms Inc/PiLink.h"
+#include "Comms Inc/PiComms.h"
+#include "Lib Inc/timing.h"
+#include "main.h"
+#include <stdbool.h>
+
+extern UART_HandleTypeDef huart2;
+
+// === PRIVATE VARIABLES ===
+//Step-down sequence, fastest first
+static const uint32_t pi_link_rates[] = {2000000, 1000000, 921600, 460800, 230400, PI_LINK_DEFAULT_BAUD};
+
+static uint32_t clock_hz = 0;
+static TX_TIMER check_timer;
+
+static volatile uint32_t pending_baud = 0;	//rate to switch to once the acknowledgement is out, 0: none
+static bool confirmed = true;				//a message was received at the current rate
+static uint32_t switch_ms = 0;
+static uint32_t last_frame_ms = 0;
+static uint32_t frames_seen = 0;
+static uint32_t errors_seen = 0;
+
+static PiLinkStats stats = {.baud = PI_LINK_DEFAULT_BAUD};
+
+// === PRIVATE METHODS ===
+static uint32_t pi_link_brr(uint32_t baud) {
+	return UART_DIV_SAMPLING16(clock_hz, baud, huart2.Init.ClockPrescaler);
+}
+
+static bool pi_link_supported(uint32_t baud) {
+	if ((baud < PI_LINK_DEFAULT_BAUD) || (baud > PI_LINK_MAX_BAUD)) {
+		return false;
+	}
+
+	uint32_t brr = pi_link_brr(baud);
+	if ((brr < 16) || (brr > UINT16_MAX)) {
+		return false;
+	}
+
+	uint32_t actual = clock_hz / brr;
+	uint32_t error = (actual > baud) ? (actual - baud) : (baud - actual);
+	return ((uint64_t)error * 1000) <= ((uint64_t)baud * PI_LINK_MAX_BAUD_ERROR_PERMILLE);
+}
+
+static uint32_t pi_link_errors(void) {
+	PiCommsRxStats rx = pi_comms_rx_get_stats();
+	return rx.cobs_errors + rx.length_errors + rx.crc_errors + rx.overflows + pi_comms_tx_get_stats().dma_errors;
+}
+
+//Transmit complete interrupt of the acknowledgement: the line is idle
+static void pi_link_apply(void) {
+	uint32_t baud = pending_baud;
+
+	CLEAR_BIT(huart2.Instance->CR1, USART_CR1_UE);
+	huart2.Instance->BRR = pi_link_brr(baud);
+	huart2.Init.BaudRate = baud;
+	SET_BIT(huart2.Instance->CR1, USART_CR1_UE);
+
+	stats.baud = baud;
+	confirmed = (baud == PI_LINK_DEFAULT_BAUD);
+	switch_ms = HAL_GetTick();
+	last_frame_ms = switch_ms;
+	frames_seen = pi_comms_rx_get_stats().frames;
+	errors_seen = pi_link_errors();
+	pending_baud = 0;
+
+	//nothing to supervise at the default rate, the timer would only wake the board from STOP2
+	tx_timer_deactivate(&check_timer);
+	if (baud != PI_LINK_DEFAULT_BAUD) {
+		tx_timer_change(&check_timer, tx_ms_to_ticks(PI_LINK_CHECK_PERIOD_MS), tx_ms_to_ticks(PI_LINK_CHECK_PERIOD_MS));
+		tx_timer_activate(&check_timer);
+	}
+}
+
+//Announces a change at the current rate, then switches. Returns false if a change is pending or the queue is full.
+static bool pi_link_change(uint32_t baud, PiLinkStatus status) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (pending_baud != 0) {
+		__set_PRIMASK(primask);
+		return false;
+	}
+	pending_baud = baud;
+	__set_PRIMASK(primask);
+
+	PiCommLinkAckPkt ack = {
+		.status = status,
+		.baud = baud,
+		.max_baud = PI_LINK_MAX_BAUD,
+	};
+	if (pi_comms_tx_send_then(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_LINK_ACK, &ack, sizeof(ack), pi_link_apply) != HAL_OK) {
+		pending_baud = 0;
+		return false;
+	}
+	return true;
+}
+
+//Timer thread, only active away from the default rate: confirmation, idle and error supervision
+static void pi_link_check(ULONG input) {
+	if ((pending_baud != 0) || (stats.baud == PI_LINK_DEFAULT_BAUD)) {
+		return;
+	}
+
+	uint32_t now = HAL_GetTick();
+	uint32_t frames = pi_comms_rx_get_stats().frames;
+	if (frames != frames_seen) {
+		frames_seen = frames;
+		last_frame_ms = now;
+		confirmed = true;
+	}
+
+	uint32_t errors = pi_link_errors();
+	uint32_t new_errors = errors - errors_seen;
+	errors_seen = errors;
+	stats.errors += new_errors;
+
+	if ((!confirmed && ((now - switch_ms) >= PI_LINK_CONFIRM_TIMEOUT_MS))
+			|| ((now - last_frame_ms) >= (PI_LINK_IDLE_TIMEOUT_S * 1000))) {
+		stats.fallbacks += pi_link_change(PI_LINK_DEFAULT_BAUD, PI_LINK_FALLBACK);
+		return;
+	}
+
+	if (new_errors > PI_LINK_ERROR_THRESHOLD) {
+		for (size_t i = 0; i < (sizeof(pi_link_rates) / sizeof(pi_link_rates[0])); i++) {
+			if ((pi_link_rates[i] < stats.baud) && pi_link_supported(pi_link_rates[i])) {
+				stats.step_downs += pi_link_change(pi_link_rates[i], PI_LINK_STEP_DOWN);
+				break;
+			}
+		}
+	}
+}
+
+// === PUBLIC METHODS ===
+void pi_link_init(void) {
+	clock_hz = HAL_RCC_GetPCLK1Freq(); //USART2 kernel clock (see HAL_UART_MspInit)
+	tx_timer_create(&check_timer, "Pi Link Timer", pi_link_check, 0,
+			tx_ms_to_ticks(PI_LINK_CHECK_PERIOD_MS), tx_ms_to_ticks(PI_LINK_CHECK_PERIOD_MS), TX_NO_ACTIVATE);
+}
+
+void pi_link_request(uint32_t baud) {
+	PiLinkStatus status = PI_LINK_OK;
+	if (!pi_link_supported(baud)) {
+		status = PI_LINK_ERROR_BAUD;
+	} else if (!pi_link_change(baud, PI_LINK_OK)) {
+		status = PI_LINK_ERROR_BUSY;
+	} else {
+		stats.negotiations++;
+		return;
+	}
+
+	PiCommLinkAckPkt ack = {
+		.status = status,
+		.baud = stats.baud,
+		.max_baud = PI_LINK_MAX_BAUD,
+	};
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_LINK_ACK, &ack, sizeof(ack));
+}
+
+PiLinkStats pi_link_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	PiLinkStats copy = stats;
+	__set_PRIMASK(primask);
+	return copy;
+}
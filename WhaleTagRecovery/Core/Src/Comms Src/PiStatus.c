@@ -0,0 +1,273 @@
+/*
+ * PiStatus.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Status responses to the Pi. See matching header file for more info.
+ */
+
+#include "Comms Inc/PiStatus.h"
+#include "Comms Inc/PiComms.h"
+#include "Lib Inc/cpu_load.h"
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/low_power.h"
+#include "Lib Inc/state_machine.h"
+#include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/AprsPacket.h"
+#include "Recovery Inc/GPS.h"
+#include "Recovery Inc/Kiss.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include "config.h"
+#include <string.h>
+
+//How long a response waits for the previous one to be handed to the DMA
+#define PI_STATUS_WAIT_TICKS tx_ms_to_ticks(100)
+
+// === PRIVATE VARIABLES ===
+//Fields of the snapshot, in order
+static const uint8_t snapshot_tags[] = {
+	PI_STATUS_STATE,
+	PI_STATUS_STATE_TIME_MS,
+	PI_STATUS_UPTIME_MS,
+	PI_STATUS_TIME,
+	PI_STATUS_CRITICAL_VOLTAGE,
+	PI_STATUS_VHF_POWER_LEVEL,
+	PI_STATUS_APRS_FREQUENCY,
+	PI_STATUS_APRS_CALLSIGN,
+	PI_STATUS_APRS_SSID,
+	PI_STATUS_APRS_COMMENT,
+	PI_STATUS_GPS_FIX_GATE,
+	PI_STATUS_GPS_FIX_GATE_CRITICAL,
+	PI_STATUS_GPS_CONTINUOUS,
+	PI_STATUS_TELEMETRY_PERIOD,
+	PI_STATUS_LAST_FIX,
+	PI_STATUS_LAST_FIX_AGE_MS,
+	PI_STATUS_LAST_TX_AGE_MS,
+	PI_STATUS_BATTERY_VOLTAGE,
+	PI_STATUS_BATTERY_LOW,
+	PI_STATUS_COUNTERS,
+};
+
+//Response being sent (zero copy), free again once framed
+static uint8_t response[PI_COMMS_MAX_DATA_PAYLOAD];
+static volatile bool response_busy = false;
+
+// === PRIVATE METHODS ===
+static bool pi_status_put_gate(PiTlvWriter *writer, uint8_t tag, const GpsFixGate *gate, uint8_t critical) {
+	PiCommGpsFixGatePkt value = {
+		.critical = critical,
+		.max_hdop = gate->max_hdop,
+		.min_satellites = gate->min_satellites,
+		.min_fix_type = gate->min_fix_type,
+		.max_age_ms = gate->max_age_ms,
+	};
+	return pi_tlv_put(writer, tag, &value, sizeof(value));
+}
+
+PiStatusCounters pi_status_get_counters(void) {
+	PiCommsRxStats rx = pi_comms_rx_get_stats();
+	PiCommsTxStats tx = pi_comms_tx_get_stats();
+	GPS_IngestStats gps = gps_get_ingest_stats();
+	PiGpsForwardStats forward = pi_gps_forward_get_stats();
+
+	PiStatusCounters counters = {
+		.pi_rx_frames = rx.frames,
+		.pi_rx_errors = rx.cobs_errors + rx.length_errors + rx.crc_errors + rx.version_errors,
+		.pi_rx_dropped = rx.overflows + rx.queue_full + rx.overruns,
+		.gps_sentences = gps.framer.nmea_sentences + gps.framer.ubx_frames,
+		.gps_dropped = gps.framer.nmea_too_long + gps.framer.nmea_truncated + gps.framer.ubx_errors + gps.ring_overruns,
+		.gps_forward_dropped = forward.dropped,
+	};
+	for (int i = 0; i < PI_COMMS_TX_NUM_PRIORITIES; i++) {
+		counters.pi_tx_rejected += tx.rejected[i];
+	}
+	return counters;
+}
+
+static void pi_status_response_done(void *context) {
+	response_busy = false;
+}
+
+static void pi_status_send_response(size_t length) {
+	if (pi_comms_tx_send_zero_copy(PI_COMMS_TX_PRIORITY_RESPONSE, PI_COMM_MSG_STATUS, response, length,
+			pi_status_response_done, NULL) != HAL_OK) {
+		response_busy = false;
+	}
+}
+
+//Waits for the previous response to be handed over, returns false if it is stuck
+static bool pi_status_take_response(void) {
+	ULONG start = tx_time_get();
+	while (response_busy) {
+		if ((tx_time_get() - start) > PI_STATUS_WAIT_TICKS) {
+			return false;
+		}
+		tx_thread_sleep(1);
+	}
+	response_busy = true;
+	return true;
+}
+
+// === PUBLIC METHODS ===
+bool pi_status_put(PiTlvWriter *writer, PiStatusTag tag) {
+	switch (tag) {
+		case PI_STATUS_STATE:
+			return pi_tlv_put_u8(writer, tag, state_machine_get_state());
+
+		case PI_STATUS_STATE_TIME_MS:
+			return pi_tlv_put_u32(writer, tag, time_monotonic_ms() - state_machine_get_state_timestamp().monotonic_ms);
+
+		case PI_STATUS_UPTIME_MS:
+			return pi_tlv_put_u32(writer, tag, time_monotonic_ms());
+
+		case PI_STATUS_TIME: {
+			Timestamp now = time_now();
+			return pi_tlv_put(writer, tag, &now, sizeof(now));
+		}
+
+		case PI_STATUS_CRITICAL_VOLTAGE:
+			return pi_tlv_put_float(writer, tag, g_config.critical_voltage);
+
+		case PI_STATUS_VHF_POWER_LEVEL:
+			return pi_tlv_put_u8(writer, tag, g_config.vhf_power);
+
+		case PI_STATUS_APRS_FREQUENCY:
+			return pi_tlv_put_float(writer, tag, g_config.aprs_freq);
+
+		case PI_STATUS_APRS_CALLSIGN: {
+			char callsign[7];
+			aprs_get_callsign(callsign);
+			return pi_tlv_put(writer, tag, callsign, strlen(callsign));
+		}
+
+		case PI_STATUS_APRS_SSID: {
+			uint8_t ssid;
+			aprs_get_ssid(&ssid);
+			return pi_tlv_put_u8(writer, tag, ssid);
+		}
+
+		case PI_STATUS_APRS_COMMENT: {
+			char comment[APRS_MAX_COMMENT_LEN + 1];
+			aprs_get_comment(comment);
+			return pi_tlv_put(writer, tag, comment, strlen(comment));
+		}
+
+		case PI_STATUS_GPS_FIX_GATE:
+			return pi_status_put_gate(writer, tag, &g_config.gps_gate, 0);
+
+		case PI_STATUS_GPS_FIX_GATE_CRITICAL:
+			return pi_status_put_gate(writer, tag, &g_config.gps_gate_critical, 1);
+
+		case PI_STATUS_GPS_CONTINUOUS:
+			return pi_tlv_put_u8(writer, tag, gps_is_continuous());
+
+		case PI_STATUS_TELEMETRY_PERIOD:
+			return pi_tlv_put_u32(writer, tag, g_config.telemetry_period_s);
+
+		case PI_STATUS_LAST_FIX:
+		case PI_STATUS_LAST_FIX_AGE_MS: {
+			GPS_Data fix;
+			Timestamp fix_timestamp = aprs_get_last_fix(&fix);
+			if (fix_timestamp.monotonic_ms == 0) {
+				return false; //no fix yet
+			}
+			return (tag == PI_STATUS_LAST_FIX)
+					? pi_tlv_put(writer, tag, &fix, sizeof(fix))
+					: pi_tlv_put_u32(writer, tag, time_monotonic_ms() - fix_timestamp.monotonic_ms);
+		}
+
+		case PI_STATUS_LAST_TX_AGE_MS: {
+			Timestamp tx_timestamp = aprs_get_last_tx_timestamp();
+			if (tx_timestamp.monotonic_ms == 0) {
+				return false; //nothing sent yet
+			}
+			return pi_tlv_put_u32(writer, tag, time_monotonic_ms() - tx_timestamp.monotonic_ms);
+		}
+
+		case PI_STATUS_BATTERY_VOLTAGE:
+			return pi_tlv_put_float(writer, tag, voltage_mon);
+
+		case PI_STATUS_BATTERY_LOW:
+			return pi_tlv_put_u8(writer, tag, battery_monitor_is_low());
+
+		case PI_STATUS_COUNTERS: {
+			PiStatusCounters counters = pi_status_get_counters();
+			return pi_tlv_put(writer, tag, &counters, sizeof(counters));
+		}
+
+		case PI_STATUS_PI_RX_STATS: {
+			PiCommsRxStats stats = pi_comms_rx_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_PI_TX_STATS: {
+			PiCommsTxStats stats = pi_comms_tx_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_GPS_INGEST_STATS: {
+			GPS_IngestStats stats = gps_get_ingest_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_GPS_FORWARD_STATS: {
+			PiGpsForwardStats stats = pi_gps_forward_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_TIME_STATS:
+			return pi_tlv_put(writer, tag, time_get_stats(), sizeof(TimeStats));
+
+		case PI_STATUS_LOW_POWER: {
+			LowPowerStats stats = low_power_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_ISR_STATS: {
+			CpuLoadIsrStats stats[CPU_LOAD_NUM_ISRS];
+			cpu_load_get_isr_stats(stats);
+			return pi_tlv_put(writer, tag, stats, sizeof(stats));
+		}
+
+		case PI_STATUS_EVENT_LOG: {
+			EventLogStats stats = event_log_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_PI_LINK: {
+			PiLinkStats stats = pi_link_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		case PI_STATUS_FW_UPDATE: {
+			FwUpdateInfo info = fw_update_get_info();
+			return pi_tlv_put(writer, tag, &info, sizeof(info));
+		}
+
+		case PI_STATUS_KISS_STATS: {
+			KissStats stats = kiss_get_stats();
+			return pi_tlv_put(writer, tag, &stats, sizeof(stats));
+		}
+
+		default:
+			return false;
+	}
+}
+
+void pi_status_send(const uint8_t *tags, size_t count) {
+	if (!pi_status_take_response()) {
+		return;
+	}
+
+	PiTlvWriter writer;
+	pi_tlv_writer_init(&writer, response, sizeof(response));
+	for (size_t i = 0; i < count; i++) {
+		pi_status_put(&writer, tags[i]);
+	}
+	pi_status_send_response(writer.length);
+}
+
+void pi_status_send_snapshot(void) {
+	pi_status_send(snapshot_tags, sizeof(snapshot_tags));
+}
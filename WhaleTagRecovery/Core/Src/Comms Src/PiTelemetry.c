@@ -0,0 +1,96 @@
+/*
+ * PiTelemetry.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Periodic telemetry to the Pi. See matching header file for more info.
+ */
+
+#include "Comms Inc/PiTelemetry.h"
+#include "Comms Inc/PiComms.h"
+#include "Lib Inc/cpu_load.h"
+#include "Lib Inc/state_machine.h"
+#include "Lib Inc/threads.h"
+#include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/GPS.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include "config.h"
+#include <stddef.h>
+
+_Static_assert(NUM_THREADS <= PI_TELEMETRY_MAX_THREADS, "PiTelemetryPkt can't hold every thread");
+_Static_assert(sizeof(PiTelemetryPkt) <= PI_COMMS_TX_INLINE_SIZE, "PiTelemetryPkt doesn't fit in a transmit queue block");
+
+extern TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
+
+// === PRIVATE VARIABLES ===
+static TX_TIMER telemetry_timer;
+
+// === PRIVATE METHODS ===
+static void pi_telemetry_timer_expired(ULONG input) {
+	tx_event_flags_set(&state_machine_event_flags_group, STATE_TELEMETRY_FLAG, TX_OR);
+}
+
+static uint16_t pi_telemetry_saturate_u16(uint32_t value) {
+	return (value > UINT16_MAX) ? UINT16_MAX : value;
+}
+
+// === PUBLIC METHODS ===
+void pi_telemetry_init(void) {
+	ULONG period = tx_s_to_ticks(g_config.telemetry_period_s);
+	tx_timer_create(&telemetry_timer, "Pi Telemetry Timer", pi_telemetry_timer_expired, 0,
+			(period != 0) ? period : 1, period, (period != 0) ? TX_AUTO_ACTIVATE : TX_NO_ACTIVATE);
+}
+
+void pi_telemetry_update_period(void) {
+	ULONG period = tx_s_to_ticks(g_config.telemetry_period_s);
+	tx_timer_deactivate(&telemetry_timer);
+	if (period != 0) {
+		tx_timer_change(&telemetry_timer, period, period);
+		tx_timer_activate(&telemetry_timer);
+	}
+}
+
+void pi_telemetry_send(void) {
+	PiTelemetryPkt telemetry = {
+		.version = PI_TELEMETRY_VERSION,
+		.state = state_machine_get_state(),
+		.gps_power = gps_get_power_state(),
+		.uptime_s = time_monotonic_ms() / 1000,
+		.battery_mV = pi_telemetry_saturate_u16((voltage_mon > 0) ? (uint32_t)(voltage_mon * 1000) : 0),
+		.cpu_load_permille = cpu_load_sample_permille(),
+		.thread_count = NUM_THREADS,
+	};
+
+	GPS_Data fix;
+	Timestamp fix_timestamp = aprs_get_last_fix(&fix);
+	if (fix_timestamp.monotonic_ms != 0) {
+		telemetry.flags |= PI_TELEMETRY_FLAG_FIX;
+		telemetry.fix_age_s = pi_telemetry_saturate_u16((time_monotonic_ms() - fix_timestamp.monotonic_ms) / 1000);
+	}
+	telemetry.flags |= battery_monitor_is_low() ? PI_TELEMETRY_FLAG_BATTERY_LOW : 0;
+	telemetry.flags |= gps_is_continuous() ? PI_TELEMETRY_FLAG_GPS_CONTINUOUS : 0;
+
+	const GPS_PowerStats *hot = gps_get_power_stats(GPS_WAKE_HOT);
+	const GPS_PowerStats *cold = gps_get_power_stats(GPS_WAKE_COLD);
+	telemetry.ttff_hot_ds = pi_telemetry_saturate_u16(hot->ttff_last_ms / 100);
+	telemetry.ttff_cold_ds = pi_telemetry_saturate_u16(cold->ttff_last_ms / 100);
+	telemetry.gps_energy_mJ = hot->energy_mJ + cold->energy_mJ;
+
+	AprsTxStats aprs = aprs_get_tx_stats();
+	telemetry.aprs_transmissions = aprs.transmissions;
+	telemetry.aprs_energy_mJ = aprs.energy_mJ;
+
+	PiStatusCounters counters = pi_status_get_counters();
+	telemetry.gps_dropped = counters.gps_dropped;
+	telemetry.gps_forward_dropped = counters.gps_forward_dropped;
+	telemetry.pi_rx_dropped = counters.pi_rx_dropped;
+	telemetry.pi_tx_rejected = counters.pi_tx_rejected;
+
+	for (Thread index = 0; index < NUM_THREADS; index++) {
+		telemetry.stack_high_water[index] = pi_telemetry_saturate_u16(thread_stack_high_water(index));
+	}
+
+	//a full queue drops this message, the next one carries fresher values anyway
+	pi_comms_tx_send(PI_COMMS_TX_PRIORITY_STREAM, PI_COMM_MSG_TELEMETRY, &telemetry,
+			offsetof(PiTelemetryPkt, stack_high_water) + (NUM_THREADS * sizeof(telemetry.stack_high_water[0])));
+}
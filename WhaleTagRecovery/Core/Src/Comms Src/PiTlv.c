@@ -0,0 +1,68 @@
+/*
+ * PiTlv.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Tag-length-value lists. See matching header file for more info.
+ */
+
+#include "Comms Inc/PiTlv.h"
+#include <string.h>
+
+// === PUBLIC METHODS ===
+void pi_tlv_writer_init(PiTlvWriter *writer, uint8_t *buffer, size_t size) {
+	writer->buffer = buffer;
+	writer->size = size;
+	writer->length = 0;
+}
+
+bool pi_tlv_put(PiTlvWriter *writer, uint8_t tag, const void *value, size_t length) {
+	if ((length > PI_TLV_MAX_VALUE) || ((writer->length + PI_TLV_HEADER_SIZE + length) > writer->size)) {
+		return false;
+	}
+
+	uint8_t *entry = &writer->buffer[writer->length];
+	entry[0] = tag;
+	entry[1] = length;
+	memcpy(&entry[PI_TLV_HEADER_SIZE], value, length);
+	writer->length += PI_TLV_HEADER_SIZE + length;
+	return true;
+}
+
+bool pi_tlv_put_u8(PiTlvWriter *writer, uint8_t tag, uint8_t value) {
+	return pi_tlv_put(writer, tag, &value, sizeof(value));
+}
+
+bool pi_tlv_put_u32(PiTlvWriter *writer, uint8_t tag, uint32_t value) {
+	uint8_t bytes[4] = {value, value >> 8, value >> 16, value >> 24};
+	return pi_tlv_put(writer, tag, bytes, sizeof(bytes));
+}
+
+bool pi_tlv_put_float(PiTlvWriter *writer, uint8_t tag, float value) {
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return pi_tlv_put_u32(writer, tag, bits);
+}
+
+void pi_tlv_reader_init(PiTlvReader *reader, const uint8_t *buffer, size_t length) {
+	reader->buffer = buffer;
+	reader->length = length;
+	reader->offset = 0;
+}
+
+bool pi_tlv_next(PiTlvReader *reader, uint8_t *tag, const uint8_t **value, uint8_t *length) {
+	if ((reader->offset + PI_TLV_HEADER_SIZE) > reader->length) {
+		return false;
+	}
+
+	const uint8_t *entry = &reader->buffer[reader->offset];
+	if ((reader->offset + PI_TLV_HEADER_SIZE + entry[1]) > reader->length) {
+		return false;
+	}
+
+	*tag = entry[0];
+	*length = entry[1];
+	*value = &entry[PI_TLV_HEADER_SIZE];
+	reader->offset += PI_TLV_HEADER_SIZE + entry[1];
+	return true;
+}
@@ -0,0 +1,258 @@
+/*
+ * config_store.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Log-structured key/value store in flash. See matching header file for more info.
+ */
+
+#include "Lib Inc/config_store.h"
+#include "Lib Inc/crc32.h"
+#include "Lib Inc/flash.h"
+#include <stdbool.h>
+#include <string.h>
+
+// === PRIVATE DEFINES ===
+#define CONFIG_STORE_SECTOR_SIZE  FLASH_PAGE_SIZE_BYTES
+#define CONFIG_STORE_SECTOR_COUNT (FLASH_CONFIG_REGION_SIZE / CONFIG_STORE_SECTOR_SIZE)
+#define CONFIG_STORE_MAGIC        0x53474643 //"CFGS"
+
+#define CONFIG_STORE_SECTOR_ADDRESS(index) (FLASH_CONFIG_REGION_ADDRESS + ((index) * CONFIG_STORE_SECTOR_SIZE))
+
+//records take whole quad-words
+#define CONFIG_STORE_RECORD_SIZE(length) \
+	((sizeof(ConfigStoreRecord) + (length) + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1))
+
+// === PRIVATE TYPEDEFS ===
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t magic;
+	uint32_t sequence;		//incremented on every compaction, the highest valid sector is active
+	uint32_t sequence_check;	//~sequence
+	uint32_t __res;
+}ConfigStoreSectorHeader;
+
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint16_t key;
+	uint16_t length;		//0: key removed
+	uint32_t crc;			//CRC-32 of the value, seeded with key and length
+}ConfigStoreRecord;
+
+_Static_assert(sizeof(ConfigStoreSectorHeader) == FLASH_QUADWORD_SIZE, "the sector header must be a single quad-word");
+
+// === PRIVATE VARIABLES ===
+static uint32_t active_sector = 0;
+static uint32_t active_sequence = 0;
+static uint32_t append_address = 0;	//end of the active sector if a record is corrupted
+
+//latest record of each key
+static struct {
+	uint16_t key;
+	const ConfigStoreRecord *record;
+}index_table[CONFIG_STORE_MAX_KEYS];
+static size_t index_count = 0;
+
+//record being programmed
+static uint8_t record_buffer[CONFIG_STORE_RECORD_SIZE(CONFIG_STORE_MAX_VALUE_LENGTH)];
+
+// === PRIVATE METHODS ===
+static uint32_t config_store_crc(uint16_t key, uint16_t length, const uint8_t *value) {
+	uint8_t seed[4] = {key & 0xFF, key >> 8, length & 0xFF, length >> 8};
+	return crc32(crc32(0, seed, sizeof(seed)), value, length);
+}
+
+static const ConfigStoreSectorHeader *config_store_sector_header(uint32_t sector) {
+	const ConfigStoreSectorHeader *header = (const ConfigStoreSectorHeader *)CONFIG_STORE_SECTOR_ADDRESS(sector);
+	flash_ecc_error();
+	if ((header->magic != CONFIG_STORE_MAGIC) || (header->sequence_check != ~header->sequence) || flash_ecc_error()) {
+		return NULL;
+	}
+	return header;
+}
+
+static const ConfigStoreRecord **config_store_find(uint16_t key) {
+	for (size_t i = 0; i < index_count; i++) {
+		if (index_table[i].key == key) {
+			return &index_table[i].record;
+		}
+	}
+	return NULL;
+}
+
+//Indexes the records of the active sector, stopping at the first erased or invalid one. A record failing its ECC
+//check (see flash.h) is invalid.
+static void config_store_scan(void) {
+	uint32_t end = CONFIG_STORE_SECTOR_ADDRESS(active_sector) + CONFIG_STORE_SECTOR_SIZE;
+	uint32_t address = CONFIG_STORE_SECTOR_ADDRESS(active_sector) + sizeof(ConfigStoreSectorHeader);
+
+	index_count = 0;
+	flash_ecc_error();
+	while (address + sizeof(ConfigStoreRecord) <= end) {
+		const ConfigStoreRecord *record = (const ConfigStoreRecord *)address;
+		uint16_t key = record->key;
+		bool corrupted = flash_ecc_error();
+		if (!corrupted && (key == CONFIG_KEY_INVALID)) {
+			append_address = address; //erased, end of the log
+			return;
+		}
+
+		if (corrupted
+				|| (record->length > CONFIG_STORE_MAX_VALUE_LENGTH)
+				|| ((address + CONFIG_STORE_RECORD_SIZE(record->length)) > end)
+				|| (config_store_crc(record->key, record->length, (const uint8_t *)(record + 1)) != record->crc)
+				|| flash_ecc_error()) {
+			break; //interrupted write, nothing after it can be trusted
+		}
+
+		const ConfigStoreRecord **entry = config_store_find(record->key);
+		if (entry != NULL) {
+			*entry = record;
+		} else if (index_count < CONFIG_STORE_MAX_KEYS) {
+			index_table[index_count].key = record->key;
+			index_table[index_count].record = record;
+			index_count++;
+		}
+		address += CONFIG_STORE_RECORD_SIZE(record->length);
+	}
+	append_address = end; //full or corrupted, compacted on the next write
+}
+
+static HAL_StatusTypeDef config_store_program_record(uint32_t address, uint16_t key, const void *value, size_t length) {
+	ConfigStoreRecord record = {
+		.key = key,
+		.length = length,
+		.crc = config_store_crc(key, length, value),
+	};
+	memcpy(record_buffer, &record, sizeof(record));
+	memcpy(&record_buffer[sizeof(record)], value, length);
+	return flash_program(address, record_buffer, sizeof(record) + length);
+}
+
+//Copies the live records to the next sector, with the new value of key in place of its current one (a length of 0
+//removes it), and activates it. Nothing is erased if they don't fit.
+static HAL_StatusTypeDef config_store_compact(uint16_t key, const void *value, size_t length) {
+	uint32_t sector = (active_sector + 1) % CONFIG_STORE_SECTOR_COUNT;
+	uint32_t address = CONFIG_STORE_SECTOR_ADDRESS(sector) + sizeof(ConfigStoreSectorHeader);
+
+	size_t used = sizeof(ConfigStoreSectorHeader) + ((length != 0) ? CONFIG_STORE_RECORD_SIZE(length) : 0);
+	for (size_t i = 0; i < index_count; i++) {
+		const ConfigStoreRecord *record = index_table[i].record;
+		if ((record->key != key) && (record->length != 0)) {
+			used += CONFIG_STORE_RECORD_SIZE(record->length);
+		}
+	}
+	if (used > CONFIG_STORE_SECTOR_SIZE) {
+		return HAL_ERROR;
+	}
+
+	if (flash_erase(CONFIG_STORE_SECTOR_ADDRESS(sector), CONFIG_STORE_SECTOR_SIZE) != HAL_OK) {
+		return HAL_ERROR;
+	}
+
+	for (size_t i = 0; i < index_count; i++) {
+		const ConfigStoreRecord *record = index_table[i].record;
+		if ((record->key == key) || (record->length == 0)) {
+			continue;
+		}
+		//the record is unchanged, including its CRC
+		if (flash_program(address, (const uint8_t *)record, sizeof(*record) + record->length) != HAL_OK) {
+			return HAL_ERROR;
+		}
+		address += CONFIG_STORE_RECORD_SIZE(record->length);
+	}
+
+	//the new value goes in before the sector is activated, a reset in between keeps the old sector and value
+	if (length != 0) {
+		if (config_store_program_record(address, key, value, length) != HAL_OK) {
+			return HAL_ERROR;
+		}
+		address += CONFIG_STORE_RECORD_SIZE(length);
+	}
+
+	//the header is programmed last, the previous sector stays active until then
+	ConfigStoreSectorHeader header = {
+		.magic = CONFIG_STORE_MAGIC,
+		.sequence = active_sequence + 1,
+		.sequence_check = ~(active_sequence + 1),
+		.__res = UINT32_MAX,
+	};
+	if (flash_program(CONFIG_STORE_SECTOR_ADDRESS(sector), (const uint8_t *)&header, sizeof(header)) != HAL_OK) {
+		return HAL_ERROR;
+	}
+
+	active_sector = sector;
+	active_sequence = header.sequence;
+	config_store_scan();
+	return HAL_OK;
+}
+
+// === PUBLIC METHODS ===
+void config_store_init(void) {
+	bool found = false;
+	for (uint32_t sector = 0; sector < CONFIG_STORE_SECTOR_COUNT; sector++) {
+		const ConfigStoreSectorHeader *header = config_store_sector_header(sector);
+		//sequences only grow, the difference handles their wrap around
+		if ((header != NULL) && (!found || ((int32_t)(header->sequence - active_sequence) > 0))) {
+			found = true;
+			active_sector = sector;
+			active_sequence = header->sequence;
+		}
+	}
+
+	if (!found) {
+		//blank or unreadable region: start over from the last sector, the first one gets formatted
+		active_sector = CONFIG_STORE_SECTOR_COUNT - 1;
+		active_sequence = 0;
+		index_count = 0;
+		append_address = CONFIG_STORE_SECTOR_ADDRESS(active_sector) + CONFIG_STORE_SECTOR_SIZE; //retried on the first write
+		config_store_compact(CONFIG_KEY_INVALID, NULL, 0);
+		return;
+	}
+
+	config_store_scan();
+}
+
+size_t config_store_read(uint16_t key, void *value, size_t max_length) {
+	const ConfigStoreRecord **entry = config_store_find(key);
+	if (entry == NULL) {
+		return 0;
+	}
+
+	size_t length = (*entry)->length;
+	memcpy(value, *entry + 1, (length < max_length) ? length : max_length);
+	return length;
+}
+
+HAL_StatusTypeDef config_store_write(uint16_t key, const void *value, size_t length) {
+	if ((key == CONFIG_KEY_INVALID) || (length > CONFIG_STORE_MAX_VALUE_LENGTH)) {
+		return HAL_ERROR;
+	}
+
+	const ConfigStoreRecord **entry = config_store_find(key);
+	if ((entry == NULL) ? (length == 0)
+			: (((*entry)->length == length) && (memcmp(*entry + 1, value, length) == 0))) {
+		return HAL_OK; //unchanged
+	}
+	if ((entry == NULL) && (index_count == CONFIG_STORE_MAX_KEYS)) {
+		return HAL_ERROR;
+	}
+
+	//full: the value is written along with the live records to the next sector
+	uint32_t end = CONFIG_STORE_SECTOR_ADDRESS(active_sector) + CONFIG_STORE_SECTOR_SIZE;
+	if ((append_address + CONFIG_STORE_RECORD_SIZE(length)) > end) {
+		return config_store_compact(key, value, length);
+	}
+
+	uint32_t address = append_address;
+	if (config_store_program_record(address, key, value, length) != HAL_OK) {
+		append_address = end; //the sector can't be trusted past this point
+		return HAL_ERROR;
+	}
+	append_address += CONFIG_STORE_RECORD_SIZE(length);
+
+	if (entry == NULL) {
+		index_table[index_count].key = key;
+		entry = &index_table[index_count++].record;
+	}
+	*entry = (const ConfigStoreRecord *)address;
+	return HAL_OK;
+}
@@ -0,0 +1,95 @@
+/*
+ * cpu_load.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * CPU load from the idle loop. See matching header file for more info.
+ */
+
+#include "Lib Inc/cpu_load.h"
+#include "Lib Inc/time_service.h"
+#include "main.h"
+#include <string.h>
+
+//ThreadX tick processing (tx_timer.h)
+void _tx_timer_interrupt(void);
+
+// === PRIVATE VARIABLES ===
+static uint32_t enter_cycles = 0;
+static uint32_t exit_cycles = 0;
+static uint64_t idle_cycles = 0;	//since the last sample
+static uint32_t sample_ms = 0;
+
+static CpuLoadIsrStats isr_stats[CPU_LOAD_NUM_ISRS] = {0};
+
+// === PUBLIC METHODS ===
+void cpu_load_init(void) {
+	//the DWT is only clocked with trace enabled, which a debugger otherwise does when it attaches
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	enter_cycles = 0;
+	exit_cycles = 0;
+}
+
+void cpu_load_idle_enter(void) {
+	enter_cycles = DWT->CYCCNT;
+
+	//back in the idle loop without having run a thread since the last pass
+	uint32_t gap = enter_cycles - exit_cycles;
+	if (gap <= CPU_LOAD_IDLE_LOOP_MAX_CYCLES) {
+		idle_cycles += gap;
+	}
+}
+
+void cpu_load_idle_exit(void) {
+	exit_cycles = DWT->CYCCNT;
+	idle_cycles += exit_cycles - enter_cycles;
+}
+
+void cpu_load_idle_stopped(uint32_t ms) {
+	idle_cycles += (uint64_t)ms * (SystemCoreClock / 1000);
+}
+
+uint16_t cpu_load_sample_permille(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	uint64_t idle = idle_cycles;
+	idle_cycles = 0;
+	uint32_t now_ms = time_monotonic_ms();
+	uint32_t elapsed_ms = now_ms - sample_ms;
+	sample_ms = now_ms;
+	__set_PRIMASK(primask);
+
+	uint64_t total = (uint64_t)elapsed_ms * (SystemCoreClock / 1000);
+	if ((total == 0) || (idle >= total)) {
+		return 0;
+	}
+	return 1000 - (uint16_t)((idle * 1000) / total);
+}
+
+void cpu_load_isr_done(CpuLoadIsr isr, uint32_t start_cycles) {
+	uint32_t cycles = DWT->CYCCNT - start_cycles;
+
+	//the handlers have different priorities and may nest
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	CpuLoadIsrStats *stats = &isr_stats[isr];
+	stats->runs++;
+	stats->total_cycles += cycles;
+	stats->max_cycles = (cycles > stats->max_cycles) ? cycles : stats->max_cycles;
+	__set_PRIMASK(primask);
+}
+
+void cpu_load_timer_interrupt(void) {
+	uint32_t start_cycles = DWT->CYCCNT;
+	_tx_timer_interrupt();
+	cpu_load_isr_done(CPU_LOAD_ISR_SYSTICK, start_cycles);
+}
+
+void cpu_load_get_isr_stats(CpuLoadIsrStats stats[CPU_LOAD_NUM_ISRS]) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memcpy(stats, isr_stats, sizeof(isr_stats));
+	__set_PRIMASK(primask);
+}
@@ -0,0 +1,30 @@
+/*
+ * crc16.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * CRC-16/CCITT-FALSE. See matching header file for more info.
+ */
+
+#include "Lib Inc/crc16.h"
+
+// === PRIVATE VARIABLES ===
+//CRC of each nibble value, two lookups per byte
+static const uint16_t crc16_nibble_table[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+// === PUBLIC METHODS ===
+uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+	crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte >> 4)];
+	crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (byte & 0x0F)];
+	return crc;
+}
+
+uint16_t crc16(uint16_t crc, const uint8_t *data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		crc = crc16_update(crc, data[i]);
+	}
+	return crc;
+}
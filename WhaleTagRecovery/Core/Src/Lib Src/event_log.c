@@ -0,0 +1,358 @@
+/*
+ * event_log.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Flash event log. See matching header file for more info.
+ */
+
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/flash.h"
+#include "Lib Inc/time_service.h"
+#include "tx_api.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// === PRIVATE DEFINES ===
+#define EVENT_LOG_PAGE_SIZE  (1 << EVENT_LOG_PAGE_SHIFT)
+#define EVENT_LOG_PAGE_COUNT (FLASH_LOG_REGION_SIZE / EVENT_LOG_PAGE_SIZE)
+#define EVENT_LOG_PAGE_ADDRESS(sequence) \
+	(FLASH_LOG_REGION_ADDRESS + (((sequence) % EVENT_LOG_PAGE_COUNT) * EVENT_LOG_PAGE_SIZE))
+
+//type, time and the largest payload (FIX: two 5 byte varints and two bytes)
+#define EVENT_LOG_MAX_RECORD_SIZE (1 + 5 + 5 + 5 + 2)
+
+#define EVENT_LOG_DEGREES_SCALE 100000.0f
+
+_Static_assert(EVENT_LOG_PAGE_SIZE == FLASH_PAGE_SIZE_BYTES, "log pages must be flash pages");
+
+// === PRIVATE TYPEDEFS ===
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint32_t magic;
+	uint32_t sequence;
+	uint32_t monotonic_s;		//time base of the page
+	uint32_t sequence_check;	//~sequence
+}EventLogPageHeader;
+
+_Static_assert(sizeof(EventLogPageHeader) == FLASH_QUADWORD_SIZE, "the page header must be a single quad-word");
+
+// === PRIVATE VARIABLES ===
+static TX_MUTEX log_mutex;
+static bool initialized = false;
+
+//current page, mirrored in RAM. Bytes up to flushed_length are programmed.
+static uint8_t page_buffer[EVENT_LOG_PAGE_SIZE];
+static uint32_t page_sequence = 0;
+static size_t page_length = 0;
+static size_t flushed_length = 0;
+static uint32_t oldest_sequence = 0;
+static uint32_t unflushed_since_s = 0;	//time of the oldest record waiting
+
+//delta coding state, reset on every page and boot
+static struct {
+	uint32_t monotonic_s;
+	int32_t latitude;
+	int32_t longitude;
+	int32_t battery_mV;
+	bool utc_offset_valid;
+	uint32_t utc_offset_s;
+}base;
+
+//battery samples rate limiting
+static int32_t battery_logged_mV = 0;
+static uint32_t battery_logged_s = 0;
+static bool battery_logged = false;
+
+static EventLogStats stats = {0};
+
+// === PRIVATE METHODS ===
+static const EventLogPageHeader *event_log_page_header(uint32_t sequence) {
+	const EventLogPageHeader *header = (const EventLogPageHeader *)EVENT_LOG_PAGE_ADDRESS(sequence);
+	flash_ecc_error();
+	if ((header->magic != EVENT_LOG_MAGIC) || (header->sequence_check != ~header->sequence)
+			|| (header->sequence != sequence) || flash_ecc_error()) {
+		return NULL;
+	}
+	return header;
+}
+
+static void event_log_put_varint(uint32_t value) {
+	do {
+		uint8_t byte = value & 0x7F;
+		value >>= 7;
+		page_buffer[page_length++] = byte | ((value != 0) ? 0x80 : 0);
+	} while (value != 0);
+}
+
+static void event_log_put_signed(int32_t value) {
+	event_log_put_varint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31)); //zigzag
+}
+
+//Programs the quad-words written since the last flush, the last one padded with 0xFF
+static void event_log_program(void) {
+	size_t end = (page_length + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1);
+	if (end == flushed_length) {
+		return;
+	}
+
+	memset(&page_buffer[page_length], EVENT_LOG_RECORD_PADDING, end - page_length);
+	if (flash_program(EVENT_LOG_PAGE_ADDRESS(page_sequence) + flushed_length, &page_buffer[flushed_length],
+			end - flushed_length) != HAL_OK) {
+		stats.flash_errors++;
+	}
+	stats.pages_written++;
+	page_length = end;
+	flushed_length = end;
+}
+
+static void event_log_reset_base(uint32_t monotonic_s) {
+	base.monotonic_s = monotonic_s;
+	base.latitude = 0;
+	base.longitude = 0;
+	base.battery_mV = 0;
+	base.utc_offset_valid = false;
+}
+
+//Closes the current page and starts the next one, erasing the oldest page
+static void event_log_next_page(uint32_t monotonic_s) {
+	if (page_sequence != 0) {
+		event_log_program();
+	}
+
+	page_sequence++;
+	if (flash_erase(EVENT_LOG_PAGE_ADDRESS(page_sequence), EVENT_LOG_PAGE_SIZE) != HAL_OK) {
+		stats.flash_errors++;
+	}
+	stats.pages_erased++;
+	if ((page_sequence - oldest_sequence) >= EVENT_LOG_PAGE_COUNT) {
+		oldest_sequence = page_sequence - EVENT_LOG_PAGE_COUNT + 1;
+	}
+
+	EventLogPageHeader header = {
+		.magic = EVENT_LOG_MAGIC,
+		.sequence = page_sequence,
+		.monotonic_s = monotonic_s,
+		.sequence_check = ~page_sequence,
+	};
+	memset(page_buffer, EVENT_LOG_RECORD_PADDING, sizeof(page_buffer));
+	memcpy(page_buffer, &header, sizeof(header));
+	page_length = sizeof(header);
+	flushed_length = 0;
+	event_log_reset_base(monotonic_s);
+}
+
+//Starts a record, with the time and UTC offset records it needs. Called with log_mutex held.
+static void event_log_begin(EventLogRecord type) {
+	Timestamp now = time_now();
+	uint32_t monotonic_s = now.monotonic_ms / 1000;
+	bool utc_valid = (now.source != TIME_SOURCE_NONE);
+	uint32_t utc_offset_s = now.utc_s - monotonic_s;
+
+	//a UTC record and this one must fit
+	if ((page_length + (2 * EVENT_LOG_MAX_RECORD_SIZE)) > EVENT_LOG_PAGE_SIZE) {
+		event_log_next_page(monotonic_s);
+	}
+
+	if (type == EVENT_LOG_RECORD_BOOT) {
+		event_log_reset_base(0); //times restart from this boot
+	} else if (utc_valid && (!base.utc_offset_valid || (((utc_offset_s - base.utc_offset_s) + 1) > 2))) {
+		page_buffer[page_length++] = EVENT_LOG_RECORD_TIME;
+		event_log_put_varint(monotonic_s - base.monotonic_s);
+		event_log_put_varint(utc_offset_s);
+		base.monotonic_s = monotonic_s;
+		base.utc_offset_valid = true;
+		base.utc_offset_s = utc_offset_s;
+		stats.records++;
+	}
+
+	if (page_length == flushed_length) {
+		unflushed_since_s = monotonic_s;
+	}
+	page_buffer[page_length++] = type;
+	event_log_put_varint(monotonic_s - base.monotonic_s);
+	base.monotonic_s = monotonic_s;
+	stats.records++;
+}
+
+//Ends a record, programming the page if the records waiting got too old. Releases log_mutex.
+static void event_log_end(void) {
+	if ((base.monotonic_s - unflushed_since_s) >= EVENT_LOG_MAX_UNFLUSHED_S) {
+		event_log_program();
+	}
+	tx_mutex_put(&log_mutex);
+}
+
+static bool event_log_lock(void) {
+	return initialized && (tx_mutex_get(&log_mutex, TX_WAIT_FOREVER) == TX_SUCCESS);
+}
+
+// === PUBLIC METHODS ===
+void event_log_init(void) {
+	tx_mutex_create(&log_mutex, "Event Log Mutex", TX_INHERIT);
+
+	//newest valid page
+	for (uint32_t index = 0; index < EVENT_LOG_PAGE_COUNT; index++) {
+		const EventLogPageHeader *header = (const EventLogPageHeader *)(FLASH_LOG_REGION_ADDRESS + (index * EVENT_LOG_PAGE_SIZE));
+		flash_ecc_error();
+		if ((header->magic == EVENT_LOG_MAGIC) && (header->sequence_check == ~header->sequence)
+				&& (header->sequence % EVENT_LOG_PAGE_COUNT == index) && !flash_ecc_error()
+				&& ((page_sequence == 0) || ((int32_t)(header->sequence - page_sequence) > 0))) {
+			page_sequence = header->sequence;
+		}
+	}
+
+	uint32_t monotonic_s = time_monotonic_ms() / 1000;
+	if (page_sequence == 0) {
+		oldest_sequence = 1;
+		event_log_next_page(monotonic_s);
+	} else {
+		//oldest page still holding its own sequence
+		oldest_sequence = page_sequence;
+		while (((page_sequence - oldest_sequence + 1) < EVENT_LOG_PAGE_COUNT) && (oldest_sequence > 1)
+				&& (event_log_page_header(oldest_sequence - 1) != NULL)) {
+			oldest_sequence--;
+		}
+
+		//continue after the last programmed quad-word
+		if (flash_read(page_buffer, EVENT_LOG_PAGE_ADDRESS(page_sequence), EVENT_LOG_PAGE_SIZE)) {
+			page_length = EVENT_LOG_PAGE_SIZE;
+			while ((page_length > sizeof(EventLogPageHeader)) && (page_buffer[page_length - 1] == EVENT_LOG_RECORD_PADDING)) {
+				page_length--;
+			}
+			page_length = (page_length + FLASH_QUADWORD_SIZE - 1) & ~(FLASH_QUADWORD_SIZE - 1);
+		} else {
+			//programming was cut off, the quad-word can't be programmed again: the page is closed, the interrupted
+			//quad-word reads as padding
+			page_length = EVENT_LOG_PAGE_SIZE;
+		}
+		flushed_length = page_length;
+	}
+
+	initialized = true;
+	tx_mutex_get(&log_mutex, TX_WAIT_FOREVER);
+	event_log_begin(EVENT_LOG_RECORD_BOOT);
+	event_log_end();
+}
+
+void event_log_fix(const GPS_Data *fix) {
+	if (!event_log_lock()) {
+		return;
+	}
+
+	int32_t latitude = lroundf(fix->latitude * EVENT_LOG_DEGREES_SCALE);
+	int32_t longitude = lroundf(fix->longitude * EVENT_LOG_DEGREES_SCALE);
+	uint32_t hdop_tenths = GPS_QUALITY_HDOP_TENTHS(fix->quality);
+
+	event_log_begin(EVENT_LOG_RECORD_FIX);
+	event_log_put_signed(latitude - base.latitude);
+	event_log_put_signed(longitude - base.longitude);
+	page_buffer[page_length++] = GPS_QUALITY_SATELLITES(fix->quality);
+	//capped below 0xFF: a programmed quad-word must never read as padding only
+	page_buffer[page_length++] = (hdop_tenths >= UINT8_MAX) ? (UINT8_MAX - 1) : hdop_tenths;
+	base.latitude = latitude;
+	base.longitude = longitude;
+	event_log_end();
+}
+
+void event_log_transmission(uint32_t on_air_ms) {
+	if (!event_log_lock()) {
+		return;
+	}
+
+	event_log_begin(EVENT_LOG_RECORD_TX);
+	event_log_put_varint(on_air_ms);
+	event_log_end();
+}
+
+void event_log_state(uint8_t state) {
+	if (!event_log_lock()) {
+		return;
+	}
+
+	event_log_begin(EVENT_LOG_RECORD_STATE);
+	page_buffer[page_length++] = state;
+	event_log_end();
+}
+
+void event_log_battery(float voltage) {
+	int32_t battery_mV = lroundf(voltage * 1000);
+	uint32_t monotonic_s = time_monotonic_ms() / 1000;
+	if (battery_logged && (abs(battery_mV - battery_logged_mV) < EVENT_LOG_BATTERY_CHANGE_MV)
+			&& ((monotonic_s - battery_logged_s) < EVENT_LOG_BATTERY_PERIOD_S)) {
+		return;
+	}
+	if (!event_log_lock()) {
+		return;
+	}
+
+	event_log_begin(EVENT_LOG_RECORD_BATTERY);
+	event_log_put_signed(battery_mV - base.battery_mV);
+	base.battery_mV = battery_mV;
+	battery_logged = true;
+	battery_logged_mV = battery_mV;
+	battery_logged_s = monotonic_s;
+	event_log_end();
+}
+
+void event_log_flush(void) {
+	if (!event_log_lock()) {
+		return;
+	}
+	event_log_program();
+	tx_mutex_put(&log_mutex);
+}
+
+size_t event_log_read(uint32_t *offset, uint8_t *data, size_t max_length) {
+	if (!event_log_lock()) {
+		return 0;
+	}
+
+	uint32_t sequence = *offset >> EVENT_LOG_PAGE_SHIFT;
+	size_t position = *offset & (EVENT_LOG_PAGE_SIZE - 1);
+	size_t length = 0;
+
+	if ((int32_t)(sequence - oldest_sequence) < 0) {
+		sequence = oldest_sequence;
+		position = 0;
+	}
+
+	//older pages, skipping any that can't be read
+	while ((int32_t)(sequence - page_sequence) < 0) {
+		if (event_log_page_header(sequence) != NULL) {
+			length = EVENT_LOG_PAGE_SIZE - position;
+			length = (length < max_length) ? length : max_length;
+			flash_read(data, EVENT_LOG_PAGE_ADDRESS(sequence) + position, length);
+			break;
+		}
+		sequence++;
+		position = 0;
+	}
+
+	//current page, from RAM
+	if ((int32_t)(sequence - page_sequence) >= 0) {
+		if ((sequence != page_sequence) || (position > page_length)) {
+			sequence = page_sequence;
+			position = page_length;
+		}
+		length = page_length - position;
+		length = (length < max_length) ? length : max_length;
+		memcpy(data, &page_buffer[position], length);
+	}
+
+	*offset = (sequence << EVENT_LOG_PAGE_SHIFT) + position;
+	tx_mutex_put(&log_mutex);
+	return length;
+}
+
+EventLogStats event_log_get_stats(void) {
+	if (!event_log_lock()) {
+		return stats;
+	}
+	EventLogStats copy = stats;
+	copy.first_offset = oldest_sequence << EVENT_LOG_PAGE_SHIFT;
+	copy.end_offset = (page_sequence << EVENT_LOG_PAGE_SHIFT) + page_length;
+	tx_mutex_put(&log_mutex);
+	return copy;
+}
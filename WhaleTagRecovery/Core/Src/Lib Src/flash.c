@@ -0,0 +1,110 @@
+/*
+ * flash.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Internal flash erase/program helpers. See matching header file for more info.
+ */
+
+#include "Lib Inc/flash.h"
+#include <string.h>
+
+_Static_assert((FLASH_LOG_REGION_ADDRESS + FLASH_LOG_REGION_SIZE) <= (FLASH_DATA_AREA_ADDRESS + FLASH_DATA_AREA_SIZE),
+		"the data regions don't fit in the data area");
+
+static volatile bool ecc_error = false;
+
+bool flash_banks_swapped(void){
+	return READ_BIT(FLASH->OPTR, FLASH_OPTR_SWAP_BANK) != 0;
+}
+
+HAL_StatusTypeDef flash_erase(uint32_t address, size_t length){
+	if ((address < FLASH_BASE_ADDRESS) || ((address - FLASH_BASE_ADDRESS) % FLASH_PAGE_SIZE_BYTES) != 0){
+		return HAL_ERROR;
+	}
+
+	HAL_StatusTypeDef result = HAL_OK;
+	bool swapped = flash_banks_swapped();
+	HAL_FLASH_Unlock();
+
+	//erase one page at a time so that regions may cross the bank boundary
+	for (uint32_t offset = 0; (offset < length) && (result == HAL_OK); offset += FLASH_PAGE_SIZE_BYTES){
+		uint32_t flash_offset = (address + offset) - FLASH_BASE_ADDRESS;
+		uint32_t page_error = 0;
+		//page erase selects the physical bank, addresses follow the swap
+		bool first_bank = ((flash_offset < FLASH_BANK_SIZE_BYTES) != swapped);
+		FLASH_EraseInitTypeDef erase = {
+			.TypeErase = FLASH_TYPEERASE_PAGES,
+			.Banks = first_bank ? FLASH_BANK_1 : FLASH_BANK_2,
+			.Page = (flash_offset % FLASH_BANK_SIZE_BYTES) / FLASH_PAGE_SIZE_BYTES,
+			.NbPages = 1,
+		};
+		result = HAL_FLASHEx_Erase(&erase, &page_error);
+	}
+
+	HAL_FLASH_Lock();
+
+	//stale contents may still be in the instruction cache
+	HAL_ICACHE_Invalidate();
+	return result;
+}
+
+HAL_StatusTypeDef flash_program(uint32_t address, const uint8_t *data, size_t length){
+	if ((address % FLASH_QUADWORD_SIZE) != 0){
+		return HAL_ERROR;
+	}
+
+	//quad-words are programmed from a word aligned copy
+	uint32_t quadword[FLASH_QUADWORD_SIZE / sizeof(uint32_t)];
+	HAL_StatusTypeDef result = HAL_OK;
+	HAL_FLASH_Unlock();
+
+	for (size_t offset = 0; (offset < length) && (result == HAL_OK); offset += FLASH_QUADWORD_SIZE){
+		size_t chunk = ((length - offset) < FLASH_QUADWORD_SIZE) ? (length - offset) : FLASH_QUADWORD_SIZE;
+		memset(quadword, FLASH_ERASED_BYTE, sizeof(quadword));
+		memcpy(quadword, &data[offset], chunk);
+		result = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address + offset, (uint32_t)quadword);
+	}
+
+	HAL_FLASH_Lock();
+	HAL_ICACHE_Invalidate();
+	return result;
+}
+
+bool flash_read(void *data, uint32_t address, size_t length){
+	bool intact = true;
+	flash_ecc_error();
+
+	//one quad-word at a time, so that only the failing ones are lost
+	for (size_t offset = 0; offset < length;){
+		size_t chunk = FLASH_QUADWORD_SIZE - ((address + offset) % FLASH_QUADWORD_SIZE);
+		chunk = (chunk < (length - offset)) ? chunk : (length - offset);
+		memcpy((uint8_t *)data + offset, (const uint8_t *)(address + offset), chunk);
+		if (flash_ecc_error()){
+			memset((uint8_t *)data + offset, FLASH_ERASED_BYTE, chunk);
+			intact = false;
+		}
+		offset += chunk;
+	}
+	return intact;
+}
+
+bool flash_ecc_error(void){
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bool error = ecc_error;
+	ecc_error = false;
+	__set_PRIMASK(primask);
+	return error;
+}
+
+bool flash_ecc_nmi(void){
+	if (READ_BIT(FLASH->ECCR, FLASH_ECCR_ECCD) == 0){
+		return false;
+	}
+
+	//ECCD is cleared by writing 1, a pending ECCC is left alone
+	MODIFY_REG(FLASH->ECCR, FLASH_ECCR_ECCC, FLASH_ECCR_ECCD);
+	ecc_error = true;
+	return true;
+}
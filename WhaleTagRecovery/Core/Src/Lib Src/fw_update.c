@@ -0,0 +1,297 @@
+/*
+ * fw_update.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Dual bank firmware updates with rollback. See matching header file for more info.
+ */
+
+#include "Lib Inc/fw_update.h"
+#include "Comms Inc/PiComms.h"
+#include "Lib Inc/crc32.h"
+#include "Lib Inc/flash.h"
+#include "Lib Inc/state_machine.h"
+#include "Lib Inc/threads.h"
+#include "Lib Inc/timing.h"
+#include "tx_api.h"
+#include <string.h>
+
+// === PRIVATE DEFINES ===
+#define FW_UPDATE_RAM_START 0x20000000
+#define FW_UPDATE_RAM_END   (FW_UPDATE_RAM_START + (768 * 1024))
+
+extern RTC_HandleTypeDef hrtc;
+extern TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
+extern Thread_HandleTypeDef threads[NUM_THREADS];
+
+// === PRIVATE VARIABLES ===
+static FwUpdateState state = FW_UPDATE_STATE_CONFIRMED;
+static uint8_t trial_boots = 0;
+static TX_TIMER confirm_timer;
+
+//upload in progress
+static bool upload_active = false;
+static bool image_ready = false;	//received and checked, waiting for fw_update_activate()
+static uint32_t upload_length = 0;
+static uint32_t upload_crc = 0;
+static uint32_t upload_offset = 0;
+static uint8_t upload_pending[FLASH_QUADWORD_SIZE]; //bytes not yet programmed (flash is written in whole quad-words)
+static size_t upload_pending_length = 0;
+
+// === PRIVATE METHODS ===
+static void fw_update_save_state(void) {
+	HAL_RTCEx_BKUPWrite(&hrtc, FW_UPDATE_BKP_REGISTER, ((uint32_t)FW_UPDATE_BKP_MAGIC << 16) | (state << 8) | trial_boots);
+}
+
+static void fw_update_confirm_expired(ULONG input) {
+	tx_event_flags_set(&state_machine_event_flags_group, STATE_FW_ROLLBACK_FLAG, TX_OR);
+}
+
+//Copies the data regions to the first bank's data area, where they will be once the banks are swapped
+static HAL_StatusTypeDef fw_update_copy_data_area(void) {
+	if (flash_erase(FLASH_SPARE_DATA_AREA_ADDRESS, FLASH_DATA_AREA_SIZE) != HAL_OK) {
+		return HAL_ERROR;
+	}
+
+	static const uint8_t erased[FLASH_QUADWORD_SIZE] = {[0 ... FLASH_QUADWORD_SIZE - 1] = FLASH_ERASED_BYTE};
+	for (uint32_t offset = 0; offset < FLASH_DATA_AREA_SIZE; offset += FLASH_QUADWORD_SIZE) {
+		const uint8_t *source = (const uint8_t *)(FLASH_DATA_AREA_ADDRESS + offset);
+
+		//erased quad-words are left erased, so that they can still be programmed
+		if ((memcmp(source, erased, FLASH_QUADWORD_SIZE) != 0)
+				&& (flash_program(FLASH_SPARE_DATA_AREA_ADDRESS + offset, source, FLASH_QUADWORD_SIZE) != HAL_OK)) {
+			return HAL_ERROR;
+		}
+	}
+	return HAL_OK;
+}
+
+//Maps the other bank at FLASH_BASE_ADDRESS. Loading the option bytes resets the board, only returns on failure.
+static void fw_update_swap_banks(void) {
+	if (fw_update_copy_data_area() != HAL_OK) {
+		return;
+	}
+
+	FLASH_OBProgramInitTypeDef option_bytes = {
+		.OptionType = OPTIONBYTE_USER,
+		.USERType = OB_USER_SWAP_BANK,
+		.USERConfig = flash_banks_swapped() ? OB_SWAP_BANK_DISABLE : OB_SWAP_BANK_ENABLE,
+	};
+
+	HAL_FLASH_Unlock();
+	HAL_FLASH_OB_Unlock();
+	if (HAL_FLASHEx_OBProgram(&option_bytes) == HAL_OK) {
+		HAL_FLASH_OB_Launch();
+	}
+	HAL_FLASH_OB_Lock();
+	HAL_FLASH_Lock();
+}
+
+//The board's side of the health check of an image on trial (see fw_update.h)
+static bool fw_update_check_health(void) {
+	if (time_monotonic_ms() < (FW_UPDATE_HEALTH_MIN_S * 1000)) {
+		return false;
+	}
+
+	if (pi_comms_rx_get_stats().frames < FW_UPDATE_HEALTH_MIN_PI_FRAMES) {
+		return false;
+	}
+
+	for (int i = 0; i < NUM_THREADS; i++) {
+		UINT thread_state;
+		if ((tx_thread_info_get(&threads[i].thread, TX_NULL, &thread_state, TX_NULL, TX_NULL, TX_NULL, TX_NULL,
+				TX_NULL, TX_NULL) != TX_SUCCESS) || (thread_state == TX_COMPLETED) || (thread_state == TX_TERMINATED)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//Checks that the reset vectors point into RAM and into the image
+static bool fw_update_check_vectors(const uint32_t *vectors, uint32_t length) {
+	uint32_t stack_pointer = vectors[0];
+	uint32_t reset_handler = vectors[1] & ~1UL; //thumb bit
+
+	return (stack_pointer > FW_UPDATE_RAM_START) && (stack_pointer <= FW_UPDATE_RAM_END)
+			&& (reset_handler >= FLASH_BASE_ADDRESS) && (reset_handler < (FLASH_BASE_ADDRESS + length));
+}
+
+// === PUBLIC METHODS ===
+void fw_update_boot(void) {
+	uint32_t saved = HAL_RTCEx_BKUPRead(&hrtc, FW_UPDATE_BKP_REGISTER);
+	if ((saved >> 16) == FW_UPDATE_BKP_MAGIC) {
+		state = (saved >> 8) & 0xFF;
+		trial_boots = saved & 0xFF;
+	}
+
+	if (state != FW_UPDATE_STATE_TRIAL) {
+		return;
+	}
+
+	//reset before being confirmed (e.g. crash or watchdog)
+	if (++trial_boots > FW_UPDATE_MAX_TRIAL_BOOTS) {
+		fw_update_rollback();
+	}
+	fw_update_save_state();
+
+	tx_timer_create(&confirm_timer, "FW Update Confirm Timer", fw_update_confirm_expired, 0,
+			tx_s_to_ticks(FW_UPDATE_CONFIRM_TIMEOUT_S), 0, TX_AUTO_ACTIVATE);
+}
+
+FwUpdateStatus fw_update_confirm(void) {
+	if (state != FW_UPDATE_STATE_TRIAL) {
+		return FW_UPDATE_OK;
+	}
+
+	if (!fw_update_check_health()) {
+		return FW_UPDATE_ERROR_UNHEALTHY;
+	}
+
+	tx_timer_deactivate(&confirm_timer);
+	state = FW_UPDATE_STATE_CONFIRMED;
+	trial_boots = 0;
+	fw_update_save_state();
+	return FW_UPDATE_OK;
+}
+
+void fw_update_rollback(void) {
+	if (state != FW_UPDATE_STATE_TRIAL) {
+		return;
+	}
+
+	state = FW_UPDATE_STATE_ROLLED_BACK;
+	fw_update_save_state();
+	fw_update_swap_banks();
+
+	//still here: keep running the image on trial, the rollback is retried on the next boot
+	state = FW_UPDATE_STATE_TRIAL;
+	fw_update_save_state();
+}
+
+FwUpdateStatus fw_update_begin(uint32_t length, uint32_t crc, uint32_t *next_offset) {
+	upload_active = false;
+	image_ready = false;
+	*next_offset = 0;
+
+	if (state == FW_UPDATE_STATE_TRIAL) {
+		return FW_UPDATE_ERROR_TRIAL;
+	}
+
+	if ((length == 0) || (length > FLASH_IMAGE_SIZE)) {
+		return FW_UPDATE_ERROR_LENGTH;
+	}
+
+	if (flash_erase(FLASH_UPDATE_IMAGE_ADDRESS, FLASH_IMAGE_SIZE) != HAL_OK) {
+		return FW_UPDATE_ERROR_FLASH;
+	}
+
+	upload_active = true;
+	upload_length = length;
+	upload_crc = crc;
+	upload_offset = 0;
+	upload_pending_length = 0;
+	return FW_UPDATE_OK;
+}
+
+FwUpdateStatus fw_update_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset) {
+	*next_offset = upload_offset;
+
+	if (!upload_active) {
+		return FW_UPDATE_ERROR_NO_TRANSFER;
+	}
+
+	if (offset + length <= upload_offset) {
+		return FW_UPDATE_OK; //repeated chunk (our ack was lost), already written
+	}
+
+	if (offset != upload_offset) {
+		return FW_UPDATE_ERROR_SEQUENCE;
+	}
+
+	if (upload_offset + length > upload_length) {
+		upload_active = false;
+		return FW_UPDATE_ERROR_LENGTH;
+	}
+
+	//program whole quad-words, keep the remainder pending for the next chunk
+	uint32_t write_address = FLASH_UPDATE_IMAGE_ADDRESS + upload_offset - upload_pending_length;
+	size_t consumed = 0;
+	while (consumed < length) {
+		size_t copy = FLASH_QUADWORD_SIZE - upload_pending_length;
+		copy = (copy < (length - consumed)) ? copy : (length - consumed);
+		memcpy(&upload_pending[upload_pending_length], &data[consumed], copy);
+		upload_pending_length += copy;
+		consumed += copy;
+
+		if (upload_pending_length == FLASH_QUADWORD_SIZE) {
+			if (flash_program(write_address, upload_pending, FLASH_QUADWORD_SIZE) != HAL_OK) {
+				upload_active = false;
+				return FW_UPDATE_ERROR_FLASH;
+			}
+			write_address += FLASH_QUADWORD_SIZE;
+			upload_pending_length = 0;
+		}
+	}
+
+	upload_offset += length;
+	*next_offset = upload_offset;
+	return FW_UPDATE_OK;
+}
+
+FwUpdateStatus fw_update_end(uint32_t length, uint32_t *next_offset) {
+	*next_offset = upload_offset;
+
+	if (!upload_active) {
+		return FW_UPDATE_ERROR_NO_TRANSFER;
+	}
+	upload_active = false;
+
+	if ((length != upload_length) || (upload_offset != upload_length)) {
+		return FW_UPDATE_ERROR_LENGTH;
+	}
+
+	//flush the final partial quad-word
+	if (upload_pending_length != 0) {
+		uint32_t write_address = FLASH_UPDATE_IMAGE_ADDRESS + upload_offset - upload_pending_length;
+		if (flash_program(write_address, upload_pending, upload_pending_length) != HAL_OK) {
+			return FW_UPDATE_ERROR_FLASH;
+		}
+		upload_pending_length = 0;
+	}
+
+	if (crc32(0, (const uint8_t *)FLASH_UPDATE_IMAGE_ADDRESS, upload_length) != upload_crc) {
+		return FW_UPDATE_ERROR_CRC;
+	}
+
+	if (!fw_update_check_vectors((const uint32_t *)FLASH_UPDATE_IMAGE_ADDRESS, upload_length)) {
+		return FW_UPDATE_ERROR_IMAGE;
+	}
+
+	image_ready = true;
+	return FW_UPDATE_OK;
+}
+
+void fw_update_activate(void) {
+	if (!image_ready) {
+		return;
+	}
+
+	FwUpdateState previous_state = state;
+	state = FW_UPDATE_STATE_TRIAL;
+	trial_boots = 0;
+	fw_update_save_state();
+	fw_update_swap_banks();
+
+	//still here: the swap failed, keep running this image
+	state = previous_state;
+	fw_update_save_state();
+}
+
+FwUpdateInfo fw_update_get_info(void) {
+	return (FwUpdateInfo){
+		.state = state,
+		.trial_boots = trial_boots,
+		.bank = flash_banks_swapped() ? 2 : 1,
+		.image_crc = upload_crc,
+	};
+}
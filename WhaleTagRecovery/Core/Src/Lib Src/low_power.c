@@ -0,0 +1,233 @@
+/*
+ * low_power.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Tickless STOP2 idle. See matching header file for more info.
+ */
+
+#include "Lib Inc/low_power.h"
+#include "Lib Inc/cpu_load.h"
+#include "main.h"
+#include "config.h"
+#include "tx_api.h"
+
+// === PRIVATE DEFINES ===
+#define LOW_POWER_TIMER_MASK 0xFFFF //16 bit counter
+
+#define LOW_POWER_PI_RX_EXTI_LINE 3 //PA3, EXT_RX_Pin
+
+//STOP2 periods in LPTIM1 counts, rounded down: the wake is never late
+#define LOW_POWER_MS_TO_COUNTS(ms) (((uint64_t)(ms) * LOW_POWER_TIMER_HZ) / 1000)
+
+_Static_assert(LOW_POWER_MS_TO_COUNTS(LOW_POWER_MAX_STOP_MS) < LOW_POWER_TIMER_MASK,
+		"the elapsed time is measured on one counter lap");
+_Static_assert(EXT_RX_Pin == (1 << LOW_POWER_PI_RX_EXTI_LINE), "the Pi link RX pin moved");
+
+// === PRIVATE TYPEDEFS ===
+typedef enum {
+	LOW_POWER_MODE_RUN,
+	LOW_POWER_MODE_SLEEP,
+	LOW_POWER_MODE_STOP2,
+}LowPowerMode;
+
+// === PRIVATE VARIABLES ===
+static volatile uint32_t held_vetoes = 0;
+static volatile uint32_t timed_vetoes = 0;
+static volatile uint32_t timed_veto_end_ms[LOW_POWER_NUM_VETOES] = {0};
+
+//next ThreadX timer expiration, given by low_power_timer_setup() before each low_power_enter()
+static bool wake_armed = false;
+static uint32_t wake_ticks = 0;
+
+static LowPowerMode mode = LOW_POWER_MODE_RUN;
+static uint16_t stop_start_count = 0;
+static bool compare_pending = false;	//CCR1 write not synchronized to the LPTIM1 clock yet
+static uint32_t adjust_ticks = 0;
+static uint32_t tick_remainder = 0;		//ticks * LOW_POWER_TIMER_HZ not yet reported to ThreadX
+static uint32_t ms_remainder = 0;		//ms * LOW_POWER_TIMER_HZ not yet added to the HAL tick
+
+static LowPowerStats stats = {0};
+
+// === PRIVATE METHODS ===
+//The counter runs on the LSE, asynchronous to the core: read until two reads agree
+static uint16_t low_power_timer_count(void) {
+	uint32_t count;
+	do {
+		count = LPTIM1->CNT;
+	} while (count != LPTIM1->CNT);
+	return count;
+}
+
+static void low_power_timer_compare(uint16_t count) {
+	if (compare_pending) {
+		while (!(LPTIM1->ISR & LPTIM_ISR_CMP1OK));
+	}
+	LPTIM1->ICR = LPTIM_ICR_CMP1OKCF | LPTIM_ICR_CC1CF;
+	LPTIM1->CCR1 = count;
+	compare_pending = true;
+	NVIC_ClearPendingIRQ(LPTIM1_IRQn);
+}
+
+static bool low_power_vetoed(void) {
+	if (held_vetoes != 0) {
+		return true;
+	}
+
+	uint32_t now = HAL_GetTick();
+	for (uint32_t source = 0; timed_vetoes != 0; source++) {
+		if (!(timed_vetoes & (1 << source))) {
+			continue;
+		}
+		if ((int32_t)(timed_veto_end_ms[source] - now) > 0) {
+			return true;
+		}
+		timed_vetoes &= ~(1 << source); //expired
+	}
+	return false;
+}
+
+//STOP2 wakes on MSIS with the PLL off, its configuration is kept
+static void low_power_restore_clocks(void) {
+	__HAL_RCC_PLL_ENABLE();
+	while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY) == 0U);
+	__HAL_RCC_SYSCLK_CONFIG(RCC_SYSCLKSOURCE_PLLCLK);
+	while (__HAL_RCC_GET_SYSCLK_SOURCE() != RCC_SYSCLKSOURCE_STATUS_PLLCLK);
+}
+
+// === PUBLIC METHODS ===
+void low_power_init(void) {
+	//LPTIM1: LSE / 32, free running, kept clocked in STOP2. The LSE is on for the RTC, and for other peripherals too
+	//(RCC_LSE_ON in SystemClock_Config()).
+	__HAL_RCC_LPTIM1_CONFIG(RCC_LPTIM1CLKSOURCE_LSE);
+	__HAL_RCC_LPTIM1_CLK_ENABLE();
+	__HAL_RCC_LPTIM1_CLKAM_ENABLE();
+
+	LPTIM1->CFGR = LPTIM_CFGR_PRESC_2 | LPTIM_CFGR_PRESC_0;
+	LPTIM1->CR = LPTIM_CR_ENABLE;
+	LPTIM1->DIER = LPTIM_DIER_CC1IE;
+	while (!(LPTIM1->ISR & LPTIM_ISR_DIEROK));
+	LPTIM1->ICR = LPTIM_ICR_DIEROKCF;
+	LPTIM1->ARR = LOW_POWER_TIMER_MASK;
+	while (!(LPTIM1->ISR & LPTIM_ISR_ARROK));
+	LPTIM1->ICR = LPTIM_ICR_ARROKCF;
+	LPTIM1->CR |= LPTIM_CR_CNTSTRT;
+	HAL_NVIC_SetPriority(LPTIM1_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+
+	//Pi link RX pin: falling edge (start bit), unmasked in STOP2 only
+	MODIFY_REG(EXTI->EXTICR[LOW_POWER_PI_RX_EXTI_LINE / 4], 0xFFU << (8 * (LOW_POWER_PI_RX_EXTI_LINE % 4)), 0); //port A
+	SET_BIT(EXTI->FTSR1, EXT_RX_Pin);
+	HAL_NVIC_SetPriority(EXTI3_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+#ifdef DEBUG
+	HAL_DBGMCU_EnableDBGStopMode(); //keep the debugger connected
+#endif
+}
+
+void low_power_veto(LowPowerVeto source, bool veto) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (veto) {
+		held_vetoes |= (1 << source);
+	} else {
+		held_vetoes &= ~(1 << source);
+	}
+	__set_PRIMASK(primask);
+}
+
+void low_power_veto_for(LowPowerVeto source, uint32_t timeout_ms) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	timed_veto_end_ms[source] = HAL_GetTick() + timeout_ms;
+	timed_vetoes |= (1 << source);
+	__set_PRIMASK(primask);
+}
+
+void low_power_timer_setup(uint32_t ticks) {
+	wake_armed = true;
+	wake_ticks = ticks;
+}
+
+void low_power_enter(void) {
+	cpu_load_idle_enter();
+
+	//without a ThreadX timer running, only an interrupt can make a thread ready
+	uint64_t stop_ms = wake_armed ? (((uint64_t)wake_ticks * 1000) / TX_TIMER_TICKS_PER_SECOND) : LOW_POWER_MAX_STOP_MS;
+	stop_ms = (stop_ms > LOW_POWER_MAX_STOP_MS) ? LOW_POWER_MAX_STOP_MS : stop_ms;
+	wake_armed = false;
+
+	mode = LOW_POWER_MODE_SLEEP;
+#if LOW_POWER_STOP2_ENABLED
+	if (low_power_vetoed()) {
+		stats.vetoed_entries++;
+	} else if (stop_ms >= LOW_POWER_STOP2_MIN_MS) {
+		mode = LOW_POWER_MODE_STOP2;
+	}
+#endif
+
+	if (mode == LOW_POWER_MODE_SLEEP) {
+		//the SysTick keeps running and wakes the core on the next tick
+		stats.sleep_entries++;
+		HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+		return;
+	}
+
+	stats.stop_entries++;
+	stop_start_count = low_power_timer_count();
+	low_power_timer_compare((stop_start_count + LOW_POWER_MS_TO_COUNTS(stop_ms)) & LOW_POWER_TIMER_MASK);
+	WRITE_REG(EXTI->FPR1, EXT_RX_Pin);
+	SET_BIT(EXTI->IMR1, EXT_RX_Pin);
+
+	HAL_PWREx_EnterSTOP2Mode(PWR_STOPENTRY_WFI);
+}
+
+void low_power_exit(void) {
+	if (mode == LOW_POWER_MODE_STOP2) {
+		low_power_restore_clocks();
+		CLEAR_BIT(EXTI->IMR1, EXT_RX_Pin);
+
+		//the ThreadX and HAL ticks stood still, the cycle counter too. The remainders carry the fractions of a
+		//tick over to the next wake, so that neither drifts from the LSE.
+		uint32_t stopped_counts = (uint16_t)(low_power_timer_count() - stop_start_count);
+		uint64_t scaled = ((uint64_t)stopped_counts * TX_TIMER_TICKS_PER_SECOND) + tick_remainder;
+		adjust_ticks = scaled / LOW_POWER_TIMER_HZ;
+		tick_remainder = scaled % LOW_POWER_TIMER_HZ;
+		scaled = ((uint64_t)stopped_counts * 1000) + ms_remainder;
+		uint32_t stopped_ms = scaled / LOW_POWER_TIMER_HZ;
+		ms_remainder = scaled % LOW_POWER_TIMER_HZ;
+		uwTick += stopped_ms;
+		cpu_load_idle_stopped(stopped_ms);
+
+		stats.stop_ms += stopped_ms;
+		stats.max_stop_ms = (stopped_ms > stats.max_stop_ms) ? stopped_ms : stats.max_stop_ms;
+	}
+	mode = LOW_POWER_MODE_RUN;
+
+	cpu_load_idle_exit();
+}
+
+uint32_t low_power_timer_adjust(void) {
+	uint32_t ticks = adjust_ticks;
+	adjust_ticks = 0;
+	return ticks;
+}
+
+void low_power_lptim_irq_handler(void) {
+	//only wakes the core, the time is read in low_power_exit()
+	LPTIM1->ICR = LPTIM_ICR_CC1CF;
+}
+
+void low_power_exti_irq_handler(void) {
+	WRITE_REG(EXTI->FPR1, EXT_RX_Pin);
+}
+
+LowPowerStats low_power_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	LowPowerStats copy = stats;
+	copy.vetoes = held_vetoes | timed_vetoes;
+	__set_PRIMASK(primask);
+	return copy;
+}
@@ -8,73 +8,205 @@
 #include "config.h"
 #include "Lib Inc/state_machine.h"
 #include "Lib Inc/threads.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/config_store.h"
+#include "Lib Inc/event_log.h"
 #include "Comms Inc/PiComms.h"
 #include "main.h"
 #include "Recovery Inc/AprsPacket.h"
 #include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/GpsAssist.h"
+#include "Recovery Inc/GpsReplay.h"
+#include "Recovery Inc/Geofence.h"
+#include "Recovery Inc/Kiss.h"
+#include "Recovery Inc/FishTracker.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include <stdbool.h>
+#include <stddef.h>
 
 //Event flags for signaling changes in state
 TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
 
 //If simulating, set the simulation state defined in the header file, else, enter data capture as a default
 static State state = STARTING_STATE;
+static Timestamp state_timestamp = {0};
+static uint32_t state_time_ms[NUM_STATES] = {0}; //time spent in each state, excluding the current period
 
 //Threads array
 extern Thread_HandleTypeDef threads[NUM_THREADS];
 extern VHF_HandleTypdeDef vhf;
+extern IWDG_HandleTypeDef hiwdg;
+
+// === State table ===
+//Power consumers a state can hold. A transition releases exactly those the new state doesn't list.
+#define STATE_RESOURCE_GPS              (1 << 0) //GPS buffer thread, receiver powered by the state's owner
+#define STATE_RESOURCE_VHF              (1 << 1) //VHF module, keyed by the state's thread
+#define STATE_RESOURCE_APRS_THREAD      (1 << 2)
+#define STATE_RESOURCE_FISHTRACKER_THREAD (1 << 3)
+#define STATE_RESOURCE_ALL ((1 << 4) - 1)
+
+#define STATE_MASK(s) (1 << (s))
+
+typedef struct {
+	uint32_t resources;		//STATE_RESOURCE_*
+	uint32_t allowed_from;		//STATE_MASK() of the states this one can be entered from
+	bool (*guard)(void);		//extra condition to enter, NULL if none
+	void (*enter)(void);		//after the new resources are acquired, before its threads resume. NULL if none
+	void (*exit)(void);		//after its threads are suspended, before its resources are released. NULL if none
+}StateDescriptor;
+
+static bool state_guard_battery(void);
+static void state_critical_enter(void);
+static void state_gps_collect_enter(void);
+static void state_fishtracker_enter(void);
+static void state_fishtracker_exit(void);
+
+//Any state may be the first one (STARTING_STATE), after that the transitions follow allowed_from. Critical shuts the
+//board down, there is no way out. The standalone modes are only entered from waiting, while recovery (the Pi's
+//PI_COMM_MSG_START) is entered from any running state: a detached tag must always start beaconing.
+static const StateDescriptor state_table[NUM_STATES] = {
+	[STATE_CRITICAL] = {
+		.resources = 0,
+		.allowed_from = STATE_MASK(STATE_WAITING) | STATE_MASK(STATE_APRS) | STATE_MASK(STATE_GPS_COLLECT)
+				| STATE_MASK(STATE_FISHTRACKER),
+		.enter = state_critical_enter,
+	},
+	[STATE_WAITING] = {
+		.resources = 0, //ToDo: Low Power Mode - UART wakeup
+		.allowed_from = STATE_MASK(STATE_APRS) | STATE_MASK(STATE_GPS_COLLECT) | STATE_MASK(STATE_FISHTRACKER),
+	},
+	[STATE_APRS] = {
+		//GPS: duty cycled around each beacon by the APRS thread (on in continuous mode)
+		.resources = STATE_RESOURCE_GPS | STATE_RESOURCE_VHF | STATE_RESOURCE_APRS_THREAD,
+		.allowed_from = STATE_MASK(STATE_WAITING) | STATE_MASK(STATE_GPS_COLLECT) | STATE_MASK(STATE_FISHTRACKER),
+		.guard = state_guard_battery,
+	},
+	[STATE_GPS_COLLECT] = {
+		.resources = STATE_RESOURCE_GPS,
+		.allowed_from = STATE_MASK(STATE_WAITING),
+		.enter = state_gps_collect_enter,
+	},
+	[STATE_FISHTRACKER] = {
+		.resources = STATE_RESOURCE_VHF | STATE_RESOURCE_FISHTRACKER_THREAD,
+		.allowed_from = STATE_MASK(STATE_WAITING),
+		.guard = state_guard_battery,
+		.enter = state_fishtracker_enter,
+		.exit = state_fishtracker_exit,
+	},
+};
+
+//Resources held by the current state. Before the first one is entered they are unknown (e.g. the GPS is powered at
+//reset), everything it doesn't need is released.
+static uint32_t held_resources = STATE_RESOURCE_ALL;
+static bool state_entered = false;
+
+//Don't start transmitting on a battery the monitor is about to shut down for
+static bool state_guard_battery(void){
+	return !battery_monitor_is_critical();
+}
 
-void state_machine_set_state(State new_state){
-	//actions to take when exiting current state
-	switch(new_state){
-		case STATE_CRITICAL:
-			break;
+static void state_critical_enter(void){
+	event_log_flush(); //the board shuts down right after
+	HAL_PWREx_EnterSHUTDOWNMode();
+}
 
-		case STATE_WAITING:
-			break;
+static void state_gps_collect_enter(void){
+	gps_wake();		//GPS: ON, nothing duty cycles it in this state
+}
 
-		case STATE_APRS:
-			tx_thread_suspend(&threads[APRS_THREAD].thread);
-			break;
+static void state_fishtracker_enter(void){
+	vhf_set_freq(&vhf, FISHTRACKER_CARRIER_FREQ_MHZ);
+	vhf_set_power_level(&vhf, FISHTRACKER_POWER);
+}
 
-		case STATE_FISHTRACKER:
-			tx_thread_suspend(&threads[FISHTRACKER_THREAD].thread);
-			break;
+static void state_fishtracker_exit(void){
+	//the thread may have been suspended during an ON period, and the next state may keep the VHF
+	vhf_sleep(&vhf);
+	vhf_set_freq(&vhf, g_config.aprs_freq);
+	vhf_set_power_level(&vhf, g_config.vhf_power);
+	geofence_invalidate(); //a geofence region may override these
+}
 
-		default:
-			break;
+//Returns false, without any change, if the transition isn't allowed
+bool state_machine_set_state(State new_state){
+	if (new_state >= NUM_STATES) {
+		return false;
+	}
+	const StateDescriptor *next = &state_table[new_state];
+	if (state_entered) {
+		if (new_state == state) {
+			return true;
+		}
+		if (!(next->allowed_from & STATE_MASK(state))) {
+			return false;
+		}
 	}
+	if ((next->guard != NULL) && !next->guard()) {
+		return false;
+	}
+
+	event_log_state(new_state);
+	uint32_t release = held_resources & ~next->resources;
+	uint32_t acquire = state_entered ? (next->resources & ~held_resources) : next->resources;
 
-	//actions to take when entering the new_state
-	switch(new_state){
-		case STATE_CRITICAL:
-			tx_thread_suspend(&threads[GPS_BUFFER_THREAD].thread);
-			gps_sleep(); 	//GPS: OFF
-			aprs_sleep();	//VHF: OFF
-			HAL_PWREx_EnterSHUTDOWNMode();
-			break;
-
-		case STATE_WAITING:
-			tx_thread_suspend(&threads[GPS_BUFFER_THREAD].thread);
-			gps_sleep(); 	//GPS: OFF
-			aprs_sleep();	//VHF: OFF
-			//ToDo: Low Power Mode - UART wakeup
-			break;
-
-		case STATE_APRS:
-			tx_thread_resume(&threads[GPS_BUFFER_THREAD].thread);
-			gps_wake();		//GPS: ON
-			tx_thread_resume(&threads[APRS_THREAD].thread);
-			break;
-
-		case STATE_FISHTRACKER:
-			gps_sleep();	//GPS: OFF
-			tx_thread_resume(&threads[FISHTRACKER_THREAD].thread);
-			break;
-
-		default:
-			break;
+	//stop the threads of the current state first, so nothing uses what is released below
+	if (release & STATE_RESOURCE_APRS_THREAD) {
+		aprs_suspend(&threads[APRS_THREAD].thread);
+	}
+	if (release & STATE_RESOURCE_FISHTRACKER_THREAD) {
+		tx_thread_suspend(&threads[FISHTRACKER_THREAD].thread);
+	}
+	if (state_entered && (state_table[state].exit != NULL)) {
+		state_table[state].exit();
 	}
+	if (release & STATE_RESOURCE_VHF) {
+		aprs_sleep();	//VHF: OFF
+	}
+	if (release & STATE_RESOURCE_GPS) {
+		tx_thread_suspend(&threads[GPS_BUFFER_THREAD].thread);
+		gps_sleep();	//GPS: OFF
+	}
+
+	Timestamp now = time_now();
+	state_time_ms[state] += now.monotonic_ms - state_timestamp.monotonic_ms;
 	state = new_state;
+	state_timestamp = now;
+	held_resources = next->resources;
+	state_entered = true;
+
+	if (acquire & STATE_RESOURCE_GPS) {
+		tx_thread_resume(&threads[GPS_BUFFER_THREAD].thread);
+	}
+	if (next->enter != NULL) {
+		next->enter();
+	}
+	if (acquire & STATE_RESOURCE_APRS_THREAD) {
+		tx_thread_resume(&threads[APRS_THREAD].thread);
+	}
+	if (acquire & STATE_RESOURCE_FISHTRACKER_THREAD) {
+		tx_thread_resume(&threads[FISHTRACKER_THREAD].thread);
+	}
+	return true;
+}
+
+State state_machine_get_state(void){
+	return state;
+}
+
+Timestamp state_machine_get_state_timestamp(void){
+	return state_timestamp;
+}
+
+uint32_t state_machine_get_state_time_ms(State query_state){
+	if (query_state >= NUM_STATES) {
+		return 0;
+	}
+
+	uint32_t time_ms = state_time_ms[query_state];
+	if (query_state == state) {
+		time_ms += time_monotonic_ms() - state_timestamp.monotonic_ms;
+	}
+	return time_ms;
 }
 
 
@@ -86,37 +218,58 @@ void state_machine_thread_entry(ULONG thread_input){
 	
 	//Event flags for triggering state changes
 	tx_event_flags_create(&state_machine_event_flags_group, "State Machine Event Flags");
-	//Check the initial state and start in the appropriate state
-	state_machine_set_state(state);
+	time_init();
+	//restore the configuration set by the Pi before anything uses it
+	config_store_init();
+	config_load();
+	event_log_init();
+	fw_update_boot();
+	geofence_init();
+	aprs_init();
 	vhf_set_freq(&vhf, g_config.aprs_freq);
+	vhf_set_power_level(&vhf, g_config.vhf_power);
+	//Check the initial state and start in the appropriate state
+	if (!state_machine_set_state(state)) {
+		state_machine_set_state(STATE_WAITING);
+	}
 	
 #if BATTERY_MONITOR_ENABLED
 	tx_thread_resume(&threads[BATTERY_MONITOR_THREAD].thread);
 #endif
 #if UART_ENABLED
+	kiss_init();
 	pi_comms_rx_init();
 	pi_comms_tx_init();
+	pi_link_init();
+	pi_telemetry_init();
+	tx_thread_resume(&threads[KISS_TNC_THREAD].thread);
 #endif
 #if RTC_ENABLED
 	tx_thread_resume(&threads[RTC_THREAD].thread);
 #endif
-	tx_thread_resume(&threads[GPS_BUFFER_THREAD].thread);
 
 	//Enter main thread execution loop ONLY if we arent simulating
 	while (1){
 		ULONG actual_flags = 0;
 
-		//wait for message or critical battery
-		tx_event_flags_get(&state_machine_event_flags_group, ALL_STATE_FLAGS, TX_OR_CLEAR, &actual_flags, TX_WAIT_FOREVER);
+		//the watchdog resets the board if this loop stops running
+		HAL_IWDG_Refresh(&hiwdg);
+		//keeps the UTC reference within the HAL tick's wrap around when nothing syncs it (TIME_REFERENCE_MAX_AGE_MS)
+		time_now();
+
+		//wait for message or critical battery, at most until the next refresh is due
+		tx_event_flags_get(&state_machine_event_flags_group, ALL_STATE_FLAGS, TX_OR_CLEAR, &actual_flags,
+				tx_ms_to_ticks(STATE_WATCHDOG_REFRESH_MS));
 
 		if(actual_flags & STATE_CRITICAL_LOW_BATTERY_FLAG){
 			//enter a critical low power state (nothing runs)
 			state_machine_set_state(STATE_CRITICAL);
 		}
 		else if(actual_flags & STATE_COMMS_MESSAGE_AVAILABLE_FLAG){
-			while(pi_comm_rx_buffer_start != pi_comm_rx_buffer_end) {
+			PiCommRxView *view;
+			while((view = pi_comms_rx_peek()) != NULL) {
 				//parse message from pi
-				PiRxCommMessage *message = (PiRxCommMessage *)pi_comm_rx_buffer[pi_comm_rx_buffer_start];
+				PiRxCommMessage *message = view->message;
 
 				switch (message->header.id) {
 					//State Change Message
@@ -154,28 +307,57 @@ void state_machine_thread_entry(ULONG thread_input){
 						break;
 					}
 
+					case PI_COMM_MSG_LINK_SPEED: {
+						//a short request is answered as an unsupported rate (PI_LINK_ERROR_BAUD)
+						uint32_t baud = (message->header.length >= sizeof(PiCommLinkSpeedPkt)) ? message->data.link_speed.baud : 0;
+						pi_link_request(baud);
+						break;
+					}
+
+					case PI_COMM_MSG_LOG_READ: {
+						if(message->header.length < sizeof(PiCommLogReadPkt)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						pi_comms_tx_log_data(message->data.log_read.offset, message->data.log_read.chunks);
+						break;
+					}
+
+					case PI_COMM_MSG_KISS: {
+						kiss_receive((const uint8_t *)&message->data, message->header.length);
+						break;
+					}
+
 					//Configuration change message
 					case PI_COMM_MSG_CONFIG_CRITICAL_VOLTAGE: {
-							if(message->header.length < sizeof(PiCommCritVoltagePkt))
-									break; //ToDo: return error
+							if(message->header.length < sizeof(PiCommCritVoltagePkt)){
+								pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+								break;
+							}
 
 							g_config.critical_voltage = message->data.critical_voltage.value;
 						}
 						break;
 
 					case PI_COMM_MSG_CONFIG_VHF_POWER_LEVEL: {
-							if(message->header.length < sizeof(PiCommTxLevelPkt))
-									break; //ToDo: return error
+							if(message->header.length < sizeof(PiCommTxLevelPkt)){
+								pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+								break;
+							}
 							g_config.vhf_power = message->data.vhf_level.value;
 							vhf_set_power_level(&vhf, g_config.vhf_power);
+							geofence_invalidate(); //a geofence region may override this
 						}
 						break;
 
 					case PI_COMM_MSG_CONFIG_APRS_FREQUENCY: {
-							if(message->header.length < sizeof(PiCommAPRSFreq))
-								break; //ToDo: return error
+							if(message->header.length < sizeof(PiCommAPRSFreq)){
+								pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+								break;
+							}
 							g_config.aprs_freq = message->data.aprs_freq_MHz.value;
 							vhf_set_freq(&vhf, g_config.aprs_freq);
+							geofence_invalidate(); //a geofence region may override this
 						}
 						break;
 
@@ -227,42 +409,237 @@ void state_machine_thread_entry(ULONG thread_input){
 						break;
 					}
 
+					case PI_COMM_MSG_CONFIG_GPS_FIX_GATE: {
+						if(message->header.length < sizeof(PiCommGpsFixGatePkt)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						GpsFixGate *gate = message->data.gps_fix_gate.critical ? &g_config.gps_gate_critical : &g_config.gps_gate;
+						gate->max_hdop = message->data.gps_fix_gate.max_hdop;
+						gate->min_satellites = message->data.gps_fix_gate.min_satellites;
+						gate->min_fix_type = message->data.gps_fix_gate.min_fix_type;
+						gate->max_age_ms = message->data.gps_fix_gate.max_age_ms;
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_GPS_CONTINUOUS: {
+						if(message->header.length < sizeof(uint8_t)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						//applied by the APRS thread at its next wake
+						gps_set_continuous(message->data.u8_pkt != 0);
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_GPS_FORWARD: {
+						if(message->header.length < sizeof(PiCommGpsForwardPkt)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						for(int i = 0; i < PI_GPS_FORWARD_NUM_TYPES; i++){
+							pi_gps_forward_set_decimation(i, message->data.gps_forward.decimation[i]);
+						}
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_TELEMETRY_PERIOD: {
+						if(message->header.length < sizeof(PiCommTelemetryPeriodPkt)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						g_config.telemetry_period_s = message->data.telemetry_period.period_s;
+						pi_telemetry_update_period();
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_UTC_TIME: {
+						if(message->header.length < sizeof(PiCommUtcTimePkt)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						//the message was stamped on reception, which is when the time was valid
+						time_set_utc(message->data.utc_time.utc_s, message->data.utc_time.utc_ms,
+								view->timestamp.monotonic_ms, TIME_SOURCE_PI);
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_GEOFENCE_CLEAR: {
+						geofence_clear();
+						break;
+					}
+
+					case PI_COMM_MSG_CONFIG_GEOFENCE_REGION: {
+						const PiCommGeofenceRegionPkt *pkt = &message->data.geofence_region;
+						if(message->header.length < offsetof(PiCommGeofenceRegionPkt, vertices)){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+						if(pkt->vertex_count > GEOFENCE_MAX_VERTICES){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_VALUE);
+							break;
+						}
+						if(message->header.length < offsetof(PiCommGeofenceRegionPkt, vertices) + pkt->vertex_count * sizeof(pkt->vertices[0])){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_LENGTH);
+							break;
+						}
+
+						GeofencePolygon polygon = {
+							.vertex_count = pkt->vertex_count,
+							.aprs_freq_MHz = pkt->aprs_freq_MHz,
+							.power_level = pkt->power_level,
+							.beacon = {.enabled = pkt->beacon_enabled, .interval_s = pkt->beacon_interval_s},
+						};
+						memcpy(polygon.digi_path, pkt->digi_path, sizeof(pkt->digi_path));
+						for(int i = 0; i < pkt->vertex_count; i++){
+							polygon.vertices[i].latitude = pkt->vertices[i].latitude;
+							polygon.vertices[i].longitude = pkt->vertices[i].longitude;
+						}
+						if(geofence_set_region(pkt->index, &polygon) != HAL_OK){
+							pi_comms_tx_error(message->header.id, PI_COMM_ERROR_VALUE);
+						}
+						break;
+					}
+
+					case PI_COMM_MSG_MGA_BEGIN: {
+						uint32_t next_offset = 0;
+						GpsAssistStatus status = GPS_ASSIST_ERROR_LENGTH;
+						if (message->header.length >= sizeof(PiCommMgaBeginPkt)) {
+							status = gps_assist_begin(message->data.mga_begin.length, message->data.mga_begin.utc_time, &next_offset);
+						}
+						pi_comms_tx_mga_ack(PI_COMM_MSG_MGA_BEGIN, status, next_offset);
+						break;
+					}
+
+					case PI_COMM_MSG_MGA_CHUNK: {
+						uint32_t next_offset = 0;
+						GpsAssistStatus status = GPS_ASSIST_ERROR_LENGTH;
+						if (message->header.length > sizeof(uint32_t)) {
+							status = gps_assist_write_chunk(message->data.mga_chunk.offset, message->data.mga_chunk.data, message->header.length - sizeof(uint32_t), &next_offset);
+						}
+						pi_comms_tx_mga_ack(PI_COMM_MSG_MGA_CHUNK, status, next_offset);
+						break;
+					}
+
+					case PI_COMM_MSG_MGA_END: {
+						uint32_t next_offset = 0;
+						GpsAssistStatus status = GPS_ASSIST_ERROR_LENGTH;
+						if (message->header.length >= sizeof(PiCommMgaEndPkt)) {
+							status = gps_assist_end(message->data.mga_end.length, &next_offset);
+						}
+						pi_comms_tx_mga_ack(PI_COMM_MSG_MGA_END, status, next_offset);
+						break;
+					}
+
+					case PI_COMM_MSG_FW_BEGIN: {
+						uint32_t next_offset = 0;
+						FwUpdateStatus status = FW_UPDATE_ERROR_LENGTH;
+						if (message->header.length >= sizeof(PiCommFwBeginPkt)) {
+							status = fw_update_begin(message->data.fw_begin.length, message->data.fw_begin.crc, &next_offset);
+						}
+						pi_comms_tx_fw_ack(PI_COMM_MSG_FW_BEGIN, status, next_offset);
+						break;
+					}
+
+					case PI_COMM_MSG_FW_CHUNK: {
+						uint32_t next_offset = 0;
+						FwUpdateStatus status = FW_UPDATE_ERROR_LENGTH;
+						if (message->header.length > sizeof(uint32_t)) {
+							status = fw_update_write_chunk(message->data.fw_chunk.offset, message->data.fw_chunk.data,
+									message->header.length - sizeof(uint32_t), &next_offset);
+						}
+						pi_comms_tx_fw_ack(PI_COMM_MSG_FW_CHUNK, status, next_offset);
+						break;
+					}
+
+					case PI_COMM_MSG_FW_END: {
+						uint32_t next_offset = 0;
+						FwUpdateStatus status = FW_UPDATE_ERROR_LENGTH;
+						if (message->header.length >= sizeof(PiCommFwEndPkt)) {
+							status = fw_update_end(message->data.fw_end.length, &next_offset);
+						}
+						pi_comms_tx_fw_ack(PI_COMM_MSG_FW_END, status, next_offset);
+						if (status == FW_UPDATE_OK) {
+							//let the acknowledgement out before the reset
+							tx_thread_sleep(tx_ms_to_ticks(FW_UPDATE_SWAP_DELAY_MS));
+							fw_update_activate();
+						}
+						break;
+					}
+
+					case PI_COMM_MSG_FW_CONFIRM: {
+						pi_comms_tx_fw_ack(PI_COMM_MSG_FW_CONFIRM, fw_update_confirm(), 0);
+						break;
+					}
+
+					case PI_COMM_MSG_GPS_REPLAY_BEGIN: {
+						GpsReplayStatus status = GPS_REPLAY_ERROR_LENGTH;
+						if (message->header.length >= sizeof(uint8_t)) {
+							status = gps_replay_begin(message->data.u8_pkt);
+						}
+						pi_comms_tx_gps_replay_ack(PI_COMM_MSG_GPS_REPLAY_BEGIN, status);
+						break;
+					}
+
+					case PI_COMM_MSG_GPS_REPLAY_DATA: {
+						GpsReplayStatus status = GPS_REPLAY_ERROR_LENGTH;
+						if (message->header.length > sizeof(uint32_t)) {
+							status = gps_replay_write_chunk(message->data.gps_replay_data.offset_ms, message->data.gps_replay_data.data, message->header.length - sizeof(uint32_t));
+						}
+						//accepted chunks are acknowledged by the GPS buffer thread once fed
+						if (status != GPS_REPLAY_OK) {
+							pi_comms_tx_gps_replay_ack(PI_COMM_MSG_GPS_REPLAY_DATA, status);
+						}
+						break;
+					}
+
+					case PI_COMM_MSG_GPS_REPLAY_END: {
+						pi_comms_tx_gps_replay_ack(PI_COMM_MSG_GPS_REPLAY_END, gps_replay_end());
+						break;
+					}
+
 					case PI_COMM_MSG_QUERY_STATE: {
-						//ToDo: return recovery board state to pi
+						pi_status_send((const uint8_t []){PI_STATUS_STATE, PI_STATUS_STATE_TIME_MS}, 2);
+						break;
+					}
+
+					case PI_COMM_MSG_QUERY_SNAPSHOT: {
+						pi_status_send_snapshot();
+						break;
+					}
+
+					case PI_COMM_MSG_QUERY_FIELDS: {
+						pi_status_send(message->data.tags, message->header.length);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_CRITICAL_VOLTAGE: {
-						//ToDo: return critical voltage setting to pi
+						pi_status_send((const uint8_t []){PI_STATUS_CRITICAL_VOLTAGE}, 1);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_VHF_POWER_LEVEL: {
-						//ToDo: return critical voltage setting to pi
+						pi_status_send((const uint8_t []){PI_STATUS_VHF_POWER_LEVEL}, 1);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_APRS_FREQ: {
-						//ToDo: implement
+						pi_status_send((const uint8_t []){PI_STATUS_APRS_FREQUENCY}, 1);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_APRS_CALLSIGN: {
-						static char callsign[7] = "";
-						aprs_get_callsign(callsign);
-						pi_comms_tx_callsign(callsign);
+						pi_status_send((const uint8_t []){PI_STATUS_APRS_CALLSIGN}, 1);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_APRS_MESSAGE: {
-						//ToDo: implement
+						pi_status_send((const uint8_t []){PI_STATUS_APRS_COMMENT}, 1);
 						break;
 					}
 
 					case PI_COMM_MSG_QUERY_APRS_SSID: {
-						uint8_t ssid;
-						aprs_get_ssid(&ssid);
-						pi_comms_tx_ssid(ssid);
+						pi_status_send((const uint8_t []){PI_STATUS_APRS_SSID}, 1);
 						break;
 					}
 
@@ -270,9 +647,23 @@ void state_machine_thread_entry(ULONG thread_input){
 						//Bad message ID - do nothing
 						break;
 				}
-				pi_comm_rx_buffer_start =  (pi_comm_rx_buffer_start + 1) % PI_COMM_RX_BUFFER_COUNT;
+
+				//configuration changes survive resets (unchanged values aren't rewritten)
+				if ((message->header.id >= PI_COMM_MSG_CONFIG_CRITICAL_VOLTAGE)
+						&& (message->header.id <= PI_COMM_MSG_CONFIG_TELEMETRY_PERIOD)) {
+					config_save();
+				}
+				pi_comms_rx_release();
 			}
 		}
+
+		if(actual_flags & STATE_TELEMETRY_FLAG){
+			pi_telemetry_send();
+		}
+
+		if(actual_flags & STATE_FW_ROLLBACK_FLAG){
+			fw_update_rollback();
+		}
 	}
 }
 
@@ -78,4 +78,19 @@ void threadListInit(void){
 		threads[index].thread_stack_start = malloc(threads[index].config.thread_stack_size);
 	}
 }
+
+uint32_t thread_stack_high_water(Thread index){
+	if ((index >= NUM_THREADS) || (threads[index].thread.tx_thread_stack_start == NULL)) {
+		return 0;
+	}
+
+	//the stack grows down, the untouched words are still filled from the bottom
+	TX_THREAD *thread = &threads[index].thread;
+	const ULONG *word = (const ULONG *) thread->tx_thread_stack_start;
+	const ULONG *end = (const ULONG *) thread->tx_thread_stack_end;
+	while ((word < end) && (*word == TX_STACK_FILL)) {
+		word++;
+	}
+	return (uint32_t)((const uint8_t *) thread->tx_thread_stack_end - (const uint8_t *) word) + 1;
+}
 #endif /* SRC_LIB_SRC_TASKS_C_ */
@@ -0,0 +1,303 @@
+/*
+ * time_service.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Firmware wide time keeping. See matching header file for more info.
+ */
+
+#include "Lib Inc/time_service.h"
+#include "config.h"
+#include <math.h>
+
+#define SECONDS_PER_DAY (24 * 60 * 60)
+
+// === PRIVATE VARIABLES ===
+extern RTC_HandleTypeDef hrtc;
+
+//UTC at a given HAL tick, read from interrupts
+static volatile struct {
+	TimeSource source;
+	uint64_t utc_ms;
+	uint32_t monotonic_ms;
+	float rate_ppm;
+} reference = {0};
+
+static TimeStats stats = {0};
+
+//start of the current HAL tick rate measurement
+static bool rate_baseline_valid = false;
+static uint64_t rate_baseline_utc_ms = 0;
+static uint32_t rate_baseline_monotonic_ms = 0;
+
+//start of the current RTC rate measurement
+static bool rtc_baseline_valid = false;
+static uint64_t rtc_baseline_utc_ms = 0;
+static int64_t rtc_baseline_offset_ms = 0;
+
+// === PRIVATE METHODS ===
+//UTC (ms) of a HAL tick at or after the reference, up to the 49.7 day wrap of the tick. Must be called with
+//interrupts disabled.
+static uint64_t time_utc_ms_at(uint32_t monotonic_ms) {
+	uint32_t elapsed_ms = monotonic_ms - reference.monotonic_ms;
+	return reference.utc_ms + elapsed_ms + (int64_t)((double)elapsed_ms * reference.rate_ppm * 1e-6);
+}
+
+//Measures the HAL tick rate against two GPS syncs
+static void time_update_rate(uint64_t utc_ms, uint32_t monotonic_ms) {
+	if (!rate_baseline_valid) {
+		rate_baseline_valid = true;
+		rate_baseline_utc_ms = utc_ms;
+		rate_baseline_monotonic_ms = monotonic_ms;
+		return;
+	}
+
+	uint32_t monotonic_elapsed_ms = monotonic_ms - rate_baseline_monotonic_ms;
+	if (monotonic_elapsed_ms < TIME_RATE_MIN_INTERVAL_MS) {
+		return;
+	}
+
+	int64_t utc_elapsed_ms = (int64_t)(utc_ms - rate_baseline_utc_ms);
+	float measured_ppm = (float)(utc_elapsed_ms - (int64_t)monotonic_elapsed_ms) * 1e6f / monotonic_elapsed_ms;
+	if (fabsf(measured_ppm) < TIME_RATE_MAX_PPM) {
+		//moving average with a weight of 1/4 on the newest measurement
+		stats.tick_rate_ppm = (stats.tick_rate_ppm == 0.0f) ? measured_ppm : (3 * stats.tick_rate_ppm + measured_ppm) / 4;
+	}
+
+	rate_baseline_utc_ms = utc_ms;
+	rate_baseline_monotonic_ms = monotonic_ms;
+}
+
+static bool time_rtc_read(uint64_t *utc_ms) {
+	if (HAL_RTCEx_BKUPRead(&hrtc, TIME_RTC_BKP_REGISTER) != TIME_RTC_VALID_MAGIC) {
+		return false;
+	}
+
+	//the date must be read after the time to unlock the shadow registers
+	RTC_TimeTypeDef time;
+	RTC_DateTypeDef date;
+	HAL_RTC_GetTime(&hrtc, &time, RTC_FORMAT_BIN);
+	HAL_RTC_GetDate(&hrtc, &date, RTC_FORMAT_BIN);
+
+	TimeDate time_date = {
+		.year = 2000 + date.Year,
+		.month = date.Month,
+		.day = date.Date,
+		.hour = time.Hours,
+		.minute = time.Minutes,
+		.second = time.Seconds,
+	};
+	//the sub-second register counts down from SecondFraction
+	*utc_ms = (uint64_t)time_utc_from_date(&time_date) * 1000
+			+ (time.SecondFraction - time.SubSeconds) * 1000 / (time.SecondFraction + 1);
+	return true;
+}
+
+static void time_rtc_set(uint64_t utc_ms) {
+	TimeDate now = time_date_from_utc(utc_ms / 1000);
+	RTC_TimeTypeDef time = {
+		.Hours = now.hour,
+		.Minutes = now.minute,
+		.Seconds = now.second,
+		.DayLightSaving = RTC_DAYLIGHTSAVING_NONE,
+		.StoreOperation = RTC_STOREOPERATION_RESET,
+	};
+	RTC_DateTypeDef date = {
+		.WeekDay = now.weekday,
+		.Month = now.month,
+		.Date = now.day,
+		.Year = now.year - 2000,
+	};
+
+	if ((HAL_RTC_SetTime(&hrtc, &time, RTC_FORMAT_BIN) != HAL_OK)
+			|| (HAL_RTC_SetDate(&hrtc, &date, RTC_FORMAT_BIN) != HAL_OK)) {
+		return;
+	}
+	HAL_RTCEx_BKUPWrite(&hrtc, TIME_RTC_BKP_REGISTER, TIME_RTC_VALID_MAGIC);
+
+	//stepping restarts the rate measurement
+	rtc_baseline_valid = false;
+}
+
+static void time_rtc_set_calibration(int16_t calibration) {
+	//CALP adds 512 pulses, CALM removes up to 511
+	if (calibration > 0) {
+		HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC, RTC_SMOOTHCALIB_PLUSPULSES_SET, 512 - calibration);
+	} else {
+		HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC, RTC_SMOOTHCALIB_PLUSPULSES_RESET, -calibration);
+	}
+	stats.rtc_calibration = calibration;
+}
+
+//Steps the RTC if it is far off, otherwise measures its rate error and trims it with the smooth calibration
+static void time_rtc_discipline(uint64_t utc_ms) {
+	uint64_t rtc_ms;
+	if (!time_rtc_read(&rtc_ms)) {
+		time_rtc_set(utc_ms);
+		return;
+	}
+
+	int64_t offset_ms = (int64_t)(utc_ms - rtc_ms);
+	if ((offset_ms > TIME_RTC_STEP_THRESHOLD_MS) || (offset_ms < -TIME_RTC_STEP_THRESHOLD_MS)) {
+		time_rtc_set(utc_ms);
+		return;
+	}
+
+	//the offset right after a step includes the dropped sub-seconds, only its change over time matters
+	if (!rtc_baseline_valid) {
+		rtc_baseline_valid = true;
+		rtc_baseline_utc_ms = utc_ms;
+		rtc_baseline_offset_ms = offset_ms;
+		return;
+	}
+
+	uint64_t elapsed_ms = utc_ms - rtc_baseline_utc_ms;
+	if (elapsed_ms < TIME_RATE_MIN_INTERVAL_MS) {
+		return;
+	}
+
+	stats.rtc_rate_ppm = (float)(offset_ms - rtc_baseline_offset_ms) * 1e6f / elapsed_ms;
+	int32_t calibration = stats.rtc_calibration + lroundf(stats.rtc_rate_ppm * TIME_RTC_PULSES_PER_PPM);
+	calibration = (calibration < TIME_RTC_CALIBRATION_MIN) ? TIME_RTC_CALIBRATION_MIN : calibration;
+	calibration = (calibration > TIME_RTC_CALIBRATION_MAX) ? TIME_RTC_CALIBRATION_MAX : calibration;
+	time_rtc_set_calibration(calibration);
+
+	rtc_baseline_utc_ms = utc_ms;
+	rtc_baseline_offset_ms = offset_ms;
+}
+
+// === PUBLIC METHODS ===
+void time_init(void) {
+	//calibration survives resets in the backup domain
+	uint32_t calr = READ_REG(hrtc.Instance->CALR);
+	stats.rtc_calibration = ((calr & RTC_CALR_CALP) ? 512 : 0) - (calr & RTC_CALR_CALM);
+
+	uint64_t utc_ms;
+	if (time_rtc_read(&utc_ms)) {
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		reference.source = TIME_SOURCE_RTC;
+		reference.utc_ms = utc_ms;
+		reference.monotonic_ms = HAL_GetTick();
+		__set_PRIMASK(primask);
+	}
+}
+
+uint32_t time_monotonic_ms(void) {
+	return HAL_GetTick();
+}
+
+Timestamp time_now(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	Timestamp timestamp = {
+		.monotonic_ms = HAL_GetTick(),
+		.source = reference.source,
+	};
+	if (reference.source != TIME_SOURCE_NONE) {
+		uint64_t utc_ms = time_utc_ms_at(timestamp.monotonic_ms);
+		//without syncs, keep the reference well within the tick's wrap around
+		if ((timestamp.monotonic_ms - reference.monotonic_ms) > TIME_REFERENCE_MAX_AGE_MS) {
+			reference.utc_ms = utc_ms;
+			reference.monotonic_ms = timestamp.monotonic_ms;
+		}
+		timestamp.utc_s = utc_ms / 1000;
+		timestamp.utc_ms = utc_ms % 1000;
+	}
+
+	__set_PRIMASK(primask);
+	return timestamp;
+}
+
+bool time_get_utc(uint32_t *utc_s) {
+	Timestamp now = time_now();
+	*utc_s = now.utc_s;
+	return (now.source != TIME_SOURCE_NONE);
+}
+
+void time_set_utc(uint32_t utc_s, uint16_t utc_ms, uint32_t monotonic_ms, TimeSource source) {
+	uint64_t new_utc_ms = (uint64_t)utc_s * 1000 + utc_ms;
+	uint32_t since_last_sync_ms = monotonic_ms - stats.last_sync_monotonic_ms;
+
+	//keep the better source while it is still syncing
+	if ((source < reference.source) && (since_last_sync_ms < TIME_SOURCE_HOLDOVER_MS)) {
+		return;
+	}
+	if ((source == TIME_SOURCE_GPS) && (reference.source == TIME_SOURCE_GPS) && (since_last_sync_ms < TIME_GPS_SYNC_PERIOD_MS)) {
+		return;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	//a time taken before the current reference is stale (e.g. a fix parsed after a Pi sync)
+	uint32_t now_ms = HAL_GetTick();
+	bool stale = (reference.source != TIME_SOURCE_NONE) && ((now_ms - monotonic_ms) > (now_ms - reference.monotonic_ms));
+	__set_PRIMASK(primask);
+	if (stale) {
+		return;
+	}
+
+	if (source == TIME_SOURCE_GPS) {
+		time_update_rate(new_utc_ms, monotonic_ms);
+	}
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	stats.last_offset_ms = (reference.source != TIME_SOURCE_NONE) ? (int32_t)(new_utc_ms - time_utc_ms_at(monotonic_ms)) : 0;
+	reference.source = source;
+	reference.utc_ms = new_utc_ms;
+	reference.monotonic_ms = monotonic_ms;
+	reference.rate_ppm = stats.tick_rate_ppm;
+	__set_PRIMASK(primask);
+
+	stats.syncs++;
+	stats.last_sync_monotonic_ms = monotonic_ms;
+
+	//bring the sync time forward to now, the RTC is read/written at the current time
+	uint64_t utc_now_ms = new_utc_ms + (HAL_GetTick() - monotonic_ms);
+	if (source == TIME_SOURCE_GPS) {
+		time_rtc_discipline(utc_now_ms);
+	} else {
+		time_rtc_set(utc_now_ms);
+	}
+}
+
+const TimeStats * time_get_stats(void) {
+	return &stats;
+}
+
+//Days-from-civil inverse (H. Hinnant)
+TimeDate time_date_from_utc(uint32_t utc_s) {
+	uint32_t days = utc_s / SECONDS_PER_DAY;
+	uint32_t seconds_of_day = utc_s % SECONDS_PER_DAY;
+	int32_t z = days + 719468;
+	int32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+	uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+	uint32_t mp = (5*doy + 2)/153;
+	uint32_t month = (mp < 10) ? (mp + 3) : (mp - 9);
+
+	return (TimeDate){
+		.year = yoe + era * 400 + (month <= 2),
+		.month = month,
+		.day = doy - (153*mp + 2)/5 + 1,
+		.hour = seconds_of_day / 3600,
+		.minute = (seconds_of_day / 60) % 60,
+		.second = seconds_of_day % 60,
+		.weekday = ((days + 3) % 7) + 1, //1970-01-01 was a thursday
+	};
+}
+
+//Days-from-civil (H. Hinnant)
+uint32_t time_utc_from_date(const TimeDate *date) {
+	int32_t year = date->year - (date->month <= 2);
+	int32_t era = year / 400;
+	uint32_t yoe = year - era * 400;
+	uint32_t doy = (153 * (date->month + ((date->month > 2) ? -3 : 9)) + 2) / 5 + date->day - 1;
+	uint32_t doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+	uint32_t days = era * 146097 + doe - 719468;
+
+	return days * SECONDS_PER_DAY + date->hour * 3600 + date->minute * 60 + date->second;
+}
@@ -10,6 +10,10 @@
 #include "Recovery Inc/GPS.h"
 #include "Recovery Inc/AprsPacket.h"
 #include "Recovery Inc/AprsTransmit.h"
+#include "Recovery Inc/Geofence.h"
+#include "Recovery Inc/DriftPredictor.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include "Lib Inc/event_log.h"
 #include "main.h"
 #include "config.h"
 #include <stdlib.h>
@@ -23,6 +27,22 @@ extern TX_QUEUE gps_tx_queue;
 
 TX_MUTEX vhf_mutex;
 
+//Time of the last transmission (beacon or message)
+static Timestamp last_tx_timestamp = {0};
+
+//Last locked fix
+static GPS_Data last_fix = {0};
+static Timestamp last_fix_timestamp = {0};
+
+static AprsTxStats tx_stats = {0};
+
+//Sends a packet on the keyed transmitter, accounting for its time on air
+static void aprs_send_on_air(uint8_t *packet, size_t packet_length){
+    Timestamp start = time_now();
+    aprs_transmit_send_data(packet, packet_length);
+    aprs_record_transmission(start);
+}
+
 void aprs_thread_entry(ULONG aprs_thread_input){
 
     //buffer for packet data
@@ -34,25 +54,43 @@ void aprs_thread_entry(ULONG aprs_thread_input){
 
     //Initialize VHF module for transmission. Turn transmission off so we don't hog the frequency
     vhf_sleep(&vhf);
-    tx_mutex_create(&vhf_mutex, "VHF mutex", 1);
 
     //Generate Aprs sine table
     aprs_transmit_init();
 
+    //Planned time (ThreadX ticks) of the next beacon. The GPS is only powered for a window ahead of it.
+    ULONG next_beacon = tx_time_get();
+
+    //Last beacon (real or estimated) and the interval planned after it
+    ULONG last_beacon = next_beacon;
+    ULONG beacon_interval = 0;
+
+    //Tracks the drift between fixes, to beacon an estimated position when no fix can be had
+    DriftPredictor drift;
+    drift_predictor_init(&drift);
+
     //Main task loop
     while(1){
 
         //GPS data struct
         GPS_Data gps_data;
 
+        //Sleep until the receiver has to be woken to have a fix by the planned beacon (its expected time to first fix)
+        ULONG wake_time = next_beacon - tx_ms_to_ticks(gps_get_wake_lead_ms());
+        LONG until_wake = (LONG)(wake_time - tx_time_get());
+        if (until_wake > 0) {
+            tx_thread_sleep(until_wake);
+        }
 
-        //Attempt to get a GPS lock
-        // bool is_locked = gps_read(&gps_data);
-       bool is_locked = get_gps_lock(&gps, &gps_data);
+        //GPS was put in standby/off after the last beacon or a no signal abort (no-op in continuous mode, or when left on)
+        gps_wake();
 
-        //The time we will eventually put this task to sleep for. We assign this assuming the GPS lock has failed (only sleep for a shorter, fixed period of time).
-        //If we did get a GPS lock, the sleep_period will correct itself by the end of the task (be appropriately assigned after succesful APRS transmission)
-        uint32_t sleep_period = GPS_SLEEP_LENGTH;
+        //Attempt to get a GPS lock. Accept a rougher fix when the battery is low, we may not get many more chances.
+        const GpsFixGate *gate = battery_monitor_is_low() ? &g_config.gps_gate_critical : &g_config.gps_gate;
+        bool is_locked = get_gps_lock(&gps, &gps_data, gate);
+
+        //If we did get a GPS lock, the next beacon is planned after the APRS transmission, else a retry below
+        ULONG beacon_time = tx_time_get();
 
         for(int i = 0; i < 15; i++){
 			HAL_GPIO_TogglePin(PWR_LED_NEN_GPIO_Port, PWR_LED_NEN_Pin);
@@ -61,43 +99,100 @@ void aprs_thread_entry(ULONG aprs_thread_input){
 		HAL_GPIO_WritePin(PWR_LED_NEN_GPIO_Port, PWR_LED_NEN_Pin, GPIO_PIN_RESET);//ensure light is off after strobe
         //If we've locked onto a position, we can start creating an APRS packet.
         if (is_locked){
+            drift_predictor_update(&drift, gps_data.latitude, gps_data.longitude, time_monotonic_ms());
+
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            last_fix = gps_data;
+            last_fix_timestamp = time_now();
+            __set_PRIMASK(primask);
+            event_log_fix(&gps_data);
+
             uint8_t *packet_end;
             size_t packet_length;
+
+            tx_mutex_get(&vhf_mutex,TX_WAIT_FOREVER);
+
+            //Switch frequency, power and path when entering another region (no-op while in the same region).
+            //Done before generating the packet so that it carries this region's digipeater path.
+            GeofenceBeaconPolicy beacon;
+            geofence_update(&vhf, gps_data.latitude, gps_data.longitude, &beacon);
             aprs_generate_location_packet(packetBuffer, &packet_end, gps_data.latitude, gps_data.longitude);
 
             //Start transmission
             //increment aprs packet #
-            tx_mutex_get(&vhf_mutex,TX_WAIT_FOREVER);
-            if(vhf_tx(&vhf) == HAL_OK){
+            if(beacon.enabled && (vhf_tx(&vhf) == HAL_OK)){
                 packet_length = packet_end - packetBuffer;
-				aprs_transmit_send_data(packetBuffer, packet_length);
+				aprs_send_on_air(packetBuffer, packet_length);
             }
             //end transmission
             vhf_sleep(&vhf);
             tx_mutex_put(&vhf_mutex);
             //gps_invalidate();
 
-            //Set the sleep period for a successful APRS transmission
-            sleep_period = APRS_BASE_SLEEP_LENGTH - tx_ms_to_ticks(VHF_MAX_WAKE_TIME_MS);
+            //Plan the next beacon one interval after this one
+            beacon_interval = (beacon.interval_s != 0) ? tx_s_to_ticks(beacon.interval_s) : APRS_BASE_SLEEP_LENGTH;
 
             //Add a random component to it so that we dont transmit at the same interval each time (to prevent bad timing drowning out other transmissions)
-            uint8_t random_num = rand() % tx_s_to_ticks(30);
+            //A random amount of time, from 0 to 30 seconds
+            beacon_interval += rand() % tx_s_to_ticks(30);
+            last_beacon = beacon_time;
+            next_beacon = beacon_time + beacon_interval;
+
+            //Position is not needed until the next wake, let the GPS choose between standby and power off
+            LONG until_beacon = (LONG)(next_beacon - tx_time_get());
+            gps_sleep_for((until_beacon > 0) ? tx_ticks_to_s(until_beacon) : 0);
+        } else {
+            //No fix: once the beacon is due, send the predicted drift position instead (an object marked as an estimate)
+            DriftEstimate estimate;
+            if (((beacon_time - last_beacon) >= beacon_interval)
+                    && drift_predictor_estimate(&drift, time_monotonic_ms(), &estimate)){
+                uint8_t *packet_end;
+
+                tx_mutex_get(&vhf_mutex,TX_WAIT_FOREVER);
+                GeofenceBeaconPolicy beacon;
+                geofence_update(&vhf, estimate.latitude, estimate.longitude, &beacon);
+                aprs_generate_estimate_packet(packetBuffer, &packet_end, estimate.latitude, estimate.longitude,
+                        estimate.course_deg, estimate.speed_mm_s, estimate.radius_m, estimate.age_ms / 1000);
+
+                if(beacon.enabled && (vhf_tx(&vhf) == HAL_OK)){
+                    aprs_send_on_air(packetBuffer, packet_end - packetBuffer);
+                }
+                vhf_sleep(&vhf);
+                tx_mutex_put(&vhf_mutex);
+
+                last_beacon = beacon_time;
+            }
 
-            //Add a random amount of seconds to the sleep, from 0 to 29
-            sleep_period += random_num;
-        } else if (0 /*!(last tx < retransmit_timer)*/) {
-            //retransmit last position with timerstamp
+            if (gps.acquisition_result == GPS_ACQ_ABORT_NO_SIGNAL) {
+                //No sky visible (likely submerged), don't keep the receiver searching until the retry
+                gps_sleep_for(tx_ticks_to_s(GPS_SLEEP_LENGTH));
+            }
+
+            //Retry after a shorter, fixed period, during which the receiver stays as it was just left: the wake lead
+            //of a powered down receiver (a cold start) must not eat into it
+            next_beacon = gps_acq_plan_retry(tx_time_get(), GPS_SLEEP_LENGTH, tx_ms_to_ticks(gps_get_wake_lead_ms()));
         }
+        //On a timeout with signal the receiver stays on, keeping its acquisition progress for the retry
         HAL_GPIO_WritePin(PWR_LED_NEN_GPIO_Port, PWR_LED_NEN_Pin, GPIO_PIN_SET);//ensure light is off after strobe
-
-
-        //Go to sleep now
-        tx_thread_sleep(sleep_period);
     }
 }
 
+void aprs_init(void){
+    tx_mutex_create(&vhf_mutex, "VHF mutex", 1);
+}
+
 void aprs_sleep(void){
+    tx_mutex_get(&vhf_mutex, TX_WAIT_FOREVER);
     vhf_sleep(&vhf);
+    tx_mutex_put(&vhf_mutex);
+}
+
+void aprs_suspend(TX_THREAD *aprs_thread){
+    //the APRS thread only holds the VHF while keyed, and always leaves it asleep
+    tx_mutex_get(&vhf_mutex, TX_WAIT_FOREVER);
+    tx_thread_suspend(aprs_thread);
+    tx_mutex_put(&vhf_mutex);
 }
 
 void aprs_tx_message(const char* message, size_t message_len){
@@ -110,9 +205,44 @@ void aprs_tx_message(const char* message, size_t message_len){
     tx_mutex_get(&vhf_mutex,TX_WAIT_FOREVER);
     if(vhf_tx(&vhf) == HAL_OK){
         //Now, transmit the signal through the VHF module. Transmit a few times just for safety.
-        aprs_transmit_send_data(packetBuffer, packet_end - packetBuffer);
+        aprs_send_on_air(packetBuffer, packet_end - packetBuffer);
     }
     //end transmission
     vhf_sleep(&vhf);
     tx_mutex_put(&vhf_mutex);
 }
+
+Timestamp aprs_get_last_tx_timestamp(void){
+    return last_tx_timestamp;
+}
+
+Timestamp aprs_get_last_fix(GPS_Data *fix){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *fix = last_fix;
+    Timestamp timestamp = last_fix_timestamp;
+    __set_PRIMASK(primask);
+    return timestamp;
+}
+
+void aprs_record_transmission(Timestamp start){
+    uint32_t on_air_ms = time_monotonic_ms() - start.monotonic_ms;
+    uint32_t current_mA = (vhf.power_level == VHF_POWER_HIGH) ? APRS_VHF_TX_CURRENT_HIGH_MA : APRS_VHF_TX_CURRENT_LOW_MA;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    last_tx_timestamp = start;
+    tx_stats.transmissions++;
+    tx_stats.on_air_ms += on_air_ms;
+    tx_stats.energy_mJ += (uint32_t)(((uint64_t)on_air_ms * current_mA * APRS_VHF_SUPPLY_MV) / 1000000);
+    __set_PRIMASK(primask);
+    event_log_transmission(on_air_ms);
+}
+
+AprsTxStats aprs_get_tx_stats(void){
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    AprsTxStats stats = tx_stats;
+    __set_PRIMASK(primask);
+    return stats;
+}
@@ -9,12 +9,15 @@
 #include "Recovery Inc/AprsPacket.h"
 #include "Recovery Inc/Aprs.h"
 #include "Sensor Inc/BatteryMonitoring.h"
+#include "Lib Inc/time_service.h"
 #include "main.h"
 #include "timing.h"
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 typedef struct callsign_t {
     char callsign[7];
@@ -24,11 +27,15 @@ typedef struct callsign_t {
 static struct {
     Callsign src;
     Callsign msg_recipient;
+    Callsign digipeater[APRS_MAX_DIGIPEATERS]; //unused entries have an empty callsign
     char comment[41];
 } aprs_config = {
     .src = {
         .callsign 	= APRS_SOURCE_CALLSIGN,
         .ssid 		= APRS_SOURCE_SSID,
+    },
+    .digipeater = {
+        [0] = {.callsign = APRS_DIGI_PATH, .ssid = APRS_DIGI_SSID},
     },
 	.msg_recipient = {
 		.callsign   = APRS_MESSAGE_RECIPIENT_CALLSIGN,
@@ -40,7 +47,7 @@ static struct {
 typedef struct ax25_frame_t {
 	Callsign destination;
 	Callsign source;
-	Callsign digipeter[8];
+	Callsign digipeter[APRS_MAX_DIGIPEATERS];
 	struct {
 		uint8_t *value;
 		size_t len;
@@ -49,6 +56,7 @@ typedef struct ax25_frame_t {
 
 static void append_gps_data(uint8_t * buffer, float lat, float lon);
 static void append_compressed_gps_data(uint8_t *buffer, float lat, float lon);
+static void append_compressed_course_speed(uint8_t *buffer, uint16_t course_deg, uint16_t speed_mm_s);
 static void append_timestamp(uint8_t *buffer, const uint16_t timestamp[3]);
 static void append_comment(uint8_t *buffer, size_t max_len, const char *comment);
 
@@ -83,18 +91,34 @@ static void callsign_to_string(const Callsign *self, char str[static 10]) {
     }
 }
 
+/* AX25 FCS ****************************************************************/
+uint16_t ax25_fcs(const uint8_t *data, size_t length){
+	//Follows the CRC-16 CCITT standard.
+    uint16_t crc = 0xFFFF;
+    for (const uint8_t *i_byte = data; i_byte < data + length; i_byte++){
+        for (uint8_t bit_index = 0; bit_index < 8; bit_index++){
+            bool bit = (*i_byte >> bit_index) & 0x01;
+            //Bit magic for the CRC
+            unsigned short xorIn;
+            xorIn = crc ^ bit;
+            crc >>= 1;
+            if (xorIn & 0x01) crc ^= 0x8408;
+        }
+    }
+    return crc ^ 0xFFFF;
+}
+
 /* AX25Frame *****************************************************************/
 static void ax25_frame_generate_bytes(const AX25Frame *self, uint8_t *dst, uint8_t **dst_end){
 	uint8_t *dst_next = dst;
 
 	callsign_to_ax25_address(&self->destination, dst_next, &dst_next);
 	callsign_to_ax25_address(&self->source, dst_next, &dst_next);
-	for(int i = 0;  (i < 8) && (self->digipeter[i].callsign[0] != 0); i++){
-		callsign_to_ax25_address(&self->digipeter[0], dst_next, &dst_next);
-		if(i == 0) {
-			dst_next[-1] += 1;
-		}
+	for(int i = 0;  (i < APRS_MAX_DIGIPEATERS) && (self->digipeter[i].callsign[0] != 0); i++){
+		callsign_to_ax25_address(&self->digipeter[i], dst_next, &dst_next);
 	}
+	//the last address in the header is marked by its extension bit
+	dst_next[-1] |= 1;
 
 	*(dst_next++) = APRS_CONTROL_FIELD;
 	*(dst_next++) = APRS_PROTOCOL_ID;
@@ -103,20 +127,10 @@ static void ax25_frame_generate_bytes(const AX25Frame *self, uint8_t *dst, uint8
 	memcpy(dst_next, self->information.value, self->information.len);
 	dst_next += self->information.len;
 
-	//Calculates and appends the CRC frame checker. Follows the CRC-16 CCITT standard.
-    uint16_t crc = 0xFFFF;
-    for (uint8_t *i_byte = dst; i_byte < dst_next; i_byte++){
-        for (uint8_t bit_index = 0; bit_index < 8; bit_index++){
-            bool bit = (*i_byte >> bit_index) & 0x01;
-            //Bit magic for the CRC
-            unsigned short xorIn;
-            xorIn = crc ^ bit;
-            crc >>= 1;
-            if (xorIn & 0x01) crc ^= 0x8408;
-        }
-    }
-    *(dst_next++) = (crc & 0xFF) ^ 0xFF;
-    *(dst_next++) = (crc >> 8) ^ 0xFF;
+	//Calculates and appends the CRC frame checker
+    uint16_t fcs = ax25_fcs(dst, dst_next - dst);
+    *(dst_next++) = fcs & 0xFF;
+    *(dst_next++) = fcs >> 8;
 
     if(dst_end != NULL){
         *dst_end = dst_next;
@@ -128,14 +142,12 @@ static void __ax25_generate_packet(uint8_t *buffer, uint8_t **buffer_end, uint8_
     AX25Frame frame = {
         .destination = {.callsign = APRS_DESTINATION_CALLSIGN, .ssid = APRS_DESTINATION_SSID},
         .source = aprs_config.src,
-        .digipeter = {
-                [0] = {.callsign = APRS_DIGI_PATH, .ssid = (APRS_DIGI_SSID)},
-        },
         .information = {
             .value = aprs_data,
             .len = aprs_data_size,
         },
 	};
+	memcpy(frame.digipeter, aprs_config.digipeater, sizeof(frame.digipeter));
 
 	//TXDelayFlags
 	memset(buffer_position, APRS_FLAG, AX25_FLAG_COUNT);
@@ -208,6 +220,44 @@ void aprs_generate_location_packet_w_timestamp(uint8_t * buffer, uint8_t **buffe
     __ax25_generate_packet(buffer, buffer_end, gps_data, gps_data_size);
 }
 
+void aprs_generate_estimate_packet(uint8_t *buffer, uint8_t **buffer_end, float lat, float lon, uint16_t course_deg, uint16_t speed_mm_s, uint32_t radius_m, uint32_t age_s){
+    uint8_t object_data[256];
+	size_t  object_data_size = 0;
+    char name_buffer[10];
+    char comment_buffer[APRS_MAX_COMMENT_LEN + 1];
+
+    //object name: callsign + suffix, space padded to 9 characters
+    snprintf(name_buffer, sizeof(name_buffer), "%-9.9s", aprs_config.src.callsign);
+    memcpy(&name_buffer[strnlen(aprs_config.src.callsign, 9 - strlen(APRS_ESTIMATE_OBJECT_SUFFIX))], APRS_ESTIMATE_OBJECT_SUFFIX, strlen(APRS_ESTIMATE_OBJECT_SUFFIX));
+
+    object_data[0] = APRS_DT_OBJECT_CHARACTER;
+    memcpy(&object_data[1], name_buffer, 9);
+    object_data[10] = '*'; //live object
+    object_data_size += 11;
+
+    //time of the estimate (objects always carry a timestamp, zeros if the time is unknown)
+    Timestamp now = time_now();
+    TimeDate utc = time_date_from_utc(now.utc_s);
+    uint16_t timestamp[3] = {utc.hour, utc.minute, utc.second};
+    if (now.source == TIME_SOURCE_NONE) {
+        memset(timestamp, 0, sizeof(timestamp));
+    }
+    append_timestamp(&object_data[object_data_size], timestamp);
+    object_data_size += 7;
+
+	append_compressed_gps_data(&object_data[object_data_size], lat, lon);
+    append_compressed_course_speed(&object_data[object_data_size], course_deg, speed_mm_s);
+    object_data_size += 13;
+
+    //mark as an estimate with its uncertainty and the age of the last real fix
+    snprintf(comment_buffer, sizeof(comment_buffer), "EST r=%lum last fix %lumin ago", (unsigned long)radius_m, (unsigned long)(age_s / 60));
+    append_comment(&object_data[object_data_size], APRS_MAX_COMMENT_LEN, comment_buffer);
+    object_data_size += strlen(comment_buffer);
+
+	//package inside AX.25 frame
+    __ax25_generate_packet(buffer, buffer_end, object_data, object_data_size);
+}
+
 void aprs_generate_message_packet(uint8_t *buffer, uint8_t **buffer_end, const char* message, size_t message_len){
 	char addressee[10] = "KC1QXQ-8";
     uint8_t message_bytes[256] = {':'};
@@ -323,6 +373,15 @@ static void append_compressed_gps_data(uint8_t *buffer, float lat, float lon){
     buffer[12] = 'T';
 }
 
+//Replaces the "no course/speed" bytes of compressed position data with a course and speed (APRS101 ch. 9)
+static void append_compressed_course_speed(uint8_t *buffer, uint16_t course_deg, uint16_t speed_mm_s){
+    float speed_knots = speed_mm_s * 0.00194384f;
+
+    buffer[10] = '!' + (course_deg % 360) / 4;
+    buffer[11] = '!' + (uint8_t)lroundf(logf(speed_knots + 1.0f) / logf(1.08f));
+    buffer[12] = '!'; //compression type: old (not current) fix, other source
+}
+
 static void append_timestamp(uint8_t *buffer, const uint16_t timestamp[3]){
     char timestamp_buffer[8];
     sprintf(timestamp_buffer, "%02d%02d%02dh", timestamp[0], timestamp[1], timestamp[2]);
@@ -381,6 +440,15 @@ int aprs_set_msg_recipient_ssid(uint8_t ssid) {
     return 0;
 }
 
+void aprs_get_msg_recipient_callsign(char callsign[static 7]){
+	memcpy(callsign, aprs_config.msg_recipient.callsign, 6);
+    callsign[6] = 0;
+}
+
+void aprs_get_msg_recipient_ssid(uint8_t *ssid){
+    *ssid = aprs_config.msg_recipient.ssid;
+}
+
 int aprs_set_callsign(const char *callsign){
 	size_t len = strlen(callsign);
 
@@ -408,8 +476,44 @@ void aprs_get_ssid(uint8_t *ssid){
     *ssid = aprs_config.src.ssid; 
 }
 
+void aprs_get_comment(char comment[static APRS_MAX_COMMENT_LEN + 1]) {
+    memcpy(comment, aprs_config.comment, APRS_MAX_COMMENT_LEN + 1);
+}
+
 void aprs_set_comment(const char *comment, size_t comment_len) {
     comment_len = (comment_len < APRS_MAX_COMMENT_LEN) ? comment_len : APRS_MAX_COMMENT_LEN;
     memcpy(aprs_config.comment, comment, comment_len);
     aprs_config.comment[comment_len] = '\0';
 }
+
+int aprs_set_digi_path(const char *path) {
+    Callsign digipeater[APRS_MAX_DIGIPEATERS] = {0};
+    const char *entry = path;
+
+    //path is a comma separated list of CALLSIGN[-SSID], e.g. "WIDE1-1,WIDE2-1"
+    for (int i = 0; (entry != NULL) && (*entry != '\0'); i++) {
+        if (i == APRS_MAX_DIGIPEATERS)
+            return -1; //too many hops
+
+        const char *end = strchr(entry, ',');
+        size_t entry_len = (end != NULL) ? (size_t)(end - entry) : strlen(entry);
+        const char *dash = memchr(entry, '-', entry_len);
+        size_t callsign_len = (dash != NULL) ? (size_t)(dash - entry) : entry_len;
+
+        if ((callsign_len == 0) || (callsign_len > APRS_CALLSIGN_LENGTH))
+            return -1; //bad callsign
+
+        memcpy(digipeater[i].callsign, entry, callsign_len);
+        if (dash != NULL) {
+            int ssid = atoi(dash + 1);
+            if ((ssid < 0) || (ssid > 15))
+                return -1; //out of range
+            digipeater[i].ssid = ssid;
+        }
+
+        entry = (end != NULL) ? (end + 1) : NULL;
+    }
+
+    memcpy(aprs_config.digipeater, digipeater, sizeof(digipeater));
+    return 0;
+}
@@ -6,6 +6,7 @@
  */
 
 #include "Recovery Inc/AprsTransmit.h"
+#include "Lib Inc/low_power.h"
 #include "constants.h"
 #include "main.h"
 
@@ -13,12 +14,17 @@
 static void calcSineValues();
 
 //Private variables
-static bool byte_complete_flag;
 static bool is_1200_hz = false;
 
+//Next byte for the bit timer, and whether it still has bits of the current one to send
+static volatile uint16_t next_byte_input;
+static volatile bool next_byte_pending = false;
+static volatile bool byte_in_progress = false;
+
 //Extern variables
 extern DAC_HandleTypeDef hdac1;
 extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim7;
 uint32_t dac_input[APRS_TRANSMIT_NUM_SINE_SAMPLES];
 
 void aprs_transmit_init(void){
@@ -26,33 +32,43 @@ void aprs_transmit_init(void){
 	MX_TIM2_Fake_Init(APRS_TRANSMIT_PERIOD_2200HZ);
 }
 
-bool aprs_transmit_send_data(uint8_t * packet_data, uint16_t packet_length){
+//Queues a single byte for the bit timer, waiting for the previous one to be taken
+static void aprs_transmit_byte(uint16_t byte_input){
 
-//	calcSineValues();
+	//Poll until the bit timer starts on the previous byte
+	while (next_byte_pending);
 
-	//Timer variables for transmitting bits
-	TX_TIMER bit_timer;
+	next_byte_input = byte_input;
+	next_byte_pending = true;
+}
 
+void aprs_transmit_start(void){
 	//Start our DAC and our timer to trigger the conversion edges
+	low_power_veto(LOW_POWER_VETO_APRS_DAC, true);
 	HAL_DAC_Start_DMA(&hdac1, DAC_CHANNEL_1, (uint32_t *)dac_input, APRS_TRANSMIT_NUM_SINE_SAMPLES, DAC_ALIGN_12B_R);
 	HAL_TIM_Base_Start(&htim2);
 
-	//Loop through each byte
-	for (int byte_index = 0; byte_index < packet_length; byte_index++){
-
-		//Set complete flag to false so we can poll it later
-		byte_complete_flag = false;
-
-		//Create a timer to control the transmission of each bit. We pass in the current byte as an input to the timer so it can iterate over it bit by bit.
-		tx_timer_create(&bit_timer, "APRS Transmit Bit Timer", aprs_transmit_bit_timer_entry, packet_data[byte_index], APRS_TRANSMIT_BIT_TIME, APRS_TRANSMIT_BIT_TIME, TX_AUTO_ACTIVATE);
-
-		//Poll for completion of the byte
-		while (!byte_complete_flag);
+	//Start the bit timer, it waits for the first byte
+	__HAL_TIM_SET_COUNTER(&htim7, 0);
+	HAL_TIM_Base_Start_IT(&htim7);
+}
 
+void aprs_transmit_flags(uint16_t count){
+	for (uint16_t i = 0; i < count; i++){
+		aprs_transmit_byte(APRS_TRANSMIT_FLAG | APRS_TRANSMIT_IS_FLAG);
+	}
+}
 
-		//Delete the timer so we can recreate it later with the next byte as an input
-		tx_timer_delete(&bit_timer);
+void aprs_transmit_frame(const uint8_t *frame, uint16_t frame_length){
+	for (uint16_t byte_index = 0; byte_index < frame_length; byte_index++){
+		aprs_transmit_byte(frame[byte_index]);
 	}
+}
+
+void aprs_transmit_stop(void){
+	//Poll for completion of the last byte
+	while (next_byte_pending || byte_in_progress);
+	HAL_TIM_Base_Stop_IT(&htim7);
 
 	//Stop DAC and timer
 	HAL_DAC_Stop_DMA(&hdac1, DAC_CHANNEL_1);
@@ -61,19 +77,45 @@ bool aprs_transmit_send_data(uint8_t * packet_data, uint16_t packet_length){
 	//Reset the timer period for the next transmission
 	MX_TIM2_Fake_Init(APRS_TRANSMIT_PERIOD_2200HZ);
 	is_1200_hz = false;
+	low_power_veto(LOW_POWER_VETO_APRS_DAC, false);
+}
+
+bool aprs_transmit_send_data(uint8_t * packet_data, uint16_t packet_length){
+
+	aprs_transmit_start();
+
+	//Loop through each byte
+	for (int byte_index = 0; byte_index < packet_length; byte_index++){
+		uint8_t byte = packet_data[byte_index];
+		aprs_transmit_byte((byte == APRS_TRANSMIT_FLAG) ? (byte | APRS_TRANSMIT_IS_FLAG) : byte);
+	}
+
+	aprs_transmit_stop();
 
 	return true;
 }
 
-void aprs_transmit_bit_timer_entry(ULONG bit_timer_input){
+void aprs_transmit_bit_timer_entry(void){
 
 	//static variable to keep track of our bit index
 	static uint8_t bit_index = 0;
 	static uint8_t bit_stuff_counter = 0;
 	static bool is_stuffed_bit = false;
+	static uint16_t bit_timer_input = 0;
+
+	//Take the next byte, the tone is held (1 bits) if it is late
+	if (!byte_in_progress){
+		if (!next_byte_pending){
+			return;
+		}
+		bit_timer_input = next_byte_input;
+		next_byte_pending = false;
+		byte_in_progress = true;
+	}
 
 	//Current byte we will iterate over
 	uint8_t current_byte = (uint8_t) bit_timer_input;
+	bool is_flag = (bit_timer_input & APRS_TRANSMIT_IS_FLAG) != 0;
 
 	if (bit_stuff_counter >= 5){
 		is_stuffed_bit = true;
@@ -90,7 +132,7 @@ void aprs_transmit_bit_timer_entry(ULONG bit_timer_input){
 		MX_TIM2_Fake_Init(newPeriod);
 		bit_stuff_counter = 0;
 
-	} else if (current_byte != 0x7E){
+	} else if (!is_flag){
 		bit_stuff_counter++;
 	}
 
@@ -102,9 +144,9 @@ void aprs_transmit_bit_timer_entry(ULONG bit_timer_input){
 		is_stuffed_bit = false;
 	}
 
-	//If we've iterated through all bits, set flag and reset index counter
+	//If we've iterated through all bits, clear flag and reset index counter
 	if (bit_index >= BITS_PER_BYTE){
-		byte_complete_flag = true;
+		byte_in_progress = false;
 		bit_index = 0;
 	}
 }
@@ -0,0 +1,120 @@
+/*
+ * DriftPredictor.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Dead-reckoning of the drifting tag between GPS fixes. See matching header file for more info.
+ */
+
+#include "Recovery Inc/DriftPredictor.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define DEG_TO_RAD (3.14159265f / 180.0f)
+
+// === PRIVATE METHODS ===
+//Displacement (1e-7 deg) after elapsed_ms at velocity_q8
+static int32_t drift_displacement(int32_t velocity_q8, uint32_t elapsed_ms) {
+	return (int32_t)(((int64_t)velocity_q8 * elapsed_ms) / (1000 << DRIFT_VELOCITY_Q));
+}
+
+//Converts a north/east offset in 1e-7 degrees to millimeters
+static void drift_to_mm(const DriftPredictor *predictor, int32_t lat_e7, int32_t lon_e7, int64_t *north_mm, int64_t *east_mm) {
+	*north_mm = ((int64_t)lat_e7 * DRIFT_UM_PER_E7) / 1000;
+	*east_mm = ((((int64_t)lon_e7 * DRIFT_UM_PER_E7) / 1000) * predictor->lon_scale_q15) >> 15;
+}
+
+static void drift_restart(DriftPredictor *predictor, int32_t lat_e7, int32_t lon_e7, uint32_t now_ms) {
+	*predictor = (DriftPredictor){
+		.fixes = 1,
+		.fix_ms = now_ms,
+		.lat_e7 = lat_e7,
+		.lon_e7 = lon_e7,
+		.lon_scale_q15 = (int32_t)(cosf(lat_e7 * 1e-7f * DEG_TO_RAD) * (1 << 15)),
+		.speed_sigma_mm_s = DRIFT_MIN_SPEED_SIGMA_MM_S,
+	};
+}
+
+// === PUBLIC METHODS ===
+void drift_predictor_init(DriftPredictor *predictor) {
+	*predictor = (DriftPredictor){0};
+}
+
+void drift_predictor_update(DriftPredictor *predictor, float latitude, float longitude, uint32_t now_ms) {
+	int32_t lat_e7 = lroundf(latitude * 1e7f);
+	int32_t lon_e7 = lroundf(longitude * 1e7f);
+	uint32_t elapsed_ms = now_ms - predictor->fix_ms;
+
+	if ((predictor->fixes == 0) || (elapsed_ms > DRIFT_MAX_FIX_GAP_MS)) {
+		drift_restart(predictor, lat_e7, lon_e7, now_ms);
+		return;
+	}
+	if (elapsed_ms == 0) {
+		return; //same epoch
+	}
+
+	//residual between the fix and the predicted position
+	int32_t predicted_lat_e7 = predictor->lat_e7 + drift_displacement(predictor->lat_velocity_q8, elapsed_ms);
+	int32_t predicted_lon_e7 = predictor->lon_e7 + drift_displacement(predictor->lon_velocity_q8, elapsed_ms);
+	int32_t residual_lat_e7 = lat_e7 - predicted_lat_e7;
+	int32_t residual_lon_e7 = lon_e7 - predicted_lon_e7;
+
+	int64_t north_mm, east_mm;
+	drift_to_mm(predictor, residual_lat_e7, residual_lon_e7, &north_mm, &east_mm);
+	uint32_t residual_mm = (uint32_t)sqrtf((float)(north_mm * north_mm + east_mm * east_mm));
+	if (residual_mm > DRIFT_RESET_DISTANCE_M * 1000) {
+		drift_restart(predictor, lat_e7, lon_e7, now_ms);
+		return;
+	}
+
+	if (predictor->fixes == 1) {
+		//second fix: take the velocity straight from the two fixes
+		predictor->lat_velocity_q8 = (int32_t)(((int64_t)residual_lat_e7 * (1000 << DRIFT_VELOCITY_Q)) / elapsed_ms);
+		predictor->lon_velocity_q8 = (int32_t)(((int64_t)residual_lon_e7 * (1000 << DRIFT_VELOCITY_Q)) / elapsed_ms);
+		predictor->lat_e7 = lat_e7;
+		predictor->lon_e7 = lon_e7;
+	} else {
+		predictor->lat_e7 = predicted_lat_e7 + ((DRIFT_ALPHA_Q8 * (int64_t)residual_lat_e7) >> 8);
+		predictor->lon_e7 = predicted_lon_e7 + ((DRIFT_ALPHA_Q8 * (int64_t)residual_lon_e7) >> 8);
+		predictor->lat_velocity_q8 += (int32_t)((DRIFT_BETA_Q8 * (int64_t)residual_lat_e7 * 1000) / elapsed_ms);
+		predictor->lon_velocity_q8 += (int32_t)((DRIFT_BETA_Q8 * (int64_t)residual_lon_e7 * 1000) / elapsed_ms);
+
+		//how fast the fixes wander off the predicted track, moving average with a weight of 1/4 on the newest fix
+		uint32_t residual_speed_mm_s = (uint32_t)(((uint64_t)residual_mm * 1000) / elapsed_ms);
+		predictor->speed_sigma_mm_s = (3 * predictor->speed_sigma_mm_s + residual_speed_mm_s) / 4;
+		if (predictor->speed_sigma_mm_s < DRIFT_MIN_SPEED_SIGMA_MM_S) {
+			predictor->speed_sigma_mm_s = DRIFT_MIN_SPEED_SIGMA_MM_S;
+		}
+	}
+
+	predictor->fix_ms = now_ms;
+	if (predictor->fixes < UINT8_MAX) {
+		predictor->fixes++;
+	}
+}
+
+bool drift_predictor_estimate(const DriftPredictor *predictor, uint32_t now_ms, DriftEstimate *estimate) {
+	uint32_t age_ms = now_ms - predictor->fix_ms;
+	if ((predictor->fixes < 2) || (age_ms > DRIFT_MAX_PREDICTION_MS)) {
+		return false;
+	}
+
+	int32_t lat_e7 = predictor->lat_e7 + drift_displacement(predictor->lat_velocity_q8, age_ms);
+	int32_t lon_e7 = predictor->lon_e7 + drift_displacement(predictor->lon_velocity_q8, age_ms);
+
+	//velocity over 1000 s, so that the millimeter conversion keeps its resolution
+	int64_t north_mm, east_mm;
+	drift_to_mm(predictor, predictor->lat_velocity_q8 * (1000 >> 3) >> (DRIFT_VELOCITY_Q - 3),
+			predictor->lon_velocity_q8 * (1000 >> 3) >> (DRIFT_VELOCITY_Q - 3), &north_mm, &east_mm);
+	float course = atan2f((float)east_mm, (float)north_mm) / DEG_TO_RAD;
+
+	*estimate = (DriftEstimate){
+		.latitude = lat_e7 * 1e-7f,
+		.longitude = lon_e7 * 1e-7f,
+		.radius_m = DRIFT_FIX_UNCERTAINTY_M + (uint32_t)(((uint64_t)predictor->speed_sigma_mm_s * age_ms) / 1000000),
+		.age_ms = age_ms,
+		.course_deg = (uint16_t)lroundf((course < 0) ? (course + 360.0f) : course) % 360,
+		.speed_mm_s = (uint16_t)(sqrtf((float)(north_mm * north_mm + east_mm * east_mm)) / 1000),
+	};
+	return true;
+}
@@ -8,6 +8,8 @@
  */
 #include "tx_api.h"
 #include "Recovery Inc/GPS.h"
+#include "Recovery Inc/GpsAssist.h"
+#include "Recovery Inc/GpsReplay.h"
 #include "Lib Inc/minmea.h"
 #include <math.h>
 #include <string.h>
@@ -15,95 +17,199 @@
 #include "stm32u5xx_hal_uart.h"
 #include "stm32u5xx_hal_uart_ex.h"
 #include "main.h"
-
-#ifdef GPS_COMM_DEBUG
+#include "util.h"
 #include "Lib Inc/timing.h"
-#endif
+#include "Lib Inc/low_power.h"
 
 //For parsing GPS outputs
-static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t buffer_length);
+static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t buffer_length, uint32_t rx_tick);
+static void parse_ubx_output(GPS_HandleTypeDef* gps, const uint8_t* frame, size_t frame_length, uint32_t rx_tick);
+static void gps_fuse_position(GPS_HandleTypeDef* gps, GPS_MsgTypes msg_type, const uint16_t *timestamp);
+static void gps_update_quality(GPS_HandleTypeDef* gps, int fix_type, int satellites, float hdop);
 
 extern UART_HandleTypeDef huart3;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel0;
 
 
 // === PRIVATE DEFINES ===
-#define NMEA_START_CHAR '$'
-#define NMEA_END_CHAR   '\r'
-#define NMEA_MAX_SIZE   (82)
-
-#define GPS_BUFFER_SIZE (NMEA_MAX_SIZE + 1)
 #define GPS_BUFFER_COUNT (256)
 
 #define GPS_BUFFER_VALID_START (1 << 0)
 
 // === PRIVATE TYPEDEFS ===
-typedef struct {
-	size_t length;
-	uint8_t sentence[GPS_BUFFER_SIZE];
-}NmeaString;
-
-
 typedef struct {
     uint8_t some;
     size_t value;
 } Option_size_t;
 
+//Signal of a single satellite, from GSV
+typedef struct {
+	char talker;	//second character of the talker id (P: GPS, L: GLONASS, A: Galileo, B: BeiDou, ...)
+	uint8_t nr;
+	uint8_t cno;	//dB-Hz, 0 if not tracked
+	uint32_t tick;	//HAL tick when last reported
+}SatelliteSignal;
+
 
 // === PRIVATE VARIABLES ===
 TX_EVENT_FLAGS_GROUP gpsBuffer_event_flags_group;
- NmeaString gps_buffer[GPS_BUFFER_COUNT] = {};
-volatile size_t gpsBuffer_write_index = 0;
+ GPS_Sentence gps_buffer[GPS_BUFFER_COUNT] = {};
 size_t gpsBuffer_read_index = 0;
+static size_t gpsBuffer_parse_index = 0; //next sentence for read_gps_data(), trails gpsBuffer_read_index
 volatile Option_size_t gpsBuffer_newest_index = {.some = 0};
-volatile uint8_t found_start = 0;
 static int rx_buffer_index= 0;
-static int partial = 0;
+static GpsFramer gps_framer = {.ring = gps_buffer, .ring_count = GPS_BUFFER_COUNT};
+
+//DMA callback statistics
+static uint32_t gps_callbacks = 0;
+static uint32_t gps_callback_max_cycles = 0;
+static uint32_t gps_callback_total_cycles = 0;
+static uint32_t gps_ring_overruns = 0;
+
+//power management
+static GPS_PowerState gps_power_state = GPS_POWER_OFF;
+static GPS_WakeType gps_wake_type = GPS_WAKE_COLD;
+static GPS_PowerStats gps_power_stats[GPS_NUM_WAKE_TYPES] = {};
+static uint32_t gps_power_transition_tick = 0; //HAL tick of the last wake or sleep
+static bool gps_awaiting_first_fix = false;
+static bool gps_has_had_fix = false;
+static uint32_t gps_last_fix_tick = 0;
+static uint32_t gps_power_state_ms[GPS_NUM_POWER_STATES] = {};
+static uint32_t gps_power_state_tick = 0; //HAL tick of the last power state change
+static volatile bool gps_continuous = false;
+
+//satellite signals from GSV
+static SatelliteSignal satellite_signals[GPS_SATELLITE_TABLE_SIZE] = {};
 
 // === PRIVATE METHODS ===
+//Feeds received bytes into the framer, counting sentences written over before the buffer thread released them
+static size_t gps_ingest(const uint8_t *data, size_t length) {
+	size_t used = (gps_framer.write_index + GPS_BUFFER_COUNT - gpsBuffer_read_index) % GPS_BUFFER_COUNT;
+	size_t sentences = gps_framer_feed(&gps_framer, data, length, time_monotonic_ms());
 
-// === PUBLIC METHODS ===
-uint8_t rx_buffer[2][16*NMEA_MAX_SIZE];
-void GPS_RxCpltCallback(struct __UART_HandleTypeDef *huart) {
-	int nmea_start = -1;
-	int new = 0;
-	for (int i = 0; i < 16*NMEA_MAX_SIZE; i++){
-		//find sentence start
-		switch(rx_buffer[rx_buffer_index][i]) {
-			case NMEA_START_CHAR:
-				nmea_start = i;
-				break;
-
-			case '\n': /* fallthrough */
-			case '\r':
-
-				if ((partial == 0) && (nmea_start == -1))
-					break; //sentence end with no start if you reach here
-
-				if (partial != 0) {
-					gps_buffer[gpsBuffer_write_index].length = (partial + i);
-					memcpy(&gps_buffer[gpsBuffer_write_index].sentence[partial], &rx_buffer[rx_buffer_index][0], i);
-				} else {
-					gps_buffer[gpsBuffer_write_index].length = ((i) - nmea_start);
-					memcpy(&gps_buffer[gpsBuffer_write_index].sentence[0], &rx_buffer[rx_buffer_index][nmea_start], gps_buffer[gpsBuffer_write_index].length);
+	if ((used + sentences) >= GPS_BUFFER_COUNT) {
+		gps_ring_overruns += (used + sentences) - (GPS_BUFFER_COUNT - 1);
+	}
+	return sentences;
+}
 
-				}
-				gps_buffer[gpsBuffer_write_index].sentence[gps_buffer[gpsBuffer_write_index].length] = '\0';
-				gpsBuffer_write_index = (gpsBuffer_write_index + 1) % GPS_BUFFER_COUNT;
-				new = 1;
-				nmea_start = -1;
-				partial = 0;
-				break;
-
-			default:
-				break;
-		}
+//Points the MCU side of the GPS UART at a new baud rate. Reception continues on the running DMA transfer.
+static void gps_set_uart_baud(uint32_t baud_rate) {
+	__HAL_UART_DISABLE(&huart3);
+	huart3.Init.BaudRate = baud_rate;
+	huart3.Instance->BRR = UART_DIV_SAMPLING16(HAL_RCC_GetPCLK1Freq(), baud_rate, huart3.Init.ClockPrescaler);
+	__HAL_UART_ENABLE(&huart3);
+}
+
+static HAL_StatusTypeDef gps_send_ubx(const uint8_t *frame, size_t frame_length) {
+	if (frame_length == 0) {
+		return HAL_ERROR; //frame failed to build
 	}
-	//(nmea_start == -1) => no start found //flush entire buffer
-	//(nmea_start == 0) => sentence too long //flush entire buffer
-	if (nmea_start > 0) {
-		partial = 16*NMEA_MAX_SIZE - nmea_start;
-		memcpy(&gps_buffer[gpsBuffer_write_index].sentence[0], &rx_buffer[rx_buffer_index][nmea_start], partial);
+	return HAL_UART_Transmit(&huart3, frame, frame_length, GPS_UART_TIMEOUT);
+}
+
+/*
+ * Configures the receiver over UBX-CFG-VALSET:
+ *  - enables UBX-NAV-PVT (time, fix, position, velocity and accuracy in a single message)
+ *  - disables the NMEA sentences we don't use (RMC and GGA are kept so the Pi can keep logging NMEA, GSV for satellite signals)
+ *  - sets the navigation rate
+ *  - raises the UART baud rate
+ * Only the RAM layer is written, so the configuration is reapplied on every power up.
+ */
+static HAL_StatusTypeDef gps_configure(void) {
+	uint8_t frame[128];
+	size_t frame_length;
+
+	const UbxConfigItem output_config[] = {
+		{.key = UBX_CFG_UART1OUTPROT_UBX,         .value = 1},
+		{.key = UBX_CFG_UART1OUTPROT_NMEA,        .value = 1},
+		{.key = UBX_CFG_MSGOUT_UBX_NAV_PVT_UART1, .value = 1},
+		{.key = UBX_CFG_MSGOUT_NMEA_RMC_UART1,    .value = 1},
+		{.key = UBX_CFG_MSGOUT_NMEA_GGA_UART1,    .value = 1},
+		{.key = UBX_CFG_MSGOUT_NMEA_GLL_UART1,    .value = 0},
+		{.key = UBX_CFG_MSGOUT_NMEA_GSA_UART1,    .value = 0},
+		{.key = UBX_CFG_MSGOUT_NMEA_GSV_UART1,    .value = 1}, //satellite C/N0 for the acquisition policy
+		{.key = UBX_CFG_MSGOUT_NMEA_VTG_UART1,    .value = 0},
+		{.key = UBX_CFG_RATE_MEAS,                .value = GPS_NAV_RATE_MS},
+		{.key = UBX_CFG_RATE_NAV,                 .value = 1},
+	};
+	frame_length = ubx_build_valset(frame, sizeof(frame), UBX_CFG_LAYER_RAM, output_config, sizeof(output_config)/sizeof(output_config[0]));
+	HAL_RESULT_PROPAGATE(gps_send_ubx(frame, frame_length));
+
+	//Baud rate is changed in its own message, the receiver switches as soon as it is applied.
+	const UbxConfigItem baud_config[] = {
+		{.key = UBX_CFG_UART1_BAUDRATE, .value = GPS_BAUD_RATE},
+	};
+	frame_length = ubx_build_valset(frame, sizeof(frame), UBX_CFG_LAYER_RAM, baud_config, 1);
+	HAL_RESULT_PROPAGATE(gps_send_ubx(frame, frame_length));
+
+	tx_thread_sleep(tx_ms_to_ticks(GPS_BAUD_SETTLE_TIME_MS));
+	gps_set_uart_baud(GPS_BAUD_RATE);
+	return HAL_OK;
+}
+
+//Adds the estimated energy of spending elapsed_ms at current_uA to the stats of the current wake cycle
+static void gps_power_account(GPS_WakeType wake_type, uint32_t elapsed_ms, uint32_t current_uA) {
+	//uA * mV * ms = 1e-12 J
+	gps_power_stats[wake_type].energy_mJ += (uint32_t)(((uint64_t)elapsed_ms * current_uA * GPS_SUPPLY_MV) / 1000000000ULL);
+}
+
+//Records the time to first fix for the current wake
+static void gps_power_record_fix(void) {
+	GPS_PowerStats *stats = &gps_power_stats[gps_wake_type];
+	uint32_t ttff_ms = HAL_GetTick() - gps_power_transition_tick;
+
+	stats->ttff_last_ms = ttff_ms;
+	stats->ttff_min_ms = ((stats->fixes == 0) || (ttff_ms < stats->ttff_min_ms)) ? ttff_ms : stats->ttff_min_ms;
+	stats->ttff_max_ms = (ttff_ms > stats->ttff_max_ms) ? ttff_ms : stats->ttff_max_ms;
+	stats->ttff_total_ms += ttff_ms;
+	stats->fixes++;
+
+	gps_awaiting_first_fix = false;
+	gps_has_had_fix = true;
+	gps_last_fix_tick = HAL_GetTick();
+}
+
+//Changes the power state, accounting for the time spent in the previous one
+static void gps_power_enter(GPS_PowerState new_state) {
+	uint32_t now = HAL_GetTick();
+	gps_power_state_ms[gps_power_state] += now - gps_power_state_tick;
+	gps_power_state_tick = now;
+	gps_power_state = new_state;
+	//USART3 stops in STOP2, sentences would be lost
+	low_power_veto(LOW_POWER_VETO_GPS_UART, new_state == GPS_POWER_ON);
+}
+
+//Leaves GPS_POWER_ON, accounting for the energy used since the receiver was woken
+static void gps_power_leave_on(GPS_PowerState new_state) {
+	uint32_t now = HAL_GetTick();
+	gps_power_account(gps_wake_type, now - gps_power_transition_tick, GPS_ACTIVE_CURRENT_UA);
+	gps_power_transition_tick = now;
+	gps_awaiting_first_fix = false;
+	gps_power_enter(new_state);
+}
+
+//Puts the receiver in software standby (backup). Ephemeris, almanac and time are kept for a hot start on wake.
+static HAL_StatusTypeDef gps_standby(void) {
+	uint8_t frame[UBX_RXM_PMREQ_PAYLOAD_LENGTH + UBX_FRAME_OVERHEAD];
+	size_t frame_length = ubx_build_pmreq(frame, sizeof(frame), 0,
+			UBX_RXM_PMREQ_FLAGS_BACKUP | UBX_RXM_PMREQ_FLAGS_FORCE,
+			UBX_RXM_PMREQ_WAKEUP_UARTRX);
+
+	HAL_RESULT_PROPAGATE(gps_send_ubx(frame, frame_length));
+	HAL_UART_DMAStop(&huart3);
+	gps_power_leave_on(GPS_POWER_STANDBY);
+	return HAL_OK;
+}
+
+// === PUBLIC METHODS ===
+uint8_t rx_buffer[2][GPS_RX_BUFFER_SIZE];
+void GPS_RxCpltCallback(struct __UART_HandleTypeDef *huart) {
+	uint32_t start_cycles = DWT->CYCCNT;
+	size_t new = 0;
+	//during a replay the framer is fed with the recording only
+	if (!gps_replay_is_active()) {
+		new = gps_ingest(rx_buffer[rx_buffer_index], GPS_RX_BUFFER_SIZE);
 	}
 
 	if(new){
@@ -112,19 +218,56 @@ void GPS_RxCpltCallback(struct __UART_HandleTypeDef *huart) {
 
 	//swap buffers
 	rx_buffer_index ^= 1 ;
+
+	uint32_t cycles = DWT->CYCCNT - start_cycles;
+	gps_callbacks++;
+	gps_callback_total_cycles += cycles;
+	gps_callback_max_cycles = (cycles > gps_callback_max_cycles) ? cycles : gps_callback_max_cycles;
+}
+
+size_t gps_feed(const uint8_t *data, size_t length) {
+	size_t sentences = gps_ingest(data, length);
+
+	if(sentences != 0){
+		tx_event_flags_set(&gpsBuffer_event_flags_group, GPS_BUFFER_VALID_START, TX_OR);
+	}
+	return sentences;
+}
+
+void gps_feed_reset(void) {
+	gps_framer_reset(&gps_framer);
+}
+
+void gpsBuffer_notify(void) {
+	tx_event_flags_set(&gpsBuffer_event_flags_group, GPS_BUFFER_VALID_START, TX_OR);
+}
+
+void gpsBuffer_release(void) {
+	while(gpsBuffer_read_index != gps_framer.write_index){
+		GPS_Sentence *read_sentence = &gps_buffer[gpsBuffer_read_index];
+		//the Pi already has the replayed recording
+		if (!gps_replay_is_active()) {
+			pi_gps_forward_sentence(read_sentence);
+		}
+		gpsBuffer_newest_index.value = gpsBuffer_read_index;
+		gpsBuffer_newest_index.some = 1;
+
+		gpsBuffer_read_index = (gpsBuffer_read_index + 1) % GPS_BUFFER_COUNT;
+	}
+	pi_gps_forward_flush();
 }
 
 /**
  * @brief Returns the latest raw gps message pointer if it exists, otherwise returns NULL ptr;
  * 
- * @return const uint8_t* 
+ * @return const GPS_Sentence* 
  */
-const uint8_t * gpsBuffer_pop_latest(void) {
+const GPS_Sentence * gpsBuffer_pop_latest(void) {
     //check if new messages
     if (!gpsBuffer_newest_index.some)
         return NULL;
 
-    const uint8_t *msg_ptr = gps_buffer[gpsBuffer_newest_index.value].sentence;
+    const GPS_Sentence *msg_ptr = &gps_buffer[gpsBuffer_newest_index.value];
     gpsBuffer_newest_index.some = 0; //make newest index as old
     return msg_ptr;
 }
@@ -144,19 +287,29 @@ void gpsBuffer_thread(ULONG thread_input) {
 	HAL_UART_RegisterCallback(&huart3, HAL_UART_RX_HALFCOMPLETE_CB_ID, GPS_RxCpltCallback);
 	HAL_UART_Receive_DMA(&huart3, &rx_buffer[0][0], sizeof(rx_buffer));
 
+	ULONG wait_ticks = TX_WAIT_FOREVER;
 	while(1) {
-        //wait for gps message start
+        //wait for gps message start (or the next replay chunk)
         ULONG actual_flags = 0;
 
-        tx_event_flags_get(&gpsBuffer_event_flags_group, GPS_BUFFER_VALID_START, TX_OR_CLEAR, &actual_flags, TX_WAIT_FOREVER);
+        tx_event_flags_get(&gpsBuffer_event_flags_group, GPS_BUFFER_VALID_START, TX_OR_CLEAR, &actual_flags, wait_ticks);
+
+        //feed the replay chunks that are due
+        uint_fast8_t replayed_chunks;
+        uint32_t replay_wait_ms = gps_replay_service(&replayed_chunks);
+        if (replay_wait_ms == GPS_REPLAY_NO_CHUNK) {
+        	wait_ticks = TX_WAIT_FOREVER;
+        } else {
+        	replay_wait_ms = (replay_wait_ms < 1000) ? replay_wait_ms : 1000;
+        	wait_ticks = (tx_ms_to_ticks(replay_wait_ms) > 0) ? tx_ms_to_ticks(replay_wait_ms) : 1;
+        }
+
         // process new messages
-		while(gpsBuffer_read_index != gpsBuffer_write_index){
-			NmeaString *read_sentence = &gps_buffer[gpsBuffer_read_index];
-			pi_comms_tx_forward_gps(read_sentence->sentence, read_sentence->length);
-			gpsBuffer_newest_index.value = gpsBuffer_read_index;
-			gpsBuffer_newest_index.some = 1;
+		gpsBuffer_release();
 
-			gpsBuffer_read_index = (gpsBuffer_read_index + 1) % GPS_BUFFER_COUNT;
+		//acknowledge the fed chunks, each frees a slot for the Pi
+		for (uint_fast8_t i = 0; i < replayed_chunks; i++) {
+			pi_comms_tx_gps_replay_ack(PI_COMM_MSG_GPS_REPLAY_DATA, GPS_REPLAY_OK);
 		}
 	}
 #else
@@ -164,9 +317,9 @@ void gpsBuffer_thread(ULONG thread_input) {
 	static uint32_t packet_index = 0;
     while(1){
         //create fake message to be buffered and logged
-		snprintf((char *)gps_buffer[gpsBuffer_write_index], GPS_BUFFER_SIZE, "%08lxh\r\n", packet_index);
-		pi_comms_tx_forward_gps(gps_buffer[gpsBuffer_write_index], 12);
-		gpsBuffer_write_index = (gpsBuffer_write_index + 1) % GPS_BUFFER_COUNT;
+		snprintf((char *)gps_buffer[gps_framer.write_index].sentence, GPS_SENTENCE_BUFFER_SIZE, "%08lxh\r\n", packet_index);
+		pi_comms_tx_send(PI_COMMS_TX_PRIORITY_STREAM, PI_COMM_MSG_GPS_PACKET, gps_buffer[gps_framer.write_index].sentence, 12);
+		gps_framer.write_index = (gps_framer.write_index + 1) % GPS_BUFFER_COUNT;
 		packet_index++;
 		tx_thread_sleep(tx_s_to_ticks(1));
     }
@@ -176,44 +329,183 @@ void gpsBuffer_thread(ULONG thread_input) {
 HAL_StatusTypeDef initialize_gps(UART_HandleTypeDef* huart, GPS_HandleTypeDef* gps){
 
 	gps->huart = huart;
+	gps->is_pos_locked = false;
+	memset(gps->data, 0, sizeof(gps->data));
+	memset(&gps->fix, 0, sizeof(gps->fix));
+	memset(&gps->fix_quality, 0, sizeof(gps->fix_quality));
+	gps_acq_init(&gps->acquisition);
+	gps->acquisition_result = GPS_ACQ_CONTINUE;
 
-	//TODO: Other initialization like configuring GPS output types or other parameter setting.
+	//Receiver output types, rate and baud are configured on every gps_wake(), since they are lost at power off.
 	return HAL_OK;
 }
 
 
 bool read_gps_data(GPS_HandleTypeDef* gps){
-#if GPS_SIMULATION
-		gps->data[GPS_SIM] = (GPS_Data){
-			.is_valid_data = true,
-			.latitude = GPS_SIM_LAT,
-			.longitude = GPS_SIM_LON,
-			.is_dominica = is_in_dominica(GPS_SIM_LAT, GPS_SIM_LON),
-		};
+	//parse every sentence that the buffer thread has released since the last call, so that no quality update is missed
+	if (gpsBuffer_parse_index == gpsBuffer_read_index) {
+		return false;
+	}
 
-		gps->is_pos_locked = true;
+	uint32_t start_cycles = DWT->CYCCNT;
+	uint32_t parsed = 0;
+	while (gpsBuffer_parse_index != gpsBuffer_read_index) {
+		const GPS_Sentence *message = &gps_buffer[gpsBuffer_parse_index];
+		if (message->type == GPS_SENTENCE_UBX) {
+			parse_ubx_output(gps, message->sentence, message->length, message->rx_tick);
+		} else {
+			parse_gps_output(gps, (const char *)message->sentence, message->length, message->rx_tick);
+		}
+		gpsBuffer_parse_index = (gpsBuffer_parse_index + 1) % GPS_BUFFER_COUNT;
+		parsed++;
+	}
 
-		return true;
-#else
-	//check if there is a new packet
-	const uint8_t *latest_message = gpsBuffer_pop_latest();
-	if (latest_message == NULL) {
-		return false;
+	if (gps_replay_is_active()) {
+		gps_replay_account_parse(parsed, DWT->CYCCNT - start_cycles);
 	}
-	size_t msg_len = strlen((const char *)latest_message);
 
-	//parse packet if it exists
-	parse_gps_output(gps, (const char *)latest_message, msg_len);
+	if (gps->is_pos_locked && gps_awaiting_first_fix) {
+		gps_power_record_fix();
+	}
 
 	return true;
+}
 
-#endif
+//Returns true if the time of day in new_timestamp is before old_timestamp (within half a day, to handle midnight)
+static bool gps_timestamp_is_older(const uint16_t *new_timestamp, const uint16_t *old_timestamp){
+	int32_t new_s = new_timestamp[0] * 3600 + new_timestamp[1] * 60 + new_timestamp[2];
+	int32_t old_s = old_timestamp[0] * 3600 + old_timestamp[1] * 60 + old_timestamp[2];
+	int32_t diff = new_s - old_s;
+
+	if (diff > 12 * 3600) {
+		diff -= 24 * 3600;
+	} else if (diff < -12 * 3600) {
+		diff += 24 * 3600;
+	}
+	return (diff < 0);
 }
 
-#if GPS_SIMULATION
-__attribute__((unused))
-#endif
-static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t buffer_length){
+//Takes the position and time of a freshly parsed (valid) message into the fused fix
+static void gps_fuse_position(GPS_HandleTypeDef* gps, GPS_MsgTypes msg_type, const uint16_t *timestamp){
+	uint32_t now = HAL_GetTick();
+	uint16_t held_timestamp[3];
+	memcpy(held_timestamp, gps->fix.timestamp, sizeof(held_timestamp)); //GPS_Data is packed
+
+	//a sentence reporting an older epoch than the fix we already hold (e.g. a late GLL) is not fresher
+	if (gps->fix.is_valid_data
+			&& ((now - gps->fix_tick) < GPS_FUSION_WINDOW_MS)
+			&& gps_timestamp_is_older(timestamp, held_timestamp)) {
+		return;
+	}
+
+	gps->fix.latitude = gps->data[msg_type].latitude;
+	gps->fix.longitude = gps->data[msg_type].longitude;
+	gps->fix.is_dominica = gps->data[msg_type].is_dominica;
+	gps->fix.is_valid_data = true;
+	gps->fix.msg_type = msg_type;
+	memcpy(gps->fix.timestamp, timestamp, sizeof(gps->fix.timestamp));
+	gps->fix_tick = now;
+	gps->fix_timestamp = time_now();
+}
+
+//Updates the fix quality. Negative values leave the corresponding field untouched.
+static void gps_update_quality(GPS_HandleTypeDef* gps, int fix_type, int satellites, float hdop){
+	uint32_t now = HAL_GetTick();
+
+	if (fix_type >= 0) {
+		gps->fix_quality.fix_type = fix_type;
+		gps->fix_quality.fix_type_tick = now;
+	}
+
+	if (satellites >= 0) {
+		gps->fix_quality.satellites = satellites;
+		gps->fix_quality.satellites_tick = now;
+	}
+
+	if (!isnan(hdop) && (hdop >= 0)) {
+		gps->fix_quality.hdop = hdop;
+		gps->fix_quality.hdop_tick = now;
+	}
+}
+
+bool gps_fix_passes_gate(const GPS_HandleTypeDef* gps, const GpsFixGate *gate){
+	uint32_t now = HAL_GetTick();
+	const GPS_FixQuality *quality = &gps->fix_quality;
+
+	return gps->fix.is_valid_data
+			&& ((now - gps->fix_tick) <= gate->max_age_ms)
+			&& ((now - quality->fix_type_tick) <= gate->max_age_ms)
+			&& ((now - quality->satellites_tick) <= gate->max_age_ms)
+			&& ((now - quality->hdop_tick) <= gate->max_age_ms)
+			&& (quality->fix_type >= gate->min_fix_type)
+			&& (quality->fix_type != UBX_FIX_TIME_ONLY)
+			&& (quality->satellites >= gate->min_satellites)
+			&& (quality->hdop <= gate->max_hdop);
+}
+
+//Records the C/N0 of a satellite from GSV, replacing the oldest entry if the satellite is new
+static void gps_update_satellite(char talker, int nr, int cno){
+	uint32_t now = HAL_GetTick();
+	SatelliteSignal *slot = &satellite_signals[0];
+
+	for (size_t i = 0; i < GPS_SATELLITE_TABLE_SIZE; i++){
+		SatelliteSignal *entry = &satellite_signals[i];
+		if ((entry->talker == talker) && (entry->nr == nr)){
+			slot = entry;
+			break;
+		}
+		if ((now - entry->tick) > (now - slot->tick)){
+			slot = entry;
+		}
+	}
+
+	slot->talker = talker;
+	slot->nr = nr;
+	slot->cno = (cno > 0) ? cno : 0;
+	slot->tick = now;
+}
+
+void gps_get_signal_summary(GpsSignalSummary *summary){
+	uint32_t now = HAL_GetTick();
+	*summary = (GpsSignalSummary){0};
+
+	for (size_t i = 0; i < GPS_SATELLITE_TABLE_SIZE; i++){
+		const SatelliteSignal *entry = &satellite_signals[i];
+		if ((entry->nr == 0) || ((now - entry->tick) > GPS_SATELLITE_MAX_AGE_MS)){
+			continue;
+		}
+
+		summary->satellites_in_view++;
+		if (entry->cno >= GPS_ACQ_MIN_CNO){
+			summary->satellites_with_signal++;
+		}
+		if (entry->cno > summary->max_cno){
+			summary->max_cno = entry->cno;
+		}
+	}
+}
+
+//Syncs the time service to a validated NMEA date and time
+static void gps_sync_time(const struct minmea_date *date, const struct minmea_time *time, uint32_t rx_tick){
+	if (gps_replay_is_active()) {
+		return; //recorded time
+	}
+	if ((date->year < 0) || (date->month < 1) || (date->day < 1) || (time->hours < 0)) {
+		return; //fields empty
+	}
+
+	TimeDate utc = {
+		.year = (date->year < 100) ? (2000 + date->year) : date->year,
+		.month = date->month,
+		.day = date->day,
+		.hour = time->hours,
+		.minute = time->minutes,
+		.second = time->seconds,
+	};
+	time_set_utc(time_utc_from_date(&utc), time->microseconds / 1000, rx_tick, TIME_SOURCE_GPS);
+}
+
+static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t buffer_length, uint32_t rx_tick){
 
 	enum minmea_sentence_id sentence_id = minmea_sentence_id((const char *)buffer, false);
 
@@ -231,7 +523,7 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 			lon = minmea_tocoord(&frame.longitude);
 
 			//Ensure the data is valid or not.
-			if (isnan(lat) || isnan(lon)){
+			if (isnan(lat) || isnan(lon) || !frame.valid){
 
 				//data invalid, set the default values and indicate invalid data
 				gps->data[GPS_RMC].latitude = DEFAULT_LAT;
@@ -250,6 +542,12 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 				//save the time data into our struct.
 				uint16_t time_temp[3] = {frame.time.hours, frame.time.minutes, frame.time.seconds};
 				memcpy(gps->data[GPS_RMC].timestamp, time_temp, 6);
+				gps_fuse_position(gps, GPS_RMC, time_temp);
+			}
+
+			//time is only trusted with a valid status
+			if (frame.valid){
+				gps_sync_time(&frame.date, &frame.time, rx_tick);
 			}
 		}
 
@@ -264,7 +562,7 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 			lon = minmea_tocoord(&frame.longitude);
 
 			//Ensure the data is valid or not.
-			if (isnan(lat) || isnan(lon)){
+			if (isnan(lat) || isnan(lon) || (frame.status != MINMEA_GLL_STATUS_DATA_VALID)){
 
 				//data invalid, set the default values and indicate invalid data
 				gps->data[GPS_GLL].latitude = DEFAULT_LAT;
@@ -283,6 +581,7 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 				//save the time data into our struct.
 				uint16_t time_temp[3] = {frame.time.hours, frame.time.minutes, frame.time.seconds};
 				memcpy(gps->data[GPS_GLL].timestamp, time_temp, 6);
+				gps_fuse_position(gps, GPS_GLL, time_temp);
 			}
 		}
 
@@ -295,8 +594,14 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 			lat = minmea_tocoord(&frame.latitude);
 			lon = minmea_tocoord(&frame.longitude);
 
+			//GGA carries the satellites used and HDOP. Fix quality 0 means no fix, the fix dimension comes from GSA/NAV-PVT.
+			bool has_fix = (frame.fix_quality != 0);
+			int fix_type = !has_fix ? UBX_FIX_NONE
+					: (gps->fix_quality.fix_type == UBX_FIX_NONE) ? UBX_FIX_2D : -1;
+			gps_update_quality(gps, fix_type, frame.satellites_tracked, minmea_tofloat(&frame.hdop));
+
 			//Ensure the data is valid or not.
-			if (isnan(lat) || isnan(lon)){
+			if (isnan(lat) || isnan(lon) || !has_fix){
 
 				//data invalid, set the default values and indicate invalid data
 				gps->data[GPS_GGA].latitude = DEFAULT_LAT;
@@ -315,51 +620,133 @@ static void parse_gps_output(GPS_HandleTypeDef* gps, const char* buffer, uint8_t
 				//save the time data into our struct.
 				uint16_t time_temp[3] = {frame.time.hours, frame.time.minutes, frame.time.seconds};
 				memcpy(gps->data[GPS_GGA].timestamp, time_temp, 6);
+				gps_fuse_position(gps, GPS_GGA, time_temp);
+			}
+		}
+
+		break;
+	}
+	case MINMEA_SENTENCE_GSV: {
+		struct minmea_sentence_gsv frame;
+		char talker[3];
+		if (minmea_parse_gsv(&frame, (const char *)buffer) && minmea_talker_id(talker, (const char *)buffer)){
+			for (int i = 0; i < 4; i++){
+				if (frame.sats[i].nr != 0){
+					gps_update_satellite(talker[1], frame.sats[i].nr, frame.sats[i].snr);
+				}
 			}
 		}
 
 		break;
 	}
+	case MINMEA_SENTENCE_GSA: {
+		struct minmea_sentence_gsa frame;
+		if (minmea_parse_gsa(&frame, (const char *)buffer)){
+			//GSA fix type: 1 = none, 2 = 2D, 3 = 3D
+			int fix_type = (frame.fix_type >= 2) ? frame.fix_type : UBX_FIX_NONE;
+			gps_update_quality(gps, fix_type, -1, minmea_tofloat(&frame.hdop));
+		}
+
+		break;
+	}
+	case MINMEA_SENTENCE_ZDA: {
+		struct minmea_sentence_zda frame;
+		if (minmea_parse_zda(&frame, (const char *)buffer)){
+			gps_sync_time(&frame.date, &frame.time, rx_tick);
+		}
+
+		break;
+	}
 	default:
 
 		break;
 	}
 }
 
-bool get_gps_lock(GPS_HandleTypeDef* gps, GPS_Data* gps_data){
+static void parse_ubx_output(GPS_HandleTypeDef* gps, const uint8_t* frame, size_t frame_length, uint32_t rx_tick){
+	UbxNavPvt pvt;
 
-	gps->is_pos_locked = false;
+	//NAV-PVT is the only UBX message used for positioning
+	if (!ubx_decode_nav_pvt(frame, frame_length, &pvt)){
+		return;
+	}
 
-	//ensure all valid data flags are false
-	for (GPS_MsgTypes msg_type = GPS_SIM; msg_type < GPS_NUM_MSG_TYPES; msg_type++){
-		gps->data[msg_type].is_valid_data = false;
+	//time is usable without a position fix once date and time are fully resolved
+	const uint8_t time_valid = UBX_NAV_PVT_VALID_DATE | UBX_NAV_PVT_VALID_TIME | UBX_NAV_PVT_VALID_FULLY_RESOLVED;
+	if (((pvt.valid & time_valid) == time_valid) && (pvt.nano >= 0) && !gps_replay_is_active()){
+		TimeDate utc = {
+			.year = pvt.year,
+			.month = pvt.month,
+			.day = pvt.day,
+			.hour = pvt.hour,
+			.minute = pvt.min,
+			.second = pvt.sec,
+		};
+		time_set_utc(time_utc_from_date(&utc), pvt.nano / 1000000, rx_tick, TIME_SOURCE_GPS);
 	}
 
-	//time trackers for any possible timeouts
-	uint32_t start_time = HAL_GetTick();
-	uint32_t current_time = start_time;
+	bool has_fix = (pvt.flags & UBX_NAV_PVT_FLAGS_GNSS_FIX_OK)
+			&& (pvt.fixType >= UBX_FIX_2D)
+			&& (pvt.fixType <= UBX_FIX_GNSS_DEAD_RECKONING);
 
-	//Keep trying to read the GPS data until we get a lock, or we timeout
-	while (!gps->is_pos_locked && ((current_time - start_time) < GPS_TRY_LOCK_TIMEOUT)){
-		read_gps_data(gps);
-		current_time = HAL_GetTick();
+	//NAV-PVT has no HDOP, it is left to GGA/GSA
+	gps_update_quality(gps, has_fix ? pvt.fixType : UBX_FIX_NONE, pvt.numSV, NAN);
+
+	if (!has_fix){
+		//data invalid, set the default values and indicate invalid data
+		gps->data[GPS_PVT].latitude = DEFAULT_LAT;
+		gps->data[GPS_PVT].longitude = DEFAULT_LON;
+		gps->data[GPS_PVT].is_valid_data = false;
+		return;
 	}
 
-	//Populate the GPS data struct that we are officially returning to the caller. Prioritize message types in the order they appear in the enum definiton
-	for (GPS_MsgTypes msg_type = GPS_SIM; msg_type < GPS_NUM_MSG_TYPES; msg_type++){
-		if (gps->data[msg_type].is_valid_data){
+	float lat = pvt.lat * 1e-7f;
+	float lon = pvt.lon * 1e-7f;
+
+	//data is valid, save the latitude and longitude + valid data flags
+	gps->data[GPS_PVT].latitude = lat;
+	gps->data[GPS_PVT].longitude = lon;
+	gps->data[GPS_PVT].is_valid_data = true;
+	gps->data[GPS_PVT].is_dominica = is_in_dominica(lat, lon);
+	gps->is_pos_locked = true;
+
+	//save the time data into our struct.
+	uint16_t time_temp[3] = {pvt.hour, pvt.min, pvt.sec};
+	memcpy(gps->data[GPS_PVT].timestamp, time_temp, 6);
+	gps_fuse_position(gps, GPS_PVT, time_temp);
+}
+
+bool get_gps_lock(GPS_HandleTypeDef* gps, GPS_Data* gps_data, const GpsFixGate *gate){
 
-			//Set the message type
-			gps->data[msg_type].msg_type = msg_type;
+	gps->is_pos_locked = false;
 
-			//Copy into the struct that returns back to the user
-			memcpy(gps_data, &gps->data[msg_type], sizeof(GPS_Data));
+	GpsAcqAttempt attempt;
+	GpsSignalSummary signal;
+	GpsAcqResult result = GPS_ACQ_CONTINUE;
 
-			return true;
+	//Keep trying to read the GPS data until the fused fix passes the gate, or the acquisition policy gives up
+	gps_acq_start(&gps->acquisition, &attempt, HAL_GetTick());
+	while (result == GPS_ACQ_CONTINUE){
+		if (!read_gps_data(gps)){
+			tx_thread_sleep(tx_ms_to_ticks(GPS_POLL_PERIOD_MS));
 		}
+		gps_get_signal_summary(&signal);
+		result = gps_acq_update(&attempt, HAL_GetTick(), gps_fix_passes_gate(gps, gate), &signal);
 	}
+	gps_acq_finish(&gps->acquisition, &attempt, result, HAL_GetTick());
+	gps->acquisition_result = result;
+	gps->acquisition_timestamp = time_now();
 
-	return false;
+	if (result != GPS_ACQ_SUCCESS){
+		return false;
+	}
+
+	//Copy the fused fix into the struct that returns back to the user
+	gps->fix.quality = GPS_QUALITY_PACK(gps->fix_quality.fix_type, gps->fix_quality.satellites,
+			(gps->fix_quality.hdop * 10 < 0xFFFF) ? (uint32_t)(gps->fix_quality.hdop * 10) : 0xFFFF);
+	memcpy(gps_data, &gps->fix, sizeof(GPS_Data));
+
+	return true;
 }
 
 bool is_in_dominica(float latitude, float longitude){
@@ -370,22 +757,155 @@ bool is_in_dominica(float latitude, float longitude){
 //External variables defined in other C files (uart handler and queue for comms threads)
 
 
-//Turn GPS off (through power FET) and starts buffering thread
+//Turn GPS off (through power FET). The next wake is a cold start.
 void gps_sleep(void){
+	if (gps_replay_is_active()) {
+		return; //receiver is already off
+	}
+
 	HAL_GPIO_WritePin(GPS_NEN_GPIO_Port, GPS_NEN_Pin, GPIO_PIN_SET);
 	HAL_UART_DMAStop(&huart3);
+
+	switch (gps_power_state) {
+		case GPS_POWER_ON:
+			gps_power_leave_on(GPS_POWER_OFF);
+			break;
+
+		case GPS_POWER_STANDBY:
+			//standby time is charged to the hot wake it was meant for
+			gps_power_account(GPS_WAKE_HOT, HAL_GetTick() - gps_power_transition_tick, GPS_STANDBY_CURRENT_UA);
+			gps_power_enter(GPS_POWER_OFF);
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * Turns the GPS off until the next gps_wake(), expecting to be off for expected_off_s seconds.
+ *
+ * Short off periods keep the receiver in software standby so the next wake is a hot start (~1 s TTFF at a
+ * fraction of the acquisition energy). The receiver is powered off completely if its last fix will be older than
+ * GPS_HOT_STANDBY_MAX_OFF_S by the next wake, or if it never had a fix (nothing worth keeping).
+ * In continuous mode the receiver is left on.
+ */
+void gps_sleep_for(uint32_t expected_off_s){
+	if (gps_continuous || gps_replay_is_active()) {
+		return;
+	}
+
+	uint32_t fix_age_s = (HAL_GetTick() - gps_last_fix_tick) / 1000;
+	bool use_standby = (gps_power_state == GPS_POWER_ON)
+			&& gps_has_had_fix
+			&& (fix_age_s + expected_off_s <= GPS_HOT_STANDBY_MAX_OFF_S);
+
+	if (use_standby && (gps_standby() == HAL_OK)) {
+		return;
+	}
+
+	gps_sleep();
 }
 
 void gps_wake(void){
+	//during a replay the receiver stays off, the recording stands in for it
+	if ((gps_power_state == GPS_POWER_ON) || gps_replay_is_active()) {
+		return;
+	}
+
+	uint32_t now = HAL_GetTick();
+	gps_wake_type = (gps_power_state == GPS_POWER_STANDBY) ? GPS_WAKE_HOT : GPS_WAKE_COLD;
+	if (gps_wake_type == GPS_WAKE_HOT) {
+		gps_power_account(GPS_WAKE_HOT, now - gps_power_transition_tick, GPS_STANDBY_CURRENT_UA);
+	}
+	gps_power_stats[gps_wake_type].wakes++;
+	gps_power_transition_tick = now;
+	gps_awaiting_first_fix = true;
+	gps_power_enter(GPS_POWER_ON);
+
+	//receiver always boots at its default baud rate (configuration is only kept in its RAM layer)
+	gps_set_uart_baud(GPS_DEFAULT_BAUD_RATE);
+
     //initiate UART DMA
-	gpsBuffer_write_index = 0;
+	gps_framer_init(&gps_framer, gps_buffer, GPS_BUFFER_COUNT);
 	gpsBuffer_read_index = 0;
+	gpsBuffer_parse_index = 0;
 	rx_buffer_index= 0;
-	partial = 0;
 	HAL_UART_RegisterCallback(&huart3, HAL_UART_RX_COMPLETE_CB_ID, GPS_RxCpltCallback);
 	HAL_UART_RegisterCallback(&huart3, HAL_UART_RX_HALFCOMPLETE_CB_ID, GPS_RxCpltCallback);
 	HAL_UART_Receive_DMA(&huart3, &rx_buffer[0][0], sizeof(rx_buffer));
 
-	//Enable power to GPS module and starts buffering thread
-	HAL_GPIO_WritePin(GPS_NEN_GPIO_Port, GPS_NEN_Pin, GPIO_PIN_RESET);
+	if (gps_wake_type == GPS_WAKE_HOT) {
+		//activity on the receiver's RX line ends software standby
+		uint8_t wake_bytes[GPS_STANDBY_WAKE_BYTE_COUNT];
+		memset(wake_bytes, GPS_STANDBY_WAKE_BYTE, sizeof(wake_bytes));
+		HAL_UART_Transmit(&huart3, wake_bytes, sizeof(wake_bytes), GPS_UART_TIMEOUT);
+	} else {
+		//Enable power to GPS module
+		HAL_GPIO_WritePin(GPS_NEN_GPIO_Port, GPS_NEN_Pin, GPIO_PIN_RESET);
+	}
+
+	//switch the receiver over to UBX-NAV-PVT at the higher baud rate
+	tx_thread_sleep(tx_ms_to_ticks(GPS_BOOT_TIME_MS));
+	gps_configure();
+
+	//time + AssistNow data from the Pi, if available
+	gps_assist_inject(gps_send_ubx);
+}
+
+GPS_PowerState gps_get_power_state(void){
+	return gps_power_state;
+}
+
+const GPS_PowerStats * gps_get_power_stats(GPS_WakeType wake_type){
+	if (wake_type >= GPS_NUM_WAKE_TYPES) {
+		return NULL;
+	}
+	return &gps_power_stats[wake_type];
+}
+
+uint32_t gps_get_power_state_time_ms(GPS_PowerState power_state){
+	if (power_state >= GPS_NUM_POWER_STATES) {
+		return 0;
+	}
+
+	uint32_t time_ms = gps_power_state_ms[power_state];
+	if (power_state == gps_power_state) {
+		time_ms += HAL_GetTick() - gps_power_state_tick;
+	}
+	return time_ms;
+}
+
+uint32_t gps_get_wake_lead_ms(void){
+	if (gps_power_state == GPS_POWER_ON) {
+		return 0;
+	}
+
+	GPS_WakeType wake_type = (gps_power_state == GPS_POWER_STANDBY) ? GPS_WAKE_HOT : GPS_WAKE_COLD;
+	const GPS_PowerStats *stats = &gps_power_stats[wake_type];
+	uint32_t ttff_ms;
+	if (stats->fixes != 0) {
+		ttff_ms = stats->ttff_total_ms / stats->fixes;
+	} else {
+		ttff_ms = (wake_type == GPS_WAKE_HOT) ? GPS_DEFAULT_TTFF_HOT_MS : GPS_DEFAULT_TTFF_COLD_MS;
+	}
+	return GPS_BOOT_TIME_MS + ttff_ms;
+}
+
+void gps_set_continuous(bool continuous){
+	gps_continuous = continuous;
+}
+
+bool gps_is_continuous(void){
+	return gps_continuous;
+}
+
+GPS_IngestStats gps_get_ingest_stats(void){
+	return (GPS_IngestStats){
+		.framer = gps_framer.stats,
+		.callbacks = gps_callbacks,
+		.callback_max_cycles = gps_callback_max_cycles,
+		.callback_total_cycles = gps_callback_total_cycles,
+		.ring_overruns = gps_ring_overruns,
+	};
 }
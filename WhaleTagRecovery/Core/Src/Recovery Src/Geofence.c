@@ -0,0 +1,192 @@
+/*
+ * Geofence.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Polygon geofences with per-region APRS settings. See matching header file for more info.
+ */
+
+#include "Recovery Inc/Geofence.h"
+#include "Recovery Inc/AprsPacket.h"
+#include "Lib Inc/config_store.h"
+#include "tx_api.h"
+#include <stddef.h>
+#include <string.h>
+
+// === PRIVATE TYPEDEFS ===
+//Stored form of a region (CONFIG_KEY_GEOFENCE_REGION + index), followed by the vertices in use only
+typedef struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+	uint8_t vertex_count;
+	uint8_t power_level;		//VHFPowerLevel
+	uint8_t beacon_enabled;
+	uint8_t __res;
+	uint16_t beacon_interval_s;
+	char digi_path[GEOFENCE_DIGI_PATH_LENGTH];	//not null terminated if full
+	float aprs_freq_MHz;
+	struct __attribute__((__packed__, scalar_storage_order("little-endian"))) {
+		float latitude;
+		float longitude;
+	} vertices[GEOFENCE_MAX_VERTICES];
+}StoredGeofenceRegion;
+
+_Static_assert(sizeof(StoredGeofenceRegion) <= CONFIG_STORE_MAX_VALUE_LENGTH, "a region doesn't fit in a store record");
+
+// === PRIVATE VARIABLES ===
+static TX_MUTEX geofence_mutex;
+static GeofencePolygon geofence_table[GEOFENCE_MAX_REGIONS];
+static uint8_t active_region = GEOFENCE_REGION_UNKNOWN;
+
+// === PRIVATE METHODS ===
+static bool geofence_bounds_contain(const GeofenceRegion *bounds, float latitude, float longitude) {
+	return (latitude >= bounds->min.latitude) && (latitude <= bounds->max.latitude)
+			&& (longitude >= bounds->min.longitude) && (longitude <= bounds->max.longitude);
+}
+
+//Even-odd rule: count the polygon edges crossed by a ray from the position towards increasing longitude
+static bool geofence_polygon_contains(const GeofencePolygon *polygon, float latitude, float longitude) {
+	bool inside = false;
+	for (uint_fast8_t i = 0, j = polygon->vertex_count - 1; i < polygon->vertex_count; j = i++) {
+		const GlobalPosition *a = &polygon->vertices[i];
+		const GlobalPosition *b = &polygon->vertices[j];
+		if ((a->latitude > latitude) != (b->latitude > latitude)) {
+			float crossing = a->longitude + (latitude - a->latitude) * (b->longitude - a->longitude) / (b->latitude - a->latitude);
+			if (longitude < crossing) {
+				inside = !inside;
+			}
+		}
+	}
+	return inside;
+}
+
+// === PUBLIC METHODS ===
+void geofence_init(void) {
+	tx_mutex_create(&geofence_mutex, "Geofence mutex", TX_INHERIT);
+	geofence_clear();
+
+	for (uint8_t i = 0; i < GEOFENCE_MAX_REGIONS; i++) {
+		StoredGeofenceRegion stored;
+		size_t length = config_store_read(CONFIG_KEY_GEOFENCE_REGION + i, &stored, sizeof(stored));
+		if ((length < offsetof(StoredGeofenceRegion, vertices)) || (stored.vertex_count > GEOFENCE_MAX_VERTICES)
+				|| (length != offsetof(StoredGeofenceRegion, vertices) + stored.vertex_count * sizeof(stored.vertices[0]))) {
+			continue;
+		}
+
+		GeofencePolygon polygon = {
+			.vertex_count = stored.vertex_count,
+			.aprs_freq_MHz = stored.aprs_freq_MHz,
+			.power_level = stored.power_level,
+			.beacon = {.enabled = stored.beacon_enabled, .interval_s = stored.beacon_interval_s},
+		};
+		memcpy(polygon.digi_path, stored.digi_path, sizeof(stored.digi_path));
+		for (uint_fast8_t v = 0; v < stored.vertex_count; v++) {
+			polygon.vertices[v].latitude = stored.vertices[v].latitude;
+			polygon.vertices[v].longitude = stored.vertices[v].longitude;
+		}
+		geofence_set_region(i, &polygon);
+	}
+}
+
+void geofence_save(void) {
+	for (uint8_t i = 0; i < GEOFENCE_MAX_REGIONS; i++) {
+		tx_mutex_get(&geofence_mutex, TX_WAIT_FOREVER);
+		GeofencePolygon polygon = geofence_table[i];
+		tx_mutex_put(&geofence_mutex);
+
+		StoredGeofenceRegion stored = {
+			.vertex_count = polygon.vertex_count,
+			.power_level = polygon.power_level,
+			.beacon_enabled = polygon.beacon.enabled,
+			.beacon_interval_s = polygon.beacon.interval_s,
+			.aprs_freq_MHz = polygon.aprs_freq_MHz,
+		};
+		memcpy(stored.digi_path, polygon.digi_path, sizeof(stored.digi_path));
+		for (uint_fast8_t v = 0; v < polygon.vertex_count; v++) {
+			stored.vertices[v].latitude = polygon.vertices[v].latitude;
+			stored.vertices[v].longitude = polygon.vertices[v].longitude;
+		}
+
+		//unused entries are removed from the store
+		size_t length = (polygon.vertex_count == 0) ? 0
+				: (offsetof(StoredGeofenceRegion, vertices) + polygon.vertex_count * sizeof(stored.vertices[0]));
+		config_store_write(CONFIG_KEY_GEOFENCE_REGION + i, &stored, length);
+	}
+}
+
+void geofence_clear(void) {
+	tx_mutex_get(&geofence_mutex, TX_WAIT_FOREVER);
+	memset(geofence_table, 0, sizeof(geofence_table));
+	active_region = GEOFENCE_REGION_UNKNOWN;
+	tx_mutex_put(&geofence_mutex);
+}
+
+HAL_StatusTypeDef geofence_set_region(uint8_t index, const GeofencePolygon *polygon) {
+	if ((index >= GEOFENCE_MAX_REGIONS) || (polygon->vertex_count > GEOFENCE_MAX_VERTICES)
+			|| ((polygon->vertex_count != 0) && (polygon->vertex_count < 3))) {
+		return HAL_ERROR;
+	}
+
+	GeofencePolygon entry = *polygon;
+	entry.digi_path[GEOFENCE_DIGI_PATH_LENGTH] = '\0';
+	if (entry.vertex_count != 0) {
+		entry.bounds = (GeofenceRegion){.min = entry.vertices[0], .max = entry.vertices[0]};
+		for (uint_fast8_t i = 1; i < entry.vertex_count; i++) {
+			const GlobalPosition *v = &entry.vertices[i];
+			entry.bounds.min.latitude = (v->latitude < entry.bounds.min.latitude) ? v->latitude : entry.bounds.min.latitude;
+			entry.bounds.min.longitude = (v->longitude < entry.bounds.min.longitude) ? v->longitude : entry.bounds.min.longitude;
+			entry.bounds.max.latitude = (v->latitude > entry.bounds.max.latitude) ? v->latitude : entry.bounds.max.latitude;
+			entry.bounds.max.longitude = (v->longitude > entry.bounds.max.longitude) ? v->longitude : entry.bounds.max.longitude;
+		}
+	}
+
+	tx_mutex_get(&geofence_mutex, TX_WAIT_FOREVER);
+	geofence_table[index] = entry;
+	active_region = GEOFENCE_REGION_UNKNOWN;
+	tx_mutex_put(&geofence_mutex);
+	return HAL_OK;
+}
+
+void geofence_invalidate(void) {
+	tx_mutex_get(&geofence_mutex, TX_WAIT_FOREVER);
+	active_region = GEOFENCE_REGION_UNKNOWN;
+	tx_mutex_put(&geofence_mutex);
+}
+
+uint8_t geofence_find_region(float latitude, float longitude) {
+	for (uint_fast8_t i = 0; i < GEOFENCE_MAX_REGIONS; i++) {
+		const GeofencePolygon *polygon = &geofence_table[i];
+		if ((polygon->vertex_count != 0)
+				&& geofence_bounds_contain(&polygon->bounds, latitude, longitude)
+				&& geofence_polygon_contains(polygon, latitude, longitude)) {
+			return i;
+		}
+	}
+	return GEOFENCE_REGION_DEFAULT;
+}
+
+bool geofence_update(VHF_HandleTypdeDef *vhf, float latitude, float longitude, GeofenceBeaconPolicy *beacon) {
+	tx_mutex_get(&geofence_mutex, TX_WAIT_FOREVER);
+	uint8_t region = geofence_find_region(latitude, longitude);
+	bool changed = (region != active_region);
+
+	//copy out the settings, the table may change once the mutex is released
+	float freq_MHz = g_config.aprs_freq;
+	VHFPowerLevel power_level = g_config.vhf_power;
+	char digi_path[GEOFENCE_DIGI_PATH_LENGTH + 1] = GEOFENCE_DEFAULT_DIGI_PATH;
+	*beacon = (GeofenceBeaconPolicy){.enabled = true, .interval_s = 0};
+	if (region != GEOFENCE_REGION_DEFAULT) {
+		const GeofencePolygon *polygon = &geofence_table[region];
+		freq_MHz = polygon->aprs_freq_MHz;
+		power_level = polygon->power_level;
+		memcpy(digi_path, polygon->digi_path, sizeof(digi_path));
+		*beacon = polygon->beacon;
+	}
+	active_region = region;
+	tx_mutex_put(&geofence_mutex);
+
+	if (changed) {
+		vhf_set_freq(vhf, freq_MHz);
+		vhf_set_power_level(vhf, power_level);
+		aprs_set_digi_path(digi_path);
+	}
+	return changed;
+}
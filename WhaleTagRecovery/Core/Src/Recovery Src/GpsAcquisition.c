@@ -0,0 +1,107 @@
+/*
+ * GpsAcquisition.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Adaptive GPS acquisition policy. See matching header file for more info.
+ */
+
+#include "Recovery Inc/GpsAcquisition.h"
+
+static uint32_t clamp_timeout(uint32_t timeout_ms) {
+	if (timeout_ms < GPS_ACQ_MIN_TIMEOUT_MS) {
+		return GPS_ACQ_MIN_TIMEOUT_MS;
+	}
+	if (timeout_ms > GPS_ACQ_MAX_TIMEOUT_MS) {
+		return GPS_ACQ_MAX_TIMEOUT_MS;
+	}
+	return timeout_ms;
+}
+
+void gps_acq_init(GpsAcqEstimator *estimator) {
+	*estimator = (GpsAcqEstimator){
+		.next_timeout_ms = GPS_ACQ_INITIAL_TIMEOUT_MS,
+	};
+}
+
+void gps_acq_start(const GpsAcqEstimator *estimator, GpsAcqAttempt *attempt, uint32_t now_ms) {
+	*attempt = (GpsAcqAttempt){
+		.start_ms = now_ms,
+		.deadline_ms = now_ms + clamp_timeout(estimator->next_timeout_ms),
+		.last_progress_ms = now_ms,
+	};
+}
+
+GpsAcqResult gps_acq_update(GpsAcqAttempt *attempt, uint32_t now_ms, bool has_fix, const GpsSignalSummary *signal) {
+	if (has_fix) {
+		return GPS_ACQ_SUCCESS;
+	}
+
+	//track acquisition progress: more satellites with signal, or a noticeably stronger best satellite
+	if (signal->satellites_with_signal > attempt->best_satellites_with_signal) {
+		attempt->best_satellites_with_signal = signal->satellites_with_signal;
+		attempt->last_progress_ms = now_ms;
+	}
+	if (signal->max_cno >= attempt->best_max_cno + GPS_ACQ_CNO_PROGRESS_STEP) {
+		attempt->best_max_cno = signal->max_cno;
+		attempt->last_progress_ms = now_ms;
+	}
+
+	uint32_t elapsed_ms = now_ms - attempt->start_ms;
+
+	//nothing above the noise floor: antenna is submerged or blocked, stop burning power
+	if ((elapsed_ms >= GPS_ACQ_NO_SIGNAL_ABORT_MS) && (attempt->best_max_cno < GPS_ACQ_MIN_CNO)) {
+		return GPS_ACQ_ABORT_NO_SIGNAL;
+	}
+
+	if ((int32_t)(now_ms - attempt->deadline_ms) < 0) {
+		return GPS_ACQ_CONTINUE;
+	}
+
+	//deadline reached, but keep going while satellites are still being acquired
+	bool making_progress = ((now_ms - attempt->last_progress_ms) < GPS_ACQ_PROGRESS_WINDOW_MS)
+			&& (signal->satellites_with_signal > 0);
+	if (making_progress && ((attempt->deadline_ms - attempt->start_ms) + GPS_ACQ_EXTEND_MS <= GPS_ACQ_MAX_TIMEOUT_MS)) {
+		attempt->deadline_ms += GPS_ACQ_EXTEND_MS;
+		return GPS_ACQ_CONTINUE;
+	}
+
+	return GPS_ACQ_TIMEOUT;
+}
+
+void gps_acq_finish(GpsAcqEstimator *estimator, const GpsAcqAttempt *attempt, GpsAcqResult result, uint32_t now_ms) {
+	uint32_t elapsed_ms = now_ms - attempt->start_ms;
+
+	estimator->attempts++;
+	estimator->total_attempt_ms += elapsed_ms;
+
+	switch (result) {
+		case GPS_ACQ_SUCCESS:
+			estimator->successes++;
+
+			//moving average with a weight of 1/4 on the newest attempt
+			if (estimator->average_lock_ms == 0) {
+				estimator->average_lock_ms = elapsed_ms;
+			} else {
+				estimator->average_lock_ms = (3 * estimator->average_lock_ms + elapsed_ms) / 4;
+			}
+			estimator->next_timeout_ms = clamp_timeout(GPS_ACQ_TIMEOUT_MARGIN * estimator->average_lock_ms);
+			break;
+
+		case GPS_ACQ_TIMEOUT:
+			estimator->timeouts++;
+			estimator->next_timeout_ms = clamp_timeout(estimator->next_timeout_ms + estimator->next_timeout_ms / 2);
+			break;
+
+		case GPS_ACQ_ABORT_NO_SIGNAL:
+			estimator->aborts_no_signal++;
+			break;
+
+		default:
+			break;
+	}
+}
+
+uint32_t gps_acq_plan_retry(uint32_t now, uint32_t off, uint32_t wake_lead) {
+	return now + off + wake_lead;
+}
@@ -0,0 +1,240 @@
+/*
+ * GpsAssist.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * AssistNow (UBX-MGA) storage and injection. See matching header file for more info.
+ */
+
+#include "Recovery Inc/GpsAssist.h"
+#include "Recovery Inc/Ubx.h"
+#include "Lib Inc/flash.h"
+#include "Lib Inc/timing.h"
+#include "Lib Inc/time_service.h"
+#include "tx_api.h"
+#include "util.h"
+#include <string.h>
+
+// === PRIVATE DEFINES ===
+#define GPS_ASSIST_HEADER_ADDRESS FLASH_MGA_REGION_ADDRESS
+#define GPS_ASSIST_DATA_ADDRESS   (FLASH_MGA_REGION_ADDRESS + sizeof(GpsAssistHeader))
+#define GPS_ASSIST_MAX_LENGTH     (FLASH_MGA_REGION_SIZE - sizeof(GpsAssistHeader))
+
+// === PRIVATE VARIABLES ===
+//upload in progress
+static bool upload_active = false;
+static uint32_t upload_length = 0;
+static uint32_t upload_offset = 0;
+static uint32_t upload_time = 0;
+static uint8_t upload_pending[FLASH_QUADWORD_SIZE]; //bytes not yet programmed (flash is written in whole quad-words)
+static size_t upload_pending_length = 0;
+
+// === PRIVATE METHODS ===
+//Walks the stored data as UBX frames. Returns false if any frame is malformed, fails its checksum or is not an MGA message.
+static bool gps_assist_validate(const uint8_t *data, uint32_t length) {
+	uint32_t offset = 0;
+	while (offset < length) {
+		if ((length - offset) < UBX_FRAME_OVERHEAD) {
+			return false;
+		}
+
+		const uint8_t *frame = &data[offset];
+		uint32_t frame_length = (frame[4] | (frame[5] << 8)) + UBX_FRAME_OVERHEAD;
+		if ((frame_length > (length - offset)) || !ubx_frame_is(frame, frame_length, UBX_CLASS_MGA, frame[3])) {
+			return false;
+		}
+
+		uint8_t ck_a, ck_b;
+		ubx_checksum(&frame[2], frame_length - 4, &ck_a, &ck_b);
+		if ((ck_a != frame[frame_length - 2]) || (ck_b != frame[frame_length - 1])) {
+			return false;
+		}
+
+		offset += frame_length;
+	}
+	return true;
+}
+
+static HAL_StatusTypeDef gps_assist_send_time(HAL_StatusTypeDef (*send)(const uint8_t *frame, size_t frame_length)) {
+	Timestamp timestamp = time_now();
+	if (timestamp.source == TIME_SOURCE_NONE) {
+		return HAL_OK; //nothing to send
+	}
+
+	TimeDate now = time_date_from_utc(timestamp.utc_s);
+	uint32_t ns = timestamp.utc_ms * 1000000;
+	uint8_t payload[UBX_MGA_INI_TIME_UTC_PAYLOAD_LENGTH] = {
+		[0] = UBX_MGA_INI_TIME_UTC_TYPE,
+		[1] = 0,	//version
+		[2] = 0,	//time reference: on receipt of message
+		[3] = 0x80,	//leap seconds unknown (-128)
+		[4] = (now.year & 0xFF),
+		[5] = (now.year >> 8),
+		[6] = now.month,
+		[7] = now.day,
+		[8] = now.hour,
+		[9] = now.minute,
+		[10] = now.second,
+		[12] = (ns & 0xFF),
+		[13] = ((ns >> 8) & 0xFF),
+		[14] = ((ns >> 16) & 0xFF),
+		[15] = (ns >> 24),
+		[16] = (GPS_ASSIST_TIME_ACCURACY_S & 0xFF),
+		[17] = (GPS_ASSIST_TIME_ACCURACY_S >> 8),
+		//[20-23] tAccNs = 0
+	};
+
+	uint8_t frame[UBX_MGA_INI_TIME_UTC_PAYLOAD_LENGTH + UBX_FRAME_OVERHEAD];
+	size_t frame_length = ubx_build_frame(frame, sizeof(frame), UBX_CLASS_MGA, UBX_ID_MGA_INI, payload, sizeof(payload));
+	return send(frame, frame_length);
+}
+
+// === PUBLIC METHODS ===
+GpsAssistStatus gps_assist_begin(uint32_t length, uint32_t utc_time, uint32_t *next_offset) {
+	upload_active = false;
+	*next_offset = 0;
+
+	if (utc_time != 0) {
+		time_set_utc(utc_time, 0, time_monotonic_ms(), TIME_SOURCE_PI);
+	}
+
+	if (length > GPS_ASSIST_MAX_LENGTH) {
+		return GPS_ASSIST_ERROR_LENGTH;
+	}
+
+	//erasing also invalidates the previous blob (header is erased)
+	if (flash_erase(FLASH_MGA_REGION_ADDRESS, FLASH_MGA_REGION_SIZE) != HAL_OK) {
+		return GPS_ASSIST_ERROR_FLASH;
+	}
+
+	upload_active = true;
+	upload_length = length;
+	upload_offset = 0;
+	upload_time = utc_time;
+	upload_pending_length = 0;
+	return GPS_ASSIST_OK;
+}
+
+GpsAssistStatus gps_assist_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset) {
+	*next_offset = upload_offset;
+
+	if (!upload_active) {
+		return GPS_ASSIST_ERROR_NO_TRANSFER;
+	}
+
+	if (offset + length <= upload_offset) {
+		return GPS_ASSIST_OK; //repeated chunk (our ack was lost), already written
+	}
+
+	if (offset != upload_offset) {
+		return GPS_ASSIST_ERROR_SEQUENCE;
+	}
+
+	if (upload_offset + length > upload_length) {
+		upload_active = false;
+		return GPS_ASSIST_ERROR_LENGTH;
+	}
+
+	//program whole quad-words, keep the remainder pending for the next chunk
+	uint32_t write_address = GPS_ASSIST_DATA_ADDRESS + upload_offset - upload_pending_length;
+	size_t consumed = 0;
+	while (consumed < length) {
+		size_t copy = FLASH_QUADWORD_SIZE - upload_pending_length;
+		copy = (copy < (length - consumed)) ? copy : (length - consumed);
+		memcpy(&upload_pending[upload_pending_length], &data[consumed], copy);
+		upload_pending_length += copy;
+		consumed += copy;
+
+		if (upload_pending_length == FLASH_QUADWORD_SIZE) {
+			if (flash_program(write_address, upload_pending, FLASH_QUADWORD_SIZE) != HAL_OK) {
+				upload_active = false;
+				return GPS_ASSIST_ERROR_FLASH;
+			}
+			write_address += FLASH_QUADWORD_SIZE;
+			upload_pending_length = 0;
+		}
+	}
+
+	upload_offset += length;
+	*next_offset = upload_offset;
+	return GPS_ASSIST_OK;
+}
+
+GpsAssistStatus gps_assist_end(uint32_t length, uint32_t *next_offset) {
+	*next_offset = upload_offset;
+
+	if (!upload_active) {
+		return GPS_ASSIST_ERROR_NO_TRANSFER;
+	}
+	upload_active = false;
+
+	if ((length != upload_length) || (upload_offset != upload_length)) {
+		return GPS_ASSIST_ERROR_LENGTH;
+	}
+
+	//flush the final partial quad-word
+	if (upload_pending_length != 0) {
+		uint32_t write_address = GPS_ASSIST_DATA_ADDRESS + upload_offset - upload_pending_length;
+		if (flash_program(write_address, upload_pending, upload_pending_length) != HAL_OK) {
+			return GPS_ASSIST_ERROR_FLASH;
+		}
+		upload_pending_length = 0;
+	}
+
+	if (!gps_assist_validate((const uint8_t *)GPS_ASSIST_DATA_ADDRESS, upload_length)) {
+		return GPS_ASSIST_ERROR_INVALID;
+	}
+
+	GpsAssistHeader header = {
+		.magic = GPS_ASSIST_MAGIC,
+		.length = upload_length,
+		.upload_time = upload_time,
+	};
+	if (flash_program(GPS_ASSIST_HEADER_ADDRESS, (const uint8_t *)&header, sizeof(header)) != HAL_OK) {
+		return GPS_ASSIST_ERROR_FLASH;
+	}
+
+	return GPS_ASSIST_OK;
+}
+
+bool gps_assist_is_valid(void) {
+	const GpsAssistHeader *header = (const GpsAssistHeader *)GPS_ASSIST_HEADER_ADDRESS;
+	return (header->magic == GPS_ASSIST_MAGIC) && (header->length <= GPS_ASSIST_MAX_LENGTH);
+}
+
+HAL_StatusTypeDef gps_assist_inject(HAL_StatusTypeDef (*send)(const uint8_t *frame, size_t frame_length)) {
+	//time first, so that the receiver can make use of the orbit data that follows
+	HAL_RESULT_PROPAGATE(gps_assist_send_time(send));
+
+	if (!gps_assist_is_valid()) {
+		return HAL_OK;
+	}
+
+	uint32_t utc_time = 0;
+	bool has_date = time_get_utc(&utc_time);
+	TimeDate today = time_date_from_utc(utc_time);
+
+	const GpsAssistHeader *header = (const GpsAssistHeader *)GPS_ASSIST_HEADER_ADDRESS;
+	const uint8_t *data = (const uint8_t *)GPS_ASSIST_DATA_ADDRESS;
+	uint32_t offset = 0;
+	while (offset + UBX_FRAME_OVERHEAD <= header->length) {
+		const uint8_t *frame = &data[offset];
+		uint16_t payload_length = frame[4] | (frame[5] << 8);
+		offset += payload_length + UBX_FRAME_OVERHEAD;
+
+		//AssistNow Offline data covers several weeks, only the current day's is useful
+		if (has_date && ubx_frame_is(frame, payload_length + UBX_FRAME_OVERHEAD, UBX_CLASS_MGA, UBX_ID_MGA_ANO)) {
+			const uint8_t *payload = &frame[UBX_HEADER_LENGTH];
+			if ((payload[UBX_MGA_ANO_YEAR_OFFSET] + 2000 != today.year)
+					|| (payload[UBX_MGA_ANO_MONTH_OFFSET] != today.month)
+					|| (payload[UBX_MGA_ANO_DAY_OFFSET] != today.day)) {
+				continue;
+			}
+		}
+
+		HAL_RESULT_PROPAGATE(send(frame, payload_length + UBX_FRAME_OVERHEAD));
+		tx_thread_sleep(tx_ms_to_ticks(GPS_ASSIST_INTER_FRAME_DELAY_MS));
+	}
+
+	return HAL_OK;
+}
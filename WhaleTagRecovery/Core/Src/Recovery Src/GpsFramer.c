@@ -0,0 +1,104 @@
+/*
+ * GpsFramer.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * NMEA/UBX stream framing into the GPS sentence ring. See matching header file for more info.
+ */
+
+#include "Recovery Inc/GpsFramer.h"
+
+// === PRIVATE METHODS ===
+//Marks the sentence currently being written as complete and moves on to the next slot
+static inline void gps_framer_commit(GpsFramer *framer, GPS_SentenceType type, size_t length, uint32_t rx_tick) {
+	GPS_Sentence *slot = &framer->ring[framer->write_index];
+	slot->type = type;
+	slot->length = length;
+	slot->rx_tick = rx_tick;
+	framer->write_index = (framer->write_index + 1) % framer->ring_count;
+}
+
+//Feeds one received byte into the framer. Returns 1 if a sentence was completed.
+static int gps_framer_push(GpsFramer *framer, uint8_t byte, uint32_t rx_tick) {
+	GPS_Sentence *slot = &framer->ring[framer->write_index];
+
+	switch (framer->state) {
+		case GPS_FRAMER_NMEA:
+			if ((byte == GPS_NMEA_END_CHAR) || (byte == '\n')) {
+				slot->sentence[slot->length] = '\0';
+				gps_framer_commit(framer, GPS_SENTENCE_NMEA, slot->length, rx_tick);
+				framer->stats.nmea_sentences++;
+				framer->state = GPS_FRAMER_IDLE;
+				return 1;
+			}
+
+			if ((byte == GPS_NMEA_START_CHAR) || (byte == UBX_SYNC_CHAR_1)) {
+				//new sentence/frame started before this one ended, drop it and resync
+				framer->stats.nmea_truncated++;
+				framer->state = GPS_FRAMER_IDLE;
+				return gps_framer_push(framer, byte, rx_tick);
+			}
+
+			if (slot->length >= GPS_NMEA_MAX_SIZE) {
+				//sentence too long, drop it
+				framer->stats.nmea_too_long++;
+				framer->state = GPS_FRAMER_IDLE;
+				return 0;
+			}
+
+			slot->sentence[slot->length++] = byte;
+			return 0;
+
+		case GPS_FRAMER_UBX:
+			switch (ubx_parser_push(&framer->ubx_parser, byte)) {
+				case UBX_PARSE_COMPLETE:
+					gps_framer_commit(framer, GPS_SENTENCE_UBX, framer->ubx_parser.payload_length + UBX_FRAME_OVERHEAD, rx_tick);
+					framer->stats.ubx_frames++;
+					framer->state = GPS_FRAMER_IDLE;
+					return 1;
+
+				case UBX_PARSE_ERROR:
+					framer->stats.ubx_errors++;
+					framer->state = GPS_FRAMER_IDLE;
+					//the offending byte may be the start of a NMEA sentence
+					return (byte == GPS_NMEA_START_CHAR) ? gps_framer_push(framer, byte, rx_tick) : 0;
+
+				default:
+					return 0;
+			}
+
+		case GPS_FRAMER_IDLE:
+		default:
+			if (byte == GPS_NMEA_START_CHAR) {
+				slot->sentence[0] = byte;
+				slot->length = 1;
+				framer->state = GPS_FRAMER_NMEA;
+			} else if (byte == UBX_SYNC_CHAR_1) {
+				ubx_parser_reset(&framer->ubx_parser, slot->sentence, sizeof(slot->sentence));
+				ubx_parser_push(&framer->ubx_parser, byte);
+				framer->state = GPS_FRAMER_UBX;
+			}
+			return 0;
+	}
+}
+
+// === PUBLIC METHODS ===
+void gps_framer_init(GpsFramer *framer, GPS_Sentence *ring, size_t ring_count) {
+	framer->ring = ring;
+	framer->ring_count = ring_count;
+	framer->write_index = 0;
+	framer->state = GPS_FRAMER_IDLE;
+}
+
+void gps_framer_reset(GpsFramer *framer) {
+	framer->state = GPS_FRAMER_IDLE;
+}
+
+size_t gps_framer_feed(GpsFramer *framer, const uint8_t *data, size_t length, uint32_t rx_tick) {
+	size_t sentences = 0;
+	for (size_t i = 0; i < length; i++) {
+		sentences += gps_framer_push(framer, data[i], rx_tick);
+	}
+	framer->stats.bytes += length;
+	return sentences;
+}
@@ -0,0 +1,186 @@
+/*
+ * GpsReplay.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Replay of recorded GPS output through the GPS framer and parsers. See matching header file for more info.
+ */
+
+#include "Recovery Inc/GpsReplay.h"
+#include "Recovery Inc/GPS.h"
+#include "Lib Inc/time_service.h"
+#include "main.h"
+#include <string.h>
+
+// === PRIVATE TYPEDEFS ===
+typedef struct {
+	uint32_t offset_ms;
+	uint16_t length;
+	uint8_t data[GPS_REPLAY_CHUNK_SIZE];
+}GpsReplayChunk;
+
+// === PRIVATE VARIABLES ===
+//The state is shared by the state machine thread (begin/write/end, acknowledgements) and the GPS buffer thread
+//(service, parse accounting). It is only touched in short critical sections: a mutex could be held by the GPS buffer
+//thread when the state machine suspends it, and the next begin/end would then block forever.
+static volatile bool replay_active = false;
+static GpsReplayPacing replay_pacing = GPS_REPLAY_REAL_TIME;
+static GpsReplayStats replay_stats = {0};
+
+//single producer (state machine thread), single consumer (GPS buffer thread)
+static GpsReplayChunk replay_chunks[GPS_REPLAY_CHUNK_COUNT];
+static volatile uint_fast8_t replay_chunk_start = 0;
+static volatile uint_fast8_t replay_chunk_end = 0;
+
+//incremented by every begin/end, so that a chunk being fed across them is not accounted to the next replay
+static uint32_t replay_session = 0;
+
+//chunk being fed, copied out of the queue since begin/end may reuse its slot meanwhile
+static GpsReplayChunk replay_feed_chunk;
+
+//monotonic time corresponding to offset 0, set when the first chunk is fed
+static bool replay_started = false;
+static uint32_t replay_start_ms = 0;
+static uint32_t replay_first_feed_ms = 0;
+
+// === PUBLIC METHODS ===
+GpsReplayStatus gps_replay_begin(GpsReplayPacing pacing) {
+	if ((pacing != GPS_REPLAY_REAL_TIME) && (pacing != GPS_REPLAY_AS_FAST_AS_POSSIBLE)) {
+		return GPS_REPLAY_ERROR_LENGTH;
+	}
+
+	//the receiver must not interleave its own output with the recording
+	gps_sleep();
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	replay_session++;
+	replay_chunk_start = 0;
+	replay_chunk_end = 0;
+	replay_started = false;
+	replay_pacing = pacing;
+	replay_stats = (GpsReplayStats){.core_clock_hz = SystemCoreClock};
+	replay_active = true;
+	__set_PRIMASK(primask);
+
+	gps_feed_reset();
+	return GPS_REPLAY_OK;
+}
+
+GpsReplayStatus gps_replay_write_chunk(uint32_t offset_ms, const uint8_t *data, size_t length) {
+	if (!replay_active) {
+		return GPS_REPLAY_ERROR_NOT_ACTIVE;
+	}
+	if ((length == 0) || (length > GPS_REPLAY_CHUNK_SIZE)) {
+		return GPS_REPLAY_ERROR_LENGTH;
+	}
+
+	uint_fast8_t next_end = (replay_chunk_end + 1) % GPS_REPLAY_CHUNK_COUNT;
+	if (next_end == replay_chunk_start) {
+		return GPS_REPLAY_ERROR_FULL;
+	}
+
+	//the slot is not visible to the consumer until the end index moves
+	GpsReplayChunk *chunk = &replay_chunks[replay_chunk_end];
+	chunk->offset_ms = offset_ms;
+	chunk->length = length;
+	memcpy(chunk->data, data, length);
+	replay_chunk_end = next_end;
+
+	gpsBuffer_notify();
+	return GPS_REPLAY_OK;
+}
+
+GpsReplayStatus gps_replay_end(void) {
+	if (!replay_active) {
+		return GPS_REPLAY_ERROR_NOT_ACTIVE;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	replay_session++;
+	replay_active = false;
+	replay_chunk_start = replay_chunk_end;
+	__set_PRIMASK(primask);
+
+	gps_feed_reset();
+	return GPS_REPLAY_OK;
+}
+
+bool gps_replay_is_active(void) {
+	return replay_active;
+}
+
+uint8_t gps_replay_free_chunks(void) {
+	uint_fast8_t used = (replay_chunk_end + GPS_REPLAY_CHUNK_COUNT - replay_chunk_start) % GPS_REPLAY_CHUNK_COUNT;
+	return (GPS_REPLAY_CHUNK_COUNT - 1) - used;
+}
+
+GpsReplayStats gps_replay_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	GpsReplayStats stats = replay_stats;
+	__set_PRIMASK(primask);
+	return stats;
+}
+
+uint32_t gps_replay_service(uint_fast8_t *fed_chunks) {
+	*fed_chunks = 0;
+
+	while (1) {
+		//take the next due chunk out of the queue
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		if (!replay_active || (replay_chunk_start == replay_chunk_end)) {
+			__set_PRIMASK(primask);
+			return GPS_REPLAY_NO_CHUNK;
+		}
+
+		const GpsReplayChunk *chunk = &replay_chunks[replay_chunk_start];
+		uint32_t now = time_monotonic_ms();
+		if (!replay_started) {
+			replay_started = true;
+			replay_start_ms = now - chunk->offset_ms;
+			replay_first_feed_ms = now;
+		}
+
+		if (replay_pacing == GPS_REPLAY_REAL_TIME) {
+			int32_t until_due = (int32_t)((replay_start_ms + chunk->offset_ms) - now);
+			if (until_due > 0) {
+				__set_PRIMASK(primask);
+				return until_due;
+			}
+		}
+
+		replay_feed_chunk.length = chunk->length;
+		memcpy(replay_feed_chunk.data, chunk->data, chunk->length);
+		replay_chunk_start = (replay_chunk_start + 1) % GPS_REPLAY_CHUNK_COUNT;
+		uint32_t session = replay_session;
+		__set_PRIMASK(primask);
+
+		//framing runs with interrupts enabled and without any lock held, the thread may be suspended in here
+		uint32_t start_cycles = DWT->CYCCNT;
+		uint32_t sentences = gps_feed(replay_feed_chunk.data, replay_feed_chunk.length);
+		uint32_t cycles = DWT->CYCCNT - start_cycles;
+
+		primask = __get_PRIMASK();
+		__disable_irq();
+		if (session == replay_session) {
+			replay_stats.framer_cycles += cycles;
+			replay_stats.sentences += sentences;
+			replay_stats.bytes += replay_feed_chunk.length;
+			replay_stats.chunks++;
+			replay_stats.elapsed_ms = now - replay_first_feed_ms;
+		}
+		__set_PRIMASK(primask);
+		(*fed_chunks)++;
+	}
+}
+
+void gps_replay_account_parse(uint32_t sentences, uint32_t cycles) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	replay_stats.parsed += sentences;
+	replay_stats.parse_cycles += cycles;
+	__set_PRIMASK(primask);
+}
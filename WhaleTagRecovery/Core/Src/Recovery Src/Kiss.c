@@ -0,0 +1,246 @@
+/*
+ * Kiss.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * KISS TNC on the Pi link. See matching header file for more info.
+ */
+
+#include "Recovery Inc/Kiss.h"
+#include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/AprsPacket.h"
+#include "Recovery Inc/AprsTransmit.h"
+#include "Recovery Inc/VHF.h"
+#include "main.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+//Flags sent for a KISS time (units of 10 ms)
+#define KISS_TIME_TO_FLAGS(time) ((uint32_t)(time) * 10 * APRS_BYTE_RATE_BYTEP_PER_S / 1000)
+
+extern VHF_HandleTypdeDef vhf;
+extern TX_MUTEX vhf_mutex;
+
+// === PRIVATE TYPEDEFS ===
+typedef struct {
+	uint16_t length;	//including the FCS
+	uint8_t frame[KISS_MAX_FRAME_LENGTH + KISS_FCS_LENGTH];
+}KissFrame;
+
+// === PRIVATE VARIABLES ===
+//Single producer (decoder, state machine thread), single consumer (TNC thread) ring
+static KissFrame queue[KISS_QUEUE_COUNT];
+static volatile uint32_t queue_head = 0;
+static volatile uint32_t queue_tail = 0;
+static TX_SEMAPHORE queue_semaphore;
+
+//Decoder state, kept across messages
+static struct {
+	bool in_frame;		//a command byte was received since the last FEND
+	bool escaped;
+	bool discard;		//data frame without a free queue slot, or for another port
+	uint8_t command;
+	uint16_t length;
+	uint8_t value;		//first byte of a parameter command
+}decoder = {0};
+
+static struct {
+	uint8_t txdelay;
+	uint8_t persistence;
+	uint8_t slot_time;
+	uint8_t txtail;
+	bool full_duplex;
+}parameters = {
+	.txdelay = KISS_DEFAULT_TXDELAY,
+	.persistence = KISS_DEFAULT_PERSISTENCE,
+	.slot_time = KISS_DEFAULT_SLOT_TIME,
+	.txtail = KISS_DEFAULT_TXTAIL,
+	.full_duplex = false,
+};
+
+static KissStats stats = {0};
+
+// === PRIVATE METHODS ===
+static void kiss_start_frame(uint8_t command) {
+	decoder.in_frame = true;
+	decoder.command = command;
+	decoder.length = 0;
+	decoder.discard = false;
+
+	if ((command != KISS_CMD_RETURN) && ((command >> 4) != 0)) {
+		decoder.discard = true; //single port TNC
+	} else if ((command == KISS_CMD_DATA) && ((queue_head - queue_tail) >= KISS_QUEUE_COUNT)) {
+		decoder.discard = true;
+		stats.frames_dropped++;
+	}
+}
+
+static void kiss_end_frame(void) {
+	if (!decoder.in_frame) {
+		return; //back to back FENDs
+	}
+	decoder.in_frame = false;
+
+	if (decoder.discard) {
+		stats.ignored += (decoder.command >> 4) != 0;
+		return;
+	}
+
+	if (decoder.command == KISS_CMD_DATA) {
+		if ((decoder.length < KISS_MIN_FRAME_LENGTH) || (decoder.length > KISS_MAX_FRAME_LENGTH)) {
+			stats.frames_invalid++;
+			return;
+		}
+
+		KissFrame *slot = &queue[queue_head % KISS_QUEUE_COUNT];
+		uint16_t fcs = ax25_fcs(slot->frame, decoder.length);
+		slot->frame[decoder.length] = fcs & 0xFF;
+		slot->frame[decoder.length + 1] = fcs >> 8;
+		slot->length = decoder.length + KISS_FCS_LENGTH;
+
+		queue_head++; //publish
+		stats.frames_queued++;
+		tx_semaphore_put(&queue_semaphore);
+		return;
+	}
+
+	if (decoder.length == 0) {
+		stats.ignored++; //parameter without a value
+		return;
+	}
+
+	switch (decoder.command) {
+		case KISS_CMD_TXDELAY:
+			parameters.txdelay = decoder.value;
+			break;
+
+		case KISS_CMD_PERSISTENCE:
+			parameters.persistence = decoder.value;
+			break;
+
+		case KISS_CMD_SLOT_TIME:
+			parameters.slot_time = decoder.value;
+			break;
+
+		case KISS_CMD_TXTAIL:
+			parameters.txtail = decoder.value;
+			break;
+
+		case KISS_CMD_FULL_DUPLEX:
+			parameters.full_duplex = (decoder.value != 0);
+			break;
+
+		default:
+			stats.ignored++;
+			break;
+	}
+}
+
+static void kiss_put_byte(uint8_t byte) {
+	if (!decoder.in_frame) {
+		kiss_start_frame(byte);
+		return;
+	}
+	if (decoder.discard) {
+		return;
+	}
+
+	if (decoder.command == KISS_CMD_DATA) {
+		//counted past the end, so that an overlong frame is rejected
+		if (decoder.length < KISS_MAX_FRAME_LENGTH) {
+			queue[queue_head % KISS_QUEUE_COUNT].frame[decoder.length] = byte;
+		}
+		decoder.length += (decoder.length <= KISS_MAX_FRAME_LENGTH);
+	} else {
+		if (decoder.length == 0) {
+			decoder.value = byte;
+		}
+		decoder.length = 1;
+	}
+}
+
+//Sends the queued frames in a single key-up
+static void kiss_key_up(void) {
+	tx_mutex_get(&vhf_mutex, TX_WAIT_FOREVER);
+
+	if (vhf_tx(&vhf) == HAL_OK) {
+		Timestamp start = time_now();
+		uint32_t tail_flags = KISS_TIME_TO_FLAGS(parameters.txtail);
+
+		aprs_transmit_start();
+		aprs_transmit_flags(KISS_TIME_TO_FLAGS(parameters.txdelay));
+		for (int sent = 0; (sent < KISS_MAX_FRAMES_PER_KEY_UP) && (queue_tail != queue_head); sent++) {
+			//the closing flag of a frame opens the next one
+			if (sent != 0) {
+				aprs_transmit_flags(1);
+			}
+			KissFrame *slot = &queue[queue_tail % KISS_QUEUE_COUNT];
+			aprs_transmit_frame(slot->frame, slot->length);
+			queue_tail++;
+			stats.frames_sent++;
+		}
+		aprs_transmit_flags((tail_flags > KISS_MIN_TAIL_FLAGS) ? tail_flags : KISS_MIN_TAIL_FLAGS);
+		aprs_transmit_stop();
+
+		aprs_record_transmission(start);
+		stats.key_ups++;
+	} else {
+		//the transmitter doesn't respond, don't send these frames late
+		stats.frames_dropped += queue_head - queue_tail;
+		queue_tail = queue_head;
+	}
+
+	vhf_sleep(&vhf);
+	tx_mutex_put(&vhf_mutex);
+}
+
+// === PUBLIC METHODS ===
+void kiss_init(void) {
+	tx_semaphore_create(&queue_semaphore, "KISS Queue Semaphore", 0);
+}
+
+void kiss_receive(const uint8_t *data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		uint8_t byte = data[i];
+
+		if (byte == KISS_FEND) {
+			kiss_end_frame();
+			decoder.escaped = false;
+			continue;
+		}
+		if (decoder.escaped) {
+			decoder.escaped = false;
+			byte = (byte == KISS_TFEND) ? KISS_FEND : (byte == KISS_TFESC) ? KISS_FESC : byte;
+		} else if (byte == KISS_FESC) {
+			decoder.escaped = true;
+			continue;
+		}
+		kiss_put_byte(byte);
+	}
+}
+
+void kiss_thread_entry(ULONG thread_input) {
+	while (1) {
+		tx_semaphore_get(&queue_semaphore, TX_WAIT_FOREVER);
+		if (queue_tail == queue_head) {
+			continue; //already sent with an earlier key-up
+		}
+
+		//p-persistence, without carrier detect the channel is taken as clear
+		if (!parameters.full_duplex) {
+			while ((rand() & 0xFF) > parameters.persistence) {
+				tx_thread_sleep(tx_ms_to_ticks(parameters.slot_time * 10));
+			}
+		}
+
+		kiss_key_up();
+	}
+}
+
+KissStats kiss_get_stats(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	KissStats copy = stats;
+	__set_PRIMASK(primask);
+	return copy;
+}
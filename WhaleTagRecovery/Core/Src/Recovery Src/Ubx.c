@@ -0,0 +1,206 @@
+/*
+ * Ubx.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * UBX framing, checksum and message helpers. See matching header file for more info.
+ */
+
+#include "Recovery Inc/Ubx.h"
+#include <string.h>
+
+//Returns the number of value bytes for a configuration key (encoded in bits 28-30 of the key id)
+static size_t ubx_config_value_size(uint32_t key){
+	switch ((key >> 28) & 0x07) {
+		case 1: /* fallthrough */ //one bit (stored as a byte)
+		case 2: return 1;
+		case 3: return 2;
+		case 4: return 4;
+		default: return 0; //8-byte values are not supported by UbxConfigItem
+	}
+}
+
+void ubx_checksum(const uint8_t *data, size_t len, uint8_t *ck_a, uint8_t *ck_b){
+	uint8_t a = 0;
+	uint8_t b = 0;
+	for (size_t i = 0; i < len; i++){
+		a += data[i];
+		b += a;
+	}
+	*ck_a = a;
+	*ck_b = b;
+}
+
+size_t ubx_build_frame(uint8_t *dst, size_t dst_size, uint8_t msg_class, uint8_t msg_id, const uint8_t *payload, uint16_t payload_length){
+	size_t frame_length = payload_length + UBX_FRAME_OVERHEAD;
+	if (frame_length > dst_size){
+		return 0;
+	}
+
+	dst[0] = UBX_SYNC_CHAR_1;
+	dst[1] = UBX_SYNC_CHAR_2;
+	dst[2] = msg_class;
+	dst[3] = msg_id;
+	dst[4] = (payload_length & 0xFF);
+	dst[5] = (payload_length >> 8);
+
+	//payload may already be in place (built directly into dst)
+	if ((payload != NULL) && (payload != &dst[UBX_HEADER_LENGTH])){
+		memmove(&dst[UBX_HEADER_LENGTH], payload, payload_length);
+	}
+
+	//checksum covers everything except the sync characters
+	ubx_checksum(&dst[2], payload_length + 4, &dst[frame_length - 2], &dst[frame_length - 1]);
+	return frame_length;
+}
+
+size_t ubx_build_valset(uint8_t *dst, size_t dst_size, uint8_t layers, const UbxConfigItem *items, size_t item_count){
+	if (item_count > UBX_CFG_VALSET_MAX_ITEMS){
+		return 0;
+	}
+
+	//payload is built in place, directly after the header
+	uint8_t *payload = &dst[UBX_HEADER_LENGTH];
+	size_t payload_capacity = (dst_size > UBX_FRAME_OVERHEAD) ? (dst_size - UBX_FRAME_OVERHEAD) : 0;
+	size_t payload_length = 4;
+
+	if (payload_capacity < payload_length){
+		return 0;
+	}
+
+	payload[0] = 0x00; //version
+	payload[1] = layers;
+	payload[2] = 0x00; //reserved
+	payload[3] = 0x00;
+
+	for (size_t i = 0; i < item_count; i++){
+		size_t value_size = ubx_config_value_size(items[i].key);
+		if ((value_size == 0) || (payload_length + 4 + value_size > payload_capacity)){
+			return 0;
+		}
+
+		//key and value are both little-endian
+		for (size_t b = 0; b < 4; b++){
+			payload[payload_length++] = (items[i].key >> (8 * b)) & 0xFF;
+		}
+		for (size_t b = 0; b < value_size; b++){
+			payload[payload_length++] = (items[i].value >> (8 * b)) & 0xFF;
+		}
+	}
+
+	return ubx_build_frame(dst, dst_size, UBX_CLASS_CFG, UBX_ID_CFG_VALSET, payload, payload_length);
+}
+
+size_t ubx_build_pmreq(uint8_t *dst, size_t dst_size, uint32_t duration_ms, uint32_t flags, uint32_t wakeup_sources){
+	uint8_t payload[UBX_RXM_PMREQ_PAYLOAD_LENGTH] = {0}; //version 0 + reserved bytes are all zero
+
+	for (size_t b = 0; b < 4; b++){
+		payload[4 + b] = (duration_ms >> (8 * b)) & 0xFF;
+		payload[8 + b] = (flags >> (8 * b)) & 0xFF;
+		payload[12 + b] = (wakeup_sources >> (8 * b)) & 0xFF;
+	}
+
+	return ubx_build_frame(dst, dst_size, UBX_CLASS_RXM, UBX_ID_RXM_PMREQ, payload, sizeof(payload));
+}
+
+void ubx_parser_reset(UbxParser *self, uint8_t *buffer, uint16_t buffer_size){
+	self->state = UBX_STATE_SYNC_1;
+	self->buffer = buffer;
+	self->buffer_size = buffer_size;
+	self->index = 0;
+	self->payload_length = 0;
+	self->ck_a = 0;
+	self->ck_b = 0;
+}
+
+UbxParseResult ubx_parser_push(UbxParser *self, uint8_t byte){
+	self->buffer[self->index++] = byte;
+
+	switch (self->state) {
+		case UBX_STATE_SYNC_1:
+			self->index = (byte == UBX_SYNC_CHAR_1) ? 1 : 0;
+			self->state = (byte == UBX_SYNC_CHAR_1) ? UBX_STATE_SYNC_2 : UBX_STATE_SYNC_1;
+			return UBX_PARSE_INCOMPLETE;
+
+		case UBX_STATE_SYNC_2:
+			if (byte == UBX_SYNC_CHAR_1){
+				//repeated sync character, the frame may still start here
+				self->index = 1;
+				return UBX_PARSE_INCOMPLETE;
+			}
+			if (byte != UBX_SYNC_CHAR_2){
+				ubx_parser_reset(self, self->buffer, self->buffer_size);
+				return UBX_PARSE_ERROR;
+			}
+			self->ck_a = 0;
+			self->ck_b = 0;
+			self->state = UBX_STATE_CLASS;
+			return UBX_PARSE_INCOMPLETE;
+
+		case UBX_STATE_CLASS:
+			self->state = UBX_STATE_ID;
+			break;
+
+		case UBX_STATE_ID:
+			self->state = UBX_STATE_LENGTH_1;
+			break;
+
+		case UBX_STATE_LENGTH_1:
+			self->payload_length = byte;
+			self->state = UBX_STATE_LENGTH_2;
+			break;
+
+		case UBX_STATE_LENGTH_2:
+			self->payload_length |= ((uint16_t)byte << 8);
+			if ((self->payload_length + UBX_FRAME_OVERHEAD) > self->buffer_size){
+				//frame will not fit, drop it and start searching for the next sync
+				ubx_parser_reset(self, self->buffer, self->buffer_size);
+				return UBX_PARSE_ERROR;
+			}
+			self->state = (self->payload_length == 0) ? UBX_STATE_CK_A : UBX_STATE_PAYLOAD;
+			break;
+
+		case UBX_STATE_PAYLOAD:
+			if (self->index == (UBX_HEADER_LENGTH + self->payload_length)){
+				self->state = UBX_STATE_CK_A;
+			}
+			break;
+
+		case UBX_STATE_CK_A:
+			if (byte != self->ck_a){
+				ubx_parser_reset(self, self->buffer, self->buffer_size);
+				return UBX_PARSE_ERROR;
+			}
+			self->state = UBX_STATE_CK_B;
+			return UBX_PARSE_INCOMPLETE;
+
+		case UBX_STATE_CK_B:
+			//frame length remains available as (payload_length + UBX_FRAME_OVERHEAD)
+			self->state = UBX_STATE_SYNC_1;
+			self->index = 0;
+			return (byte == self->ck_b) ? UBX_PARSE_COMPLETE : UBX_PARSE_ERROR;
+	}
+
+	//class, id, length and payload bytes are all part of the checksum
+	self->ck_a += byte;
+	self->ck_b += self->ck_a;
+	return UBX_PARSE_INCOMPLETE;
+}
+
+bool ubx_frame_is(const uint8_t *frame, size_t frame_length, uint8_t msg_class, uint8_t msg_id){
+	return (frame_length >= UBX_FRAME_OVERHEAD)
+			&& (frame[0] == UBX_SYNC_CHAR_1)
+			&& (frame[1] == UBX_SYNC_CHAR_2)
+			&& (frame[2] == msg_class)
+			&& (frame[3] == msg_id);
+}
+
+bool ubx_decode_nav_pvt(const uint8_t *frame, size_t frame_length, UbxNavPvt *pvt){
+	if (!ubx_frame_is(frame, frame_length, UBX_CLASS_NAV, UBX_ID_NAV_PVT)
+			|| (frame_length != UBX_NAV_PVT_FRAME_LENGTH)){
+		return false;
+	}
+
+	memcpy(pvt, &frame[UBX_HEADER_LENGTH], sizeof(UbxNavPvt));
+	return true;
+}
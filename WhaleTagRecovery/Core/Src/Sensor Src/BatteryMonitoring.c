@@ -7,6 +7,7 @@
 
 #include "Sensor Inc/BatteryMonitoring.h"
 #include "Lib Inc/state_machine.h"
+#include "Lib Inc/event_log.h"
 #include "main.h"
 #include "config.h"
 #include "stm32u5xx_hal_adc.h"
@@ -25,6 +26,7 @@ void battery_monitor_thread_entry(ULONG thread_input){
 
 		//Get our battery voltage value
 		voltage_mon = battery_monitor_get_true_voltage();
+		event_log_battery(voltage_mon);
 
 		//If our voltage is too low (low battery detected)
 		if (voltage_mon < g_config.critical_voltage){
@@ -65,3 +67,20 @@ float battery_monitor_get_true_voltage(){
 	//Use our macros to scale the voltage appropriately
 	return batt_true_voltage(batt_to_analog(raw));
 }
+
+bool battery_monitor_is_low(void){
+#if BATTERY_MONITOR_ENABLED
+	return (voltage_mon < BATT_MON_LOW_VOLTAGE_THRESHOLD);
+#else
+	return false;
+#endif
+}
+
+bool battery_monitor_is_critical(void){
+#if BATTERY_MONITOR_ENABLED
+	//no reading until the monitor thread's first pass
+	return (voltage_mon != 0) && (voltage_mon < g_config.critical_voltage);
+#else
+	return false;
+#endif
+}
@@ -24,6 +24,8 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "Lib Inc/threads.h"
+#include "Lib Inc/low_power.h"
+#include "Lib Inc/cpu_load.h"
 #include "Recovery Inc/Aprs.h"
 #include "Recovery Inc/FishTracker.h"
 #include <stdint.h>
@@ -66,6 +68,8 @@ UINT App_ThreadX_Init(VOID *memory_ptr)
 
 	//Initialize thread list so we can create threads
 	threadListInit();
+	cpu_load_init();
+	low_power_init();
 
 	//loop through each thread in the list, allocate the memory and create the stack
 	for (uint8_t index = 0; index < NUM_THREADS; index++){
@@ -127,7 +131,7 @@ void MX_ThreadX_Init(void)
 void App_ThreadX_LowPower_Timer_Setup(ULONG count)
 {
   /* USER CODE BEGIN  App_ThreadX_LowPower_Timer_Setup */
-
+	low_power_timer_setup(count);
   /* USER CODE END  App_ThreadX_LowPower_Timer_Setup */
 }
 
@@ -139,6 +143,7 @@ void App_ThreadX_LowPower_Timer_Setup(ULONG count)
 void App_ThreadX_LowPower_Enter(void)
 {
   /* USER CODE BEGIN  App_ThreadX_LowPower_Enter */
+	low_power_enter();
 
   /* USER CODE END  App_ThreadX_LowPower_Enter */
 }
@@ -151,6 +156,7 @@ void App_ThreadX_LowPower_Enter(void)
 void App_ThreadX_LowPower_Exit(void)
 {
   /* USER CODE BEGIN  App_ThreadX_LowPower_Exit */
+	low_power_exit();
 
   /* USER CODE END  App_ThreadX_LowPower_Exit */
 }
@@ -163,7 +169,7 @@ void App_ThreadX_LowPower_Exit(void)
 ULONG App_ThreadX_LowPower_Timer_Adjust(void)
 {
   /* USER CODE BEGIN  App_ThreadX_LowPower_Timer_Adjust */
-  return 0;
+  return low_power_timer_adjust();
   /* USER CODE END  App_ThreadX_LowPower_Timer_Adjust */
 }
 
@@ -5,5 +5,77 @@
  *      Author: Michael Salino-Hugg (msalinohugg@seas.harvard.edu)
  */
 #include "config.h"
+#include "Lib Inc/config_store.h"
+#include "Recovery Inc/AprsPacket.h"
+#include "Recovery Inc/Geofence.h"
+#include <string.h>
 
 Configuration g_config = DEFAULT_CONFIGURATION;
+
+//Stored form of g_config
+typedef struct __attribute__((__packed__)) {
+	uint8_t version;	//CONFIGURATION_VERSION
+	Configuration config;
+}StoredConfiguration;
+
+_Static_assert(sizeof(StoredConfiguration) <= CONFIG_STORE_MAX_VALUE_LENGTH, "Configuration doesn't fit in a store record");
+
+static size_t config_load_string(uint16_t key, char *value, size_t max_length) {
+	size_t length = config_store_read(key, value, max_length);
+	length = (length < max_length) ? length : max_length;
+	value[length] = '\0';
+	return length;
+}
+
+void config_load(void) {
+	StoredConfiguration stored;
+	if ((config_store_read(CONFIG_KEY_CONFIGURATION, &stored, sizeof(stored)) == sizeof(stored))
+			&& (stored.version == CONFIGURATION_VERSION)) {
+		g_config = stored.config;
+	}
+
+	char callsign[7];
+	char comment[APRS_MAX_COMMENT_LEN + 1];
+	uint8_t ssid;
+
+	if (config_load_string(CONFIG_KEY_APRS_CALLSIGN, callsign, sizeof(callsign) - 1) != 0) {
+		aprs_set_callsign(callsign);
+	}
+	if (config_store_read(CONFIG_KEY_APRS_SSID, &ssid, sizeof(ssid)) == sizeof(ssid)) {
+		aprs_set_ssid(ssid);
+	}
+	if (config_load_string(CONFIG_KEY_APRS_COMMENT, comment, sizeof(comment) - 1) != 0) {
+		aprs_set_comment(comment, strlen(comment));
+	}
+	if (config_load_string(CONFIG_KEY_APRS_RCPT_CALLSIGN, callsign, sizeof(callsign) - 1) != 0) {
+		aprs_set_msg_recipient_callsign(callsign);
+	}
+	if (config_store_read(CONFIG_KEY_APRS_RCPT_SSID, &ssid, sizeof(ssid)) == sizeof(ssid)) {
+		aprs_set_msg_recipient_ssid(ssid);
+	}
+}
+
+void config_save(void) {
+	StoredConfiguration stored = {
+		.version = CONFIGURATION_VERSION,
+		.config = g_config,
+	};
+	config_store_write(CONFIG_KEY_CONFIGURATION, &stored, sizeof(stored));
+
+	char callsign[7];
+	char comment[APRS_MAX_COMMENT_LEN + 1];
+	uint8_t ssid;
+
+	aprs_get_callsign(callsign);
+	config_store_write(CONFIG_KEY_APRS_CALLSIGN, callsign, strlen(callsign));
+	aprs_get_ssid(&ssid);
+	config_store_write(CONFIG_KEY_APRS_SSID, &ssid, sizeof(ssid));
+	aprs_get_comment(comment);
+	config_store_write(CONFIG_KEY_APRS_COMMENT, comment, strlen(comment));
+	aprs_get_msg_recipient_callsign(callsign);
+	config_store_write(CONFIG_KEY_APRS_RCPT_CALLSIGN, callsign, strlen(callsign));
+	aprs_get_msg_recipient_ssid(&ssid);
+	config_store_write(CONFIG_KEY_APRS_RCPT_SSID, &ssid, sizeof(ssid));
+
+	geofence_save();
+}
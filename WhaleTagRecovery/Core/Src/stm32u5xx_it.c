@@ -22,6 +22,9 @@
 #include "stm32u5xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "Lib Inc/cpu_load.h"
+#include "Lib Inc/flash.h"
+#include "Lib Inc/low_power.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -60,6 +63,8 @@ extern DMA_QListTypeDef List_GPDMA1_Channel1;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel1;
 extern DAC_HandleTypeDef hdac1;
 extern TIM_HandleTypeDef htim2;
+extern TIM_HandleTypeDef htim7;
+extern DMA_HandleTypeDef handle_GPDMA1_Channel3;
 extern DMA_HandleTypeDef handle_GPDMA1_Channel2;
 extern DMA_NodeTypeDef Node_GPDMA1_Channel0;
 extern DMA_QListTypeDef List_GPDMA1_Channel0;
@@ -80,7 +85,11 @@ extern TIM_HandleTypeDef htim6;
 void NMI_Handler(void)
 {
   /* USER CODE BEGIN NonMaskableInt_IRQn 0 */
-
+  //flash double ECC error, e.g. reading a quad-word whose programming was interrupted: flagged for the reader
+  if (flash_ecc_nmi())
+  {
+    return;
+  }
   /* USER CODE END NonMaskableInt_IRQn 0 */
   /* USER CODE BEGIN NonMaskableInt_IRQn 1 */
   while (1)
@@ -211,6 +220,20 @@ void GPDMA1_Channel2_IRQHandler(void)
   /* USER CODE END GPDMA1_Channel2_IRQn 1 */
 }
 
+/**
+  * @brief This function handles GPDMA1 Channel 3 global interrupt.
+  */
+void GPDMA1_Channel3_IRQHandler(void)
+{
+  /* USER CODE BEGIN GPDMA1_Channel3_IRQn 0 */
+
+  /* USER CODE END GPDMA1_Channel3_IRQn 0 */
+  HAL_DMA_IRQHandler(&handle_GPDMA1_Channel3);
+  /* USER CODE BEGIN GPDMA1_Channel3_IRQn 1 */
+
+  /* USER CODE END GPDMA1_Channel3_IRQn 1 */
+}
+
 /**
   * @brief This function handles DAC1 interrupt.
   */
@@ -245,14 +268,28 @@ void TIM2_IRQHandler(void)
 void TIM6_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM6_IRQn 0 */
-
+  uint32_t start_cycles = DWT->CYCCNT;
   /* USER CODE END TIM6_IRQn 0 */
   HAL_TIM_IRQHandler(&htim6);
   /* USER CODE BEGIN TIM6_IRQn 1 */
-
+  cpu_load_isr_done(CPU_LOAD_ISR_TIM6, start_cycles);
   /* USER CODE END TIM6_IRQn 1 */
 }
 
+/**
+  * @brief This function handles TIM7 global interrupt.
+  */
+void TIM7_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM7_IRQn 0 */
+  uint32_t start_cycles = DWT->CYCCNT;
+  /* USER CODE END TIM7_IRQn 0 */
+  HAL_TIM_IRQHandler(&htim7);
+  /* USER CODE BEGIN TIM7_IRQn 1 */
+  cpu_load_isr_done(CPU_LOAD_ISR_TIM7, start_cycles);
+  /* USER CODE END TIM7_IRQn 1 */
+}
+
 /**
   * @brief This function handles USART2 global interrupt.
   */
@@ -269,4 +306,20 @@ void USART2_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles LPTIM1 global interrupt (wake-up from the tickless idle).
+  */
+void LPTIM1_IRQHandler(void)
+{
+  low_power_lptim_irq_handler();
+}
+
+/**
+  * @brief This function handles EXTI Line3 interrupt (Pi link RX, wake-up from STOP2).
+  */
+void EXTI3_IRQHandler(void)
+{
+  low_power_exti_irq_handler();
+}
+
 /* USER CODE END 1 */
@@ -0,0 +1,290 @@
+/*
+ * shim.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host implementations of the shimmed HAL and ThreadX services, see stm32u5xx_hal.h and tx_api.h.
+ */
+
+#include "stm32u5xx_hal.h"
+#include "tx_api.h"
+#include <time.h>
+
+// === PRIVATE VARIABLES ===
+static GPIO_TypeDef gpio_ports[4];
+static USART_TypeDef usart2;
+static USART_TypeDef usart3;
+static RTC_TypeDef rtc;
+static DWT_Type dwt;
+static TX_TIMER *timers = NULL;
+
+// === PUBLIC VARIABLES ===
+volatile uint32_t shim_tick_ms = 0;
+uint32_t SystemCoreClock = 1000000000;
+
+GPIO_TypeDef *GPIOA = &gpio_ports[0], *GPIOB = &gpio_ports[1], *GPIOC = &gpio_ports[2], *GPIOD = &gpio_ports[3];
+
+//defined by main.c on the target
+UART_HandleTypeDef huart2 = {.Instance = &usart2, .gState = HAL_UART_STATE_READY};
+UART_HandleTypeDef huart3 = {.Instance = &usart3, .gState = HAL_UART_STATE_READY};
+DMA_HandleTypeDef handle_GPDMA1_Channel0;
+RTC_HandleTypeDef hrtc = {.Instance = &rtc};
+IWDG_HandleTypeDef hiwdg;
+uint32_t shim_shutdowns = 0;
+
+// === HAL ===
+uint32_t HAL_GetTick(void) {
+	return shim_tick_ms;
+}
+
+void HAL_Delay(uint32_t delay_ms) {
+	shim_tick_ms += delay_ms;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+	port->ODR = (state == GPIO_PIN_SET) ? (port->ODR | pin) : (port->ODR & ~pin);
+}
+
+HAL_StatusTypeDef HAL_UART_RegisterCallback(UART_HandleTypeDef *huart, HAL_UART_CallbackIDTypeDef id, pUART_CallbackTypeDef callback) {
+	//the receive callbacks are called by the tests directly
+	if (id == HAL_UART_TX_COMPLETE_CB_ID) {
+		huart->TxCpltCallback = callback;
+	} else if (id == HAL_UART_ERROR_CB_ID) {
+		huart->ErrorCallback = callback;
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout) {
+	(void)huart; (void)data; (void)size; (void)timeout;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size) {
+	if (huart->gState != HAL_UART_STATE_READY) {
+		return HAL_BUSY;
+	}
+	huart->pTxBuffPtr = data;
+	huart->TxXferSize = size;
+	huart->gState = HAL_UART_STATE_BUSY_TX;
+	return HAL_OK;
+}
+
+void shim_uart_tx_complete(UART_HandleTypeDef *huart) {
+	huart->gState = HAL_UART_STATE_READY;
+	if (huart->TxCpltCallback != NULL) {
+		huart->TxCpltCallback(huart);
+	}
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+	huart->pRxBuffPtr = data;
+	huart->RxXferSize = size;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+	return HAL_UART_Receive_DMA(huart, data, size);
+}
+
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart) {
+	(void)huart;
+	return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+	return 160000000;
+}
+
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef *hrtc, uint32_t index) {
+	(void)hrtc; (void)index;
+	return 0;
+}
+
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef *hrtc, uint32_t index, uint32_t value) {
+	(void)hrtc; (void)index; (void)value;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *time, uint32_t format) {
+	(void)hrtc; (void)format;
+	*time = (RTC_TimeTypeDef){0};
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *date, uint32_t format) {
+	(void)hrtc; (void)format;
+	*date = (RTC_DateTypeDef){.Month = 1, .Date = 1};
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *time, uint32_t format) {
+	(void)hrtc; (void)time; (void)format;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *date, uint32_t format) {
+	(void)hrtc; (void)date; (void)format;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef *hrtc, uint32_t period, uint32_t plus_pulses, uint32_t minus_pulses) {
+	(void)period;
+	hrtc->Instance->CALR = plus_pulses | minus_pulses;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef *hiwdg) {
+	hiwdg->refreshes++;
+	return HAL_OK;
+}
+
+void HAL_PWREx_EnterSHUTDOWNMode(void) {
+	shim_shutdowns++;
+}
+
+// === CMSIS ===
+DWT_Type *shim_dwt(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	dwt.CYCCNT = (uint32_t)((uint64_t)now.tv_sec * 1000000000 + now.tv_nsec);
+	return &dwt;
+}
+
+// === THREADX ===
+UINT tx_event_flags_create(TX_EVENT_FLAGS_GROUP *group, CHAR *name) {
+	(void)name;
+	group->flags = 0;
+	return TX_SUCCESS;
+}
+
+UINT tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group, ULONG flags, UINT option) {
+	group->flags = (option == TX_OR) ? (group->flags | flags) : (group->flags & flags);
+	return TX_SUCCESS;
+}
+
+UINT tx_event_flags_get(TX_EVENT_FLAGS_GROUP *group, ULONG requested, UINT option, ULONG *actual, ULONG wait_option) {
+	(void)wait_option;
+	*actual = group->flags & requested;
+	if (*actual == 0) {
+		return TX_NO_EVENTS;
+	}
+	if (option == TX_OR_CLEAR) {
+		group->flags &= ~requested;
+	}
+	return TX_SUCCESS;
+}
+
+UINT tx_thread_sleep(ULONG ticks) {
+	shim_tick_ms += ticks * 1000 / TX_TIMER_TICKS_PER_SECOND;
+	return TX_SUCCESS;
+}
+
+UINT tx_thread_suspend(TX_THREAD *thread) {
+	thread->tx_thread_state = TX_SUSPENDED;
+	return TX_SUCCESS;
+}
+
+UINT tx_thread_resume(TX_THREAD *thread) {
+	thread->tx_thread_state = TX_READY;
+	return TX_SUCCESS;
+}
+
+ULONG tx_time_get(void) {
+	return (ULONG)shim_tick_ms * TX_TIMER_TICKS_PER_SECOND / 1000;
+}
+
+UINT tx_block_pool_create(TX_BLOCK_POOL *pool, CHAR *name, ULONG block_size, VOID *area, ULONG area_size) {
+	(void)name;
+	//as ThreadX: each block is preceded by a pointer, to the next free block or, once allocated, to its pool
+	ULONG slot_size = sizeof(VOID *) + ((block_size + sizeof(VOID *) - 1) / sizeof(VOID *)) * sizeof(VOID *);
+	pool->free = NULL;
+	pool->available = 0;
+	for (ULONG offset = 0; (offset + slot_size) <= area_size; offset += slot_size) {
+		VOID **slot = (VOID **)((uint8_t *)area + offset);
+		*slot = pool->free;
+		pool->free = slot;
+		pool->available++;
+	}
+	return TX_SUCCESS;
+}
+
+UINT tx_block_allocate(TX_BLOCK_POOL *pool, VOID **block, ULONG wait_option) {
+	(void)wait_option;
+	if (pool->free == NULL) {
+		return TX_NO_MEMORY;
+	}
+	VOID **slot = pool->free;
+	pool->free = *slot;
+	pool->available--;
+	*slot = pool;
+	*block = slot + 1;
+	return TX_SUCCESS;
+}
+
+UINT tx_block_release(VOID *block) {
+	VOID **slot = (VOID **)block - 1;
+	TX_BLOCK_POOL *pool = *slot;
+	*slot = pool->free;
+	pool->free = slot;
+	pool->available++;
+	return TX_SUCCESS;
+}
+
+UINT tx_timer_create(TX_TIMER *timer, CHAR *name, VOID (*expiration_function)(ULONG input), ULONG input,
+		ULONG initial_ticks, ULONG reschedule_ticks, UINT auto_activate) {
+	(void)name;
+	*timer = (TX_TIMER){
+		.expiration_function = expiration_function,
+		.input = input,
+		.remaining_ticks = initial_ticks,
+		.reschedule_ticks = reschedule_ticks,
+		.active = auto_activate,
+		.next = timers,
+	};
+	timers = timer;
+	return TX_SUCCESS;
+}
+
+UINT tx_timer_activate(TX_TIMER *timer) {
+	if (timer->active || (timer->remaining_ticks == 0)) {
+		return TX_ACTIVATE_ERROR;
+	}
+	timer->active = 1;
+	return TX_SUCCESS;
+}
+
+UINT tx_timer_deactivate(TX_TIMER *timer) {
+	timer->active = 0;
+	return TX_SUCCESS;
+}
+
+UINT tx_timer_change(TX_TIMER *timer, ULONG initial_ticks, ULONG reschedule_ticks) {
+	timer->remaining_ticks = initial_ticks;
+	timer->reschedule_ticks = reschedule_ticks;
+	return TX_SUCCESS;
+}
+
+unsigned int shim_active_timers(void) {
+	unsigned int active = 0;
+	for (TX_TIMER *timer = timers; timer != NULL; timer = timer->next) {
+		active += (timer->active != 0);
+	}
+	return active;
+}
+
+void shim_advance_ms(uint32_t delay_ms) {
+	for (uint32_t i = 0; i < delay_ms; i++) {
+		ULONG ticks = tx_time_get();
+		shim_tick_ms++;
+		for (ticks = tx_time_get() - ticks; ticks != 0; ticks--) {
+			for (TX_TIMER *timer = timers; timer != NULL; timer = timer->next) {
+				if (!timer->active || (--timer->remaining_ticks != 0)) {
+					continue;
+				}
+				timer->remaining_ticks = timer->reschedule_ticks;
+				timer->active = (timer->reschedule_ticks != 0);
+				timer->expiration_function(timer->input);
+			}
+		}
+	}
+}
@@ -0,0 +1,202 @@
+/*
+ * stm32u5xx_hal.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host shim of the parts of the STM32U5 HAL and CMSIS used by the firmware modules under test. Peripherals do
+ * nothing, HAL_GetTick() returns shim_tick_ms (set by the test), and the DWT cycle counter counts host nanoseconds
+ * (SystemCoreClock is 1 GHz), so the firmware's own cycle statistics read as host time.
+ */
+
+#ifndef TESTS_SHIM_STM32U5XX_HAL_H_
+#define TESTS_SHIM_STM32U5XX_HAL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*** HAL *********************************************************************/
+
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR = 1,
+	HAL_BUSY = 2,
+	HAL_TIMEOUT = 3,
+}HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+extern volatile uint32_t shim_tick_ms;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay_ms);
+
+/*** GPIO ********************************************************************/
+
+typedef enum {
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET,
+}GPIO_PinState;
+
+typedef struct {
+	volatile uint32_t ODR;
+}GPIO_TypeDef;
+
+extern GPIO_TypeDef *GPIOA, *GPIOB, *GPIOC, *GPIOD;
+
+#define GPIO_PIN_0  (1U << 0)
+#define GPIO_PIN_1  (1U << 1)
+#define GPIO_PIN_2  (1U << 2)
+#define GPIO_PIN_3  (1U << 3)
+#define GPIO_PIN_4  (1U << 4)
+#define GPIO_PIN_5  (1U << 5)
+#define GPIO_PIN_6  (1U << 6)
+#define GPIO_PIN_11 (1U << 11)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+
+/*** UART/DMA ****************************************************************/
+
+typedef struct {
+	volatile uint32_t CR1;
+	volatile uint32_t CR3;
+	volatile uint32_t BRR;
+}USART_TypeDef;
+
+typedef struct {
+	int unused;
+}DMA_HandleTypeDef;
+
+typedef struct {
+	uint32_t BaudRate;
+	uint32_t ClockPrescaler;
+}UART_InitTypeDef;
+
+typedef enum {
+	HAL_UART_STATE_READY = 0x20,
+	HAL_UART_STATE_BUSY_TX = 0x21,
+}HAL_UART_StateTypeDef;
+
+typedef enum {
+	HAL_UART_TX_COMPLETE_CB_ID,
+	HAL_UART_RX_HALFCOMPLETE_CB_ID,
+	HAL_UART_RX_COMPLETE_CB_ID,
+	HAL_UART_ERROR_CB_ID,
+}HAL_UART_CallbackIDTypeDef;
+
+typedef struct __UART_HandleTypeDef UART_HandleTypeDef;
+
+typedef void (*pUART_CallbackTypeDef)(UART_HandleTypeDef *huart);
+
+struct __UART_HandleTypeDef {
+	USART_TypeDef *Instance;
+	UART_InitTypeDef Init;
+	const uint8_t *pTxBuffPtr;	//transmission in progress, for the test to read out as the DMA would
+	uint16_t TxXferSize;
+	uint8_t *pRxBuffPtr;	//reception buffer, for the test to write into as the DMA would
+	uint16_t RxXferSize;
+	volatile HAL_UART_StateTypeDef gState;
+	pUART_CallbackTypeDef TxCpltCallback;
+	pUART_CallbackTypeDef ErrorCallback;
+};
+
+#define USART_CR1_UE (1U << 0)
+#define USART_CR3_EIE (1U << 0)
+#define __HAL_UART_ENABLE(HANDLE)  ((HANDLE)->Instance->CR1 |= USART_CR1_UE)
+#define __HAL_UART_DISABLE(HANDLE) ((HANDLE)->Instance->CR1 &= ~USART_CR1_UE)
+#define UART_DIV_SAMPLING16(CLOCK, BAUD, PRESCALER) ((CLOCK) / (BAUD))
+
+#define SET_BIT(REG, BIT)   ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+
+HAL_StatusTypeDef HAL_UART_RegisterCallback(UART_HandleTypeDef *huart, HAL_UART_CallbackIDTypeDef id, pUART_CallbackTypeDef callback);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+//End of the transmission started by HAL_UART_Transmit_DMA(): the handle is ready again and the registered transmit
+//complete callback runs, as from the interrupt
+void shim_uart_tx_complete(UART_HandleTypeDef *huart);
+
+/*** RTC *******************************************************************/
+
+typedef struct {
+	volatile uint32_t CALR;
+}RTC_TypeDef;
+
+typedef struct {
+	RTC_TypeDef *Instance;
+}RTC_HandleTypeDef;
+
+typedef struct {
+	uint8_t Hours;
+	uint8_t Minutes;
+	uint8_t Seconds;
+	uint32_t SubSeconds;
+	uint32_t SecondFraction;
+	uint32_t DayLightSaving;
+	uint32_t StoreOperation;
+}RTC_TimeTypeDef;
+
+typedef struct {
+	uint8_t WeekDay;
+	uint8_t Month;
+	uint8_t Date;
+	uint8_t Year;
+}RTC_DateTypeDef;
+
+#define RTC_FORMAT_BIN                  0U
+#define RTC_DAYLIGHTSAVING_NONE         0U
+#define RTC_STOREOPERATION_RESET        0U
+#define RTC_BKP_DR0                     0U
+#define RTC_CALR_CALP                   (1U << 15)
+#define RTC_CALR_CALM                   0x1FFU
+#define RTC_SMOOTHCALIB_PERIOD_32SEC    0U
+#define RTC_SMOOTHCALIB_PLUSPULSES_SET  RTC_CALR_CALP
+#define RTC_SMOOTHCALIB_PLUSPULSES_RESET 0U
+
+#define READ_REG(REG) ((REG))
+
+//the backup registers read back as 0 (RTC never set)
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef *hrtc, uint32_t index);
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef *hrtc, uint32_t index, uint32_t value);
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *time, uint32_t format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *date, uint32_t format);
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef *hrtc, RTC_TimeTypeDef *time, uint32_t format);
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef *hrtc, RTC_DateTypeDef *date, uint32_t format);
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef *hrtc, uint32_t period, uint32_t plus_pulses, uint32_t minus_pulses);
+
+/*** IWDG / PWR **************************************************************/
+
+typedef struct {
+	uint32_t refreshes;
+}IWDG_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_IWDG_Refresh(IWDG_HandleTypeDef *hiwdg);
+
+//returns on the host, counting the calls in shim_shutdowns
+void HAL_PWREx_EnterSHUTDOWNMode(void);
+extern uint32_t shim_shutdowns;
+
+/*** CMSIS *******************************************************************/
+
+typedef struct {
+	volatile uint32_t CYCCNT;
+}DWT_Type;
+
+//reading DWT->CYCCNT samples the host clock
+DWT_Type *shim_dwt(void);
+#define DWT (shim_dwt())
+
+extern uint32_t SystemCoreClock;
+
+#define __disable_irq() do {} while (0)
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+
+#define ATOMIC_SET_BIT(REG, BIT)   ((REG) |= (BIT))
+#define ATOMIC_CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+
+#endif /* TESTS_SHIM_STM32U5XX_HAL_H_ */
@@ -0,0 +1,2 @@
+/* Host shim, see stm32u5xx_hal.h */
+#include "stm32u5xx_hal.h"
@@ -0,0 +1,86 @@
+/*
+ * tx_api.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Host shim of the ThreadX services used by the firmware modules under test. There is no scheduler: event flags
+ * are plain bit masks that are never waited on, threads are never started, and timers only expire when the test
+ * moves the time on with shim_advance_ms().
+ */
+
+#ifndef TESTS_SHIM_TX_API_H_
+#define TESTS_SHIM_TX_API_H_
+
+#include "tx_user.h"
+#include <stdint.h>
+
+typedef unsigned long ULONG;
+typedef unsigned int UINT;
+typedef char CHAR;
+typedef void VOID;
+
+typedef struct {
+	ULONG flags;
+}TX_EVENT_FLAGS_GROUP;
+
+typedef struct {
+	UINT tx_thread_state;	//TX_READY or TX_SUSPENDED, as set by tx_thread_resume()/tx_thread_suspend()
+}TX_THREAD;
+
+typedef struct {
+	int unused;
+}TX_QUEUE;
+
+typedef struct {
+	VOID *free;		//free blocks, linked through their header word
+	ULONG available;
+}TX_BLOCK_POOL;
+
+typedef struct TX_TIMER_STRUCT {
+	VOID (*expiration_function)(ULONG input);
+	ULONG input;
+	ULONG remaining_ticks;
+	ULONG reschedule_ticks;
+	UINT active;
+	struct TX_TIMER_STRUCT *next;
+}TX_TIMER;
+
+#define TX_SUCCESS      0x00
+#define TX_NO_EVENTS    0x07
+#define TX_WAIT_FOREVER 0xFFFFFFFFUL
+#define TX_NO_WAIT      0
+#define TX_OR           0
+#define TX_OR_CLEAR     1
+#define TX_NO_MEMORY    0x10
+#define TX_READY        0
+#define TX_SUSPENDED    3
+#define TX_NO_TIME_SLICE 0
+#define TX_AUTO_START   1
+#define TX_DONT_START   0
+#define TX_AUTO_ACTIVATE 1
+#define TX_NO_ACTIVATE  0
+#define TX_ACTIVATE_ERROR 0x17
+
+UINT tx_event_flags_create(TX_EVENT_FLAGS_GROUP *group, CHAR *name);
+UINT tx_event_flags_set(TX_EVENT_FLAGS_GROUP *group, ULONG flags, UINT option);
+UINT tx_event_flags_get(TX_EVENT_FLAGS_GROUP *group, ULONG requested, UINT option, ULONG *actual, ULONG wait_option);
+UINT tx_thread_sleep(ULONG ticks);
+UINT tx_thread_suspend(TX_THREAD *thread);
+UINT tx_thread_resume(TX_THREAD *thread);
+ULONG tx_time_get(void);
+UINT tx_block_pool_create(TX_BLOCK_POOL *pool, CHAR *name, ULONG block_size, VOID *area, ULONG area_size);
+UINT tx_block_allocate(TX_BLOCK_POOL *pool, VOID **block, ULONG wait_option);
+UINT tx_block_release(VOID *block);
+UINT tx_timer_create(TX_TIMER *timer, CHAR *name, VOID (*expiration_function)(ULONG input), ULONG input,
+		ULONG initial_ticks, ULONG reschedule_ticks, UINT auto_activate);
+UINT tx_timer_activate(TX_TIMER *timer);
+UINT tx_timer_deactivate(TX_TIMER *timer);
+UINT tx_timer_change(TX_TIMER *timer, ULONG initial_ticks, ULONG reschedule_ticks);
+
+//Number of active timers, e.g. to check nothing keeps waking the board
+unsigned int shim_active_timers(void);
+
+//Moves shim_tick_ms on by delay_ms, one tick at a time, running the timers expiring on the way
+void shim_advance_ms(uint32_t delay_ms);
+
+#endif /* TESTS_SHIM_TX_API_H_ */
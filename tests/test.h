@@ -0,0 +1,78 @@
+/*
+ * test.h
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Minimal checks for the host tests. A failed check prints its location and the test carries on, the executable
+ * returns non-zero if anything failed (see test_report()).
+ */
+
+#ifndef TESTS_TEST_H_
+#define TESTS_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+#define CHECK(COND) do { \
+		test_checks++; \
+		if (!(COND)) { \
+			test_failures++; \
+			printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #COND); \
+		} \
+	} while (0)
+
+#define CHECK_EQ(A, B) do { \
+		long long _a = (long long)(A), _b = (long long)(B); \
+		test_checks++; \
+		if (_a != _b) { \
+			test_failures++; \
+			printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #A, #B, _a, _b); \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(A, B, TOLERANCE) do { \
+		double _a = (double)(A), _b = (double)(B); \
+		test_checks++; \
+		if (!((_a - _b) <= (TOLERANCE) && (_b - _a) <= (TOLERANCE))) { \
+			test_failures++; \
+			printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g != %g\n", __FILE__, __LINE__, #A, #B, _a, _b); \
+		} \
+	} while (0)
+
+#define CHECK_MEM(A, B, LENGTH) CHECK(memcmp((A), (B), (LENGTH)) == 0)
+
+#define RUN(TEST) do { \
+		int _failures = test_failures; \
+		TEST(); \
+		printf("%s %s\n", (test_failures == _failures) ? "PASS" : "FAIL", #TEST); \
+	} while (0)
+
+static inline int test_report(void) {
+	printf("%d checks, %d failed\n", test_checks, test_failures);
+	return (test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//Deterministic pseudo-random numbers (xorshift32), so that a failure can be replayed with the same seed
+static unsigned int test_random_state = 1;
+
+static inline void test_random_seed(unsigned int seed) {
+	test_random_state = (seed != 0) ? seed : 1;
+}
+
+static inline unsigned int test_random(void) {
+	unsigned int x = test_random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return test_random_state = x;
+}
+
+static inline unsigned int test_random_below(unsigned int bound) {
+	return (bound == 0) ? 0 : (test_random() % bound);
+}
+
+#endif /* TESTS_TEST_H_ */
@@ -0,0 +1,240 @@
+/*
+ * test_drift_predictor.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Dead-reckoning between fixes (Recovery Src/DriftPredictor.c): checks of the track start/restart rules and of the
+ * course/speed on a clean drift, then a replay of drift tracks (current plus a veering wind drift, GPS noise, and
+ * most lock attempts lost to wave wash) checking the predictions against the true position.
+ */
+
+#include "test.h"
+#include "Recovery Inc/DriftPredictor.h"
+#include <math.h>
+
+#define PI 3.14159265358979
+#define METERS_PER_DEGREE 111320.0
+
+//Off Dominica, where the tags are deployed
+#define START_LATITUDE  15.30
+#define START_LONGITUDE -61.45
+
+typedef struct {
+	double north_m;
+	double east_m;
+}Offset;
+
+static void offset_to_position(Offset offset, float *latitude, float *longitude) {
+	*latitude = (float)(START_LATITUDE + offset.north_m / METERS_PER_DEGREE);
+	*longitude = (float)(START_LONGITUDE + offset.east_m / (METERS_PER_DEGREE * cos(START_LATITUDE * PI / 180)));
+}
+
+static double distance_m(Offset offset, float latitude, float longitude) {
+	double north_m = (latitude - START_LATITUDE) * METERS_PER_DEGREE - offset.north_m;
+	double east_m = (longitude - START_LONGITUDE) * METERS_PER_DEGREE * cos(START_LATITUDE * PI / 180) - offset.east_m;
+	return sqrt(north_m * north_m + east_m * east_m);
+}
+
+//Roughly gaussian, from the sum of 4 uniform draws
+static double random_normal(double sigma) {
+	double sum = 0;
+	for (int i = 0; i < 4; i++) {
+		sum += test_random_below(10001) / 10000.0 - 0.5;
+	}
+	return sum * sqrt(3.0) * sigma;
+}
+
+static void test_needs_two_recent_fixes(void) {
+	DriftPredictor predictor;
+	DriftEstimate estimate;
+	drift_predictor_init(&predictor);
+	CHECK(!drift_predictor_estimate(&predictor, 0, &estimate));
+
+	float latitude, longitude;
+	offset_to_position((Offset){0, 0}, &latitude, &longitude);
+	drift_predictor_update(&predictor, latitude, longitude, 1000);
+	CHECK(!drift_predictor_estimate(&predictor, 2000, &estimate));
+
+	//a second fix in the same epoch does not make a track
+	drift_predictor_update(&predictor, latitude, longitude, 1000);
+	CHECK(!drift_predictor_estimate(&predictor, 2000, &estimate));
+
+	offset_to_position((Offset){100, 0}, &latitude, &longitude);
+	drift_predictor_update(&predictor, latitude, longitude, 1000 + 200 * 1000);
+	CHECK(drift_predictor_estimate(&predictor, 1000 + 200 * 1000, &estimate));
+	CHECK(drift_predictor_estimate(&predictor, 1000 + 200 * 1000 + DRIFT_MAX_PREDICTION_MS, &estimate));
+	CHECK(!drift_predictor_estimate(&predictor, 1000 + 200 * 1000 + DRIFT_MAX_PREDICTION_MS + 1, &estimate));
+}
+
+static void test_steady_drift(void) {
+	//0.5 m/s towards the north east, a fix every 5 min without noise
+	const double speed_m_s = 0.5, course_deg = 45;
+	double north_m_s = speed_m_s * cos(course_deg * PI / 180), east_m_s = speed_m_s * sin(course_deg * PI / 180);
+
+	DriftPredictor predictor;
+	DriftEstimate estimate;
+	drift_predictor_init(&predictor);
+	uint32_t now_ms = 0;
+	for (int i = 0; i < 6; i++, now_ms += 300 * 1000) {
+		float latitude, longitude;
+		offset_to_position((Offset){north_m_s * now_ms / 1000, east_m_s * now_ms / 1000}, &latitude, &longitude);
+		drift_predictor_update(&predictor, latitude, longitude, now_ms);
+	}
+	uint32_t last_fix_ms = now_ms - 300 * 1000;
+
+	//30 min after the last fix
+	uint32_t estimate_ms = last_fix_ms + 30 * 60 * 1000;
+	CHECK(drift_predictor_estimate(&predictor, estimate_ms, &estimate));
+	CHECK_EQ(estimate.age_ms, 30 * 60 * 1000);
+	CHECK_NEAR(estimate.course_deg, course_deg, 1);
+	CHECK_NEAR(estimate.speed_mm_s, speed_m_s * 1000, 10);
+	Offset truth = {north_m_s * estimate_ms / 1000, east_m_s * estimate_ms / 1000};
+	CHECK(distance_m(truth, estimate.latitude, estimate.longitude) < 20);
+
+	//the radius grows with the age from the fix uncertainty, by at least the speed floor
+	CHECK(drift_predictor_estimate(&predictor, last_fix_ms, &estimate));
+	CHECK_EQ(estimate.radius_m, DRIFT_FIX_UNCERTAINTY_M);
+	CHECK(drift_predictor_estimate(&predictor, estimate_ms, &estimate));
+	CHECK(estimate.radius_m >= DRIFT_FIX_UNCERTAINTY_M + DRIFT_MIN_SPEED_SIGMA_MM_S * 30 * 60 / 1000);
+
+	//course quadrants: due west
+	drift_predictor_init(&predictor);
+	for (uint32_t t = 0; t <= 600; t += 300) {
+		float latitude, longitude;
+		offset_to_position((Offset){0, -0.3 * t}, &latitude, &longitude);
+		drift_predictor_update(&predictor, latitude, longitude, t * 1000);
+	}
+	CHECK(drift_predictor_estimate(&predictor, 600 * 1000, &estimate));
+	CHECK_NEAR(estimate.course_deg, 270, 1);
+	CHECK_NEAR(estimate.speed_mm_s, 300, 10);
+}
+
+static void test_restarts(void) {
+	DriftPredictor predictor;
+	DriftEstimate estimate;
+	float latitude, longitude;
+	drift_predictor_init(&predictor);
+	for (uint32_t t = 0; t <= 900; t += 300) {
+		offset_to_position((Offset){0.4 * t, 0}, &latitude, &longitude);
+		drift_predictor_update(&predictor, latitude, longitude, t * 1000);
+	}
+	CHECK_EQ(predictor.fixes, 4);
+
+	//picked up and carried away: further than DRIFT_RESET_DISTANCE_M from the prediction
+	offset_to_position((Offset){0.4 * 1200 + DRIFT_RESET_DISTANCE_M + 100, 0}, &latitude, &longitude);
+	drift_predictor_update(&predictor, latitude, longitude, 1200 * 1000);
+	CHECK_EQ(predictor.fixes, 1);
+	CHECK(!drift_predictor_estimate(&predictor, 1200 * 1000, &estimate));
+
+	//fixes too far apart in time
+	drift_predictor_update(&predictor, latitude, longitude, 1500 * 1000);
+	CHECK_EQ(predictor.fixes, 2);
+	drift_predictor_update(&predictor, latitude, longitude, 1500 * 1000 + DRIFT_MAX_FIX_GAP_MS + 1);
+	CHECK_EQ(predictor.fixes, 1);
+
+	//tick counter wrapping around between fixes
+	drift_predictor_init(&predictor);
+	offset_to_position((Offset){0, 0}, &latitude, &longitude);
+	drift_predictor_update(&predictor, latitude, longitude, UINT32_MAX - 100 * 1000);
+	offset_to_position((Offset){0, 50}, &latitude, &longitude);
+	drift_predictor_update(&predictor, latitude, longitude, 100 * 1000);
+	CHECK(drift_predictor_estimate(&predictor, 100 * 1000, &estimate));
+	CHECK_NEAR(estimate.speed_mm_s, 250, 10);
+}
+
+/* Replay ------------------------------------------------------------------- */
+
+//A drift track sampled every TRACK_STEP_S: a steady current plus a wind drift veering by up to 90 degrees over the
+//track, fixes every WAKE_PERIOD_S when the lock attempt succeeds
+#define TRACK_STEP_S       10
+#define TRACK_LENGTH_S     (8 * 60 * 60)
+#define WAKE_PERIOD_S      (5 * 60)
+#define GPS_NOISE_SIGMA_M  5.0
+#define FIX_PROBABILITY    35 //%
+
+typedef struct {
+	unsigned int predictions;
+	unsigned int inside_radius;
+	double error_sum_m;
+	double last_fix_error_sum_m;
+	double worst_error_m;
+}ReplayStats;
+
+static void replay_track(unsigned int seed, ReplayStats *stats) {
+	test_random_seed(seed);
+	double current_speed = 0.1 + test_random_below(500) / 1000.0;
+	double current_course = test_random_below(360) * PI / 180;
+	double wind_speed = 0.05 + test_random_below(300) / 1000.0;
+	double wind_course = test_random_below(360) * PI / 180;
+	double veer = ((double)test_random_below(180) - 90) * PI / 180 / TRACK_LENGTH_S;
+
+	DriftPredictor predictor;
+	drift_predictor_init(&predictor);
+	Offset truth = {0, 0};
+	Offset last_fix = {0, 0};
+	bool has_fix = false;
+
+	for (uint32_t t = 0; t <= TRACK_LENGTH_S; t += TRACK_STEP_S) {
+		double wind = wind_course + veer * t;
+		truth.north_m += (current_speed * cos(current_course) + wind_speed * cos(wind)) * TRACK_STEP_S;
+		truth.east_m += (current_speed * sin(current_course) + wind_speed * sin(wind)) * TRACK_STEP_S;
+
+		if ((t % WAKE_PERIOD_S) != 0) {
+			continue;
+		}
+		uint32_t now_ms = t * 1000;
+
+		if (test_random_below(100) < FIX_PROBABILITY) {
+			Offset fix = {truth.north_m + random_normal(GPS_NOISE_SIGMA_M), truth.east_m + random_normal(GPS_NOISE_SIGMA_M)};
+			float latitude, longitude;
+			offset_to_position(fix, &latitude, &longitude);
+			drift_predictor_update(&predictor, latitude, longitude, now_ms);
+			last_fix = fix;
+			has_fix = true;
+			continue;
+		}
+
+		//wave wash: what would go out instead
+		DriftEstimate estimate;
+		if (!drift_predictor_estimate(&predictor, now_ms, &estimate)) {
+			continue;
+		}
+		double error_m = distance_m(truth, estimate.latitude, estimate.longitude);
+		stats->predictions++;
+		stats->inside_radius += (error_m <= estimate.radius_m);
+		stats->error_sum_m += error_m;
+		stats->worst_error_m = (error_m > stats->worst_error_m) ? error_m : stats->worst_error_m;
+		if (has_fix) {
+			double north_m = truth.north_m - last_fix.north_m, east_m = truth.east_m - last_fix.east_m;
+			stats->last_fix_error_sum_m += sqrt(north_m * north_m + east_m * east_m);
+		}
+	}
+}
+
+static void test_replay_drift_tracks(void) {
+	enum { NUM_TRACKS = 50 };
+	ReplayStats stats = {0};
+	for (unsigned int seed = 1; seed <= NUM_TRACKS; seed++) {
+		replay_track(seed * 7919, &stats);
+	}
+
+	double mean_error_m = stats.error_sum_m / stats.predictions;
+	double mean_last_fix_error_m = stats.last_fix_error_sum_m / stats.predictions;
+	printf("%u predictions, %.1f%% inside the radius, mean error %.0f m (last fix: %.0f m), worst %.0f m\n",
+			stats.predictions, 100.0 * stats.inside_radius / stats.predictions, mean_error_m, mean_last_fix_error_m,
+			stats.worst_error_m);
+
+	CHECK(stats.predictions > NUM_TRACKS * 50);
+	//the radius covers the true position most of the time
+	CHECK(stats.inside_radius * 100 >= stats.predictions * 90);
+	//and the prediction is much closer than the last fix
+	CHECK(mean_error_m * 3 < mean_last_fix_error_m);
+}
+
+int main(void) {
+	RUN(test_needs_two_recent_fixes);
+	RUN(test_steady_drift);
+	RUN(test_restarts);
+	RUN(test_replay_drift_tracks);
+	return test_report();
+}
@@ -0,0 +1,300 @@
+/*
+ * test_gps_acquisition.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Adaptive acquisition policy (Recovery Src/GpsAcquisition.c): unit checks of the abort/extend rules and of the
+ * timeout estimator, then a replay of simulated surfacing cycles comparing the receiver on-time, and so the energy,
+ * per successful fix against fixed timeouts.
+ */
+
+#include "test.h"
+#include "Recovery Inc/GpsAcquisition.h"
+
+#define UPDATE_PERIOD_MS 1000
+
+//NEO-M9N acquisition power (about 30 mA at 3.3 V), only used to express the on-time as energy
+#define ACQUISITION_POWER_MW 100
+
+static const GpsSignalSummary no_signal = {.satellites_in_view = 0, .satellites_with_signal = 0, .max_cno = 0};
+
+static void test_aborts_without_signal(void) {
+	GpsAcqEstimator estimator;
+	GpsAcqAttempt attempt;
+	gps_acq_init(&estimator);
+	gps_acq_start(&estimator, &attempt, 1000);
+
+	uint32_t now = 1000;
+	GpsAcqResult result;
+	while ((result = gps_acq_update(&attempt, now, false, &no_signal)) == GPS_ACQ_CONTINUE) {
+		now += UPDATE_PERIOD_MS;
+	}
+	CHECK_EQ(result, GPS_ACQ_ABORT_NO_SIGNAL);
+	CHECK_EQ(now - 1000, GPS_ACQ_NO_SIGNAL_ABORT_MS);
+
+	//says nothing about the time to lock
+	gps_acq_finish(&estimator, &attempt, result, now);
+	CHECK_EQ(estimator.next_timeout_ms, GPS_ACQ_INITIAL_TIMEOUT_MS);
+	CHECK_EQ(estimator.aborts_no_signal, 1);
+	CHECK_EQ(estimator.attempts, 1);
+
+	//weak satellites only (below GPS_ACQ_MIN_CNO) are no signal either
+	const GpsSignalSummary weak = {.satellites_in_view = 6, .satellites_with_signal = 0, .max_cno = GPS_ACQ_MIN_CNO - 1};
+	gps_acq_start(&estimator, &attempt, 0);
+	CHECK_EQ(gps_acq_update(&attempt, GPS_ACQ_NO_SIGNAL_ABORT_MS - 1, false, &weak), GPS_ACQ_CONTINUE);
+	CHECK_EQ(gps_acq_update(&attempt, GPS_ACQ_NO_SIGNAL_ABORT_MS, false, &weak), GPS_ACQ_ABORT_NO_SIGNAL);
+}
+
+static void test_extends_while_progressing(void) {
+	GpsAcqEstimator estimator;
+	GpsAcqAttempt attempt;
+	gps_acq_init(&estimator);
+	estimator.next_timeout_ms = 20 * 1000;
+	gps_acq_start(&estimator, &attempt, 0);
+
+	//a new satellite every 3 s: the deadline keeps moving until GPS_ACQ_MAX_TIMEOUT_MS
+	uint32_t now = 0;
+	GpsAcqResult result;
+	do {
+		GpsSignalSummary signal = {.satellites_in_view = 12, .satellites_with_signal = 1 + now / 3000, .max_cno = 30};
+		result = gps_acq_update(&attempt, now, false, &signal);
+		now += UPDATE_PERIOD_MS;
+	} while (result == GPS_ACQ_CONTINUE);
+	CHECK_EQ(result, GPS_ACQ_TIMEOUT);
+	CHECK(attempt.deadline_ms - attempt.start_ms <= GPS_ACQ_MAX_TIMEOUT_MS);
+	CHECK(now > GPS_ACQ_MAX_TIMEOUT_MS - GPS_ACQ_EXTEND_MS);
+
+	//stalled signal: stops at the first deadline
+	gps_acq_start(&estimator, &attempt, 0);
+	const GpsSignalSummary stalled = {.satellites_in_view = 8, .satellites_with_signal = 3, .max_cno = 28};
+	now = 0;
+	while ((result = gps_acq_update(&attempt, now, false, &stalled)) == GPS_ACQ_CONTINUE) {
+		now += UPDATE_PERIOD_MS;
+	}
+	CHECK_EQ(result, GPS_ACQ_TIMEOUT);
+	CHECK_EQ(now, 20 * 1000);
+
+	//a fix ends the attempt whatever the signal
+	CHECK_EQ(gps_acq_update(&attempt, now, true, &no_signal), GPS_ACQ_SUCCESS);
+}
+
+static void test_estimator(void) {
+	GpsAcqEstimator estimator;
+	GpsAcqAttempt attempt;
+	gps_acq_init(&estimator);
+
+	//first success sets the average, the timeout is GPS_ACQ_TIMEOUT_MARGIN times it
+	gps_acq_start(&estimator, &attempt, 0);
+	gps_acq_finish(&estimator, &attempt, GPS_ACQ_SUCCESS, 8000);
+	CHECK_EQ(estimator.average_lock_ms, 8000);
+	CHECK_EQ(estimator.next_timeout_ms, GPS_ACQ_TIMEOUT_MARGIN * 8000);
+
+	//then a 1/4 weight on the newest
+	gps_acq_start(&estimator, &attempt, 0);
+	gps_acq_finish(&estimator, &attempt, GPS_ACQ_SUCCESS, 16000);
+	CHECK_EQ(estimator.average_lock_ms, 10000);
+	CHECK_EQ(estimator.next_timeout_ms, GPS_ACQ_TIMEOUT_MARGIN * 10000);
+
+	//a timeout with signal grows it by half, up to the maximum
+	gps_acq_start(&estimator, &attempt, 0);
+	gps_acq_finish(&estimator, &attempt, GPS_ACQ_TIMEOUT, 20000);
+	CHECK_EQ(estimator.next_timeout_ms, 30000);
+	for (int i = 0; i < 10; i++) {
+		gps_acq_finish(&estimator, &attempt, GPS_ACQ_TIMEOUT, 20000);
+	}
+	CHECK_EQ(estimator.next_timeout_ms, GPS_ACQ_MAX_TIMEOUT_MS);
+
+	//hot starts bring it down to the minimum
+	for (int i = 0; i < 30; i++) {
+		gps_acq_start(&estimator, &attempt, 0);
+		gps_acq_finish(&estimator, &attempt, GPS_ACQ_SUCCESS, 1000);
+	}
+	CHECK_EQ(estimator.next_timeout_ms, GPS_ACQ_MIN_TIMEOUT_MS);
+	CHECK_EQ(estimator.successes, 32);
+	CHECK_EQ(estimator.timeouts, 11);
+
+	//tick counter wrapping around during an attempt
+	gps_acq_init(&estimator);
+	gps_acq_start(&estimator, &attempt, UINT32_MAX - 1000);
+	gps_acq_finish(&estimator, &attempt, GPS_ACQ_SUCCESS, 3000);
+	CHECK_EQ(estimator.average_lock_ms, 4001);
+}
+
+//The APRS thread's retry loop under water: every attempt aborts for lack of signal and powers the receiver down, the
+//next wake is a cold start (boot + default cold time to first fix ahead of the planned fix, see GPS.h)
+static void test_retry_leaves_receiver_off(void) {
+	enum { RETRY_OFF_MS = 10 * 1000, COLD_WAKE_LEAD_MS = 1000 + 30 * 1000, BOOT_MS = 1000 };
+	GpsAcqEstimator estimator;
+	gps_acq_init(&estimator);
+
+	uint32_t now = UINT32_MAX - 30 * 1000; //through the tick wrap around
+	uint32_t due = now;
+	bool receiver_on = false;
+	uint32_t attempts = 0, min_off_ms = UINT32_MAX;
+	uint64_t on_ms = 0, off_ms = 0;
+	while (on_ms + off_ms < 60 * 60 * 1000) {
+		//sleep until the wake lead of the current power state ahead of the planned fix
+		uint32_t wake_lead = receiver_on ? 0 : COLD_WAKE_LEAD_MS;
+		int32_t until_wake = (int32_t)(due - wake_lead - now);
+		until_wake = (until_wake > 0) ? until_wake : 0;
+		now += until_wake;
+		off_ms += until_wake;
+		if ((attempts > 0) && ((uint32_t)until_wake < min_off_ms)) {
+			min_off_ms = until_wake;
+		}
+
+		//cold start, then the attempt gives up without signal
+		GpsAcqAttempt attempt;
+		receiver_on = true;
+		gps_acq_start(&estimator, &attempt, now);
+		now += BOOT_MS;
+		on_ms += BOOT_MS;
+		while (gps_acq_update(&attempt, now, false, &no_signal) == GPS_ACQ_CONTINUE) {
+			now += UPDATE_PERIOD_MS;
+			on_ms += UPDATE_PERIOD_MS;
+		}
+		attempts++;
+
+		//powered down (gps_sleep_for()), the wake lead is taken after that
+		receiver_on = false;
+		due = gps_acq_plan_retry(now, RETRY_OFF_MS, COLD_WAKE_LEAD_MS);
+	}
+
+	//every retry keeps the receiver off for the full period
+	printf("%u attempts in an hour under water, receiver on %.0f%% of the time\n", attempts, 100.0 * on_ms / (on_ms + off_ms));
+	CHECK_EQ(min_off_ms, RETRY_OFF_MS);
+	CHECK(attempts <= (60 * 60 * 1000) / (GPS_ACQ_NO_SIGNAL_ABORT_MS + RETRY_OFF_MS) + 1);
+
+	//a receiver left on (timeout with signal) has no wake lead, it is retried after the period itself
+	CHECK_EQ(gps_acq_plan_retry(UINT32_MAX - 100, RETRY_OFF_MS, 0), RETRY_OFF_MS - 101);
+}
+
+/* Replay ------------------------------------------------------------------- */
+
+typedef enum {
+	SURFACE_SUBMERGED,	//nothing above the noise floor
+	SURFACE_OPEN_SKY,	//satellites come in one by one until the fix
+	SURFACE_WAVE_WASH,	//signal, but waves keep the receiver from locking
+}SurfaceKind;
+
+typedef struct {
+	SurfaceKind kind;
+	uint32_t time_to_fix_ms;
+}Surfacing;
+
+static GpsSignalSummary surfacing_signal(const Surfacing *surfacing, uint32_t elapsed_ms) {
+	GpsSignalSummary signal = no_signal;
+	switch (surfacing->kind) {
+		case SURFACE_SUBMERGED:
+			break;
+		case SURFACE_OPEN_SKY: {
+			uint32_t satellites = 1 + (12 * elapsed_ms) / surfacing->time_to_fix_ms;
+			signal.satellites_in_view = 16;
+			signal.satellites_with_signal = (satellites > 12) ? 12 : satellites;
+			signal.max_cno = 24 + ((elapsed_ms < 12000) ? elapsed_ms / 1000 : 12);
+			break;
+		}
+		case SURFACE_WAVE_WASH:
+			signal.satellites_in_view = 10;
+			signal.satellites_with_signal = 2 + (elapsed_ms / 4000) % 2;
+			signal.max_cno = 26;
+			break;
+	}
+	return signal;
+}
+
+typedef struct {
+	const char *name;
+	bool adaptive;
+	uint32_t fixed_timeout_ms;
+	uint32_t fixes;
+	uint64_t on_ms;
+}Policy;
+
+//Runs one attempt of the policy on a surfacing, returns true on a fix
+static bool replay_attempt(Policy *policy, GpsAcqEstimator *estimator, const Surfacing *surfacing) {
+	GpsAcqAttempt attempt;
+	uint32_t start = 1000000;
+	if (policy->adaptive) {
+		gps_acq_start(estimator, &attempt, start);
+	}
+
+	for (uint32_t elapsed = 0; ; elapsed += UPDATE_PERIOD_MS) {
+		bool has_fix = (surfacing->kind == SURFACE_OPEN_SKY) && (elapsed >= surfacing->time_to_fix_ms);
+		GpsAcqResult result;
+		if (policy->adaptive) {
+			GpsSignalSummary signal = surfacing_signal(surfacing, elapsed);
+			result = gps_acq_update(&attempt, start + elapsed, has_fix, &signal);
+		} else {
+			result = has_fix ? GPS_ACQ_SUCCESS : ((elapsed >= policy->fixed_timeout_ms) ? GPS_ACQ_TIMEOUT : GPS_ACQ_CONTINUE);
+		}
+
+		if (result != GPS_ACQ_CONTINUE) {
+			if (policy->adaptive) {
+				gps_acq_finish(estimator, &attempt, result, start + elapsed);
+			}
+			policy->on_ms += elapsed;
+			policy->fixes += (result == GPS_ACQ_SUCCESS);
+			return result == GPS_ACQ_SUCCESS;
+		}
+	}
+}
+
+static void test_replay_energy_per_fix(void) {
+	//A drifting tag: half the wakes under water, some in wave wash, the others under open sky with a time to fix
+	//between a hot start and a cold one
+	enum { NUM_SURFACINGS = 500 };
+	static Surfacing surfacings[NUM_SURFACINGS];
+	test_random_seed(30);
+	uint32_t possible_fixes = 0;
+	for (int i = 0; i < NUM_SURFACINGS; i++) {
+		unsigned int draw = test_random_below(100);
+		if (draw < 50) {
+			surfacings[i].kind = SURFACE_SUBMERGED;
+		} else if (draw < 65) {
+			surfacings[i].kind = SURFACE_WAVE_WASH;
+		} else {
+			surfacings[i].kind = SURFACE_OPEN_SKY;
+			surfacings[i].time_to_fix_ms = 2000 + test_random_below(40000);
+			possible_fixes++;
+		}
+	}
+
+	Policy policies[] = {
+		{.name = "fixed 5 s", .fixed_timeout_ms = 5000},
+		{.name = "fixed 60 s", .fixed_timeout_ms = 60000},
+		{.name = "fixed 180 s", .fixed_timeout_ms = 180000},
+		{.name = "adaptive", .adaptive = true},
+	};
+	const int num_policies = sizeof(policies) / sizeof(policies[0]);
+
+	for (int p = 0; p < num_policies; p++) {
+		GpsAcqEstimator estimator;
+		gps_acq_init(&estimator);
+		for (int i = 0; i < NUM_SURFACINGS; i++) {
+			replay_attempt(&policies[p], &estimator, &surfacings[i]);
+		}
+		double joules = (double)policies[p].on_ms * ACQUISITION_POWER_MW / 1e6;
+		printf("%-12s %3u/%u fixes, receiver on %7.0f s, %6.2f J per fix\n", policies[p].name, policies[p].fixes,
+				possible_fixes, policies[p].on_ms / 1000.0, (policies[p].fixes != 0) ? joules / policies[p].fixes : 0.0);
+	}
+
+	Policy *fixed_5s = &policies[0], *fixed_60s = &policies[1], *fixed_180s = &policies[2], *adaptive = &policies[3];
+
+	//5 s misses most fixes, the adaptive policy gets nearly all of them
+	CHECK(fixed_5s->fixes < possible_fixes / 4);
+	CHECK(adaptive->fixes >= possible_fixes * 9 / 10);
+
+	//and spends less per fix than the fixed timeouts long enough to get them
+	CHECK(adaptive->on_ms * fixed_60s->fixes < fixed_60s->on_ms * adaptive->fixes);
+	CHECK(adaptive->on_ms * fixed_180s->fixes < fixed_180s->on_ms * adaptive->fixes);
+}
+
+int main(void) {
+	RUN(test_aborts_without_signal);
+	RUN(test_extends_while_progressing);
+	RUN(test_estimator);
+	RUN(test_retry_leaves_receiver_off);
+	RUN(test_replay_energy_per_fix);
+	return test_report();
+}
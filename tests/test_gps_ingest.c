@@ -0,0 +1,479 @@
+/*
+ * test_gps_ingest.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * GPS ingest path (Recovery Src/GPS.c with the framer, the sentence ring and the NMEA/UBX parsers) on the host shim.
+ *
+ * A capture is streamed into GPS_RxCpltCallback() through the DMA double buffer, starting at random points of the
+ * stream, and into gps_feed() (replay path) in chunks of random length. Every sentence must come out of the ring
+ * intact and in order, including the ones spanning two DMA halves, and the parsers must end on the last position and
+ * time of the capture. The throughput in sentences per second and the worst case callback time are reported.
+ *
+ * By default the capture is generated: one hour of NEO-M9N output at 1 Hz (RMC, VTG, GGA, GSA, GSV, GLL, ZDA and
+ * UBX-NAV-PVT) from a drifting tag. A recorded capture (raw receiver bytes) can be given as argument instead:
+ *
+ *   test_gps_ingest [capture]
+ *
+ * The reference is then the framer output for the capture fed in one piece, every split must give the same sentences.
+ */
+
+#include "test.h"
+#include "Recovery Inc/GPS.h"
+#include "Lib Inc/low_power.h"
+#include "Recovery Inc/GpsAssist.h"
+#include <math.h>
+#include <stdarg.h>
+#include <time.h>
+
+extern volatile uint32_t shim_tick_ms;
+extern uint8_t rx_buffer[2][GPS_RX_BUFFER_SIZE]; //DMA double buffer (GPS.c)
+extern UART_HandleTypeDef huart3;
+
+//registered as the USART3 DMA half/full transfer callback (GPS.c)
+void GPS_RxCpltCallback(UART_HandleTypeDef *huart);
+
+#define CAPTURE_EPOCHS    3600
+#define CAPTURE_MAX_SIZE  (CAPTURE_EPOCHS * 1200)
+#define MAX_SENTENCES     (CAPTURE_EPOCHS * 16)
+
+//Capture start: 2026-10-19 12:00:00 UTC, off Dominica
+#define START_UTC_S       1792411200
+#define START_LATITUDE    15.30
+#define START_LONGITUDE   -61.45
+
+//UART at GPS_BAUD_RATE, 10 bits per byte
+#define BYTE_TIME_US      (10 * 1000000 / GPS_BAUD_RATE)
+
+typedef struct {
+	size_t offset;		//in Capture.sentence_data
+	size_t length;		//NMEA without "\r\n", UBX whole frame
+	GPS_SentenceType type;
+}Sentence;
+
+typedef struct {
+	uint8_t data[CAPTURE_MAX_SIZE];
+	size_t length;
+	uint32_t *byte_ms;	//reception time of each byte, relative to the start of the capture
+	const uint8_t *sentence_data; //bytes of the expected sentences
+	Sentence sentences[MAX_SENTENCES];
+	size_t sentence_count;
+	float last_latitude;
+	float last_longitude;
+	uint32_t last_utc_s;
+}Capture;
+
+static Capture capture;
+static uint32_t capture_byte_ms[CAPTURE_MAX_SIZE];
+static uint8_t reference_data[CAPTURE_MAX_SIZE];
+
+/* Stubs of the modules outside the ingest path ----------------------------- */
+
+//Sentences released by the ring (gpsBuffer_release() forwards each of them to the Pi)
+static size_t released_count = 0;
+static size_t released_mismatches = 0;
+static size_t released_expected = 0; //index in capture.sentences of the next sentence expected
+static bool released_record = false; //record the released sentences as the expected ones
+static size_t reference_length = 0;
+
+void pi_gps_forward_sentence(const GPS_Sentence *sentence) {
+	released_count++;
+	if (released_record) {
+		if (capture.sentence_count < MAX_SENTENCES) {
+			capture.sentences[capture.sentence_count++] = (Sentence){.offset = reference_length, .length = sentence->length, .type = sentence->type};
+			memcpy(&reference_data[reference_length], sentence->sentence, sentence->length);
+			reference_length += sentence->length;
+		}
+		return;
+	}
+
+	const Sentence *expected = &capture.sentences[released_expected];
+	bool intact = (released_expected < capture.sentence_count)
+			&& (sentence->type == expected->type)
+			&& (sentence->length == expected->length)
+			&& (memcmp(sentence->sentence, &capture.sentence_data[expected->offset], expected->length) == 0)
+			&& ((sentence->type != GPS_SENTENCE_NMEA) || (sentence->sentence[sentence->length] == '\0'));
+	if (!intact) {
+		released_mismatches++;
+		if (released_mismatches <= 5) {
+			printf("sentence %zu not intact: \"%.*s\"\n", released_expected, (int)sentence->length, sentence->sentence);
+		}
+	}
+	released_expected++;
+}
+
+void pi_gps_forward_flush(void) {
+}
+
+void pi_comms_tx_gps_replay_ack(uint8_t id, uint8_t status) {
+}
+
+void low_power_veto(LowPowerVeto source, bool veto) {
+}
+
+HAL_StatusTypeDef gps_assist_inject(HAL_StatusTypeDef (*send)(const uint8_t *frame, size_t frame_length)) {
+	return HAL_OK;
+}
+
+/* Capture ------------------------------------------------------------------ */
+
+//the receiver outputs each epoch in a burst at the start of its second
+static uint32_t capture_epoch_ms = 0;
+static size_t capture_epoch_offset = 0;
+
+static void capture_append(const uint8_t *data, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		capture.byte_ms[capture.length] = capture_epoch_ms + ((capture.length - capture_epoch_offset) * BYTE_TIME_US) / 1000;
+		capture.data[capture.length++] = data[i];
+	}
+}
+
+static void capture_nmea(const char *format, ...) {
+	char body[GPS_NMEA_MAX_SIZE];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(body, sizeof(body), format, args);
+	va_end(args);
+
+	uint8_t checksum = 0;
+	for (const char *c = body; *c != '\0'; c++) {
+		checksum ^= *c;
+	}
+	char sentence[GPS_NMEA_MAX_SIZE + 3];
+	int length = snprintf(sentence, sizeof(sentence), "$%s*%02X", body, checksum);
+
+	capture.sentences[capture.sentence_count++] = (Sentence){.offset = capture.length, .length = length, .type = GPS_SENTENCE_NMEA};
+	capture_append((const uint8_t *)sentence, length);
+	capture_append((const uint8_t *)"\r\n", 2);
+}
+
+static void capture_nav_pvt(const UbxNavPvt *pvt) {
+	uint8_t frame[UBX_NAV_PVT_FRAME_LENGTH];
+	size_t length = ubx_build_frame(frame, sizeof(frame), UBX_CLASS_NAV, UBX_ID_NAV_PVT, (const uint8_t *)pvt, sizeof(*pvt));
+	capture.sentences[capture.sentence_count++] = (Sentence){.offset = capture.length, .length = length, .type = GPS_SENTENCE_UBX};
+	capture_append(frame, length);
+}
+
+//ddmm.mmmmm / dddmm.mmmmm
+static void format_coordinate(char *dst, size_t size, double degrees, int degree_digits) {
+	double magnitude = fabs(degrees);
+	int whole = (int)magnitude;
+	snprintf(dst, size, "%0*d%08.5f", degree_digits, whole, (magnitude - whole) * 60);
+}
+
+static void capture_generate(void) {
+	capture.byte_ms = capture_byte_ms;
+	capture.sentence_data = capture.data;
+	capture.length = 0;
+	capture.sentence_count = 0;
+
+	//the DMA transfer starts in the middle of a sentence
+	capture_append((const uint8_t *)"0.80,5.0,M,-40.0,M,,*4A\r\n", 25);
+
+	test_random_seed(36);
+	double north_m = 0, east_m = 0;
+	for (uint32_t epoch = 0; epoch < CAPTURE_EPOCHS; epoch++) {
+		capture_epoch_ms = epoch * 1000;
+		capture_epoch_offset = capture.length;
+		north_m += 0.35 + ((int)test_random_below(100) - 50) / 1000.0;
+		east_m += 0.20 + ((int)test_random_below(100) - 50) / 1000.0;
+		double latitude = START_LATITUDE + north_m / 111320.0;
+		double longitude = START_LONGITUDE + east_m / (111320.0 * cos(START_LATITUDE * M_PI / 180));
+
+		uint32_t utc_s = START_UTC_S + epoch;
+		TimeDate date = time_date_from_utc(utc_s);
+		char time[16], lat[16], lon[16];
+		snprintf(time, sizeof(time), "%02u%02u%02u.00", date.hour, date.minute, date.second);
+		format_coordinate(lat, sizeof(lat), latitude, 2);
+		format_coordinate(lon, sizeof(lon), longitude, 3);
+
+		capture_nmea("GNRMC,%s,A,%s,N,%s,W,0.781,30.2,%02u%02u%02u,,,A", time, lat, lon, date.day, date.month, date.year % 100);
+		capture_nmea("GNVTG,30.2,T,,M,0.781,N,1.446,K,A");
+		capture_nmea("GNGGA,%s,%s,N,%s,W,1,12,0.80,5.0,M,-40.0,M,,", time, lat, lon);
+		capture_nmea("GNGSA,A,3,02,05,07,13,15,18,20,24,29,,,,1.50,0.80,1.27,1");
+		capture_nmea("GNGSA,A,3,65,71,72,,,,,,,,,,1.50,0.80,1.27,2");
+		for (int message = 1; message <= 3; message++) {
+			int base = (message - 1) * 4;
+			capture_nmea("GPGSV,3,%d,11,%02d,45,120,%02u,%02d,30,200,%02u,%02d,60,040,%02u,%02d,15,310,%02u,1",
+					message, base + 2, 30 + test_random_below(15), base + 5, 25 + test_random_below(15),
+					base + 7, 35 + test_random_below(10), base + 13, 20 + test_random_below(15));
+		}
+		capture_nmea("GNGLL,%s,N,%s,W,%s,A,A", lat, lon, time);
+		capture_nmea("GNZDA,%s,%02u,%02u,%04u,00,00", time, date.day, date.month, date.year);
+
+		UbxNavPvt pvt = {
+			.iTOW = (utc_s % (7 * 24 * 3600)) * 1000,
+			.year = date.year, .month = date.month, .day = date.day,
+			.hour = date.hour, .min = date.minute, .sec = date.second,
+			.valid = UBX_NAV_PVT_VALID_DATE | UBX_NAV_PVT_VALID_TIME | UBX_NAV_PVT_VALID_FULLY_RESOLVED,
+			.fixType = UBX_FIX_3D,
+			.flags = UBX_NAV_PVT_FLAGS_GNSS_FIX_OK,
+			.numSV = 12,
+			.lat = lround(latitude * 1e7),
+			.lon = lround(longitude * 1e7),
+			.pDOP = 150,
+		};
+		capture_nav_pvt(&pvt);
+
+		capture.last_latitude = latitude;
+		capture.last_longitude = longitude;
+		capture.last_utc_s = utc_s;
+	}
+}
+
+/* Ingest ------------------------------------------------------------------- */
+
+static GPS_HandleTypeDef gps;
+static uint_fast8_t dma_half = 0; //half that GPS_RxCpltCallback() frames next
+static double parse_ns = 0;
+static size_t parsed_sentences = 0;
+static uint32_t pass_tick_base = 0; //the tick keeps counting up across passes
+
+static double host_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+//What the GPS buffer thread and its consumer do once woken up
+static void release_and_parse(void) {
+	size_t released = released_count;
+	gpsBuffer_release();
+	double start_ns = host_ns();
+	while (read_gps_data(&gps)) {
+	}
+	parse_ns += host_ns() - start_ns;
+	parsed_sentences += released_count - released;
+}
+
+static void start_pass(void) {
+	pass_tick_base = shim_tick_ms + 10000;
+	shim_tick_ms = pass_tick_base;
+	gps_feed_reset();
+	released_expected = 0;
+	released_count = 0;
+	released_mismatches = 0;
+	initialize_gps(NULL, &gps);
+}
+
+//Streams data through the DMA double buffer: a callback for each full half, the rest of the last one is idle line
+static void feed_dma(const uint8_t *data, size_t length, const uint32_t *byte_ms) {
+	for (size_t offset = 0; offset < length; offset += GPS_RX_BUFFER_SIZE) {
+		size_t chunk = ((length - offset) < GPS_RX_BUFFER_SIZE) ? (length - offset) : GPS_RX_BUFFER_SIZE;
+		memcpy(rx_buffer[dma_half], &data[offset], chunk);
+		memset(&rx_buffer[dma_half][chunk], 0, GPS_RX_BUFFER_SIZE - chunk);
+
+		shim_tick_ms = (byte_ms != NULL) ? (pass_tick_base + byte_ms[offset + chunk - 1]) : (shim_tick_ms + 100);
+		GPS_RxCpltCallback(&huart3);
+		dma_half ^= 1;
+		release_and_parse();
+	}
+}
+
+//Streams data into gps_feed() (replay path) in chunks of 1 to max_chunk bytes
+static void feed_random_chunks(const uint8_t *data, size_t length, const uint32_t *byte_ms, size_t max_chunk) {
+	for (size_t offset = 0; offset < length; ) {
+		size_t chunk = 1 + test_random_below(max_chunk);
+		chunk = ((length - offset) < chunk) ? (length - offset) : chunk;
+		shim_tick_ms = (byte_ms != NULL) ? (pass_tick_base + byte_ms[offset + chunk - 1]) : (shim_tick_ms + 1);
+		gps_feed(&data[offset], chunk);
+		release_and_parse();
+		offset += chunk;
+	}
+}
+
+//Sentences spanning two DMA halves when the capture is received from offset start
+static size_t count_spanning(size_t start) {
+	size_t spanning = 0;
+	for (size_t i = 0; i < capture.sentence_count; i++) {
+		const Sentence *sentence = &capture.sentences[i];
+		if (sentence->offset < start) {
+			continue;
+		}
+		size_t first = sentence->offset - start, last = first + sentence->length - 1;
+		spanning += ((first / GPS_RX_BUFFER_SIZE) != (last / GPS_RX_BUFFER_SIZE));
+	}
+	return spanning;
+}
+
+//Moves a start point out of UBX frames: their binary tail could hold a '$' or sync char and start a bogus sentence
+static size_t start_outside_ubx(size_t start) {
+	for (size_t i = 0; i < capture.sentence_count; i++) {
+		const Sentence *sentence = &capture.sentences[i];
+		if ((sentence->type == GPS_SENTENCE_UBX) && (start > sentence->offset) && (start < sentence->offset + sentence->length)) {
+			return sentence->offset + sentence->length;
+		}
+	}
+	return start;
+}
+
+static size_t first_sentence_from(size_t start) {
+	size_t index = 0;
+	while ((index < capture.sentence_count) && (capture.sentences[index].offset < start)) {
+		index++;
+	}
+	return index;
+}
+
+static void check_parsed_state(void) {
+	CHECK(gps.is_pos_locked);
+	CHECK(gps.fix.is_valid_data);
+	CHECK_NEAR(gps.fix.latitude, capture.last_latitude, 1e-5);
+	CHECK_NEAR(gps.fix.longitude, capture.last_longitude, 1e-5);
+	CHECK_EQ(gps.fix_quality.fix_type, UBX_FIX_3D);
+	CHECK_EQ(gps.fix_quality.satellites, 12);
+	CHECK_NEAR(gps.fix_quality.hdop, 0.8, 1e-3);
+
+	GpsSignalSummary signal;
+	gps_get_signal_summary(&signal);
+	CHECK_EQ(signal.satellites_in_view, 11);
+	CHECK(signal.max_cno >= 35);
+
+	uint32_t utc_s;
+	CHECK(time_get_utc(&utc_s));
+	//whole seconds on both sides, and a chunk of up to 2000 bytes (3 epochs) is stamped with its last byte's time
+	CHECK_NEAR(utc_s, capture.last_utc_s, 4);
+}
+
+static void test_dma_callback_random_start(void) {
+	enum { PASSES = 20 };
+	size_t spanning = 0;
+	GPS_IngestStats before = gps_get_ingest_stats();
+
+	test_random_seed(3600);
+	for (int pass = 0; pass < PASSES; pass++) {
+		//the receiver output starts at a random point relative to the DMA halves
+		size_t start = start_outside_ubx(test_random_below(capture.sentences[20].offset));
+		start_pass();
+		released_expected = first_sentence_from(start);
+		spanning += count_spanning(start);
+
+		feed_dma(&capture.data[start], capture.length - start, &capture.byte_ms[start]);
+
+		CHECK_EQ(released_mismatches, 0);
+		CHECK_EQ(released_expected, capture.sentence_count);
+		check_parsed_state();
+	}
+
+	GPS_IngestStats after = gps_get_ingest_stats();
+	uint32_t sentences = (after.framer.nmea_sentences - before.framer.nmea_sentences) + (after.framer.ubx_frames - before.framer.ubx_frames);
+	uint32_t callbacks = after.callbacks - before.callbacks;
+	double callback_s = (after.callback_total_cycles - before.callback_total_cycles) / (double)SystemCoreClock;
+	double worst_us = after.callback_max_cycles * 1e6 / SystemCoreClock;
+	double half_fill_us = GPS_RX_BUFFER_SIZE * (double)BYTE_TIME_US;
+	printf("DMA path: %u sentences (%zu across halves) in %u callbacks, %.0f sentences/s in the callback, "
+			"worst callback %.1f us (half fills in %.0f us), parse %.0f sentences/s\n",
+			sentences, spanning, callbacks, sentences / callback_s, worst_us, half_fill_us, parsed_sentences / (parse_ns * 1e-9));
+
+	CHECK(spanning > PASSES * 100);
+	CHECK_EQ(after.ring_overruns - before.ring_overruns, 0);
+	CHECK_EQ(after.framer.nmea_truncated - before.framer.nmea_truncated, 0);
+	CHECK_EQ(after.framer.nmea_too_long - before.framer.nmea_too_long, 0);
+	CHECK_EQ(after.framer.ubx_errors - before.framer.ubx_errors, 0);
+	//the callback must be done well before the other half is full
+	CHECK(worst_us < half_fill_us / 10);
+}
+
+static void test_feed_random_chunks(void) {
+	test_random_seed(2026);
+	static const size_t max_chunks[] = {1, 7, 80, 251, 2000};
+	for (size_t i = 0; i < sizeof(max_chunks) / sizeof(max_chunks[0]); i++) {
+		start_pass();
+		released_expected = first_sentence_from(1);
+		double start_ns = host_ns();
+		feed_random_chunks(capture.data, capture.length, capture.byte_ms, max_chunks[i]);
+		double elapsed_ns = host_ns() - start_ns;
+
+		printf("gps_feed() in chunks of 1-%zu bytes: %.0f sentences/s with parsing\n", max_chunks[i],
+				capture.sentence_count / (elapsed_ns * 1e-9));
+		CHECK_EQ(released_mismatches, 0);
+		CHECK_EQ(released_expected, capture.sentence_count);
+		check_parsed_state();
+	}
+}
+
+static void test_sentence_across_halves(void) {
+	//a NAV-PVT frame and a RMC sentence cut exactly at the end of a half, and one byte after the start
+	for (size_t i = 0; i < capture.sentence_count; i++) {
+		if ((capture.sentences[i].type != GPS_SENTENCE_UBX) || (capture.sentences[i].offset < 2 * GPS_RX_BUFFER_SIZE)) {
+			continue;
+		}
+		for (size_t cut = 1; cut < 3; cut++) {
+			const Sentence *ubx = &capture.sentences[i], *rmc = &capture.sentences[i + 1];
+			size_t ubx_start = ubx->offset + ubx->length - cut - GPS_RX_BUFFER_SIZE;
+			size_t rmc_start = rmc->offset + cut - GPS_RX_BUFFER_SIZE;
+			size_t starts[] = {ubx_start, rmc_start};
+			for (size_t s = 0; s < 2; s++) {
+				start_pass();
+				released_expected = first_sentence_from(starts[s]);
+				size_t length = 4 * GPS_RX_BUFFER_SIZE;
+				feed_dma(&capture.data[starts[s]], length, &capture.byte_ms[starts[s]]);
+				CHECK_EQ(released_mismatches, 0);
+				CHECK(released_expected > i + 1);
+			}
+		}
+		break;
+	}
+}
+
+/* Recorded capture --------------------------------------------------------- */
+
+static bool capture_load(const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		printf("cannot open %s\n", path);
+		return false;
+	}
+	capture.length = fread(capture.data, 1, sizeof(capture.data), file);
+	fclose(file);
+	capture.byte_ms = NULL;
+
+	//reference: the sentences framed from the capture fed in one piece
+	capture.sentence_data = reference_data;
+	capture.sentence_count = 0;
+	reference_length = 0;
+	start_pass();
+	released_record = true;
+	gps_feed(capture.data, capture.length);
+	gpsBuffer_release();
+	released_record = false;
+
+	printf("%s: %zu bytes, %zu sentences\n", path, capture.length, capture.sentence_count);
+	return true;
+}
+
+static void test_recorded_capture(void) {
+	CHECK(capture.sentence_count > 0);
+	CHECK(capture.sentence_count < MAX_SENTENCES);
+
+	test_random_seed(1);
+	for (int pass = 0; pass < 10; pass++) {
+		start_pass();
+		feed_random_chunks(capture.data, capture.length, NULL, 1 + test_random_below(GPS_RX_BUFFER_SIZE));
+		CHECK_EQ(released_mismatches, 0);
+		CHECK_EQ(released_expected, capture.sentence_count);
+
+		start_pass();
+		feed_dma(capture.data, capture.length, NULL);
+		CHECK_EQ(released_mismatches, 0);
+		CHECK_EQ(released_expected, capture.sentence_count);
+	}
+}
+
+int main(int argc, char **argv) {
+	time_init();
+	if (argc > 1) {
+		if (!capture_load(argv[1])) {
+			return EXIT_FAILURE;
+		}
+		RUN(test_recorded_capture);
+		return test_report();
+	}
+
+	capture_generate();
+	printf("generated capture: %zu bytes, %zu sentences\n", capture.length, capture.sentence_count);
+	RUN(test_dma_callback_random_start);
+	RUN(test_feed_random_chunks);
+	RUN(test_sentence_across_halves);
+	return test_report();
+}
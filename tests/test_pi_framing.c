@@ -0,0 +1,335 @@
+/*
+ * test_pi_framing.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Pi link framing (Comms Src/PiFraming.c, Lib Src/crc16.c) and reception (Comms Src/PiCommsRX.c): round trips of
+ * every payload length, fuzzing of the decoder with bit errors and random data, then a stream of frames with bit
+ * errors received through the USART2 DMA ring in random splits, checking that only the damaged frames are lost.
+ */
+
+#include "test.h"
+#include "Comms Inc/PiComms.h"
+#include "Comms Inc/PiFraming.h"
+#include "Lib Inc/crc16.h"
+#include "Lib Inc/low_power.h"
+#include <time.h>
+
+//Guard bytes after the buffers handed to the decoder, which must never be touched
+#define GUARD_SIZE 16
+#define GUARD_BYTE 0xA5
+
+extern UART_HandleTypeDef huart2;
+
+//defined by state_machine.c on the target
+TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
+
+void low_power_veto_for(LowPowerVeto source, uint32_t timeout_ms) {
+}
+
+static double host_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+typedef enum {
+	PAYLOAD_RANDOM,
+	PAYLOAD_ZEROS,
+	PAYLOAD_NO_ZEROS,	//COBS blocks as long as they get
+	PAYLOAD_SPARSE,		//a few zeros in long runs
+	NUM_PAYLOAD_KINDS,
+}PayloadKind;
+
+static void fill_payload(uint8_t *payload, size_t length, PayloadKind kind) {
+	for (size_t i = 0; i < length; i++) {
+		switch (kind) {
+			case PAYLOAD_RANDOM:
+				payload[i] = test_random();
+				break;
+			case PAYLOAD_ZEROS:
+				payload[i] = 0;
+				break;
+			case PAYLOAD_NO_ZEROS:
+				payload[i] = 1 + test_random_below(255);
+				break;
+			case PAYLOAD_SPARSE:
+			default:
+				payload[i] = (test_random_below(100) == 0) ? 0 : (1 + test_random_below(255));
+				break;
+		}
+	}
+}
+
+static void test_crc16(void) {
+	//CRC-16/CCITT-FALSE check value
+	const uint8_t check[] = "123456789";
+	CHECK_EQ(crc16(CRC16_INIT, check, 9), 0x29B1);
+
+	//appended most significant byte first, the CRC of the whole message is 0
+	uint8_t message[11];
+	memcpy(message, check, 9);
+	message[9] = 0x29;
+	message[10] = 0xB1;
+	CHECK_EQ(crc16(CRC16_INIT, message, sizeof(message)), 0);
+}
+
+static void test_round_trip(void) {
+	static uint8_t payload[PI_FRAME_MAX_PAYLOAD];
+	static uint8_t encoded[PI_FRAME_MAX_ENCODED_SIZE + GUARD_SIZE];
+	test_random_seed(39);
+
+	for (int kind = 0; kind < NUM_PAYLOAD_KINDS; kind++) {
+		for (size_t length = 0; length <= PI_FRAME_MAX_PAYLOAD; length++) {
+			fill_payload(payload, length, kind);
+			memset(encoded, GUARD_BYTE, sizeof(encoded));
+
+			//refused unless the worst case fits
+			CHECK_EQ(pi_frame_encode(encoded, PI_FRAME_ENCODED_SIZE(length) - 1, length, 7, payload, length), 0);
+
+			size_t encoded_length = pi_frame_encode(encoded, PI_FRAME_ENCODED_SIZE(length), length, 7, payload, length);
+			CHECK(encoded_length > PI_FRAME_DECODED_SIZE(length));
+			CHECK(encoded_length <= PI_FRAME_ENCODED_SIZE(length));
+			CHECK_EQ(encoded[encoded_length - 1], PI_FRAME_DELIMITER);
+			CHECK(memchr(encoded, PI_FRAME_DELIMITER, encoded_length - 1) == NULL);
+			CHECK_EQ(encoded[PI_FRAME_ENCODED_SIZE(length)], GUARD_BYTE);
+
+			PiFrame frame;
+			CHECK_EQ(pi_frame_decode(encoded, encoded_length - 1, &frame), PI_FRAME_OK);
+			CHECK_EQ(frame.sequence, (uint8_t)length);
+			CHECK_EQ(frame.id, 7);
+			CHECK_EQ(frame.length, length);
+			CHECK_MEM(frame.payload, payload, length);
+		}
+	}
+}
+
+//Flips bit_errors random bits of a frame (delimiter excluded) and decodes what a receiver would split out of it.
+//Returns the number of pieces wrongly accepted.
+static int decode_damaged(const uint8_t *encoded, size_t encoded_length, int bit_errors, const uint8_t *payload,
+		uint8_t length) {
+	static uint8_t damaged[PI_FRAME_MAX_ENCODED_SIZE];
+	static uint8_t piece[PI_FRAME_MAX_ENCODED_SIZE + GUARD_SIZE];
+	memcpy(damaged, encoded, encoded_length);
+	for (int i = 0; i < bit_errors; i++) {
+		size_t bit = test_random_below((encoded_length - 1) * 8);
+		damaged[bit / 8] ^= 1 << (bit % 8);
+	}
+	if (memcmp(damaged, encoded, encoded_length) == 0) {
+		return 0;
+	}
+
+	//a byte turned into 0x00 splits the frame in two for the receiver
+	int accepted = 0;
+	size_t start = 0;
+	for (size_t i = 0; i < encoded_length; i++) {
+		if (damaged[i] != PI_FRAME_DELIMITER) {
+			continue;
+		}
+		if (i > start) {
+			size_t piece_length = i - start;
+			memcpy(piece, &damaged[start], piece_length);
+			memset(&piece[piece_length], GUARD_BYTE, GUARD_SIZE);
+			PiFrame frame;
+			if (pi_frame_decode(piece, piece_length, &frame) == PI_FRAME_OK) {
+				accepted += (frame.length != length) || (memcmp(frame.payload, payload, length) != 0);
+			}
+			for (size_t g = 0; g < GUARD_SIZE; g++) {
+				CHECK_EQ(piece[piece_length + g], GUARD_BYTE);
+			}
+		}
+		start = i + 1;
+	}
+	return accepted;
+}
+
+static void test_bit_errors(void) {
+	enum { FRAMES = 200000 };
+	static uint8_t payload[PI_FRAME_MAX_PAYLOAD];
+	static uint8_t encoded[PI_FRAME_MAX_ENCODED_SIZE + GUARD_SIZE];
+	test_random_seed(1039);
+
+	//the CRC catches every odd number of bit errors, COBS code bytes hit turn into multi-byte errors
+	int accepted_odd = 0, accepted_even = 0;
+	for (int i = 0; i < FRAMES; i++) {
+		uint8_t length = test_random_below(PI_FRAME_MAX_PAYLOAD + 1);
+		fill_payload(payload, length, test_random_below(NUM_PAYLOAD_KINDS));
+		size_t encoded_length = pi_frame_encode(encoded, sizeof(encoded), i, 3, payload, length);
+
+		int bit_errors = 1 + test_random_below(4);
+		int accepted = decode_damaged(encoded, encoded_length, bit_errors, payload, length);
+		if ((bit_errors % 2) != 0) {
+			accepted_odd += accepted;
+		} else {
+			accepted_even += accepted;
+		}
+	}
+	printf("%d damaged frames: %d accepted with 1 or 3 bit errors, %d with 2 or 4\n", FRAMES, accepted_odd, accepted_even);
+	//about 1 in 65536 at worst for a 16-bit CRC
+	CHECK(accepted_odd + accepted_even <= FRAMES / 20000);
+}
+
+static void test_random_data(void) {
+	enum { RUNS = 200000 };
+	static uint8_t buffer[PI_FRAME_MAX_ENCODED_SIZE + GUARD_SIZE];
+	test_random_seed(2039);
+
+	int accepted = 0;
+	int status_counts[PI_FRAME_ERROR_VERSION + 1] = {0};
+	for (int i = 0; i < RUNS; i++) {
+		size_t length = 1 + test_random_below(PI_FRAME_MAX_ENCODED_SIZE - 1);
+		for (size_t j = 0; j < length; j++) {
+			buffer[j] = 1 + test_random_below(255);
+		}
+		memset(&buffer[length], GUARD_BYTE, GUARD_SIZE);
+
+		PiFrame frame;
+		PiFrameStatus status = pi_frame_decode(buffer, length, &frame);
+		CHECK(status <= PI_FRAME_ERROR_VERSION);
+		status_counts[status]++;
+		accepted += (status == PI_FRAME_OK);
+		for (size_t g = 0; g < GUARD_SIZE; g++) {
+			CHECK_EQ(buffer[length + g], GUARD_BYTE);
+		}
+	}
+	printf("%d random frames: %d accepted, %d COBS, %d length, %d CRC, %d version errors\n", RUNS, accepted,
+			status_counts[PI_FRAME_ERROR_COBS], status_counts[PI_FRAME_ERROR_LENGTH], status_counts[PI_FRAME_ERROR_CRC],
+			status_counts[PI_FRAME_ERROR_VERSION]);
+	CHECK(accepted <= RUNS / 20000);
+}
+
+static void test_throughput(void) {
+	enum { FRAMES = 100000 };
+	static uint8_t payload[PI_FRAME_MAX_PAYLOAD];
+	static uint8_t encoded[PI_FRAME_MAX_ENCODED_SIZE];
+	test_random_seed(3039);
+	fill_payload(payload, sizeof(payload), PAYLOAD_SPARSE);
+
+	double encode_ns = 0, decode_ns = 0;
+	size_t bytes = 0;
+	for (int i = 0; i < FRAMES; i++) {
+		double start_ns = host_ns();
+		size_t length = pi_frame_encode(encoded, sizeof(encoded), i, 1, payload, sizeof(payload));
+		encode_ns += host_ns() - start_ns;
+
+		PiFrame frame;
+		start_ns = host_ns();
+		PiFrameStatus status = pi_frame_decode(encoded, length - 1, &frame);
+		decode_ns += host_ns() - start_ns;
+		if (status != PI_FRAME_OK) {
+			CHECK_EQ(status, PI_FRAME_OK);
+			return;
+		}
+		bytes += length;
+	}
+	printf("%zu bytes framed: encode %.0f MB/s, decode %.0f MB/s\n", bytes, bytes * 1e3 / encode_ns, bytes * 1e3 / decode_ns);
+}
+
+/* Reception ---------------------------------------------------------------- */
+
+typedef struct {
+	uint8_t sequence;
+	uint8_t id;
+	uint8_t length;
+	bool damaged;
+	uint8_t payload[PI_FRAME_MAX_PAYLOAD];
+}SentFrame;
+
+static void test_stream_random_splits(void) {
+	enum { FRAMES = 20000, DAMAGE_PERCENT = 5, MAX_SPLIT = 1024 };
+	static SentFrame sent[FRAMES];
+	static uint8_t stream[FRAMES * PI_FRAME_MAX_ENCODED_SIZE];
+	test_random_seed(4039);
+
+	size_t stream_length = 0;
+	uint32_t expected_gaps = 0;
+	bool after_damage = false;
+	for (int i = 0; i < FRAMES; i++) {
+		SentFrame *frame = &sent[i];
+		frame->sequence = i;
+		frame->id = test_random();
+		frame->length = test_random_below(PI_FRAME_MAX_PAYLOAD + 1);
+		fill_payload(frame->payload, frame->length, test_random_below(NUM_PAYLOAD_KINDS));
+
+		uint8_t *encoded = &stream[stream_length];
+		size_t encoded_length = pi_frame_encode(encoded, PI_FRAME_MAX_ENCODED_SIZE, frame->sequence, frame->id,
+				frame->payload, frame->length);
+		stream_length += encoded_length;
+
+		//a single bit error, the CRC catches all of them
+		frame->damaged = (test_random_below(100) < DAMAGE_PERCENT);
+		if (frame->damaged) {
+			size_t bit = test_random_below((encoded_length - 1) * 8);
+			encoded[bit / 8] ^= 1 << (bit % 8);
+			after_damage = true;
+		} else {
+			expected_gaps += after_damage;
+			after_damage = false;
+		}
+	}
+
+	//"DMA" the stream into the ring in random splits, the state machine handles each message right away
+	pi_comms_rx_init();
+	CHECK_EQ(huart2.RxXferSize, PI_COMM_RX_RING_SIZE);
+	uint8_t *ring = huart2.pRxBuffPtr;
+	size_t position = 0, next = 0, mismatches = 0;
+	double callback_ns = 0;
+	for (size_t offset = 0; offset < stream_length; ) {
+		size_t split = 1 + test_random_below(MAX_SPLIT);
+		split = ((stream_length - offset) < split) ? (stream_length - offset) : split;
+		for (size_t i = 0; i < split; i++) {
+			ring[position++] = stream[offset++];
+			//full ring event at the end of each lap, then an idle line event for the rest
+			if ((position == PI_COMM_RX_RING_SIZE) || (i == split - 1)) {
+				double start_ns = host_ns();
+				Pi_RxEventCallback(&huart2, position);
+				callback_ns += host_ns() - start_ns;
+				position %= PI_COMM_RX_RING_SIZE;
+			}
+		}
+
+		for (PiCommRxView *view; (view = pi_comms_rx_peek()) != NULL; pi_comms_rx_release()) {
+			while ((next < FRAMES) && sent[next].damaged) {
+				next++;
+			}
+			if (next == FRAMES) {
+				mismatches++;
+				continue;
+			}
+			const SentFrame *expected = &sent[next++];
+			const PiCommHeader *header = &view->message->header;
+			mismatches += (header->sequence != expected->sequence) || (header->id != expected->id) ||
+					(header->length != expected->length) ||
+					(memcmp(view->message->data.tags, expected->payload, expected->length) != 0);
+		}
+	}
+
+	size_t undamaged = 0;
+	for (int i = 0; i < FRAMES; i++) {
+		undamaged += !sent[i].damaged;
+	}
+	PiCommsRxStats stats = pi_comms_rx_get_stats();
+	printf("%zu bytes received in random splits: %u frames, %u errors, %u gaps, %.0f MB/s in the callback\n",
+			stream_length, stats.frames, stats.cobs_errors + stats.length_errors + stats.crc_errors + stats.version_errors,
+			stats.sequence_gaps, stream_length * 1e3 / callback_ns);
+
+	CHECK_EQ(mismatches, 0);
+	CHECK_EQ(stats.frames, undamaged);
+	CHECK_EQ(stats.sequence_gaps, expected_gaps);
+	//a bit error may also split a frame in two
+	CHECK(stats.cobs_errors + stats.length_errors + stats.crc_errors + stats.version_errors >= FRAMES - undamaged);
+	CHECK_EQ(stats.overflows, 0);
+	CHECK_EQ(stats.queue_full, 0);
+	CHECK_EQ(stats.overruns, 0);
+}
+
+int main(void) {
+	time_init();
+	RUN(test_crc16);
+	RUN(test_round_trip);
+	RUN(test_bit_errors);
+	RUN(test_random_data);
+	RUN(test_throughput);
+	RUN(test_stream_random_splits);
+	return test_report();
+}
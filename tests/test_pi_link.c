@@ -0,0 +1,507 @@
+/*
+ * test_pi_link.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * Pi link speed negotiation (Comms Src/PiLink.c) over a pseudo-terminal pair standing in for USART2. The board end
+ * runs the firmware transmitter and receiver (PiCommsTX.c, PiCommsRX.c) on the shim, the test plays the Pi on the
+ * other end. Checks the negotiation, the fallbacks and the step-down while bulk data flows both ways, that no frame
+ * is lost across a rate change, and measures the sustained throughput of both directions at once.
+ *
+ * A pseudo-terminal doesn't pace the bytes at the baud rate, so the throughput is that of the framing, queues and
+ * ring handling of both ends, which has to stay above what the fastest rate carries.
+ */
+
+#define _GNU_SOURCE
+#include "test.h"
+#include "Comms Inc/PiComms.h"
+#include "Comms Inc/PiFraming.h"
+#include "Comms Inc/PiLink.h"
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/low_power.h"
+#include "Recovery Inc/GpsReplay.h"
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+//Bulk data in both directions: a firmware upload and a log download, each chunk numbered
+#define STREAM_PAYLOAD PI_FRAME_MAX_PAYLOAD
+#define STREAM_ID_PI    PI_COMM_MSG_FW_CHUNK
+#define STREAM_ID_BOARD PI_COMM_MSG_LOG_DATA
+
+//Board chunks in flight, half the transmit blocks so that responses always find one
+#define BOARD_CHUNKS (PI_COMMS_TX_BLOCK_COUNT / 2)
+
+//Bytes moved per end and pass at most, before the virtual time moves on by 1 ms
+#define PASS_BYTES 4096
+
+extern UART_HandleTypeDef huart2;
+
+//defined by state_machine.c on the target
+TX_EVENT_FLAGS_GROUP state_machine_event_flags_group;
+
+void low_power_veto(LowPowerVeto source, bool veto) {
+}
+
+void low_power_veto_for(LowPowerVeto source, uint32_t timeout_ms) {
+}
+
+size_t event_log_read(uint32_t *offset, uint8_t *data, size_t max_length) {
+	return 0;
+}
+
+FwUpdateInfo fw_update_get_info(void) {
+	return (FwUpdateInfo){0};
+}
+
+uint8_t gps_replay_free_chunks(void) {
+	return 0;
+}
+
+GpsReplayStats gps_replay_get_stats(void) {
+	return (GpsReplayStats){0};
+}
+
+static double host_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+//Chunk number, then bytes derived from it
+static void stream_fill(uint8_t *payload, uint32_t number) {
+	for (int i = 0; i < 4; i++) {
+		payload[i] = number >> (8 * i);
+	}
+	for (size_t i = 4; i < STREAM_PAYLOAD; i++) {
+		payload[i] = number * 7 + i;
+	}
+}
+
+//Returns true if the payload is chunk number
+static bool stream_check(const uint8_t *payload, size_t length, uint32_t number) {
+	uint8_t expected[STREAM_PAYLOAD];
+	stream_fill(expected, number);
+	return (length == STREAM_PAYLOAD) && (memcmp(payload, expected, STREAM_PAYLOAD) == 0);
+}
+
+/* Pi end ------------------------------------------------------------------- */
+
+typedef struct {
+	int fd;
+	uint32_t baud;				//rate as acknowledged by the board
+
+	uint8_t out[64 * 1024];		//frames not yet written
+	size_t out_start;
+	size_t out_end;
+	uint8_t tx_sequence;
+	bool streaming;
+	uint32_t stream_sent;
+
+	uint8_t in[PI_FRAME_MAX_ENCODED_SIZE];
+	size_t in_length;
+	int rx_last_sequence;
+	uint32_t rx_gaps;
+	uint32_t rx_errors;
+	uint32_t stream_received;
+	uint32_t stream_errors;
+	uint32_t acks;
+	PiCommLinkAckPkt last_ack;
+}PiEnd;
+
+static PiEnd pi = {.baud = PI_LINK_DEFAULT_BAUD, .rx_last_sequence = -1};
+
+static bool pi_send(uint8_t id, const void *payload, uint8_t length, bool damaged) {
+	if ((sizeof(pi.out) - pi.out_end) < PI_FRAME_MAX_ENCODED_SIZE) {
+		return false;
+	}
+
+	uint8_t *encoded = &pi.out[pi.out_end];
+	size_t encoded_length = pi_frame_encode(encoded, PI_FRAME_MAX_ENCODED_SIZE, pi.tx_sequence++, id, payload, length);
+	if (damaged) {
+		encoded[encoded_length / 2] ^= 0x10;
+	}
+	pi.out_end += encoded_length;
+	return true;
+}
+
+static void pi_request(uint32_t baud) {
+	PiCommLinkSpeedPkt request = {.baud = baud};
+	CHECK(pi_send(PI_COMM_MSG_LINK_SPEED, &request, sizeof(request), false));
+}
+
+static void pi_frame(uint8_t *encoded, size_t length) {
+	PiFrame frame;
+	if (pi_frame_decode(encoded, length, &frame) != PI_FRAME_OK) {
+		pi.rx_errors++;
+		return;
+	}
+	if ((pi.rx_last_sequence >= 0) && (frame.sequence != (uint8_t)(pi.rx_last_sequence + 1))) {
+		pi.rx_gaps++;
+	}
+	pi.rx_last_sequence = frame.sequence;
+
+	switch (frame.id) {
+		case PI_COMM_MSG_LINK_ACK:
+			CHECK_EQ(frame.length, sizeof(PiCommLinkAckPkt));
+			memcpy(&pi.last_ack, frame.payload, sizeof(pi.last_ack));
+			pi.acks++;
+			//the board switches after this acknowledgement, unless it refused the request
+			if ((pi.last_ack.status == PI_LINK_OK) || (pi.last_ack.status == PI_LINK_STEP_DOWN)
+					|| (pi.last_ack.status == PI_LINK_FALLBACK)) {
+				pi.baud = pi.last_ack.baud;
+			}
+			break;
+		case STREAM_ID_BOARD:
+			pi.stream_errors += !stream_check(frame.payload, frame.length, pi.stream_received);
+			pi.stream_received++;
+			break;
+		default:
+			pi.stream_errors++;
+			break;
+	}
+}
+
+//Writes what it can, reads and handles what was received. Returns the bytes moved.
+static size_t pi_pump(void) {
+	size_t moved = 0;
+	//refilled once written out, leaving room for other messages
+	while (pi.streaming && (pi.out_end < (sizeof(pi.out) / 2))) {
+		uint8_t payload[STREAM_PAYLOAD];
+		stream_fill(payload, pi.stream_sent++);
+		pi_send(STREAM_ID_PI, payload, sizeof(payload), false);
+	}
+
+	if (pi.out_start != pi.out_end) {
+		size_t length = pi.out_end - pi.out_start;
+		ssize_t written = write(pi.fd, &pi.out[pi.out_start], (length < PASS_BYTES) ? length : PASS_BYTES);
+		if (written > 0) {
+			pi.out_start += written;
+			moved += written;
+		}
+		if (pi.out_start == pi.out_end) {
+			pi.out_start = pi.out_end = 0;
+		}
+	}
+
+	uint8_t received[PASS_BYTES];
+	ssize_t length = read(pi.fd, received, sizeof(received));
+	for (ssize_t i = 0; i < length; i++) {
+		if (received[i] != PI_FRAME_DELIMITER) {
+			pi.rx_errors += (pi.in_length == sizeof(pi.in));
+			pi.in_length = (pi.in_length == sizeof(pi.in)) ? 0 : pi.in_length;
+			pi.in[pi.in_length++] = received[i];
+		} else if (pi.in_length != 0) {
+			pi_frame(pi.in, pi.in_length);
+			pi.in_length = 0;
+		}
+	}
+	moved += (length > 0) ? length : 0;
+	return moved;
+}
+
+/* Board end ---------------------------------------------------------------- */
+
+typedef struct {
+	int fd;
+	size_t tx_written;			//bytes of the transmit DMA transfer written so far
+	size_t rx_position;			//ring index the receive DMA writes next
+
+	bool streaming;
+	uint32_t stream_sent;
+	uint8_t chunks[BOARD_CHUNKS][STREAM_PAYLOAD];
+	volatile bool chunk_busy[BOARD_CHUNKS];
+
+	uint32_t stream_received;
+	uint32_t stream_errors;
+}BoardEnd;
+
+static BoardEnd board;
+
+static void board_chunk_done(void *context) {
+	*(volatile bool *)context = false;
+}
+
+//The state machine's handling of the received messages
+static void board_handle_messages(void) {
+	for (PiCommRxView *view; (view = pi_comms_rx_peek()) != NULL; pi_comms_rx_release()) {
+		PiRxCommMessage *message = view->message;
+		switch (message->header.id) {
+			case PI_COMM_MSG_LINK_SPEED:
+				pi_link_request(message->data.link_speed.baud);
+				break;
+			case STREAM_ID_PI:
+				board.stream_errors += !stream_check(message->data.tags, message->header.length, board.stream_received);
+				board.stream_received++;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+static size_t board_pump(void) {
+	for (int i = 0; board.streaming && (i < BOARD_CHUNKS); i++) {
+		if (board.chunk_busy[i]) {
+			continue;
+		}
+		stream_fill(board.chunks[i], board.stream_sent);
+		board.chunk_busy[i] = true;
+		if (pi_comms_tx_send_zero_copy(PI_COMMS_TX_PRIORITY_STREAM, STREAM_ID_BOARD, board.chunks[i], STREAM_PAYLOAD,
+				board_chunk_done, (void *)&board.chunk_busy[i]) != HAL_OK) {
+			board.chunk_busy[i] = false;
+			break;
+		}
+		board.stream_sent++;
+	}
+
+	//transmit DMA: out on the line, then the transmit complete interrupt starts the next frame
+	size_t moved = 0;
+	while ((huart2.gState == HAL_UART_STATE_BUSY_TX) && (moved < PASS_BYTES)) {
+		ssize_t written = write(board.fd, &huart2.pTxBuffPtr[board.tx_written], huart2.TxXferSize - board.tx_written);
+		if (written <= 0) {
+			break;
+		}
+		board.tx_written += written;
+		moved += written;
+		if (board.tx_written == huart2.TxXferSize) {
+			board.tx_written = 0;
+			shim_uart_tx_complete(&huart2);
+		}
+	}
+
+	//circular receive DMA, with an event at the half and the end of each lap, and on idle line
+	size_t received = 0;
+	while (received < PASS_BYTES) {
+		size_t half = huart2.RxXferSize / 2;
+		size_t space = (board.rx_position < half) ? (half - board.rx_position) : (huart2.RxXferSize - board.rx_position);
+		ssize_t length = read(board.fd, &huart2.pRxBuffPtr[board.rx_position], space);
+		if (length <= 0) {
+			break;
+		}
+		board.rx_position += length;
+		received += length;
+		Pi_RxEventCallback(&huart2, board.rx_position);
+		board.rx_position %= huart2.RxXferSize;
+		board_handle_messages();
+	}
+	return moved + received;
+}
+
+/* Link --------------------------------------------------------------------- */
+
+static void link_open(void) {
+	pi.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	CHECK(pi.fd >= 0);
+	CHECK_EQ(grantpt(pi.fd), 0);
+	CHECK_EQ(unlockpt(pi.fd), 0);
+	board.fd = open(ptsname(pi.fd), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	CHECK(board.fd >= 0);
+
+	//raw bytes, no echo nor line editing
+	struct termios settings;
+	CHECK_EQ(tcgetattr(board.fd, &settings), 0);
+	cfmakeraw(&settings);
+	CHECK_EQ(tcsetattr(board.fd, TCSANOW, &settings), 0);
+
+	pi_comms_tx_init();
+	pi_comms_rx_init();
+	pi_link_init();
+	CHECK_EQ(shim_active_timers(), 0);
+}
+
+//One pass of both ends, then 1 ms of virtual time. Returns the bytes moved.
+static size_t link_pass(void) {
+	size_t moved = pi_pump() + board_pump();
+	shim_advance_ms(1);
+	return moved;
+}
+
+//Runs until acks acknowledgements in total reached the Pi, at most timeout_ms. Returns the virtual time it took.
+static uint32_t link_wait_ack(uint32_t acks, uint32_t timeout_ms) {
+	uint32_t start = HAL_GetTick();
+	while ((pi.acks < acks) && ((HAL_GetTick() - start) < timeout_ms)) {
+		link_pass();
+	}
+	CHECK_EQ(pi.acks, acks);
+	return HAL_GetTick() - start;
+}
+
+//Stops the streams and runs until all was received on both ends
+static void link_drain(void) {
+	pi.streaming = false;
+	board.streaming = false;
+	for (int idle = 0; idle < 10; ) {
+		idle = (link_pass() == 0) ? (idle + 1) : 0;
+	}
+	CHECK_EQ(pi.out_start, pi.out_end);
+	CHECK_EQ(huart2.gState, HAL_UART_STATE_READY);
+}
+
+static void check_board_rate(uint32_t baud) {
+	CHECK_EQ(huart2.Init.BaudRate, baud);
+	CHECK_EQ(huart2.Instance->BRR, HAL_RCC_GetPCLK1Freq() / baud);
+	CHECK_EQ(pi_link_get_stats().baud, baud);
+	CHECK_EQ(pi.baud, baud);
+	//the supervision timer only runs away from the default rate
+	CHECK_EQ(shim_active_timers(), baud != PI_LINK_DEFAULT_BAUD);
+}
+
+/* Tests -------------------------------------------------------------------- */
+
+static void test_rejects_unsupported_rates(void) {
+	huart2.Init.BaudRate = PI_LINK_DEFAULT_BAUD; //MX_USART2_UART_Init()
+	link_open();
+
+	pi_request(PI_LINK_MAX_BAUD + 1);
+	link_wait_ack(1, 100);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_ERROR_BAUD);
+	CHECK_EQ(pi.last_ack.baud, PI_LINK_DEFAULT_BAUD);
+	CHECK_EQ(pi.last_ack.max_baud, PI_LINK_MAX_BAUD);
+
+	pi_request(9600);
+	link_wait_ack(2, 100);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_ERROR_BAUD);
+	CHECK_EQ(huart2.Init.BaudRate, PI_LINK_DEFAULT_BAUD);
+	CHECK_EQ(pi_link_get_stats().negotiations, 0);
+}
+
+static void test_switch_under_load(void) {
+	//bulk data flowing both ways when the Pi asks for the fastest rate
+	pi.streaming = true;
+	board.streaming = true;
+	for (int i = 0; i < 200; i++) {
+		link_pass();
+	}
+	CHECK(pi.stream_received > 0);
+	CHECK(board.stream_received > 0);
+
+	pi_request(PI_LINK_MAX_BAUD);
+	link_wait_ack(pi.acks + 1, 1000);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_OK);
+	check_board_rate(PI_LINK_MAX_BAUD);
+
+	//confirmed by the Pi's data, no fallback
+	for (int i = 0; i < 3 * PI_LINK_CONFIRM_TIMEOUT_MS; i++) {
+		link_pass();
+	}
+	link_drain();
+	check_board_rate(PI_LINK_MAX_BAUD);
+
+	//not a frame lost across the switch, in either direction
+	PiCommsRxStats rx = pi_comms_rx_get_stats();
+	CHECK_EQ(board.stream_received, pi.stream_sent);
+	CHECK_EQ(board.stream_errors, 0);
+	CHECK_EQ(pi.stream_received, board.stream_sent);
+	CHECK_EQ(pi.stream_errors, 0);
+	CHECK_EQ(rx.sequence_gaps, 0);
+	CHECK_EQ(rx.cobs_errors + rx.length_errors + rx.crc_errors + rx.overflows + rx.queue_full + rx.overruns, 0);
+	CHECK_EQ(pi.rx_gaps, 0);
+	CHECK_EQ(pi.rx_errors, 0);
+
+	PiLinkStats stats = pi_link_get_stats();
+	CHECK_EQ(stats.negotiations, 1);
+	CHECK_EQ(stats.fallbacks, 0);
+	CHECK_EQ(stats.step_downs, 0);
+}
+
+static void test_fallbacks(void) {
+	//the Pi goes quiet (e.g. it rebooted)
+	uint32_t elapsed = link_wait_ack(pi.acks + 1, PI_LINK_IDLE_TIMEOUT_S * 1000 + 2 * PI_LINK_CHECK_PERIOD_MS);
+	CHECK(elapsed >= PI_LINK_IDLE_TIMEOUT_S * 1000 - PI_LINK_CHECK_PERIOD_MS);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_FALLBACK);
+	check_board_rate(PI_LINK_DEFAULT_BAUD);
+	CHECK_EQ(pi_link_get_stats().fallbacks, 1);
+
+	//accepted, but nothing heard at the new rate
+	pi_request(PI_LINK_MAX_BAUD);
+	link_wait_ack(pi.acks + 1, 100);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_OK);
+	elapsed = link_wait_ack(pi.acks + 1, PI_LINK_CONFIRM_TIMEOUT_MS + 2 * PI_LINK_CHECK_PERIOD_MS);
+	CHECK(elapsed >= PI_LINK_CONFIRM_TIMEOUT_MS - PI_LINK_CHECK_PERIOD_MS);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_FALLBACK);
+	check_board_rate(PI_LINK_DEFAULT_BAUD);
+	CHECK_EQ(pi_link_get_stats().fallbacks, 2);
+}
+
+static void test_step_down(void) {
+	pi.streaming = true;
+	board.streaming = true;
+	pi_request(PI_LINK_MAX_BAUD);
+	link_wait_ack(pi.acks + 1, 1000);
+	check_board_rate(PI_LINK_MAX_BAUD);
+	for (int i = 0; i < PI_LINK_CONFIRM_TIMEOUT_MS; i++) {
+		link_pass();
+	}
+
+	//a burst of damaged frames within one check period
+	uint32_t errors = pi_link_get_stats().errors;
+	for (int i = 0; i <= PI_LINK_ERROR_THRESHOLD; i++) {
+		CHECK(pi_send(PI_COMM_MSG_QUERY_STATE, NULL, 0, true));
+	}
+	link_wait_ack(pi.acks + 1, 2 * PI_LINK_CHECK_PERIOD_MS);
+	CHECK_EQ(pi.last_ack.status, PI_LINK_STEP_DOWN);
+	check_board_rate(1000000);
+	CHECK(pi_link_get_stats().errors - errors > PI_LINK_ERROR_THRESHOLD);
+	CHECK_EQ(pi_link_get_stats().step_downs, 1);
+
+	//the data carries on at the slower rate, only the damaged frames were lost
+	for (int i = 0; i < PI_LINK_CONFIRM_TIMEOUT_MS; i++) {
+		link_pass();
+	}
+	link_drain();
+	check_board_rate(1000000);
+	CHECK_EQ(board.stream_received, pi.stream_sent);
+	CHECK_EQ(board.stream_errors, 0);
+	CHECK_EQ(pi.stream_received, board.stream_sent);
+	CHECK_EQ(pi.stream_errors, 0);
+}
+
+static void test_sustained_throughput(void) {
+	enum { CHUNKS = 40000 };
+	pi_request(PI_LINK_MAX_BAUD);
+	link_wait_ack(pi.acks + 1, 100);
+	check_board_rate(PI_LINK_MAX_BAUD);
+
+	uint32_t pi_start = pi.stream_sent, board_start = board.stream_sent;
+	PiCommsTxStats tx_start = pi_comms_tx_get_stats();
+	pi.streaming = true;
+	board.streaming = true;
+	double start_ns = host_ns();
+	while (((pi.stream_sent - pi_start) < CHUNKS) || ((board.stream_sent - board_start) < CHUNKS)) {
+		pi.streaming = (pi.stream_sent - pi_start) < CHUNKS;
+		board.streaming = (board.stream_sent - board_start) < CHUNKS;
+		link_pass();
+	}
+	link_drain();
+	double seconds = (host_ns() - start_ns) / 1e9;
+
+	//framed bytes on the line, 10 bits each
+	double board_bytes = pi_comms_tx_get_stats().bytes - tx_start.bytes;
+	double pi_bytes = (pi.stream_sent - pi_start) * (double)PI_FRAME_ENCODED_SIZE(STREAM_PAYLOAD);
+	printf("%u chunks each way in %.2f s: Pi to board %.1f Mbaud, board to Pi %.1f Mbaud (link at most %.1f)\n",
+			CHUNKS, seconds, pi_bytes * 10 / seconds / 1e6, board_bytes * 10 / seconds / 1e6, PI_LINK_MAX_BAUD / 1e6);
+
+	CHECK_EQ(board.stream_received, pi.stream_sent);
+	CHECK_EQ(board.stream_errors, 0);
+	CHECK_EQ(pi.stream_received, board.stream_sent);
+	CHECK_EQ(pi.stream_errors, 0);
+	CHECK_EQ(pi_comms_tx_get_stats().dma_errors, 0);
+	PiCommsRxStats rx = pi_comms_rx_get_stats();
+	CHECK_EQ(rx.queue_full + rx.overruns + rx.overflows, 0);
+
+	//both ends keep up with the fastest rate in both directions at once
+	CHECK(pi_bytes * 10 / seconds >= PI_LINK_MAX_BAUD);
+	CHECK(board_bytes * 10 / seconds >= PI_LINK_MAX_BAUD);
+}
+
+int main(void) {
+	RUN(test_rejects_unsupported_rates);
+	RUN(test_switch_under_load);
+	RUN(test_fallbacks);
+	RUN(test_step_down);
+	RUN(test_sustained_throughput);
+	return test_report();
+}
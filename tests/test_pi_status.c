@@ -0,0 +1,490 @@
+/*
+ * test_pi_status.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * TLV lists (Comms Src/PiTlv.c) and the status responses built from them (Comms Src/PiStatus.c): writer/reader
+ * round trips and edge cases, then the snapshot as the Pi receives it, decoded field by field against the values
+ * the firmware modules (stubbed here) reported.
+ */
+
+#include "test.h"
+#include "Comms Inc/PiComms.h"
+#include "Comms Inc/PiStatus.h"
+#include "Comms Inc/PiTlv.h"
+#include "Lib Inc/cpu_load.h"
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/low_power.h"
+#include "Lib Inc/state_machine.h"
+#include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/AprsPacket.h"
+#include "Recovery Inc/Kiss.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include "config.h"
+
+extern volatile uint32_t shim_tick_ms;
+
+/* Firmware modules ----------------------------------------------------------- */
+
+//What the modules report, set by the tests
+static const char *stub_callsign = "KC1QXQ";
+static const char *stub_comment = "";
+static GPS_Data stub_fix;
+static Timestamp stub_fix_timestamp;
+static Timestamp stub_tx_timestamp;
+static PiCommsRxStats stub_rx_stats;
+static PiCommsTxStats stub_tx_stats;
+
+Configuration g_config;
+float voltage_mon;
+
+State state_machine_get_state(void) {
+	return STATE_APRS;
+}
+
+Timestamp state_machine_get_state_timestamp(void) {
+	return (Timestamp){.monotonic_ms = 1000};
+}
+
+void aprs_get_callsign(char callsign[static 7]) {
+	strcpy(callsign, stub_callsign);
+}
+
+void aprs_get_ssid(uint8_t *p_ssid) {
+	*p_ssid = 11;
+}
+
+void aprs_get_comment(char comment[static APRS_MAX_COMMENT_LEN + 1]) {
+	strcpy(comment, stub_comment);
+}
+
+Timestamp aprs_get_last_fix(GPS_Data *fix) {
+	*fix = stub_fix;
+	return stub_fix_timestamp;
+}
+
+Timestamp aprs_get_last_tx_timestamp(void) {
+	return stub_tx_timestamp;
+}
+
+bool gps_is_continuous(void) {
+	return true;
+}
+
+bool battery_monitor_is_low(void) {
+	return false;
+}
+
+PiCommsRxStats pi_comms_rx_get_stats(void) {
+	return stub_rx_stats;
+}
+
+PiCommsTxStats pi_comms_tx_get_stats(void) {
+	return stub_tx_stats;
+}
+
+GPS_IngestStats gps_get_ingest_stats(void) {
+	GPS_IngestStats stats = {0};
+	stats.framer.nmea_sentences = 900;
+	stats.framer.ubx_frames = 100;
+	stats.ring_overruns = 3;
+	return stats;
+}
+
+PiGpsForwardStats pi_gps_forward_get_stats(void) {
+	return (PiGpsForwardStats){.dropped = 7};
+}
+
+KissStats kiss_get_stats(void) {
+	return (KissStats){0};
+}
+
+LowPowerStats low_power_get_stats(void) {
+	return (LowPowerStats){0};
+}
+
+void cpu_load_get_isr_stats(CpuLoadIsrStats stats[CPU_LOAD_NUM_ISRS]) {
+	memset(stats, 0, CPU_LOAD_NUM_ISRS * sizeof(CpuLoadIsrStats));
+	stats[CPU_LOAD_ISR_SYSTICK].runs = 1000;
+}
+
+EventLogStats event_log_get_stats(void) {
+	return (EventLogStats){0};
+}
+
+PiLinkStats pi_link_get_stats(void) {
+	return (PiLinkStats){0};
+}
+
+FwUpdateInfo fw_update_get_info(void) {
+	return (FwUpdateInfo){0};
+}
+
+//The response as handed to the transmit queue
+static uint8_t sent_payload[PI_COMMS_MAX_DATA_PAYLOAD];
+static size_t sent_length;
+static int sent_count;
+
+HAL_StatusTypeDef pi_comms_tx_send_zero_copy(PiCommsTxPriority priority, uint8_t id, const void *payload, size_t length,
+		void (*done)(void *context), void *context) {
+	CHECK_EQ(id, PI_COMM_MSG_STATUS);
+	CHECK(length <= sizeof(sent_payload));
+	memcpy(sent_payload, payload, length);
+	sent_length = length;
+	sent_count++;
+	done(context);
+	return HAL_OK;
+}
+
+/* TLV ------------------------------------------------------------------------ */
+
+static void test_tlv_round_trip(void) {
+	uint8_t buffer[64];
+	PiTlvWriter writer;
+	pi_tlv_writer_init(&writer, buffer, sizeof(buffer));
+	CHECK(pi_tlv_put_u8(&writer, 0x01, 0xAB));
+	CHECK(pi_tlv_put_u32(&writer, 0x02, 0x12345678));
+	CHECK(pi_tlv_put_float(&writer, 0x03, -61.45f));
+	CHECK(pi_tlv_put(&writer, 0x04, "abc", 3));
+	CHECK(pi_tlv_put(&writer, 0x05, NULL, 0));
+	CHECK_EQ(writer.length, 5 * PI_TLV_HEADER_SIZE + 1 + 4 + 4 + 3);
+
+	//little-endian on the wire
+	const uint8_t u32_entry[] = {0x02, 4, 0x78, 0x56, 0x34, 0x12};
+	CHECK_MEM(&buffer[PI_TLV_HEADER_SIZE + 1], u32_entry, sizeof(u32_entry));
+
+	PiTlvReader reader;
+	pi_tlv_reader_init(&reader, buffer, writer.length);
+	uint8_t tag, length;
+	const uint8_t *value;
+
+	CHECK(pi_tlv_next(&reader, &tag, &value, &length));
+	CHECK_EQ(tag, 0x01);
+	CHECK_EQ(length, 1);
+	CHECK_EQ(value[0], 0xAB);
+
+	CHECK(pi_tlv_next(&reader, &tag, &value, &length));
+	CHECK_EQ(tag, 0x02);
+	CHECK_EQ(length, 4);
+	CHECK_EQ(value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24), 0x12345678);
+
+	CHECK(pi_tlv_next(&reader, &tag, &value, &length));
+	CHECK_EQ(tag, 0x03);
+	float latitude;
+	memcpy(&latitude, value, sizeof(latitude));
+	CHECK_EQ(length, 4);
+	CHECK(latitude == -61.45f);
+
+	CHECK(pi_tlv_next(&reader, &tag, &value, &length));
+	CHECK_EQ(tag, 0x04);
+	CHECK_EQ(length, 3);
+	CHECK_MEM(value, "abc", 3);
+
+	CHECK(pi_tlv_next(&reader, &tag, &value, &length));
+	CHECK_EQ(tag, 0x05);
+	CHECK_EQ(length, 0);
+
+	CHECK(!pi_tlv_next(&reader, &tag, &value, &length));
+}
+
+static void test_tlv_limits(void) {
+	uint8_t buffer[PI_TLV_HEADER_SIZE + PI_TLV_MAX_VALUE + 1];
+	uint8_t value[PI_TLV_MAX_VALUE + 1] = {0};
+	PiTlvWriter writer;
+
+	//too long for the length byte
+	pi_tlv_writer_init(&writer, buffer, sizeof(buffer));
+	CHECK(!pi_tlv_put(&writer, 0x01, value, PI_TLV_MAX_VALUE + 1));
+	CHECK(pi_tlv_put(&writer, 0x01, value, PI_TLV_MAX_VALUE));
+
+	//an entry that doesn't fit writes nothing, a smaller one still does
+	pi_tlv_writer_init(&writer, buffer, 9);
+	CHECK(pi_tlv_put_u32(&writer, 0x01, 1));
+	size_t length_before = writer.length;
+	CHECK(!pi_tlv_put_u32(&writer, 0x02, 2));
+	CHECK_EQ(writer.length, length_before);
+	CHECK(pi_tlv_put_u8(&writer, 0x03, 3));
+	CHECK_EQ(writer.length, 9);
+
+	//the reader stops on an entry running past the end, whatever its header says
+	const uint8_t truncated[] = {0x01, 1, 0xAA, 0x02, 4, 0x00, 0x00};
+	PiTlvReader reader;
+	uint8_t tag, value_length;
+	const uint8_t *entry;
+	pi_tlv_reader_init(&reader, truncated, sizeof(truncated));
+	CHECK(pi_tlv_next(&reader, &tag, &entry, &value_length));
+	CHECK(!pi_tlv_next(&reader, &tag, &entry, &value_length));
+
+	//and on a lone tag byte
+	pi_tlv_reader_init(&reader, truncated, 4);
+	CHECK(pi_tlv_next(&reader, &tag, &entry, &value_length));
+	CHECK(!pi_tlv_next(&reader, &tag, &entry, &value_length));
+}
+
+static void test_tlv_random_lists(void) {
+	enum { LISTS = 10000, MAX_ENTRIES = 40 };
+	uint8_t buffer[PI_COMMS_MAX_DATA_PAYLOAD];
+	uint8_t values[MAX_ENTRIES][PI_TLV_MAX_VALUE];
+	uint8_t tags[MAX_ENTRIES], lengths[MAX_ENTRIES];
+	test_random_seed(41);
+
+	for (int list = 0; list < LISTS; list++) {
+		PiTlvWriter writer;
+		pi_tlv_writer_init(&writer, buffer, sizeof(buffer));
+		int entries = 0;
+		for (int i = 0; i < MAX_ENTRIES; i++) {
+			tags[entries] = test_random();
+			lengths[entries] = test_random_below((test_random_below(4) == 0) ? 200 : 8);
+			for (int j = 0; j < lengths[entries]; j++) {
+				values[entries][j] = test_random();
+			}
+			size_t length_before = writer.length;
+			bool fits = (length_before + PI_TLV_HEADER_SIZE + lengths[entries]) <= sizeof(buffer);
+			CHECK_EQ(pi_tlv_put(&writer, tags[entries], values[entries], lengths[entries]), fits);
+			entries += fits;
+		}
+
+		PiTlvReader reader;
+		pi_tlv_reader_init(&reader, buffer, writer.length);
+		uint8_t tag, length;
+		const uint8_t *value;
+		int read = 0;
+		while (pi_tlv_next(&reader, &tag, &value, &length)) {
+			if ((read >= entries) || (tag != tags[read]) || (length != lengths[read]) || (memcmp(value, values[read], length) != 0)) {
+				CHECK(false);
+				return;
+			}
+			read++;
+		}
+		CHECK_EQ(read, entries);
+		CHECK_EQ(reader.offset, writer.length);
+	}
+}
+
+/* Status ----------------------------------------------------------------------- */
+
+//The snapshot as the Pi decodes it
+typedef struct {
+	bool seen[256];
+	uint8_t state;
+	uint32_t state_time_ms;
+	uint32_t uptime_ms;
+	Timestamp time;
+	float critical_voltage;
+	uint8_t vhf_power;
+	float aprs_freq;
+	char callsign[8];
+	uint8_t ssid;
+	char comment[APRS_MAX_COMMENT_LEN + 1];
+	PiCommGpsFixGatePkt gate;
+	PiCommGpsFixGatePkt gate_critical;
+	uint8_t continuous;
+	uint32_t telemetry_period_s;
+	GPS_Data last_fix;
+	uint32_t last_fix_age_ms;
+	uint32_t last_tx_age_ms;
+	float battery_voltage;
+	uint8_t battery_low;
+	PiStatusCounters counters;
+	PiCommsRxStats rx_stats;
+	int unknown;
+}DecodedStatus;
+
+static uint32_t read_u32(const uint8_t *value) {
+	return value[0] | (value[1] << 8) | (value[2] << 16) | ((uint32_t)value[3] << 24);
+}
+
+static float read_float(const uint8_t *value) {
+	uint32_t bits = read_u32(value);
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+//Copies a fixed size value, checking its length
+#define READ_VALUE(DEST) do { \
+		CHECK_EQ(length, sizeof(DEST)); \
+		memcpy(&(DEST), value, sizeof(DEST)); \
+	} while (0)
+
+static DecodedStatus decode_status(const uint8_t *payload, size_t payload_length) {
+	DecodedStatus status;
+	memset(&status, 0, sizeof(status));
+
+	PiTlvReader reader;
+	pi_tlv_reader_init(&reader, payload, payload_length);
+	uint8_t tag, length;
+	const uint8_t *value;
+	while (pi_tlv_next(&reader, &tag, &value, &length)) {
+		CHECK(!status.seen[tag]);
+		status.seen[tag] = true;
+		switch (tag) {
+			case PI_STATUS_STATE:                 READ_VALUE(status.state); break;
+			case PI_STATUS_STATE_TIME_MS:         CHECK_EQ(length, 4); status.state_time_ms = read_u32(value); break;
+			case PI_STATUS_UPTIME_MS:             CHECK_EQ(length, 4); status.uptime_ms = read_u32(value); break;
+			case PI_STATUS_TIME:                  READ_VALUE(status.time); break;
+			case PI_STATUS_CRITICAL_VOLTAGE:      CHECK_EQ(length, 4); status.critical_voltage = read_float(value); break;
+			case PI_STATUS_VHF_POWER_LEVEL:       READ_VALUE(status.vhf_power); break;
+			case PI_STATUS_APRS_FREQUENCY:        CHECK_EQ(length, 4); status.aprs_freq = read_float(value); break;
+			case PI_STATUS_APRS_SSID:             READ_VALUE(status.ssid); break;
+			case PI_STATUS_GPS_FIX_GATE:          READ_VALUE(status.gate); break;
+			case PI_STATUS_GPS_FIX_GATE_CRITICAL: READ_VALUE(status.gate_critical); break;
+			case PI_STATUS_GPS_CONTINUOUS:        READ_VALUE(status.continuous); break;
+			case PI_STATUS_TELEMETRY_PERIOD:      CHECK_EQ(length, 4); status.telemetry_period_s = read_u32(value); break;
+			case PI_STATUS_LAST_FIX:              READ_VALUE(status.last_fix); break;
+			case PI_STATUS_LAST_FIX_AGE_MS:       CHECK_EQ(length, 4); status.last_fix_age_ms = read_u32(value); break;
+			case PI_STATUS_LAST_TX_AGE_MS:        CHECK_EQ(length, 4); status.last_tx_age_ms = read_u32(value); break;
+			case PI_STATUS_BATTERY_VOLTAGE:       CHECK_EQ(length, 4); status.battery_voltage = read_float(value); break;
+			case PI_STATUS_BATTERY_LOW:           READ_VALUE(status.battery_low); break;
+			case PI_STATUS_COUNTERS:              READ_VALUE(status.counters); break;
+			case PI_STATUS_PI_RX_STATS:           READ_VALUE(status.rx_stats); break;
+			case PI_STATUS_APRS_CALLSIGN:
+				CHECK(length < sizeof(status.callsign));
+				memcpy(status.callsign, value, (length < sizeof(status.callsign)) ? length : 0);
+				break;
+			case PI_STATUS_APRS_COMMENT:
+				CHECK(length < sizeof(status.comment));
+				memcpy(status.comment, value, (length < sizeof(status.comment)) ? length : 0);
+				break;
+			default:
+				status.unknown++;
+				break;
+		}
+	}
+	CHECK_EQ(reader.offset, payload_length);
+	return status;
+}
+
+static void set_up_modules(void) {
+	shim_tick_ms = 50000;
+	g_config.critical_voltage = 6.2f;
+	g_config.vhf_power = 1;
+	g_config.aprs_freq = 144.39f;
+	g_config.gps_gate = (GpsFixGate){.max_hdop = 5.0f, .min_satellites = 4, .min_fix_type = 3, .max_age_ms = 2000};
+	g_config.gps_gate_critical = (GpsFixGate){.max_hdop = 20.0f, .min_satellites = 3, .min_fix_type = 2, .max_age_ms = 10000};
+	g_config.telemetry_period_s = 600;
+	voltage_mon = 7.4f;
+	stub_rx_stats = (PiCommsRxStats){.frames = 1234, .crc_errors = 5, .cobs_errors = 1, .queue_full = 2};
+	stub_tx_stats = (PiCommsTxStats){0};
+	stub_tx_stats.rejected[0] = 4;
+	stub_fix = (GPS_Data){.latitude = 15.3f, .longitude = -61.45f, .timestamp = {12, 34, 56}, .is_valid_data = 1};
+	stub_fix_timestamp = (Timestamp){.monotonic_ms = 45000};
+	stub_tx_timestamp = (Timestamp){.monotonic_ms = 48000};
+	stub_callsign = "KC1QXQ";
+	stub_comment = "";
+}
+
+static void test_snapshot(void) {
+	set_up_modules();
+	sent_count = 0;
+	pi_status_send_snapshot();
+	CHECK_EQ(sent_count, 1);
+	DecodedStatus status = decode_status(sent_payload, sent_length);
+
+	CHECK_EQ(status.state, STATE_APRS);
+	CHECK_EQ(status.state_time_ms, 49000);
+	CHECK_EQ(status.uptime_ms, 50000);
+	CHECK(status.seen[PI_STATUS_TIME]);
+	CHECK_EQ(status.time.monotonic_ms, 50000);
+	CHECK(status.critical_voltage == 6.2f);
+	CHECK_EQ(status.vhf_power, 1);
+	CHECK(status.aprs_freq == 144.39f);
+	CHECK(strcmp(status.callsign, "KC1QXQ") == 0);
+	CHECK_EQ(status.ssid, 11);
+	CHECK(status.seen[PI_STATUS_APRS_COMMENT]);
+	CHECK(strcmp(status.comment, "") == 0);
+	CHECK_EQ(status.gate.critical, 0);
+	CHECK(status.gate.max_hdop == 5.0f);
+	CHECK_EQ(status.gate.min_satellites, 4);
+	CHECK_EQ(status.gate.min_fix_type, 3);
+	CHECK_EQ(status.gate.max_age_ms, 2000);
+	CHECK_EQ(status.gate_critical.critical, 1);
+	CHECK(status.gate_critical.max_hdop == 20.0f);
+	CHECK_EQ(status.gate_critical.max_age_ms, 10000);
+	CHECK_EQ(status.continuous, 1);
+	CHECK_EQ(status.telemetry_period_s, 600);
+	CHECK(status.last_fix.latitude == 15.3f);
+	CHECK(status.last_fix.longitude == -61.45f);
+	CHECK_EQ(status.last_fix.timestamp[2], 56);
+	CHECK_EQ(status.last_fix_age_ms, 5000);
+	CHECK_EQ(status.last_tx_age_ms, 2000);
+	CHECK(status.battery_voltage == 7.4f);
+	CHECK_EQ(status.battery_low, 0);
+	CHECK_EQ(status.counters.pi_rx_frames, 1234);
+	CHECK_EQ(status.counters.pi_rx_errors, 6);
+	CHECK_EQ(status.counters.pi_rx_dropped, 2);
+	CHECK_EQ(status.counters.pi_tx_rejected, 4);
+	CHECK_EQ(status.counters.gps_sentences, 1000);
+	CHECK_EQ(status.counters.gps_dropped, 3);
+	CHECK_EQ(status.counters.gps_forward_dropped, 7);
+	CHECK_EQ(status.unknown, 0);
+
+	//the detailed statistics are left out of the snapshot
+	CHECK(!status.seen[PI_STATUS_PI_RX_STATS]);
+}
+
+static void test_snapshot_fits(void) {
+	//longest callsign and comment: every field still fits in the one message
+	set_up_modules();
+	static char long_comment[APRS_MAX_COMMENT_LEN + 1];
+	memset(long_comment, 'x', APRS_MAX_COMMENT_LEN);
+	stub_comment = long_comment;
+	pi_status_send_snapshot();
+	DecodedStatus status = decode_status(sent_payload, sent_length);
+	CHECK_EQ(strlen(status.comment), APRS_MAX_COMMENT_LEN);
+	CHECK(status.seen[PI_STATUS_COUNTERS]);
+	printf("snapshot: %zu of %d bytes\n", sent_length, PI_COMMS_MAX_DATA_PAYLOAD);
+
+	//before the first fix and transmission, their fields are left out
+	stub_fix_timestamp = (Timestamp){0};
+	stub_tx_timestamp = (Timestamp){0};
+	pi_status_send_snapshot();
+	status = decode_status(sent_payload, sent_length);
+	CHECK(!status.seen[PI_STATUS_LAST_FIX]);
+	CHECK(!status.seen[PI_STATUS_LAST_FIX_AGE_MS]);
+	CHECK(!status.seen[PI_STATUS_LAST_TX_AGE_MS]);
+	CHECK(status.seen[PI_STATUS_BATTERY_VOLTAGE]);
+}
+
+static void test_field_queries(void) {
+	set_up_modules();
+
+	//any set of fields in any order, unknown tags ignored
+	const uint8_t tags[] = {PI_STATUS_PI_RX_STATS, 0xEE, PI_STATUS_STATE, PI_STATUS_APRS_SSID};
+	pi_status_send(tags, sizeof(tags));
+	DecodedStatus status = decode_status(sent_payload, sent_length);
+	CHECK_EQ(status.rx_stats.frames, 1234);
+	CHECK_EQ(status.rx_stats.crc_errors, 5);
+	CHECK_EQ(status.state, STATE_APRS);
+	CHECK_EQ(status.ssid, 11);
+	CHECK(!status.seen[0xEE]);
+	CHECK(!status.seen[PI_STATUS_UPTIME_MS]);
+	CHECK_EQ(sent_length, 3 * PI_TLV_HEADER_SIZE + sizeof(PiCommsRxStats) + 1 + 1);
+
+	//each detailed statistic fits on its own
+	for (uint8_t tag = PI_STATUS_PI_RX_STATS; tag <= PI_STATUS_ISR_STATS; tag++) {
+		pi_status_send(&tag, 1);
+		status = decode_status(sent_payload, sent_length);
+		CHECK(status.seen[tag]);
+	}
+
+	//every counted interrupt
+	const uint8_t isr_tag = PI_STATUS_ISR_STATS;
+	pi_status_send(&isr_tag, 1);
+	CHECK_EQ(sent_length, PI_TLV_HEADER_SIZE + CPU_LOAD_NUM_ISRS * sizeof(CpuLoadIsrStats));
+	CpuLoadIsrStats systick;
+	memcpy(&systick, &sent_payload[PI_TLV_HEADER_SIZE + CPU_LOAD_ISR_SYSTICK * sizeof(CpuLoadIsrStats)], sizeof(systick));
+	CHECK_EQ(systick.runs, 1000);
+}
+
+int main(void) {
+	time_init();
+	RUN(test_tlv_round_trip);
+	RUN(test_tlv_limits);
+	RUN(test_tlv_random_lists);
+	RUN(test_snapshot);
+	RUN(test_snapshot_fits);
+	RUN(test_field_queries);
+	return test_report();
+}
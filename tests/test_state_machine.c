@@ -0,0 +1,339 @@
+/*
+ * test_state_machine.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * State transitions (Lib Src/state_machine.c): every (from, to) pair against the expected predecessor table, with
+ * and without a critical battery, checking what each state leaves running (threads, GPS, VHF) and that a refused
+ * transition changes nothing. The state is module-static, so each case runs in a forked child from a fresh first
+ * entry.
+ */
+
+#include "test.h"
+#include "Comms Inc/PiComms.h"
+#include "Comms Inc/PiGpsForward.h"
+#include "Comms Inc/PiLink.h"
+#include "Comms Inc/PiStatus.h"
+#include "Comms Inc/PiTelemetry.h"
+#include "Lib Inc/config_store.h"
+#include "Lib Inc/event_log.h"
+#include "Lib Inc/fw_update.h"
+#include "Lib Inc/state_machine.h"
+#include "Lib Inc/threads.h"
+#include "Recovery Inc/Aprs.h"
+#include "Recovery Inc/FishTracker.h"
+#include "Recovery Inc/Geofence.h"
+#include "Recovery Inc/GPS.h"
+#include "Recovery Inc/GpsAssist.h"
+#include "Recovery Inc/GpsReplay.h"
+#include "Recovery Inc/Kiss.h"
+#include "Recovery Inc/VHF.h"
+#include "Sensor Inc/BatteryMonitoring.h"
+#include "config.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern volatile uint32_t shim_tick_ms;
+
+/* Firmware modules ----------------------------------------------------------- */
+
+//What the state machine did to them
+static bool stub_battery_critical = false;
+static bool stub_gps_on = true; //powered at reset
+static bool stub_vhf_on = true;
+static float stub_vhf_freq_mhz = 0;
+static unsigned int stub_state_logs = 0;
+static uint8_t stub_logged_state = 0xFF;
+
+Thread_HandleTypeDef threads[NUM_THREADS];
+VHF_HandleTypdeDef vhf;
+Configuration g_config;
+
+bool battery_monitor_is_critical(void) {
+	return stub_battery_critical;
+}
+
+void event_log_state(uint8_t state) {
+	stub_state_logs++;
+	stub_logged_state = state;
+}
+
+void gps_wake(void) {
+	stub_gps_on = true;
+}
+
+void gps_sleep(void) {
+	stub_gps_on = false;
+}
+
+void aprs_suspend(TX_THREAD *aprs_thread) {
+	tx_thread_suspend(aprs_thread);
+}
+
+void aprs_sleep(void) {
+	stub_vhf_on = false;
+}
+
+void vhf_sleep(VHF_HandleTypdeDef *vhf) {
+	stub_vhf_on = false;
+}
+
+HAL_StatusTypeDef vhf_set_freq(VHF_HandleTypdeDef *vhf, float freq_MHz) {
+	stub_vhf_freq_mhz = freq_MHz;
+	return HAL_OK;
+}
+
+void vhf_set_power_level(VHF_HandleTypdeDef *vhf, VHFPowerLevel power_level) {
+	vhf->power_level = power_level;
+}
+
+//Only used by the state machine thread, not reached here
+void event_log_init(void) {}
+void event_log_flush(void) {}
+void config_load(void) {}
+void config_save(void) {}
+void config_store_init(void) {}
+void geofence_init(void) {}
+void geofence_clear(void) {}
+void geofence_invalidate(void) {}
+HAL_StatusTypeDef geofence_set_region(uint8_t index, const GeofencePolygon *polygon) { return HAL_OK; }
+void aprs_init(void) {}
+int aprs_set_callsign(const char *callsign) { return 0; }
+int aprs_set_ssid(uint8_t ssid) { return 0; }
+void aprs_set_comment(const char *comment, size_t comment_len) {}
+int aprs_set_msg_recipient_callsign(const char *callsign) { return 0; }
+int aprs_set_msg_recipient_ssid(uint8_t ssid) { return 0; }
+void aprs_tx_message(const char *message, size_t message_len) {}
+void gps_set_continuous(bool continuous) {}
+void fw_update_boot(void) {}
+void fw_update_activate(void) {}
+void fw_update_rollback(void) {}
+FwUpdateStatus fw_update_confirm(void) { return 0; }
+FwUpdateStatus fw_update_begin(uint32_t length, uint32_t crc, uint32_t *next_offset) { return 0; }
+FwUpdateStatus fw_update_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset) { return 0; }
+FwUpdateStatus fw_update_end(uint32_t length, uint32_t *next_offset) { return 0; }
+GpsAssistStatus gps_assist_begin(uint32_t length, uint32_t utc_time, uint32_t *next_offset) { return 0; }
+GpsAssistStatus gps_assist_write_chunk(uint32_t offset, const uint8_t *data, size_t length, uint32_t *next_offset) { return 0; }
+GpsAssistStatus gps_assist_end(uint32_t length, uint32_t *next_offset) { return 0; }
+GpsReplayStatus gps_replay_begin(GpsReplayPacing pacing) { return 0; }
+GpsReplayStatus gps_replay_write_chunk(uint32_t offset_ms, const uint8_t *data, size_t length) { return 0; }
+GpsReplayStatus gps_replay_end(void) { return 0; }
+void kiss_init(void) {}
+void kiss_receive(const uint8_t *data, size_t length) {}
+void pi_comms_rx_init(void) {}
+PiCommRxView *pi_comms_rx_peek(void) { return NULL; }
+void pi_comms_rx_release(void) {}
+void pi_comms_tx_init(void) {}
+void pi_comms_tx_pong(void) {}
+void pi_comms_tx_log_data(uint32_t offset, uint8_t chunks) {}
+void pi_comms_tx_fw_ack(uint8_t id, uint8_t status, uint32_t next_offset) {}
+void pi_comms_tx_error(uint8_t id, PiCommError error) {}
+void pi_comms_tx_mga_ack(uint8_t id, uint8_t status, uint32_t next_offset) {}
+void pi_comms_tx_gps_replay_ack(uint8_t id, uint8_t status) {}
+void pi_gps_forward_set_decimation(PiGpsForwardType type, uint8_t decimation) {}
+void pi_link_init(void) {}
+void pi_link_request(uint32_t baud) {}
+void pi_status_send(const uint8_t *tags, size_t count) {}
+void pi_status_send_snapshot(void) {}
+void pi_telemetry_init(void) {}
+void pi_telemetry_send(void) {}
+void pi_telemetry_update_period(void) {}
+
+//Thread entries, only referenced by the thread configuration
+void aprs_thread_entry(ULONG thread_input) {}
+void gpsBuffer_thread(ULONG thread_input) {}
+void fishtracker_thread_entry(ULONG thread_input) {}
+void kiss_thread_entry(ULONG thread_input) {}
+
+/* Expected behaviour ----------------------------------------------------------- */
+
+#define FROM(s) (1 << (s))
+
+//Written out independently of the firmware's table: the states each one can be entered from
+static const uint32_t expected_predecessors[NUM_STATES] = {
+	[STATE_CRITICAL] = FROM(STATE_WAITING) | FROM(STATE_APRS) | FROM(STATE_GPS_COLLECT) | FROM(STATE_FISHTRACKER),
+	[STATE_WAITING] = FROM(STATE_APRS) | FROM(STATE_GPS_COLLECT) | FROM(STATE_FISHTRACKER),
+	[STATE_APRS] = FROM(STATE_WAITING) | FROM(STATE_GPS_COLLECT) | FROM(STATE_FISHTRACKER),
+	[STATE_GPS_COLLECT] = FROM(STATE_WAITING),
+	[STATE_FISHTRACKER] = FROM(STATE_WAITING),
+};
+
+//States that transmit, refused on a critical battery
+static bool transmits(State state) {
+	return (state == STATE_APRS) || (state == STATE_FISHTRACKER);
+}
+
+static const char *state_name(State state) {
+	static const char *names[NUM_STATES] = {"CRITICAL", "WAITING", "APRS", "GPS_COLLECT", "FISHTRACKER"};
+	return names[state];
+}
+
+static bool thread_running(Thread thread) {
+	return threads[thread].thread.tx_thread_state == TX_READY;
+}
+
+//What a state leaves running once entered
+static void check_holds(State state) {
+	CHECK_EQ(state_machine_get_state(), state);
+	CHECK_EQ(thread_running(APRS_THREAD), state == STATE_APRS);
+	CHECK_EQ(thread_running(FISHTRACKER_THREAD), state == STATE_FISHTRACKER);
+	CHECK_EQ(thread_running(GPS_BUFFER_THREAD), (state == STATE_APRS) || (state == STATE_GPS_COLLECT));
+	//the APRS thread duty cycles the GPS itself, in GPS collection nothing does
+	if (state == STATE_GPS_COLLECT) {
+		CHECK(stub_gps_on);
+	}
+	else if (state != STATE_APRS) {
+		CHECK(!stub_gps_on);
+	}
+	//the APRS and fishtracker threads key the VHF themselves
+	if (!transmits(state)) {
+		CHECK(!stub_vhf_on);
+	}
+	if (state == STATE_FISHTRACKER) {
+		CHECK_NEAR(stub_vhf_freq_mhz, FISHTRACKER_CARRIER_FREQ_MHZ, 1e-4);
+		CHECK_EQ(vhf.power_level, FISHTRACKER_POWER);
+	}
+	else {
+		CHECK_NEAR(stub_vhf_freq_mhz, g_config.aprs_freq, 1e-4);
+		CHECK_EQ(vhf.power_level, g_config.vhf_power);
+	}
+	CHECK_EQ(shim_shutdowns, state == STATE_CRITICAL);
+}
+
+/* Forked cases --------------------------------------------------------------- */
+
+//Fresh board: threads created suspended, GPS and VHF powered, the configured carrier set by the thread entry
+static void reset_board(void) {
+	for (int i = 0; i < NUM_THREADS; i++) {
+		threads[i].thread.tx_thread_state = TX_SUSPENDED;
+	}
+	g_config = DEFAULT_CONFIGURATION;
+	vhf_set_freq(&vhf, g_config.aprs_freq);
+	vhf_set_power_level(&vhf, g_config.vhf_power);
+	stub_gps_on = true;
+	stub_vhf_on = true;
+	stub_battery_critical = false;
+	stub_state_logs = 0;
+	stub_logged_state = 0xFF;
+	shim_shutdowns = 0;
+}
+
+//Runs case(from, to) in a child, so that the state machine starts before its first entry, and counts its failures
+static void run_forked(void (*test_case)(State from, State to), State from, State to) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		int failures = test_failures;
+		reset_board();
+		test_case(from, to);
+		fflush(stdout);
+		_exit((test_failures == failures) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	int status = 0;
+	CHECK(pid > 0);
+	CHECK(waitpid(pid, &status, 0) == pid);
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+		printf("  %s -> %s\n", state_name(from), state_name(to));
+		CHECK(false);
+	}
+}
+
+//First entry: allowed from anywhere (it follows a reset), releases everything the state doesn't need
+static void first_entry_case(State from, State to) {
+	(void)to;
+	CHECK(state_machine_set_state(from));
+	CHECK_EQ(stub_state_logs, 1);
+	CHECK_EQ(stub_logged_state, from);
+	check_holds(from);
+}
+
+static void transition_case(State from, State to) {
+	CHECK(state_machine_set_state(from));
+	check_holds(from);
+	stub_state_logs = 0;
+
+	bool expected = (to == from) || (expected_predecessors[to] & FROM(from));
+	CHECK_EQ(state_machine_set_state(to), expected);
+	if (expected && (to != from)) {
+		CHECK_EQ(stub_state_logs, 1);
+		CHECK_EQ(stub_logged_state, to);
+		check_holds(to);
+	}
+	else {
+		CHECK_EQ(stub_state_logs, 0);
+		check_holds(from);
+	}
+}
+
+//On a critical battery the transmitting states are refused, the others still follow the table
+static void critical_battery_case(State from, State to) {
+	CHECK(state_machine_set_state(from));
+	stub_state_logs = 0;
+	stub_battery_critical = true;
+
+	bool expected = (to == from) || ((expected_predecessors[to] & FROM(from)) && !transmits(to));
+	CHECK_EQ(state_machine_set_state(to), expected);
+	check_holds(expected ? to : from);
+}
+
+static void test_first_entry(void) {
+	for (State state = 0; state < NUM_STATES; state++) {
+		run_forked(first_entry_case, state, state);
+	}
+}
+
+static void test_every_transition(void) {
+	for (State from = 0; from < NUM_STATES; from++) {
+		for (State to = 0; to < NUM_STATES; to++) {
+			run_forked(transition_case, from, to);
+		}
+	}
+}
+
+static void test_critical_battery(void) {
+	for (State from = 0; from < NUM_STATES; from++) {
+		for (State to = 0; to < NUM_STATES; to++) {
+			if (!transmits(from)) {
+				run_forked(critical_battery_case, from, to);
+			}
+		}
+	}
+}
+
+//Refused first entry (a transmitting state on a critical battery): the thread entry falls back to waiting
+static void refused_first_entry_case(State from, State to) {
+	stub_battery_critical = true;
+	CHECK(!state_machine_set_state(from));
+	CHECK_EQ(stub_state_logs, 0);
+	CHECK(state_machine_set_state(to));
+	check_holds(to);
+}
+
+static void test_refused_first_entry(void) {
+	run_forked(refused_first_entry_case, STATE_APRS, STATE_WAITING);
+	run_forked(refused_first_entry_case, STATE_FISHTRACKER, STATE_WAITING);
+}
+
+static void time_in_state_case(State from, State to) {
+	CHECK(state_machine_set_state(from));
+	shim_tick_ms += 1500;
+	CHECK(state_machine_set_state(to));
+	shim_tick_ms += 700;
+	CHECK_EQ(state_machine_get_state_time_ms(from), 1500);
+	CHECK_EQ(state_machine_get_state_time_ms(to), 700);
+	CHECK_EQ(state_machine_get_state_timestamp().monotonic_ms, shim_tick_ms - 700);
+	CHECK_EQ(state_machine_get_state_time_ms(NUM_STATES), 0);
+}
+
+static void test_time_in_state(void) {
+	run_forked(time_in_state_case, STATE_WAITING, STATE_GPS_COLLECT);
+}
+
+int main(void) {
+	RUN(test_first_entry);
+	RUN(test_every_transition);
+	RUN(test_critical_battery);
+	RUN(test_refused_first_entry);
+	RUN(test_time_in_state);
+	return test_report();
+}
@@ -0,0 +1,101 @@
+/*
+ * test_time_service.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * UTC between syncs (Lib Src/time_service.c): long holdovers without syncs, past the 24.8 days where a signed
+ * millisecond count overflows and the 49.7 day wrap of the HAL tick, the tick rate correction over such holdovers,
+ * and syncs taken before the current reference.
+ */
+
+#include "test.h"
+#include "Lib Inc/time_service.h"
+
+extern volatile uint32_t shim_tick_ms;
+
+#define DAY_MS (24ULL * 60 * 60 * 1000)
+#define START_UTC_S 1790000000 //Sep 2026
+
+static uint64_t utc_ms(Timestamp timestamp) {
+	return (uint64_t)timestamp.utc_s * 1000 + timestamp.utc_ms;
+}
+
+static void test_holdover_past_signed_overflow(void) {
+	shim_tick_ms = 5000;
+	time_set_utc(START_UTC_S, 250, shim_tick_ms, TIME_SOURCE_PI);
+	uint64_t start_ms = (uint64_t)START_UTC_S * 1000 + 250;
+
+	//30 days in one go, nothing calling time_now() in between
+	shim_tick_ms += 30 * DAY_MS;
+	Timestamp now = time_now();
+	CHECK_EQ(now.source, TIME_SOURCE_PI);
+	CHECK_EQ(utc_ms(now), start_ms + 30 * DAY_MS);
+}
+
+static void test_holdover_past_tick_wrap(void) {
+	shim_tick_ms = UINT32_MAX - 10000;
+	time_set_utc(START_UTC_S, 0, shim_tick_ms, TIME_SOURCE_PI);
+	uint64_t start_ms = (uint64_t)START_UTC_S * 1000;
+
+	//120 days, the state machine loop reading the time every 30 s (sampled here every hour)
+	uint64_t elapsed_ms = 0;
+	for (int hour = 0; hour < 120 * 24; hour++) {
+		shim_tick_ms += 60 * 60 * 1000;
+		elapsed_ms += 60 * 60 * 1000;
+		Timestamp now = time_now();
+		if (utc_ms(now) != start_ms + elapsed_ms) {
+			CHECK_EQ(utc_ms(now), start_ms + elapsed_ms);
+			break;
+		}
+	}
+	CHECK_EQ(utc_ms(time_now()), start_ms + 120 * DAY_MS);
+}
+
+static void test_rate_correction_over_holdover(void) {
+	//a HAL tick 100 ppm slow, measured by GPS syncs 20 min apart
+	const double tick_ppm = 100;
+	uint64_t utc_start_ms = (uint64_t)(START_UTC_S + 1000000) * 1000;
+	uint32_t tick = 1000;
+	shim_tick_ms = tick;
+	for (int i = 0; i < 4; i++) {
+		uint64_t utc_now_ms = utc_start_ms + (uint64_t)i * 20 * 60 * 1000;
+		tick = 1000 + (uint32_t)((utc_now_ms - utc_start_ms) / (1 + tick_ppm * 1e-6));
+		shim_tick_ms = tick;
+		time_set_utc(utc_now_ms / 1000, utc_now_ms % 1000, tick, TIME_SOURCE_GPS);
+	}
+	CHECK_NEAR(time_get_stats()->tick_rate_ppm, tick_ppm, 2);
+
+	//GPS off for 40 days: 346 s of tick error corrected
+	uint64_t last_sync_ms = utc_start_ms + 3 * 20 * 60 * 1000;
+	shim_tick_ms = tick + (uint32_t)(40 * DAY_MS / (1 + tick_ppm * 1e-6));
+	CHECK_NEAR((double)utc_ms(time_now()), (double)(last_sync_ms + 40 * DAY_MS), 40 * DAY_MS * 2e-6);
+}
+
+static void test_stale_sync(void) {
+	shim_tick_ms = 200000;
+	time_set_utc(START_UTC_S, 0, shim_tick_ms, TIME_SOURCE_PI);
+	uint32_t syncs = time_get_stats()->syncs;
+
+	//a GPS time from just before the Pi sync, handed over later
+	shim_tick_ms += 50;
+	time_set_utc(START_UTC_S + 3600, 0, shim_tick_ms - 100, TIME_SOURCE_GPS);
+	CHECK_EQ(time_get_stats()->syncs, syncs);
+	CHECK_EQ(time_now().source, TIME_SOURCE_PI);
+	CHECK_EQ(utc_ms(time_now()), (uint64_t)START_UTC_S * 1000 + 50);
+
+	//the next one is used
+	shim_tick_ms += 1000;
+	time_set_utc(START_UTC_S + 3600, 0, shim_tick_ms, TIME_SOURCE_GPS);
+	CHECK_EQ(time_get_stats()->syncs, syncs + 1);
+	CHECK_EQ(time_now().source, TIME_SOURCE_GPS);
+	CHECK_EQ(utc_ms(time_now()), (uint64_t)(START_UTC_S + 3600) * 1000);
+}
+
+int main(void) {
+	time_init();
+	RUN(test_holdover_past_signed_overflow);
+	RUN(test_holdover_past_tick_wrap);
+	RUN(test_rate_correction_over_holdover);
+	RUN(test_stale_sync);
+	return test_report();
+}
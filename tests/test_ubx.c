@@ -0,0 +1,256 @@
+/*
+ * test_ubx.c
+ *
+ *  Created on: Oct 19, 2026
+ *
+ * UBX framing, message builders and the byte at a time parser (Recovery Src/Ubx.c).
+ */
+
+#include "test.h"
+#include "Recovery Inc/Ubx.h"
+
+#define FRAME_BUFFER_SIZE 256
+
+//Feeds bytes to the parser, returns the number of complete frames (the last one is left in the parser buffer)
+static int parse_all(UbxParser *parser, const uint8_t *data, size_t length, int *errors) {
+	int frames = 0;
+	for (size_t i = 0; i < length; i++) {
+		UbxParseResult result = ubx_parser_push(parser, data[i]);
+		frames += (result == UBX_PARSE_COMPLETE);
+		if (errors != NULL) {
+			*errors += (result == UBX_PARSE_ERROR);
+		}
+	}
+	return frames;
+}
+
+static void test_checksum_known_frames(void) {
+	//UBX-ACK-ACK of a CFG-VALSET and UBX-CFG-MSG, checksums from the interface description examples
+	const uint8_t ack[] = {0x05, 0x01, 0x02, 0x00, 0x06, 0x8A};
+	const uint8_t cfg_msg[] = {0x06, 0x01, 0x03, 0x00, 0xF0, 0x01, 0x00};
+	uint8_t ck_a, ck_b;
+
+	ubx_checksum(ack, sizeof(ack), &ck_a, &ck_b);
+	CHECK_EQ(ck_a, 0x98);
+	CHECK_EQ(ck_b, 0xC1);
+	ubx_checksum(cfg_msg, sizeof(cfg_msg), &ck_a, &ck_b);
+	CHECK_EQ(ck_a, 0xFB);
+	CHECK_EQ(ck_b, 0x11);
+}
+
+static void test_build_frame(void) {
+	const uint8_t payload[] = {0x06, 0x8A};
+	const uint8_t expected[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x8A, 0x98, 0xC1};
+	uint8_t frame[FRAME_BUFFER_SIZE];
+
+	CHECK_EQ(ubx_build_frame(frame, sizeof(frame), UBX_CLASS_ACK, UBX_ID_ACK_ACK, payload, sizeof(payload)), sizeof(expected));
+	CHECK_MEM(frame, expected, sizeof(expected));
+
+	//exactly fits, then one byte short
+	CHECK_EQ(ubx_build_frame(frame, sizeof(expected), UBX_CLASS_ACK, UBX_ID_ACK_ACK, payload, sizeof(payload)), sizeof(expected));
+	CHECK_EQ(ubx_build_frame(frame, sizeof(expected) - 1, UBX_CLASS_ACK, UBX_ID_ACK_ACK, payload, sizeof(payload)), 0);
+
+	//payload built in place
+	frame[UBX_HEADER_LENGTH] = 0x06;
+	frame[UBX_HEADER_LENGTH + 1] = 0x8A;
+	CHECK_EQ(ubx_build_frame(frame, sizeof(frame), UBX_CLASS_ACK, UBX_ID_ACK_ACK, &frame[UBX_HEADER_LENGTH], 2), sizeof(expected));
+	CHECK_MEM(frame, expected, sizeof(expected));
+}
+
+static void test_build_valset(void) {
+	const UbxConfigItem items[] = {
+		{UBX_CFG_UART1OUTPROT_NMEA, 0},				//1 bit, sent as a byte
+		{UBX_CFG_MSGOUT_UBX_NAV_PVT_UART1, 1},		//U1
+		{UBX_CFG_RATE_MEAS, 1000},					//U2
+		{UBX_CFG_UART1_BAUDRATE, 115200},			//U4
+	};
+	const uint8_t expected_payload[] = {
+		0x00, UBX_CFG_LAYER_RAM | UBX_CFG_LAYER_BBR, 0x00, 0x00,
+		0x02, 0x00, 0x74, 0x10, 0x00,
+		0x07, 0x00, 0x91, 0x20, 0x01,
+		0x01, 0x00, 0x21, 0x30, 0xE8, 0x03,
+		0x01, 0x00, 0x52, 0x40, 0x00, 0xC2, 0x01, 0x00,
+	};
+	uint8_t frame[FRAME_BUFFER_SIZE];
+
+	size_t length = ubx_build_valset(frame, sizeof(frame), UBX_CFG_LAYER_RAM | UBX_CFG_LAYER_BBR, items, 4);
+	CHECK_EQ(length, sizeof(expected_payload) + UBX_FRAME_OVERHEAD);
+	CHECK(ubx_frame_is(frame, length, UBX_CLASS_CFG, UBX_ID_CFG_VALSET));
+	CHECK_EQ(frame[4] | (frame[5] << 8), sizeof(expected_payload));
+	CHECK_MEM(&frame[UBX_HEADER_LENGTH], expected_payload, sizeof(expected_payload));
+
+	uint8_t ck_a, ck_b;
+	ubx_checksum(&frame[2], length - 4, &ck_a, &ck_b);
+	CHECK_EQ(frame[length - 2], ck_a);
+	CHECK_EQ(frame[length - 1], ck_b);
+
+	//no room for the last value
+	CHECK_EQ(ubx_build_valset(frame, length - 1, UBX_CFG_LAYER_RAM, items, 4), 0);
+
+	//8 byte values aren't supported
+	const UbxConfigItem wide = {0x50000001, 0};
+	CHECK_EQ(ubx_build_valset(frame, sizeof(frame), UBX_CFG_LAYER_RAM, &wide, 1), 0);
+
+	//more than a VALSET can hold
+	static UbxConfigItem many[UBX_CFG_VALSET_MAX_ITEMS + 1];
+	static uint8_t large_frame[1024];
+	for (size_t i = 0; i < UBX_CFG_VALSET_MAX_ITEMS + 1; i++) {
+		many[i] = (UbxConfigItem){UBX_CFG_MSGOUT_NMEA_GGA_UART1, 0};
+	}
+	CHECK(ubx_build_valset(large_frame, sizeof(large_frame), UBX_CFG_LAYER_RAM, many, UBX_CFG_VALSET_MAX_ITEMS) != 0);
+	CHECK_EQ(ubx_build_valset(large_frame, sizeof(large_frame), UBX_CFG_LAYER_RAM, many, UBX_CFG_VALSET_MAX_ITEMS + 1), 0);
+}
+
+static void test_build_pmreq(void) {
+	uint8_t frame[FRAME_BUFFER_SIZE];
+	size_t length = ubx_build_pmreq(frame, sizeof(frame), 0x12345678, UBX_RXM_PMREQ_FLAGS_BACKUP | UBX_RXM_PMREQ_FLAGS_FORCE,
+			UBX_RXM_PMREQ_WAKEUP_UARTRX | UBX_RXM_PMREQ_WAKEUP_EXTINT0);
+
+	CHECK_EQ(length, UBX_RXM_PMREQ_PAYLOAD_LENGTH + UBX_FRAME_OVERHEAD);
+	CHECK(ubx_frame_is(frame, length, UBX_CLASS_RXM, UBX_ID_RXM_PMREQ));
+	const uint8_t *payload = &frame[UBX_HEADER_LENGTH];
+	const uint8_t expected[UBX_RXM_PMREQ_PAYLOAD_LENGTH] = {
+		0x00, 0x00, 0x00, 0x00,
+		0x78, 0x56, 0x34, 0x12,
+		0x06, 0x00, 0x00, 0x00,
+		0x28, 0x00, 0x00, 0x00,
+	};
+	CHECK_MEM(payload, expected, sizeof(expected));
+}
+
+static size_t build_nav_pvt(uint8_t *frame, size_t frame_size, const UbxNavPvt *pvt) {
+	return ubx_build_frame(frame, frame_size, UBX_CLASS_NAV, UBX_ID_NAV_PVT, (const uint8_t *)pvt, sizeof(*pvt));
+}
+
+static void test_nav_pvt_round_trip(void) {
+	CHECK_EQ(sizeof(UbxNavPvt), UBX_NAV_PVT_PAYLOAD_LENGTH);
+
+	UbxNavPvt sent = {
+		.iTOW = 123456789, .year = 2026, .month = 10, .day = 19, .hour = 12, .min = 34, .sec = 56,
+		.valid = UBX_NAV_PVT_VALID_DATE | UBX_NAV_PVT_VALID_TIME | UBX_NAV_PVT_VALID_FULLY_RESOLVED,
+		.fixType = UBX_FIX_3D, .flags = UBX_NAV_PVT_FLAGS_GNSS_FIX_OK, .numSV = 11,
+		.lon = -613700000, .lat = 153000000, .hMSL = -1234, .hAcc = 2500, .gSpeed = 850, .headMot = 27000000,
+		.pDOP = 123,
+	};
+	uint8_t frame[FRAME_BUFFER_SIZE];
+	size_t length = build_nav_pvt(frame, sizeof(frame), &sent);
+	CHECK_EQ(length, UBX_NAV_PVT_FRAME_LENGTH);
+
+	//little-endian on the wire, whatever the host
+	CHECK_EQ(frame[UBX_HEADER_LENGTH + 0], 0x15);
+	CHECK_EQ(frame[UBX_HEADER_LENGTH + 3], 0x07);
+
+	uint8_t buffer[FRAME_BUFFER_SIZE];
+	UbxParser parser;
+	ubx_parser_reset(&parser, buffer, sizeof(buffer));
+	CHECK_EQ(parse_all(&parser, frame, length, NULL), 1);
+
+	UbxNavPvt received;
+	CHECK(ubx_decode_nav_pvt(buffer, parser.payload_length + UBX_FRAME_OVERHEAD, &received));
+	CHECK_EQ(received.iTOW, sent.iTOW);
+	CHECK_EQ(received.year, 2026);
+	CHECK_EQ(received.lat, sent.lat);
+	CHECK_EQ(received.lon, sent.lon);
+	CHECK_EQ(received.hMSL, sent.hMSL);
+	CHECK_EQ(received.numSV, 11);
+	CHECK_EQ(received.pDOP, 123);
+
+	//wrong length or message
+	CHECK(!ubx_decode_nav_pvt(buffer, UBX_NAV_PVT_FRAME_LENGTH - 1, &received));
+	buffer[3] = UBX_ID_MGA_INI;
+	CHECK(!ubx_decode_nav_pvt(buffer, UBX_NAV_PVT_FRAME_LENGTH, &received));
+}
+
+static void test_parser_resynchronises(void) {
+	const uint8_t ack[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x06, 0x8A, 0x98, 0xC1};
+	uint8_t buffer[FRAME_BUFFER_SIZE];
+	UbxParser parser;
+	ubx_parser_reset(&parser, buffer, sizeof(buffer));
+
+	//NMEA and repeated sync characters ahead of the frame
+	const char *nmea = "$GNGGA,,,,,,0,00,99.99,,,,,,*56\r\n";
+	CHECK_EQ(parse_all(&parser, (const uint8_t *)nmea, strlen(nmea), NULL), 0);
+	const uint8_t syncs[] = {0xB5, 0xB5};
+	CHECK_EQ(parse_all(&parser, syncs, sizeof(syncs), NULL), 0);
+	CHECK_EQ(parse_all(&parser, &ack[1], sizeof(ack) - 1, NULL), 1);
+	CHECK_MEM(buffer, ack, sizeof(ack));
+
+	//a corrupted checksum is an error, the next frame still parses
+	uint8_t corrupted[sizeof(ack)];
+	memcpy(corrupted, ack, sizeof(ack));
+	corrupted[6] ^= 0x01;
+	int errors = 0;
+	CHECK_EQ(parse_all(&parser, corrupted, sizeof(corrupted), &errors), 0);
+	CHECK(errors >= 1);
+	CHECK_EQ(parse_all(&parser, ack, sizeof(ack), NULL), 1);
+
+	//a frame larger than the buffer is dropped at its length
+	UbxParser small;
+	uint8_t small_buffer[16];
+	ubx_parser_reset(&small, small_buffer, sizeof(small_buffer));
+	uint8_t frame[FRAME_BUFFER_SIZE];
+	UbxNavPvt pvt = {0};
+	size_t length = build_nav_pvt(frame, sizeof(frame), &pvt);
+	errors = 0;
+	CHECK_EQ(parse_all(&small, frame, length, &errors), 0);
+	CHECK(errors >= 1);
+	CHECK_EQ(parse_all(&small, ack, sizeof(ack), NULL), 1);
+
+	//empty payload
+	uint8_t empty[UBX_FRAME_OVERHEAD];
+	CHECK_EQ(ubx_build_frame(empty, sizeof(empty), UBX_CLASS_NAV, UBX_ID_NAV_PVT, NULL, 0), UBX_FRAME_OVERHEAD);
+	CHECK_EQ(parse_all(&parser, empty, sizeof(empty), NULL), 1);
+	CHECK_EQ(parser.payload_length, 0);
+}
+
+//Frames mixed with noise: every frame comes out, and never a frame with a wrong checksum
+static void test_parser_random_stream(void) {
+	test_random_seed(26);
+	static uint8_t stream[64 * 1024];
+	size_t stream_length = 0;
+	int frames_sent = 0;
+
+	while (stream_length < sizeof(stream) - 2 * FRAME_BUFFER_SIZE) {
+		if (test_random_below(3) == 0) {
+			//noise, without sync characters so that it can't swallow the next frame
+			size_t noise = test_random_below(40);
+			for (size_t i = 0; i < noise; i++) {
+				uint8_t byte = test_random();
+				stream[stream_length++] = (byte == UBX_SYNC_CHAR_1) ? 0x00 : byte;
+			}
+		}
+		uint8_t payload[100];
+		uint16_t payload_length = test_random_below(sizeof(payload));
+		for (size_t i = 0; i < payload_length; i++) {
+			payload[i] = test_random();
+		}
+		stream_length += ubx_build_frame(&stream[stream_length], sizeof(stream) - stream_length, test_random(), test_random(), payload, payload_length);
+		frames_sent++;
+	}
+
+	uint8_t buffer[FRAME_BUFFER_SIZE];
+	UbxParser parser;
+	ubx_parser_reset(&parser, buffer, sizeof(buffer));
+	int frames_received = 0;
+	for (size_t i = 0; i < stream_length; i++) {
+		if (ubx_parser_push(&parser, stream[i]) == UBX_PARSE_COMPLETE) {
+			uint8_t ck_a, ck_b;
+			size_t length = parser.payload_length + UBX_FRAME_OVERHEAD;
+			ubx_checksum(&buffer[2], length - 4, &ck_a, &ck_b);
+			CHECK((buffer[length - 2] == ck_a) && (buffer[length - 1] == ck_b));
+			frames_received++;
+		}
+	}
+	CHECK_EQ(frames_received, frames_sent);
+}
+
+int main(void) {
+	RUN(test_checksum_known_frames);
+	RUN(test_build_frame);
+	RUN(test_build_valset);
+	RUN(test_build_pmreq);
+	RUN(test_nav_pvt_round_trip);
+	RUN(test_parser_resynchronises);
+	RUN(test_parser_random_stream);
+	return test_report();
+}
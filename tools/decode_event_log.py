@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""Decodes the recovery board's event log (see Core/Inc/Lib Inc/event_log.h) into CSV or GPX.
+
+The input is the log as downloaded with PI_COMM_MSG_LOG_READ: the data of the PI_COMM_MSG_LOG_DATA messages,
+written at their offset in the file (or simply appended in order, when no part of the log was skipped).
+
+    decode_event_log.py log.bin                 # CSV of every record on stdout
+    decode_event_log.py --gpx log.bin > track.gpx
+"""
+
+import argparse
+import csv
+import datetime
+import struct
+import sys
+
+MAGIC = 0x474F4C45
+PAGE_SIZE = 1 << 13
+HEADER = struct.Struct("<IIII")
+
+FIX, TX, STATE, BATTERY, TIME, BOOT = range(1, 7)
+PADDING = 0xFF
+RECORD_NAMES = {FIX: "fix", TX: "tx", STATE: "state", BATTERY: "battery", TIME: "time", BOOT: "boot"}
+STATE_NAMES = {0: "critical", 1: "waiting", 2: "aprs", 3: "gps_collect", 4: "fishtracker"}
+DEGREES_SCALE = 1e5
+
+
+class Reader:
+    def __init__(self, data, position, end):
+        self.data = data
+        self.position = position
+        self.end = end
+
+    def byte(self):
+        if self.position >= self.end:
+            raise EOFError
+        value = self.data[self.position]
+        self.position += 1
+        return value
+
+    def varint(self):
+        value = 0
+        for shift in range(0, 35, 7):
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            if not byte & 0x80:
+                return value
+        raise ValueError("varint too long")
+
+    def signed(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def find_pages(data):
+    """Yields (sequence, start, end) of every page header found on a quad-word boundary."""
+    pages = []
+    for start in range(0, len(data) - HEADER.size + 1, 16):
+        magic, sequence, monotonic_s, check = HEADER.unpack_from(data, start)
+        if magic == MAGIC and check == (~sequence & 0xFFFFFFFF):
+            pages.append((sequence, monotonic_s, start))
+    for index, (sequence, monotonic_s, start) in enumerate(pages):
+        end = pages[index + 1][2] if index + 1 < len(pages) else len(data)
+        yield sequence, monotonic_s, start, min(end, start + PAGE_SIZE)
+
+
+def decode(data):
+    """Yields a dict per record, in log order."""
+    boot = 0
+    for sequence, monotonic_s, start, end in find_pages(data):
+        reader = Reader(data, start + HEADER.size, end)
+        time_s = monotonic_s
+        utc_offset = None
+        latitude = longitude = battery_mV = 0
+        while True:
+            try:
+                record = reader.byte()
+                if record == PADDING:
+                    continue
+                delta = reader.varint()
+                if record == BOOT:
+                    boot += 1
+                    time_s = delta
+                    utc_offset = None
+                    latitude = longitude = battery_mV = 0
+                else:
+                    time_s += delta
+                entry = {"page": sequence, "boot": boot, "monotonic_s": time_s, "record": RECORD_NAMES.get(record, record)}
+
+                if record == FIX:
+                    latitude += reader.signed()
+                    longitude += reader.signed()
+                    entry.update(latitude=latitude / DEGREES_SCALE, longitude=longitude / DEGREES_SCALE,
+                                 satellites=reader.byte(), hdop=reader.byte() / 10)
+                elif record == TX:
+                    entry["on_air_ms"] = reader.varint()
+                elif record == STATE:
+                    state = reader.byte()
+                    entry["state"] = STATE_NAMES.get(state, state)
+                elif record == BATTERY:
+                    battery_mV += reader.signed()
+                    entry["battery_mV"] = battery_mV
+                elif record == TIME:
+                    utc_offset = reader.varint()
+                elif record != BOOT:
+                    print(f"page {sequence}: unknown record 0x{record:02X}, skipping the rest", file=sys.stderr)
+                    break
+            except EOFError:
+                break
+
+            if utc_offset is not None:
+                utc = datetime.datetime.fromtimestamp((time_s + utc_offset) & 0xFFFFFFFF, datetime.timezone.utc)
+                entry["utc"] = utc.strftime("%Y-%m-%dT%H:%M:%SZ")
+            yield entry
+
+
+def write_csv(records, output):
+    fields = ["page", "boot", "monotonic_s", "utc", "record", "latitude", "longitude", "satellites", "hdop",
+              "on_air_ms", "state", "battery_mV"]
+    writer = csv.DictWriter(output, fieldnames=fields, extrasaction="ignore")
+    writer.writeheader()
+    for record in records:
+        if record["record"] != "time":
+            writer.writerow(record)
+
+
+def write_gpx(records, output):
+    output.write('<?xml version="1.0" encoding="UTF-8"?>\n'
+                 '<gpx version="1.1" creator="decode_event_log.py" xmlns="http://www.topografix.com/GPX/1/1">\n'
+                 '<trk><name>Whale tag recovery board</name>\n')
+    boot = None
+    for record in records:
+        if record["record"] != "fix":
+            continue
+        #one segment per boot, times don't carry over a reset
+        if record["boot"] != boot:
+            if boot is not None:
+                output.write("</trkseg>\n")
+            output.write("<trkseg>\n")
+            boot = record["boot"]
+        output.write(f'<trkpt lat="{record["latitude"]:.5f}" lon="{record["longitude"]:.5f}">')
+        if "utc" in record:
+            output.write(f'<time>{record["utc"]}</time>')
+        output.write(f'<sat>{record["satellites"]}</sat><hdop>{record["hdop"]:.1f}</hdop></trkpt>\n')
+    if boot is not None:
+        output.write("</trkseg>\n")
+    output.write("</trk>\n</gpx>\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", type=argparse.FileType("rb"))
+    parser.add_argument("--gpx", action="store_true", help="write the fixes as a GPX track instead of CSV")
+    args = parser.parse_args()
+
+    records = decode(args.log.read())
+    if args.gpx:
+        write_gpx(records, sys.stdout)
+    else:
+        write_csv(records, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()